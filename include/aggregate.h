@@ -0,0 +1,81 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include <stdint.h>
+#include "message.h"
+
+/* Optional per-source downsampling at the gateway. A reading whose text is
+   a plain number (e.g. "23.5") is folded into its source's open window
+   instead of being uploaded. The window is summarized as count, min, max,
+   mean and last, and handed to the emit callback as one record when it
+   holds windowCount readings or windowMs has passed since its first
+   reading, whichever comes first. Non-numeric readings and sources marked
+   pass-through (AGGREGATE_PASSTHROUGH) still go up raw. A source holds an
+   entry only while its window is open or it is marked, so a quiet source
+   gives its entry back and only sources beyond AGGREGATE_SOURCES open
+   windows at once go up raw. Belongs to the uplink stage. */
+
+#ifndef AGGREGATE_SOURCES
+#define AGGREGATE_SOURCES 32 // Sources with an Open Window (or a Pass-Through Mark)
+#endif
+
+#ifndef AGGREGATE_PASSTHROUGH
+#define AGGREGATE_PASSTHROUGH "" // Sources Always Uploaded Raw: "aa:bb:cc:dd:ee:ff,..."
+#endif
+
+#ifndef AGGREGATE_WINDOW_MS
+#define AGGREGATE_WINDOW_MS 0 // Time Window (0 -> none)
+#endif
+
+#ifndef AGGREGATE_WINDOW_COUNT
+#define AGGREGATE_WINDOW_COUNT 0 // Readings per Window (0 -> none). Both 0 -> aggregation off
+#endif
+
+typedef struct {
+  uint8_t source[MAC_SIZE];
+  uint32_t count;
+  double min;
+  double max;
+  double mean;
+  double last;
+  uint32_t firstMs; // First Reading in the Window
+  uint32_t lastMs; // Latest Reading in the Window
+  int32_t lastPacketID;
+} aggregate_summary_t;
+
+// Summary of a closed window. Returns false if it could not be queued
+typedef bool (*aggregate_emit_fn)(const aggregate_summary_t *summary, uint32_t now);
+
+typedef struct {
+  uint32_t readings; // Readings Folded into Windows
+  uint32_t summaries; // Windows Emitted
+  uint32_t raw; // Readings Passed Through (non-numeric, marked or no slot)
+  uint32_t lost; // Summaries the Emit Callback Refused
+} aggregate_stats_t;
+
+void Aggregate_Init(aggregate_emit_fn emit);
+
+// Change the window (open windows are flushed first)
+void Aggregate_Configure(uint32_t windowMs, uint32_t windowCount);
+
+// Always upload source's readings raw (or stop doing so)
+bool Aggregate_Set_Passthrough(const uint8_t *source, bool passthrough);
+
+// Mark every source in a comma-separated MAC list pass-through. Returns the count marked, or -1 if the list is malformed or too long
+int Aggregate_Set_Passthrough_List(const char *list);
+
+// Parse a reading as a finite number. False for anything else
+bool Aggregate_Parse(const unsigned char *text, size_t max, double *value);
+
+// Fold msg into its source's window. False -> upload it raw
+bool Aggregate_Add(const message_t *msg, uint32_t now);
+
+// Emit windows whose time is up
+void Aggregate_Poll(uint32_t now);
+
+// Emit every open window
+void Aggregate_Flush(uint32_t now);
+
+const aggregate_stats_t *Aggregate_Get_Stats();
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "log.h"
+#include "message.h"
+
+/* Raw receive capture. Every frame On_Data_Receive gets (malformed ones
+   included) is copied into a lock-free ring from the receive callback and
+   written out later, from loop(), to a byte sink: a TCP client on
+   CAPTURE_PORT or the Serial port on the device, a file on the host.
+
+   Stream format (little endian):
+     header  "ENCP" | version (1) | reserved (1) | gateway MAC  12 bytes
+     record  delta_us (4) | sender MAC (6) | len (1) | bytes     11 + len
+   delta_us is the time since the previous captured frame; a reader
+   starts its clock at the first record and ignores that record's delta.
+   The gateway MAC lets a replay answer as the gateway that was captured.
+   Frames that arrive while the ring is full are counted, not written. */
+
+#define CAPTURE_OFF 0
+#define CAPTURE_TCP 1 // Stream to One Client on CAPTURE_PORT (nc <gateway> 9102 > capture.bin)
+#define CAPTURE_SERIAL 2 // Binary on the Console (build with LOG_LEVEL=0)
+
+#ifndef CAPTURE_SINK
+#define CAPTURE_SINK CAPTURE_OFF
+#endif
+
+#if CAPTURE_SINK == CAPTURE_SERIAL && LOG_LEVEL > 0
+#error "CAPTURE_SERIAL shares the console with the log drainer: build with -DLOG_LEVEL=0"
+#endif
+
+#ifndef CAPTURE_PORT
+#define CAPTURE_PORT 9102
+#endif
+
+#ifndef CAPTURE_RING_SIZE
+#define CAPTURE_RING_SIZE 32 // Frames Buffered (power of two)
+#endif
+
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_SIZE 12
+#define CAPTURE_RECORD_HEADER_SIZE 11
+#define CAPTURE_RECORD_MAX (CAPTURE_RECORD_HEADER_SIZE + ESPNOW_MTU)
+
+typedef struct {
+  uint32_t deltaUs; // Since the Previous Frame
+  uint8_t mac[MAC_SIZE];
+  uint8_t len;
+  uint8_t data[ESPNOW_MTU];
+} capture_frame_t;
+
+// Sink: accept up to len bytes, return how many were taken
+typedef size_t (*capture_write_fn)(const uint8_t *data, size_t len);
+
+typedef struct {
+  uint32_t captured; // Frames Queued
+  uint32_t dropped; // Frames Lost to a Full Ring (none are Counted while no Sink is Set: Capture is Off)
+  uint32_t written; // Records Fully Written
+} capture_stats_t;
+
+// self is this gateway's MAC, written into every stream header
+void Capture_Init(capture_write_fn write, const uint8_t *self);
+
+// Receive callback side: queue one frame
+void Capture_Frame(const uint8_t *mac, const uint8_t *data, int len, uint32_t nowUs);
+
+// Begin a new stream (file opened or client connected): the header goes out first
+void Capture_Start_Stream();
+
+// Consumer side: write queued records until the sink stops taking bytes
+void Capture_Drain();
+
+// Validate a stream header and return the captured gateway's MAC
+bool Capture_Check_Header(const uint8_t *buf, size_t len, uint8_t *gateway);
+
+// Decode one record from buf. Returns bytes consumed, 0 if incomplete
+size_t Capture_Parse(const uint8_t *buf, size_t len, capture_frame_t *frame);
+
+capture_stats_t Capture_Get_Stats();
+
+#endif
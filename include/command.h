@@ -0,0 +1,96 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+
+/* Downlink command channel. The server keeps one TCP connection open to
+   COMMAND_PORT on ETH and writes one command per line:
+     <id> <node MAC aa:bb:cc:dd:ee:ff> <text>
+   id is the server's own tag (decimal, up to 32 bits). text is at most
+   COMMAND_TEXT_MAX bytes. Each command is answered with exactly one line
+   on the same connection:
+     <id> delivered <us>   node acked; us is line received -> ack received
+     <id> failed <us>      no ack after MAX_TRIES transmissions
+     <id> noroute          node has never sent data, so no path is known
+     <id> busy             too many commands in flight; send it again later
+     <id> malformed        line did not parse (id 0 if the id did not)
+
+   Lines are parsed in loop() and handed to the route stage through a
+   lock-free ring. The route stage sends them and reports the outcomes
+   through a second ring, which loop() writes back to the client. */
+
+#ifndef COMMAND_PORT
+#define COMMAND_PORT 9103 // Command Client Port on ETH (0 -> disabled)
+#endif
+
+#ifndef COMMAND_QUEUE_SIZE
+#define COMMAND_QUEUE_SIZE 8 // Commands Waiting for the Route Stage (power of two)
+#endif
+
+#ifndef COMMAND_PENDING
+#define COMMAND_PENDING 8 // Commands Awaiting their Node's Ack
+#endif
+
+#define COMMAND_TEXT_MAX 63 // Fits message_t.text
+#define COMMAND_LINE_MAX 96 // id, MAC, text and spaces
+#define COMMAND_REPORT_MAX 40 // Longest Report Line, with its terminator
+
+enum command_status {
+  COMMAND_DELIVERED,
+  COMMAND_FAILED,
+  COMMAND_NO_ROUTE,
+  COMMAND_BUSY,
+  COMMAND_MALFORMED,
+};
+
+typedef struct {
+  uint32_t id; // Server's Tag
+  uint8_t mac[MAC_SIZE]; // Target Node
+  uint32_t received; // Line Parsed (us)
+  char text[COMMAND_TEXT_MAX + 1];
+} command_t;
+
+// Client stream: read up to cap bytes / write up to len bytes without blocking, return the count
+typedef size_t (*command_read_fn)(uint8_t *data, size_t cap);
+typedef size_t (*command_write_fn)(const uint8_t *data, size_t len);
+
+typedef struct {
+  uint32_t received; // Lines Queued for the Route Stage
+  uint32_t sent; // Handed to the Reliable Engine
+  /* Outcomes, counted as their reports are written */
+  uint32_t delivered;
+  uint32_t failed;
+  uint32_t noRoute;
+  uint32_t busy;
+  uint32_t malformed;
+  uint32_t reportsDropped; // Outcomes Lost to a Full Report Ring
+  uint64_t latency; // Sum of received -> Ack over delivered commands
+  uint32_t lastLatency;
+} command_stats_t;
+
+void Command_Init(command_read_fn read, command_write_fn write);
+
+// New client: forget any partial line and unsent report text
+void Command_Start_Stream();
+
+// loop() side: read and queue new commands, write back outcomes. Returns commands queued
+int Command_Service(uint32_t nowUs);
+
+// Route stage side: next queued command, once a pending slot is free to track it
+bool Command_Next(command_t *command);
+
+// Route stage side: command is on its way as packetID
+void Command_Sent(const command_t *command, int32_t packetID);
+
+// Route stage side: command never left the gateway (COMMAND_NO_ROUTE / COMMAND_BUSY)
+void Command_Rejected(const command_t *command, command_status status);
+
+// Route stage side: node acked packetID / the reliable engine gave up on it. True if it was a command
+bool Command_On_Ack(const uint8_t *node, int32_t packetID, uint32_t nowUs);
+bool Command_On_Failed(const uint8_t *node, int32_t packetID, uint32_t nowUs);
+
+const command_stats_t *Command_Get_Stats();
+
+#endif
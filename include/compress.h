@@ -0,0 +1,33 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Gzip (RFC 1952) for uplink batches, small enough for the ESP32. The whole
+   batch is in memory, so the input itself is the LZ77 window: the encoder
+   keeps only a hash table of the last position each 3-byte prefix was
+   seen (2^COMPRESS_HASH_BITS 16-bit entries) and emits one deflate block
+   with the fixed Huffman code. No allocation; the caller owns the output
+   buffer. Any HTTP server or gzip tool can decode the result. Not
+   reentrant (one static hash table). */
+
+#ifndef COMPRESS_HASH_BITS
+#define COMPRESS_HASH_BITS 11 // 4 KB Hash Table
+#endif
+
+#define COMPRESS_MAX_INPUT 65535 // Positions are 16-bit
+
+typedef struct {
+  uint32_t batches; // Inputs Compressed
+  uint32_t skipped; // Did not Shrink (sent raw)
+  uint64_t bytesIn;
+  uint64_t bytesOut;
+} compress_stats_t;
+
+// Gzip in into out. Returns the compressed length, or 0 if it would not be smaller than cap
+size_t Compress_Gzip(const uint8_t *in, size_t len, uint8_t *out, size_t cap);
+
+const compress_stats_t *Compress_Get_Stats();
+
+#endif
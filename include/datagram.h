@@ -0,0 +1,133 @@
+#ifndef DATAGRAM_H
+#define DATAGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "uplink.h"
+
+/* Sequenced datagram uplink: a lighter transport than one HTTP POST per
+   batch, with no request headers and no waiting on each response.
+
+   Each batch travels as one UDP datagram behind a 14 byte header. Seqs
+   run from 1 within a session, which is random per boot, so the
+   receiver can tell a restart from a repeat. The receiver answers every
+   datagram with a cumulative ack: the highest seq up to which it holds
+   every datagram of the session. Up to DATAGRAM_WINDOW batches may be
+   unacknowledged at once, so batches go out back to back. A batch
+   unacknowledged after its timeout is sent again (the timeout doubles
+   each time). After DATAGRAM_TRIES sends it goes to the failed callback,
+   and the gateway spools it there. The window holds each batch as it was
+   handed in and frames it again for every send, gzipped when asked, so a
+   batch given up on leaves as it came and replay may compress it afresh.
+   Batches in the window share one DATAGRAM_BUFFER_BYTES buffer rather than
+   a full batch buffer each; the window takes another batch only while a
+   whole UPLINK_BATCH_BYTES still fits, so a send once ready never fails
+   for room. Typical batches of a few KB keep all DATAGRAM_WINDOW in use.
+
+   A seq given up on never arrives, so every datagram also carries a floor:
+   the seq below which the sender waits on nothing. The receiver moves its
+   cumulative ack up to the floor, which steps it past a hole, and a
+   receiver that restarted (and knows no session) starts from there. Only
+   the oldest batch is ever given up, and a bodiless DATAGRAM_SKIP goes
+   out at once, so batches held behind the hole get acked rather than
+   running out of tries too. An ack
+   that goes backwards means the receiver lost its state: the window is
+   sent again at once so it learns the floor and what it is missing.
+
+   0    1     type (DATAGRAM_DATA / DATAGRAM_ACK)
+   1    1     flags (DATAGRAM_FLAG_*; 0 in acks)
+   2    4     session
+   6    4     seq (data), highest seq held in order (ack), floor (skip)
+   10   4     floor (data and skip)
+   14   ..    batch body (data only) */
+
+#ifndef UPLINK_UDP_HOST
+#define UPLINK_UDP_HOST "192.168.1.1" // Datagram Receiver (UPLINK_UDP)
+#endif
+
+#ifndef UPLINK_UDP_PORT
+#define UPLINK_UDP_PORT 5001
+#endif
+
+#ifndef DATAGRAM_WINDOW
+#define DATAGRAM_WINDOW 4 // Batches Awaiting an Ack
+#endif
+
+#ifndef DATAGRAM_TRIES
+#define DATAGRAM_TRIES 4 // Sends per Batch
+#endif
+
+#ifndef DATAGRAM_RTO_MS
+#define DATAGRAM_RTO_MS 200 // First Resend Timeout
+#endif
+
+#ifndef DATAGRAM_BUFFER_BYTES
+#define DATAGRAM_BUFFER_BYTES (2 * UPLINK_BATCH_BYTES) // Shared by the Window's Batches
+#endif
+
+#define DATAGRAM_HEADER_SIZE 14
+#define DATAGRAM_ACK_SIZE 10
+#define DATAGRAM_MAX (DATAGRAM_HEADER_SIZE + UPLINK_BATCH_BYTES)
+
+#define DATAGRAM_DATA 'D'
+#define DATAGRAM_ACK  'A'
+#define DATAGRAM_SKIP 'S' // Floor Moved by a Give-up, no Body
+
+#define DATAGRAM_FLAG_GZIP    0x01 // Body is Gzipped (to Datagram_Send: gzip it if it Shrinks)
+#define DATAGRAM_FLAG_MSGPACK 0x02 // Body is a MessagePack Array (else JSON)
+
+// Hand one datagram to the network. Returns true if the stack took it
+typedef bool (*datagram_send_fn)(const uint8_t *data, size_t len);
+// Non-blocking: length of the next datagram received (0 -> none waiting)
+typedef size_t (*datagram_recv_fn)(uint8_t *data, size_t cap);
+// Batch given up after DATAGRAM_TRIES sends
+typedef void (*datagram_failed_fn)(const uint8_t *body, size_t len);
+
+typedef struct {
+  bool used;
+  uint8_t tries;
+  uint8_t flags; // As Asked (DATAGRAM_FLAG_GZIP may be Dropped per Send)
+  uint16_t len; // Body
+  uint16_t offset; // Body in datagram_t::buffer (Uncompressed)
+  uint32_t seq;
+  uint32_t due; // Next Resend (ms)
+  uint32_t stamp; // First Sent (Metrics_Clock)
+} datagram_slot_t;
+
+typedef struct {
+  uint32_t sent; // Batches Sent (first time)
+  uint32_t acked;
+  uint32_t resent;
+  uint32_t failed; // Given up after DATAGRAM_TRIES
+  uint32_t full; // Sends Refused for a Full Window (or Buffer)
+  uint32_t stray; // Acks for Another Session or Malformed
+  uint32_t skips; // Floor Markers Sent after a Give-up
+  uint32_t resyncs; // Acks that Went Backwards (Receiver Restarted)
+} datagram_stats_t;
+
+typedef struct {
+  datagram_send_fn send;
+  datagram_recv_fn recv;
+  datagram_failed_fn failed; // NULL -> failures only counted
+  uint32_t session;
+  uint32_t nextSeq;
+  uint32_t acked; // Cumulative Ack Received
+  datagram_slot_t slots[DATAGRAM_WINDOW];
+  uint8_t buffer[DATAGRAM_BUFFER_BYTES];
+  datagram_stats_t stats;
+} datagram_t;
+
+void Datagram_Init(datagram_t *d, datagram_send_fn send, datagram_recv_fn recv, uint32_t session);
+
+// True if a batch can be sent now (a slot and room for the largest batch are free)
+bool Datagram_Can_Send(const datagram_t *d);
+
+// Frame and send one uncompressed batch. False if the window is full or the batch too big
+bool Datagram_Send(datagram_t *d, const uint8_t *body, size_t len, uint8_t flags, uint32_t now);
+
+// Take in waiting acks and resend or give up on overdue batches. Call from the uplink stage
+void Datagram_Poll(datagram_t *d, uint32_t now);
+
+uint8_t Datagram_In_Flight(const datagram_t *d);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef DEDUP_CACHE_H
+#define DEDUP_CACHE_H
+
+#include <stdint.h>
+#include "message.h"
+
+/* Fixed-memory duplicate suppression cache keyed on (source MAC, packet ID).
+   Open addressing with a bounded probe window: an entry is forgotten once it
+   is older than DEDUP_MAX_AGE_MS or when it is the oldest entry in a full
+   probe window and a new key needs the room. */
+
+#ifndef DEDUP_CACHE_SIZE
+#define DEDUP_CACHE_SIZE 256 // Entries (power of two)
+#endif
+
+#ifndef DEDUP_PROBE_LIMIT
+#define DEDUP_PROBE_LIMIT 8 // Slots searched per lookup
+#endif
+
+#ifndef DEDUP_MAX_AGE_MS
+#define DEDUP_MAX_AGE_MS 60000 // Entry Lifetime
+#endif
+
+typedef struct {
+  uint8_t mac[MAC_SIZE]; // Source MAC
+  uint8_t used; // Slot Holds an Entry
+  uint8_t reserved;
+  int32_t packetID; // Packet ID
+  uint32_t stamp; // Insert Time (ms)
+} dedup_entry_t;
+
+typedef struct {
+  dedup_entry_t slots[DEDUP_CACHE_SIZE];
+  uint32_t duplicates; // Packets Suppressed
+  uint32_t evictions; // Live Entries Overwritten Before Expiry
+} dedup_cache_t;
+
+void Dedup_Init(dedup_cache_t *cache);
+
+// Returns true if (mac, packetID) was seen within the window, else records it
+bool Dedup_Check_And_Insert(dedup_cache_t *cache, const uint8_t *mac, int32_t packetID, uint32_t now);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef FLOOD_H
+#define FLOOD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dedup_cache.h"
+#include "message.h"
+
+/* Controlled flooding of broadcast packets (destination FF:FF:FF:FF:FF:FF).
+
+   A packet heard for the first time is delivered once. If its TTL leaves
+   at least one more hop, a rebroadcast is scheduled after a random delay
+   of 0..jitter us. The rebroadcast carries TTL - 1 and has this node
+   appended to Path_Array, so the flood accumulates its path. Copies
+   heard later are recognised by the duplicate cache and only counted.
+   When k copies have been heard before the delay runs out, the
+   rebroadcast is cancelled, since enough neighbours already repeated it
+   (counter-based suppression; k 0 never cancels). */
+
+#ifndef FLOOD_PENDING
+#define FLOOD_PENDING 8 // Rebroadcasts Waiting at Once
+#endif
+
+#ifndef FLOOD_K
+#define FLOOD_K 3 // Copies Heard that Cancel a Rebroadcast (0 -> never)
+#endif
+
+#ifndef FLOOD_JITTER_US
+#define FLOOD_JITTER_US 20000 // Longest Random Rebroadcast Delay
+#endif
+
+#ifndef FLOOD_TTL
+#define FLOOD_TTL 8 // Hops for Floods this Node Starts
+#endif
+
+// Broadcast an encoded frame. Returns true if the radio accepted it
+typedef bool (*flood_send_fn)(void *ctx, const uint8_t *frame, size_t len);
+
+typedef struct {
+  bool used;
+  uint8_t copies; // Heard so Far, the First Included
+  uint8_t len;
+  uint8_t source[MAC_SIZE];
+  int32_t packetID;
+  uint32_t due; // Rebroadcast Time (us)
+  uint8_t frame[ESPNOW_MTU]; // Encoded with TTL - 1 and this Node Appended
+} flood_pending_t;
+
+typedef struct {
+  uint32_t originated; // Floods Started Here
+  uint32_t delivered; // First Copies Received
+  uint32_t duplicates; // Later Copies Received
+  uint32_t expired; // First Copies whose TTL Allows no Further Hop
+  uint32_t rebroadcasts; // Copies Sent Again
+  uint32_t suppressed; // Rebroadcasts Cancelled after k Copies
+  uint32_t overflow; // Rebroadcasts Sent at Once for Lack of a Pending Slot
+} flood_stats_t;
+
+typedef struct {
+  flood_send_fn send;
+  void *ctx;
+  uint8_t self[MAC_SIZE]; // Appended to Path_Array on Rebroadcast
+  dedup_cache_t *seen; // Shared with Unicast Duplicate Suppression
+  uint8_t k;
+  uint32_t jitterUs;
+  bool relay; // false -> deliver only, never rebroadcast
+  flood_pending_t pending[FLOOD_PENDING];
+  flood_stats_t stats;
+} flood_t;
+
+void Flood_Init(flood_t *f, flood_send_fn send, void *ctx, const uint8_t *self, dedup_cache_t *seen);
+
+bool Flood_Is_Broadcast(const uint8_t *mac);
+
+/* The duplicate cache is shared with unicast and stamped in milliseconds,
+   so the calls that touch it take Hal_Millis() as nowMs. Rebroadcast
+   delays run on Hal_Micros() (nowUs), which wraps after about 71.6
+   minutes and must never be stamped into the cache. */
+
+// Start a flood of packet (TTL, packetID and source_mac set by the caller)
+bool Flood_Originate(flood_t *f, const message_t *packet, uint32_t nowMs);
+
+// Broadcast packet heard. True if it is the first copy (deliver it), false for a repeat
+bool Flood_On_Receive(flood_t *f, const message_t *packet, uint32_t nowUs, uint32_t nowMs);
+
+// Send or cancel rebroadcasts whose delay has run out
+void Flood_Poll(flood_t *f, uint32_t nowUs);
+
+#endif
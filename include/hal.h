@@ -0,0 +1,130 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Thin hardware-abstraction layer for the gateway. The WT32-ETH01 build
+   (hal_esp32.cpp) maps it onto ESP-NOW, ETH and HTTPClient; the native
+   build (hal_native.cpp) maps it onto the in-process radio simulator and
+   POSIX sockets. Serial stays the console on both. */
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdio.h>
+
+#define HEX 16
+#define DEC 10
+
+// Minimal Serial stand-in for host builds
+class HalConsole {
+public:
+  bool enabled = true;
+  void begin(unsigned long) {}
+  void print(const char *s) { if(enabled) fputs(s, stdout); }
+  void print(long v, int base = DEC) { if(enabled) printf(base == HEX ? "%lX" : "%ld", v); }
+  void print(int v, int base = DEC) { print((long)v, base); }
+  void print(unsigned v, int base = DEC) { print((long)v, base); }
+  void print(unsigned long v, int base = DEC) { print((long)v, base); }
+  void print(unsigned char v, int base = DEC) { print((long)v, base); }
+  void print(double v) { if(enabled) printf("%.2f", v); }
+  template <typename T> void println(T v) { print(v); println(); }
+  template <typename T> void println(T v, int base) { print(v, base); println(); }
+  void println() { if(enabled) fputc('\n', stdout); }
+  int availableForWrite() { return 4096; }
+  size_t write(const uint8_t *data, size_t len) { return fwrite(data, 1, len, stdout); }
+  int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HalConsole Serial;
+#endif
+
+typedef int hal_err_t; // ESP-IDF error code on device
+#define HAL_OK 0
+#define HAL_FAIL -1
+
+#define HAL_KEY_LEN 16
+
+/* Time */
+uint32_t Hal_Millis();
+uint32_t Hal_Micros();
+void Hal_Delay(uint32_t ms);
+uint32_t Hal_Random();
+
+/* ESP-NOW Radio */
+
+/* The ESP-NOW receive callback reports no RSSI. With LINK_RSSI_PROMISCUOUS
+   set, the ESP32 HAL puts the whole radio in promiscuous mode (management
+   frames only, ESP-NOW being action frames) and notes the RSSI of each
+   frame sniffed. That runs a callback in the Wi-Fi task for every such
+   frame in the air, not just ours, which costs CPU on a busy channel. Off,
+   Hal_Radio_RSSI is always 0 and link quality comes from send status
+   alone. The host HAL always reports the simulated RSSI. */
+#ifndef LINK_RSSI_PROMISCUOUS
+#define LINK_RSSI_PROMISCUOUS 0
+#endif
+
+typedef void (*hal_recv_cb_t)(const uint8_t *mac, const uint8_t *data, int len);
+typedef void (*hal_sent_cb_t)(const uint8_t *mac, bool success);
+
+// Bring up Wi-Fi STA + ESP-NOW with the given PMK and register callbacks
+bool Hal_Radio_Init(const char *pmk, hal_recv_cb_t onReceive, hal_sent_cb_t onSent);
+bool Hal_Radio_Read_MAC(uint8_t *mac);
+hal_err_t Hal_Radio_Send(const uint8_t *mac, const uint8_t *data, size_t len);
+bool Hal_Radio_Peer_Exists(const uint8_t *mac);
+hal_err_t Hal_Radio_Peer_Encrypted(const uint8_t *mac, bool *encrypted);
+hal_err_t Hal_Radio_Add_Peer(const uint8_t *mac, const char *lmk); // lmk NULL -> unencrypted
+hal_err_t Hal_Radio_Del_Peer(const uint8_t *mac);
+// RSSI (dBm) of the frame just received from mac, 0 if unknown. Call from the receive callback
+int8_t Hal_Radio_RSSI(const uint8_t *mac);
+const char *Hal_Err_Name(hal_err_t err);
+
+/* Ethernet + HTTP */
+bool Hal_Network_Init(const uint8_t localIP[4], const uint8_t gateway[4], const uint8_t subnet[4]);
+
+// POST over a kept-alive connection (contentEncoding NULL -> no header). Returns HTTP status, or <= 0 on transport error
+int Hal_Http_Post(const char *url, const char *contentType, const char *contentEncoding, const uint8_t *body, size_t len);
+
+// Uplink datagrams: one UDP socket to the receiver, replies read back from it
+bool Hal_Udp_Open(const char *host, uint16_t port);
+// Returns true if the stack took the datagram
+bool Hal_Udp_Send(const uint8_t *data, size_t len);
+// Non-blocking: length of the next datagram (0 -> none waiting)
+size_t Hal_Udp_Recv(uint8_t *data, size_t cap);
+
+// Scrape endpoint: handler fills body for a GET path, returns length (0 -> 404)
+typedef size_t (*hal_http_handler_t)(const char *path, char *body, size_t cap, const char **contentType);
+#define HAL_HTTP_RESPONSE_MAX 16384 // Largest Response Body
+bool Hal_Http_Serve(uint16_t port, hal_http_handler_t handler);
+// Answer at most one pending request. Call from loop()
+void Hal_Http_Serve_Poll();
+
+// Raw byte stream to a single TCP client on ETH (capture). A new client replaces the old one
+bool Hal_Stream_Serve(uint16_t port);
+// True when a new client connected since the last call. Call from loop()
+bool Hal_Stream_Accept();
+// Non-blocking: returns bytes taken (0 -> no client or socket buffer full)
+size_t Hal_Stream_Write(const uint8_t *data, size_t len);
+
+// Downlink command connection: a single TCP client on ETH, commands in and reports out. A new client replaces the old one
+bool Hal_Command_Serve(uint16_t port);
+// True when a new client connected since the last call. Call from loop()
+bool Hal_Command_Accept();
+// Non-blocking: returns bytes read (0 -> nothing waiting or no client)
+size_t Hal_Command_Read(uint8_t *data, size_t cap);
+// Non-blocking: returns bytes taken (0 -> no client or socket buffer full)
+size_t Hal_Command_Write(const uint8_t *data, size_t len);
+
+#ifndef ARDUINO
+/* Host Build Controls */
+void Hal_Native_Set_MAC(const uint8_t *mac); // Before Hal_Radio_Init
+int Hal_Native_Node(); // Simulator node id of this gateway (-1 before init)
+void Hal_Native_Http_Sink(bool sink); // true -> POSTs succeed without a server
+// Sink mode: hook answers each POST instead (NULL -> 200 at once)
+typedef int (*hal_native_post_fn)(const char *contentType, const char *contentEncoding, const uint8_t *body, size_t len);
+void Hal_Native_Http_Hook(hal_native_post_fn hook);
+uint32_t Hal_Native_Http_Posts();
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef LINK_QUALITY_H
+#define LINK_QUALITY_H
+
+#include <stdint.h>
+#include "message.h"
+
+/* Quality of the gateway's links to its direct neighbours. For each
+   neighbour it keeps the signal strength of frames heard from it (RSSI)
+   and the MAC-layer delivery ratio of frames sent to it (ESP-NOW send
+   status). Both are moving averages that weight each new sample by
+   1/LINK_EWMA_DIV. A neighbour with no sends yet gets a delivery estimate
+   from its RSSI; without RSSI (a device built without
+   LINK_RSSI_PROMISCUOUS) it starts from LINK_DELIVERY_PRIOR and only
+   send status moves it. Link_ETX is the expected number of transmissions,
+   1 / delivery. Everything belongs to one task (the route stage). */
+
+#ifndef LINK_NEIGHBORS
+#define LINK_NEIGHBORS 16 // Neighbours Tracked
+#endif
+
+#define LINK_EWMA_DIV 8 // Sample Weight 1/8
+#define LINK_RSSI_GOOD -65 // dBm: Assumed Clean at or Above
+#define LINK_RSSI_BAD -90 // dBm: Assumed to Lose Half its Frames
+#define LINK_DELIVERY_PRIOR 0.9f // Neighbour Never Heard or Sent To
+#define LINK_DELIVERY_MIN 0.05f // Caps ETX at 20
+
+typedef struct {
+  uint8_t mac[MAC_SIZE];
+  bool used;
+  float rssi; // Averaged dBm (0 -> none yet)
+  float delivery; // Averaged Send Success (seeded from RSSI)
+  uint32_t sent; // Frames Sent
+  uint32_t failed; // Of Those, Not Acked at the MAC Layer
+  uint32_t stamp; // Last Activity (ms, LRU)
+} link_entry_t;
+
+typedef struct {
+  uint32_t samples; // RSSI and Send Results Recorded
+  uint32_t evictions; // Neighbours Forgotten to Make Room
+} link_stats_t;
+
+void Link_Init();
+
+// Frame heard from neighbour (rssi 0 -> unknown)
+void Link_On_Receive(const uint8_t *mac, int8_t rssi, uint32_t now);
+
+// Send status of a unicast frame to neighbour
+void Link_On_Sent(const uint8_t *mac, bool success, uint32_t now);
+
+// Estimated chance one frame to neighbour gets through
+float Link_Delivery(const uint8_t *mac);
+
+// Expected transmissions for one frame to neighbour
+float Link_ETX(const uint8_t *mac);
+
+const link_entry_t *Link_Find(const uint8_t *mac);
+
+const link_stats_t *Link_Get_Stats();
+
+#endif
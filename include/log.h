@@ -0,0 +1,140 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+/* Deferred binary logging with compile-time level filtering.
+
+   LOG_ERROR/WARN/INFO/DEBUG above LOG_LEVEL expand to nothing. Enabled
+   calls store the format pointer (its address is the format ID), a
+   timestamp and up to LOG_MAX_ARGS raw arguments in a lock-free ring; a
+   low-priority task formats and prints them later. Any number of contexts
+   (Wi-Fi callback, loop, tasks) may log concurrently.
+
+   Arguments are captured by value, so %s must point at a string that
+   outlives the record (a literal, Hal_Err_Name, ...). Wrap transient
+   text in Log_Str() to copy up to LOG_INLINE_TEXT bytes into the record.
+   Conversions: %d %i %u %x %X %c %s %p with flags/width; one line per
+   record. */
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 64 // Pending Records (power of two)
+#endif
+
+#define LOG_MAX_ARGS 8
+#define LOG_INLINE_TEXT 32
+
+// MAC Address Helpers: LOG_INFO("Peer " MAC_FMT, MAC_ARGS(mac))
+#define MAC_FMT "%02X:%02X:%02X:%02X:%02X:%02X"
+#define MAC_ARGS(m) (m)[0], (m)[1], (m)[2], (m)[3], (m)[4], (m)[5]
+
+typedef struct {
+  const char *format; // Format ID
+  uint32_t stamp; // ms
+  uint8_t level;
+  uint8_t argCount;
+  int8_t inlineArg; // Argument index served from text (-1 -> none)
+  uintptr_t args[LOG_MAX_ARGS];
+  char text[LOG_INLINE_TEXT];
+} log_entry_t;
+
+typedef struct {
+  const char *s;
+} log_str_t;
+
+typedef struct {
+  uint32_t written; // Records Queued
+  uint32_t dropped; // Records Lost to a Full Ring
+} log_stats_t;
+
+// Copy transient text into the record
+static inline log_str_t Log_Str(const void *s) {
+  log_str_t str = {(const char *)s};
+  return str;
+}
+
+void Log_Push(const log_entry_t *entry);
+
+// Start the drainer task. Returns false where there is none (host builds)
+bool Log_Start();
+// Format and print up to max pending records. Returns records printed
+int Log_Drain(int max);
+// Drain from the caller when no drainer task is running
+void Log_Service();
+const log_stats_t *Log_Get_Stats();
+
+/* Argument Capture */
+template <typename T>
+static inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+Log_Capture(log_entry_t *entry, int index, T value) {
+  entry->args[index] = (uintptr_t)(intptr_t)value;
+}
+
+template <typename T>
+static inline void Log_Capture(log_entry_t *entry, int index, T *value) {
+  entry->args[index] = (uintptr_t)value;
+}
+
+void Log_Capture(log_entry_t *entry, int index, log_str_t value);
+
+static inline void Log_Capture_All(log_entry_t *, int) {}
+
+template <typename T, typename... Rest>
+static inline void Log_Capture_All(log_entry_t *entry, int index, T value, Rest... rest) {
+  Log_Capture(entry, index, value);
+  Log_Capture_All(entry, index + 1, rest...);
+}
+
+uint32_t Log_Clock();
+
+template <typename... Args>
+static inline void Log_Record(uint8_t level, const char *format, Args... args) {
+  static_assert(sizeof...(args) <= LOG_MAX_ARGS, "Too many log arguments");
+  log_entry_t entry;
+  entry.format = format;
+  entry.stamp = Log_Clock();
+  entry.level = level;
+  entry.argCount = sizeof...(args);
+  entry.inlineArg = -1;
+  Log_Capture_All(&entry, 0, args...);
+  Log_Push(&entry);
+}
+
+// Disabled levels keep their arguments type-checked but emit no code
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Log_Record(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do { if(0) Log_Record(LOG_LEVEL_ERROR, __VA_ARGS__); } while(0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log_Record(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do { if(0) Log_Record(LOG_LEVEL_WARN, __VA_ARGS__); } while(0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log_Record(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do { if(0) Log_Record(LOG_LEVEL_INFO, __VA_ARGS__); } while(0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log_Record(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do { if(0) Log_Record(LOG_LEVEL_DEBUG, __VA_ARGS__); } while(0)
+#endif
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef MESSAGE_H
+#define MESSAGE_H
+
+#include <stdint.h>
+
+#define MAX_NODES 9
+#define MAC_SIZE 6
+#define ESPNOW_MTU 250 // Largest ESP-NOW Payload
+#define FRAGMENT_DATA_MAX 218 // Chunk Bytes in a Fragment Frame with an Empty Path
+#define BEACON_MAX_GRANTS 32 // Slot Grants in one Beacon Frame
+
+/* PRIORITY CLASSES (set by the sending node, carried in the frame header) */
+enum priority_class {
+  PRIORITY_NORMAL, // Telemetry (default, and every legacy frame)
+  PRIORITY_ALARM,  // Served ahead of everything else
+  PRIORITY_BULK,   // Large or deferrable data, smallest share
+  PRIORITY_CLASSES,
+};
+
+/* PACKET STRUCTURE */
+typedef struct message {
+  unsigned char text[64]; // 64 bytes of text
+  //int value; 
+  //float temperature;
+  int TTL; // Time to live for packet 
+  int identification; // 1-> BROADCAST, 2-> DATA
+  bool broadcast_Ack; //  0 -> Default Communication, 1 -> Acknowledgement of Broadcast
+  bool Data_Ack; // 0 -> Default Communication, 1 -> Acknowledgement of Data
+  uint8_t destination_mac[6]; // MAC Address of Receiver
+  uint8_t source_mac[6]; // MAC Address of Sender
+  int packetID; // Packet ID
+  uint8_t Path_Array[MAX_NODES][MAC_SIZE]; // Path Array
+  uint8_t Path_Index; // Index of Path Array
+  uint8_t Path_Length;  // Length of Path Array
+  bool Path_Exist;  // Check if Path Exists
+  int ackID; // Packet ID Acknowledged (Data_Ack only; not in legacy frames)
+  uint8_t priority; // priority_class (not in legacy frames)
+  uint32_t captured; // Network Time the Reading was Taken (ms, 0 -> unknown; not in legacy frames)
+} message_t;
+
+/* FRAGMENT (one piece of a payload larger than text) */
+typedef struct fragment {
+  uint16_t messageID; // Same for every Fragment of a Payload
+  uint8_t index; // 0..count-1
+  uint8_t count; // Fragments in Payload
+  uint16_t total; // Payload Length
+  uint16_t offset; // Position of data in Payload
+  uint8_t len; // Bytes in data
+  uint8_t data[FRAGMENT_DATA_MAX];
+} fragment_t;
+
+/* BEACON (gateway time and transmit slot grants, repeated hop by hop) */
+typedef struct beacon_grant {
+  uint8_t mac[MAC_SIZE]; // Source
+  uint8_t slot; // 0..slots-1
+} beacon_grant_t;
+
+typedef struct beacon {
+  uint16_t seq; // Same for every Copy of a Beacon
+  uint8_t ttl; // Hops Left
+  uint8_t hops; // Hops Travelled
+  uint32_t timeUs; // Network Time when this Copy was Sent
+  uint32_t epochUs; // Network Time the Current Superframe Layout Started
+  uint32_t slotUs; // Slot Width
+  uint8_t slots; // Granted Slots (superframe: beacon slot, granted slots, contention slot)
+  uint8_t count; // Grants Listed
+  beacon_grant_t grants[BEACON_MAX_GRANTS];
+} beacon_t;
+
+// Queue Slot (received packet plus MAC of the hop it arrived from)
+typedef struct queue_node {
+  message_t data;
+  uint8_t mac[6];
+  uint32_t rxStamp; // Receive Time (Metrics_Clock)
+  int8_t rssi; // Signal of the Hop it arrived from (0 -> unknown)
+  bool fragmented; // fragment Holds the Payload Piece (text is empty)
+  fragment_t fragment;
+} queue_node_t;
+
+#endif
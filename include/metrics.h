@@ -0,0 +1,101 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Gateway metrics: fixed-bucket latency histograms, counters and gauges,
+   rendered in the Prometheus text exposition format.
+
+   Recording is a relaxed atomic add on a preallocated slot, safe from any
+   context (Wi-Fi callback, loop, tasks) and free of locks and allocation.
+   Histogram buckets are powers of two starting at METRICS_BUCKET_MIN_US,
+   so the bucket index is a count-leading-zeros away from the sample. */
+
+#ifndef METRICS_PORT
+#define METRICS_PORT 9100 // Scrape Port on ETH (0 -> disabled)
+#endif
+
+#define METRICS_BUCKET_MIN_US 16 // First Bucket Bound
+#define METRICS_BUCKETS 18 // Bounds 16us .. ~2.1s, plus +Inf
+#define METRICS_TEXT_MAX 16384 // Rendered Scrape Size
+
+enum metrics_histogram {
+  HIST_RX_TO_PROCESS,     // On_Data_Receive -> ProcessReceivedData
+  HIST_PROCESS_TO_UPLINK, // Record batched -> batch handed to transport
+  HIST_HTTP_RTT,          // POST round trip
+  HIST_PEER_REGISTER,     // Encrypted peer swapped into the radio
+  HIST_RX_TO_ACK,         // On_Data_Receive -> Data_Ack handed to the radio
+  HIST_COMPRESS,          // Gzip of one batch
+  HIST_COMMAND_RTT,       // Command line received -> node's Data_Ack received
+  HIST_ALARM_TO_UPLINK,   // Alarm record batched -> batch handed to transport
+  HIST_DATAGRAM_RTT,      // Uplink datagram sent -> its cumulative ack
+  METRICS_HISTOGRAMS,
+};
+
+enum metrics_id {
+  /* Counters */
+  METRIC_RX_FRAMES,
+  METRIC_RX_MALFORMED,
+  METRIC_RX_DROPPED,
+  METRIC_DUPLICATES,
+  METRIC_TX_FAILURES,
+  METRIC_UPLINK_RECORDS,
+  METRIC_UPLINK_BATCHES,
+  METRIC_UPLINK_FAILURES,
+  METRIC_UPLINK_OVERSIZE,
+  METRIC_HTTP_ERRORS,
+  METRIC_SPOOL_SPOOLED,
+  METRIC_SPOOL_REPLAYED,
+  METRIC_SPOOL_OVERWRITTEN,
+  METRIC_ROUTE_HITS,
+  METRIC_ROUTE_MISSES,
+  METRIC_ROUTE_SWITCHES,
+  METRIC_ROUTE_ACKS_LOST,
+  METRIC_FLOOD_REBROADCASTS,
+  METRIC_FLOOD_SUPPRESSED,
+  METRIC_LOG_DROPPED,
+  METRIC_RELIABLE_RETRANSMITS,
+  METRIC_RELIABLE_FAILED,
+  METRIC_REASSEMBLY_COMPLETED,
+  METRIC_REASSEMBLY_TIMEOUTS,
+  METRIC_PEER_EVICTIONS,
+  METRIC_UPLINK_QUEUE_DROPPED,
+  METRIC_AGGREGATE_READINGS,
+  METRIC_AGGREGATE_SUMMARIES,
+  METRIC_COMPRESS_IN_BYTES,
+  METRIC_COMPRESS_OUT_BYTES,
+  METRIC_CAPTURE_FRAMES,
+  METRIC_CAPTURE_DROPPED,
+  METRIC_COMMANDS_DELIVERED,
+  METRIC_COMMANDS_FAILED,
+  METRIC_COMMANDS_REJECTED,
+  METRIC_UPLINK_ALARMS,
+  METRIC_ALARMS_DROPPED,
+  METRIC_TDMA_BEACONS,
+  METRIC_DATAGRAM_RESENT,
+  METRIC_DATAGRAM_FAILED,
+  /* Gauges */
+  METRIC_RX_QUEUE_DEPTH,
+  METRIC_UPLINK_PENDING,
+  METRIC_SPOOL_DEPTH,
+  METRIC_PEERS_REGISTERED,
+  METRIC_TDMA_SLOTS,
+  METRIC_UPTIME_SECONDS,
+  METRICS_COUNT,
+};
+
+// Timestamp for latency samples (us)
+uint32_t Metrics_Clock();
+
+void Metrics_Observe(metrics_histogram hist, uint32_t us);
+void Metrics_Add(metrics_id id, uint32_t n = 1);
+// Gauges, and counters mirrored from a module's own stats
+void Metrics_Set(metrics_id id, uint32_t value);
+uint32_t Metrics_Get(metrics_id id);
+
+// Prometheus text into out. Returns length, truncated at a line if cap is short
+size_t Metrics_Render(char *out, size_t cap);
+const char *Metrics_Content_Type();
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <stdint.h>
+
+/* Host microbenchmarks for the gateway's per-packet stages.
+
+   Each stage runs in isolation over a seeded mix of the traffic a
+   gateway sees: data from sources 1 to 8 hops out (most of them close),
+   retransmits of data already held, Data_Acks for commands, fragments of
+   larger payloads, broadcasts, and frames meant for another node. Calls
+   are timed in small batches on the wall clock. Between batches the
+   route and uplink stages drain the queues, and none of that is timed.
+
+   Every stage reports its median ns per call over MICROBENCH_ROUNDS
+   rounds, as key=value lines (the format of every other simulator
+   report). Given a baseline in the same format, a stage whose median
+   rises more than tolerance percent plus MICROBENCH_SLACK_NS above its
+   baseline counts as regressed and the run fails. A baseline is only
+   valid on the machine and build flags it was taken with. */
+
+#ifndef MICROBENCH_OPS
+#define MICROBENCH_OPS 16384 // Calls per Stage per Round
+#endif
+
+#ifndef MICROBENCH_ROUNDS
+#define MICROBENCH_ROUNDS 7 // Timed Rounds per Stage (one more Warms Up)
+#endif
+
+#ifndef MICROBENCH_TOLERANCE
+#define MICROBENCH_TOLERANCE 25 // Percent over Baseline before a Stage Regresses
+#endif
+
+#ifndef MICROBENCH_SLACK_NS
+#define MICROBENCH_SLACK_NS 10 // Allowed on top of the Tolerance (code placement swings calls of a few ns by half)
+#endif
+
+typedef struct {
+  const char *baseline; // Compare against this (NULL -> report only)
+  const char *results; // Write the report here as well (NULL -> stdout only)
+  uint32_t tolerance; // Percent
+  uint32_t seed;
+} microbench_options_t;
+
+// 0: no stage regressed. 1: a stage regressed. 2: baseline or results file unusable
+int Microbench_Run(const microbench_options_t *options);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef PEER_CACHE_H
+#define PEER_CACHE_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "message.h"
+
+/* Encrypted ESP-NOW peers beyond the radio's limit. ESP-NOW holds only a
+   few encrypted peers (CONFIG_ESP_WIFI_ESPNOW_MAX_ENCRYPT_NUM, 7 by
+   default), so every next hop the gateway has seen is kept in a software
+   table and only the PEER_HW_SLOTS most recently used ones are registered
+   with the radio. Sending to an unregistered hop deletes the least
+   recently used registration and adds the hop with its LMK in a single
+   call (no unencrypted add, delete and re-add). */
+
+#ifndef PEER_CACHE_SIZE
+#define PEER_CACHE_SIZE 64 // Next Hops Remembered
+#endif
+
+#ifndef PEER_HW_SLOTS
+#define PEER_HW_SLOTS 7 // Encrypted Peers Registered with the Radio
+#endif
+
+typedef struct {
+  uint8_t mac[MAC_SIZE];
+  bool used;
+  bool registered; // Currently an ESP-NOW Peer
+  uint32_t stamp; // Last Send (ms)
+  uint32_t sends; // Frames Sent to this Peer
+} peer_entry_t;
+
+typedef struct {
+  uint32_t hits; // Send to an Already Registered Peer
+  uint32_t registrations; // Peers Added to the Radio
+  uint32_t evictions; // Registrations Removed to Make Room
+  uint32_t forgotten; // Table Entries Replaced by a New Peer
+  uint32_t failures; // Radio Refused the Add
+  uint32_t registerUs; // Delete + Add Time of the Latest Registration
+  uint64_t registerUsTotal;
+} peer_cache_stats_t;
+
+// lmk is used for every registration (HAL_KEY_LEN bytes)
+void Peer_Cache_Init(const char *lmk);
+
+// Make mac a registered encrypted peer before sending to it
+hal_err_t Peer_Cache_Acquire(const uint8_t *mac, uint32_t now);
+
+// Registered peers right now
+int Peer_Cache_Registered();
+
+const peer_cache_stats_t *Peer_Cache_Get_Stats();
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+
+/* Gateway pipeline stages. On the ESP32 each stage is a FreeRTOS task
+   pinned to a core that sleeps on its task notification and runs when a
+   producer wakes it (or after idleMs, for timers such as retransmits and
+   batch deadlines). Stages are joined by bounded SPSC rings, so a slow
+   stage drops or backs up work instead of stalling the one before it.
+   Host builds have no tasks: Pipeline_Start returns false and loop()
+   runs every stage in turn. */
+
+#ifndef PIPELINE_TASKS
+#ifdef ARDUINO
+#define PIPELINE_TASKS 1 // Run Stages as Tasks (0 -> everything in loop())
+#else
+#define PIPELINE_TASKS 0
+#endif
+#endif
+
+// Drain the stage's input and service its timers
+typedef void (*pipeline_stage_fn)(void);
+
+typedef struct {
+  const char *name;
+  pipeline_stage_fn run;
+  uint8_t core; // 0: Wi-Fi / ESP-NOW, 1: Arduino loop
+  uint8_t priority;
+  uint16_t stackBytes;
+  uint32_t idleMs; // Longest Sleep without a Wake
+  void *task; // TaskHandle_t once started
+  uint32_t wakes; // Runs Started by a Notification
+  uint32_t timeouts; // Runs Started by idleMs
+} pipeline_stage_t;
+
+// Start stage as a pinned task. False where tasks are unavailable or disabled
+bool Pipeline_Start(pipeline_stage_t *stage);
+
+// Wake stage (from a task or the Wi-Fi callback). No-op if it is not a task
+void Pipeline_Wake(pipeline_stage_t *stage);
+
+bool Pipeline_Running(const pipeline_stage_t *stage);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef QOS_H
+#define QOS_H
+
+#include <stdint.h>
+#include "message.h"
+
+/* Class scheduler for the per-priority receive and uplink queues.
+
+   PRIORITY_ALARM is strict: whenever an alarm is waiting it is served
+   first. The other classes share what is left by weighted round robin:
+   each round a class may take up to its weight in items, and a class
+   with nothing waiting gives its turn to the next. So bulk traffic
+   cannot starve normal telemetry, and neither can delay an alarm by
+   more than the item being served when it arrived. */
+
+#ifndef QOS_WEIGHT_NORMAL
+#define QOS_WEIGHT_NORMAL 4 // Items per Round
+#endif
+
+#ifndef QOS_WEIGHT_BULK
+#define QOS_WEIGHT_BULK 1 // Items per Round
+#endif
+
+typedef struct {
+  uint8_t weight[PRIORITY_CLASSES]; // >= 1 (PRIORITY_ALARM's is unused)
+  uint8_t credit[PRIORITY_CLASSES]; // Left in this Round
+  uint8_t turn; // Class the Round is at
+  uint32_t served[PRIORITY_CLASSES];
+} qos_scheduler_t;
+
+void Qos_Init(qos_scheduler_t *q);
+
+// ready: bit c set when class c has an item waiting. Returns the class to serve, or -1 when none is ready
+int Qos_Pick(qos_scheduler_t *q, uint8_t ready);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef RADIO_SIM_H
+#define RADIO_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* In-process ESP-NOW radio simulator for host builds.
+
+   Discrete-event model on a virtual microsecond clock. Every node has a
+   MAC and a receive/sent callback pair. A frame reaches only nodes joined
+   by a link; each direction of a link has its own loss probability, fixed
+   latency and uniform jitter. A sender transmits one frame at a time, so
+   frames from the same node queue behind each other for their airtime.
+   Unicast frames report success to the sender once delivered (ESP-NOW
+   MAC-layer ack); broadcasts always report success.
+
+   With collisions enabled, two frames whose airtime overlaps at a
+   receiver are both lost there (no carrier sense, no capture effect),
+   and a unicast sender learns the outcome when the frame would have
+   been received instead of when it finished sending. */
+
+#define SIM_MAX_FRAME 250 // ESP-NOW Payload Limit
+
+typedef struct {
+  float loss; // Drop Probability (0..1)
+  uint32_t latencyUs; // Fixed Propagation + Stack Delay
+  uint32_t jitterUs; // Extra Uniform Delay 0..jitterUs
+  int8_t rssi; // Signal at the Receiver (dBm, 0 -> not reported)
+} sim_link_t;
+
+typedef void (*sim_rx_fn)(int node, const uint8_t *from, const uint8_t *data, int len);
+typedef void (*sim_sent_fn)(int node, const uint8_t *to, bool success);
+
+typedef struct {
+  uint64_t frames; // Frames Transmitted (broadcast counts once)
+  uint64_t delivered; // Frame Copies Received
+  uint64_t lost; // Frame Copies Dropped by Link Loss
+  uint64_t noRoute; // Unicast to a MAC not linked to the sender
+  uint64_t bytes; // Payload Bytes Transmitted
+  uint64_t collided; // Frame Copies Lost to Overlapping Frames
+} sim_stats_t;
+
+void Sim_Reset(uint32_t seed);
+void Sim_Set_Collisions(bool enabled); // After Sim_Reset (off by default)
+int Sim_Add_Node(const uint8_t *mac, sim_rx_fn onReceive, sim_sent_fn onSent);
+const uint8_t *Sim_Node_MAC(int node);
+int Sim_Find_Node(const uint8_t *mac);
+
+// Link a -> b with the given quality (one direction)
+void Sim_Set_Link(int a, int b, const sim_link_t *link);
+// Link both directions with the same quality
+void Sim_Connect(int a, int b, const sim_link_t *link);
+// Link a -> b, or NULL
+const sim_link_t *Sim_Get_Link(int a, int b);
+
+bool Sim_Send(int from, const uint8_t *to, const uint8_t *data, size_t len);
+
+uint64_t Sim_Now_Us();
+// Run every event due up to untilUs and leave the clock there
+void Sim_Run_Until(uint64_t untilUs);
+uint32_t Sim_Random();
+float Sim_Uniform(); // [0, 1)
+
+const sim_stats_t *Sim_Get_Stats();
+
+#endif
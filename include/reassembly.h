@@ -0,0 +1,88 @@
+#ifndef REASSEMBLY_H
+#define REASSEMBLY_H
+
+#include <stdint.h>
+#include "message.h"
+
+/* Gateway-side reassembly of fragmented payloads, keyed on (source MAC,
+   messageID). REASSEMBLY_SLOTS payloads at once, whose bytes share one
+   REASSEMBLY_POOL_BYTES pool: each takes its announced length, first fit,
+   so the pool holds two payloads of the largest size or many small ones
+   rather than SLOTS x MAX_BYTES of mostly idle RAM. A payload that is not
+   complete within REASSEMBLY_TIMEOUT_MS of its first fragment is dropped.
+   Repeated fragments are recognised from a per-payload bitmap and ignored,
+   so a retransmission can never corrupt or complete a payload twice. When
+   every slot is busy, or the pool has no room for a new payload, the
+   oldest partial payload is evicted.
+
+   A delivered payload is handed out in place and stays held until
+   Reassembly_Release, so another task can upload it without a copy; held
+   slots are never reused. Everything except Reassembly_Release belongs to
+   one task. */
+
+#ifndef REASSEMBLY_SLOTS
+#define REASSEMBLY_SLOTS 8 // Payloads Reassembled at Once (~2 per sending source)
+#endif
+
+#ifndef REASSEMBLY_MAX_BYTES
+#define REASSEMBLY_MAX_BYTES 4096 // Largest Payload
+#endif
+
+#ifndef REASSEMBLY_POOL_BYTES
+#define REASSEMBLY_POOL_BYTES (2 * REASSEMBLY_MAX_BYTES) // Shared by the Slots' Payloads
+#endif
+
+#ifndef REASSEMBLY_TIMEOUT_MS
+#define REASSEMBLY_TIMEOUT_MS 2000 // First Fragment -> Complete
+#endif
+
+#define REASSEMBLY_MAX_FRAGMENTS 32 // Bitmap Width
+
+enum reassembly_result {
+  REASSEMBLY_PENDING,   // Stored, more fragments to come
+  REASSEMBLY_COMPLETE,  // Payload ready
+  REASSEMBLY_DUPLICATE, // Fragment already held (or payload already delivered)
+  REASSEMBLY_REJECTED,  // Inconsistent with the payload's other fragments or out of range
+  REASSEMBLY_NO_ROOM,   // Every slot holds a payload not yet released
+};
+
+typedef struct {
+  uint8_t mac[MAC_SIZE]; // Source
+  bool used;
+  bool complete; // Delivered; kept so late duplicates are recognised
+  uint16_t messageID;
+  uint8_t count; // Fragments Expected
+  uint8_t received; // Fragments Held
+  uint16_t total; // Payload Length
+  uint32_t bitmap; // Bit i -> Fragment i Held
+  uint16_t offset; // Payload in the Pool
+  uint32_t started; // First Fragment (ms)
+} reassembly_slot_t;
+
+typedef struct {
+  uint32_t fragments; // Fragments Stored
+  uint32_t completed; // Payloads Delivered
+  uint32_t completedBytes;
+  uint32_t duplicates; // Fragments Ignored as Repeats
+  uint32_t rejected; // Malformed or Inconsistent Fragments
+  uint32_t timedOut; // Partial Payloads Dropped for Age
+  uint32_t evicted; // Partial Payloads Dropped for a Slot or Pool Room
+  uint32_t noRoom; // Fragments Refused while Every Slot or the Pool was Held
+} reassembly_stats_t;
+
+void Reassembly_Init();
+
+// Store fragment from source. On REASSEMBLY_COMPLETE *payload/*len hold the
+// payload, valid until it is passed to Reassembly_Release
+reassembly_result Reassembly_Add(const uint8_t *source, const fragment_t *fragment, uint32_t now,
+                                 const uint8_t **payload, uint16_t *len);
+
+// Done with a delivered payload (safe from any task); its pool bytes are free again
+void Reassembly_Release(const uint8_t *payload);
+
+// Drop partial payloads older than REASSEMBLY_TIMEOUT_MS
+void Reassembly_Expire(uint32_t now);
+
+const reassembly_stats_t *Reassembly_Get_Stats();
+
+#endif
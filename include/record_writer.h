@@ -0,0 +1,40 @@
+#ifndef RECORD_WRITER_H
+#define RECORD_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+#include "aggregate.h"
+
+/* Allocation-free uplink record serializer. Writes one message_t straight
+   into a caller buffer as JSON or MessagePack (same keys in both). A record
+   that does not fit is never truncated: the writer returns 0 instead.
+   A reassembled payload travels as an extra "payload" key: base64 in JSON,
+   bin in MessagePack. An aggregation window is written as a summary record
+   (SourceMAC, packetID of its latest reading, count, min, max, mean, last,
+   window_ms). Alarm and bulk records carry "priority": "alarm" / "bulk";
+   normal records leave the key out. Records with a capture time carry
+   "captured_ms" (network time, see tdma.h). */
+
+enum record_format {
+  RECORD_JSON,    // application/json
+  RECORD_MSGPACK, // application/msgpack
+};
+
+// Worst case record sizes (every text byte escaped, full path)
+#define RECORD_JSON_MAX 1024
+#define RECORD_MSGPACK_MAX 512
+
+// Serialize msg into out. Returns bytes written, or 0 if cap is too small
+size_t Record_Write(const message_t *msg, record_format format, uint8_t *out, size_t cap);
+
+// Same, with a reassembled payload (payload may be NULL)
+size_t Record_Write_Payload(const message_t *msg, const uint8_t *payload, size_t len, record_format format,
+                            uint8_t *out, size_t cap);
+
+// Serialize a window summary into out. Returns bytes written, or 0 if cap is too small
+size_t Record_Write_Summary(const aggregate_summary_t *summary, record_format format, uint8_t *out, size_t cap);
+
+const char *Record_Content_Type(record_format format);
+
+#endif
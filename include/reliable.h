@@ -0,0 +1,119 @@
+#ifndef RELIABLE_H
+#define RELIABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+
+/* End-to-end reliable delivery for packets that expect a Data_Ack.
+
+   Each destination gets a window of up to RELIABLE_WINDOW packets in
+   flight. A packet keeps its encoded frame (the old copy_msg) until the
+   ack naming its packetID arrives (message_t.ackID), or until MAX_TRIES transmissions
+   have timed out. Packet IDs are consecutive per sender from a random
+   start, so they double as sequence numbers and stay unique for the
+   receiver's duplicate cache.
+
+   The retransmission timeout is kept per destination from round trip
+   samples (RFC 6298: SRTT/RTTVAR, RTO = SRTT + 4 * RTTVAR), skipping
+   samples from retransmitted packets (Karn). Every retry doubles the
+   timeout of that packet. All times are in microseconds. */
+
+#ifndef MAX_TRIES
+#define MAX_TRIES 3 // Transmissions per Packet
+#endif
+
+#ifndef RELIABLE_WINDOW
+#define RELIABLE_WINDOW 4 // In-Flight Packets per Destination
+#endif
+
+#ifndef RELIABLE_PEERS
+#define RELIABLE_PEERS 8 // Destinations Tracked
+#endif
+
+#ifndef RELIABLE_RTO_INITIAL_MS
+#define RELIABLE_RTO_INITIAL_MS 1000 // Before the First RTT Sample
+#endif
+
+#ifndef RELIABLE_RTO_MIN_MS
+#define RELIABLE_RTO_MIN_MS 20
+#endif
+
+#ifndef RELIABLE_RTO_MAX_MS
+#define RELIABLE_RTO_MAX_MS 8000
+#endif
+
+// Transmit an encoded frame to the next hop. Returns true if the radio accepted it
+typedef bool (*reliable_send_fn)(void *ctx, const uint8_t *nextHop, const uint8_t *frame, size_t len);
+
+// Packet packetID to destination was given up after maxTries
+typedef void (*reliable_failed_fn)(void *ctx, const uint8_t *destination, int32_t packetID, uint32_t now);
+
+typedef struct {
+  bool used;
+  uint8_t tries; // Transmissions So Far
+  uint8_t nextHop[MAC_SIZE];
+  uint32_t firstSent; // First Transmission (latency)
+  uint32_t sentAt; // Latest Transmission
+  uint32_t deadline; // Retransmit or Give Up
+  int32_t packetID;
+  uint8_t len;
+  uint8_t frame[ESPNOW_MTU]; // Retransmit Copy (compact wire frame)
+} reliable_slot_t;
+
+typedef struct {
+  uint8_t mac[MAC_SIZE]; // Destination
+  bool used;
+  bool sampled; // srtt/rttvar Valid
+  uint32_t srtt; // Smoothed RTT
+  uint32_t rttvar; // RTT Variation
+  uint32_t rto; // Current Timeout
+  uint32_t stamp; // Last Activity (LRU)
+  uint8_t inFlight;
+  reliable_slot_t slots[RELIABLE_WINDOW];
+} reliable_peer_t;
+
+typedef struct {
+  uint32_t sent; // Packets Accepted
+  uint32_t transmissions; // Frames Handed to the Radio
+  uint32_t retransmits;
+  uint32_t acked;
+  uint32_t failed; // Gave Up after MAX_TRIES
+  uint32_t duplicateAcks; // Acks for Nothing in Flight
+  uint32_t rttSamples;
+  uint64_t ackLatency; // Sum of firstSent -> Ack over acked packets
+  uint32_t lastAckLatency; // firstSent -> Ack of the latest acked packet
+} reliable_stats_t;
+
+typedef struct {
+  reliable_send_fn send;
+  reliable_failed_fn failed; // NULL -> failures only counted
+  void *ctx;
+  uint8_t window; // <= RELIABLE_WINDOW (1 -> stop-and-wait)
+  uint8_t maxTries; // <= MAX_TRIES
+  uint32_t rtoInitial; // Seed for New Destinations
+  int32_t nextID; // Next Packet ID
+  reliable_peer_t peers[RELIABLE_PEERS];
+  reliable_stats_t stats;
+} reliable_t;
+
+// seed picks the first packet ID. window/maxTries/rtoInitial may be lowered, and failed set, afterwards
+void Reliable_Init(reliable_t *r, reliable_send_fn send, void *ctx, uint32_t seed);
+
+// True if destination has room in its window (or a destination slot is free)
+bool Reliable_Can_Send(const reliable_t *r, const uint8_t *destination);
+
+// Assign packet->packetID, encode (as a fragment frame if fragment is set), keep the
+// frame and transmit it to nextHop. False if the window is full or the frame too big
+bool Reliable_Send(reliable_t *r, const uint8_t *nextHop, message_t *packet, const fragment_t *fragment, uint32_t now);
+
+// Ack from source for packet ackID. Returns true if it completed a packet in flight
+bool Reliable_On_Ack(reliable_t *r, const uint8_t *source, int32_t ackID, uint32_t now);
+
+// Retransmit or give up on packets whose timeout has passed
+void Reliable_Poll(reliable_t *r, uint32_t now);
+
+// Current timeout toward destination (rtoInitial if unknown)
+uint32_t Reliable_RTO(const reliable_t *r, const uint8_t *destination);
+
+#endif
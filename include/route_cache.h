@@ -0,0 +1,97 @@
+#ifndef ROUTE_CACHE_H
+#define ROUTE_CACHE_H
+
+#include <stdint.h>
+#include "message.h"
+
+/* Learned reverse routes, keyed by source MAC. A source's data can reach
+   the gateway over several relay paths. Each entry keeps up to
+   ROUTE_CANDIDATES of them as reversed paths (gateway first, source
+   last). Acks and gateway-originated downlink take the candidate with the
+   lowest expected transmission count (ETX), not the path the packet
+   happened to arrive on.
+
+   A path's cost combines two things:
+   - The gateway's measured link to its first hop (link_quality.h).
+   - The end-to-end ratio of acks sent along the path that got through.
+     An ack is counted lost when the source sends the acked packet again.
+
+   The end-to-end ratio starts from a prior: the first-hop delivery times
+   ROUTE_HOP_PRIOR for each further hop, worth ROUTE_PRIOR_WEIGHT acks.
+   With no samples, short paths over good first hops therefore win. The
+   ratio is spread evenly over the hops past the first:
+     cost = 1/q1 + (hops-1) / (p/q1)^(1/(hops-1))
+
+   A candidate not used for ROUTE_MAX_AGE_MS is dropped. A new path
+   replaces the least recently used candidate, and a new source replaces
+   the least recently used source. ROUTE_CANDIDATES 1 keeps only the
+   latest arrival path, which was the original behaviour. */
+
+#ifndef ROUTE_CACHE_SIZE
+#define ROUTE_CACHE_SIZE 32 // Sources Remembered
+#endif
+
+#ifndef ROUTE_CANDIDATES
+#define ROUTE_CANDIDATES 3 // Paths Remembered per Source
+#endif
+
+#ifndef ROUTE_MAX_AGE_MS
+#define ROUTE_MAX_AGE_MS 300000 // Path Lifetime without Traffic
+#endif
+
+#define ROUTE_ACK_HISTORY 8 // Recent Acks per Source (loss attribution)
+#define ROUTE_SAMPLE_WINDOW 32.0f // Ack Counts Halve Beyond This
+#define ROUTE_PRIOR_WEIGHT 4.0f // Prior Worth in Acks
+#define ROUTE_HOP_PRIOR 0.9f // Assumed Delivery of a Hop Past the First
+
+typedef struct {
+  uint8_t used;
+  uint8_t hops; // Forward Rows (source + relays); reverse[hops] is the source
+  uint32_t stamp; // Last Arrival or Ack over it (ms)
+  float acks; // Acks Sent along it (decayed)
+  float lost; // Of Those, Found Lost
+  uint8_t reverse[MAX_NODES][MAC_SIZE]; // Gateway first, source last
+} route_path_t;
+
+typedef struct {
+  uint8_t mac[MAC_SIZE]; // Source MAC
+  uint8_t used;
+  uint8_t ackHead; // Next ackedID Slot
+  uint32_t stamp; // Last Use (ms)
+  route_path_t paths[ROUTE_CANDIDATES];
+  int32_t ackedID[ROUTE_ACK_HISTORY]; // Packet IDs Acked Recently
+  int8_t ackedPath[ROUTE_ACK_HISTORY]; // Candidate each went on (-1 -> none)
+} route_entry_t;
+
+typedef struct {
+  uint32_t hits; // Arrival Path Already Known
+  uint32_t misses; // New Path Learned (unknown source or path)
+  uint32_t evictions; // Live Sources Replaced by a New Source
+  uint32_t expired; // Sources or Paths Dropped for Age
+  uint32_t switches; // Acks Sent on a Cheaper Path than the Arrival Path
+  uint32_t acksLost; // Acks Found Lost (source sent the packet again)
+} route_cache_stats_t;
+
+void Route_Cache_Init();
+
+// Cheapest path to source if the forward path its packet arrived on is already known
+const route_path_t *Route_Cache_Match(const uint8_t *source, const uint8_t path[MAX_NODES][MAC_SIZE], uint8_t hops, uint32_t now);
+
+// Cheapest path to source for downlink traffic, or NULL
+const route_path_t *Route_Cache_Lookup(const uint8_t *source, uint32_t now);
+
+// Add reversed rows 0..hops as a candidate for source. Returns the cheapest path (NULL if hops is out of range)
+const route_path_t *Route_Cache_Store(const uint8_t *source, const uint8_t reverse[MAX_NODES][MAC_SIZE], uint8_t hops, uint32_t now);
+
+// An ack for packetID went to source along path
+void Route_Cache_Ack_Sent(const uint8_t *source, const route_path_t *path, int32_t packetID, uint32_t now);
+
+// Source sent packetID again: the ack for it never arrived
+void Route_Cache_Ack_Lost(const uint8_t *source, int32_t packetID);
+
+// Expected transmissions for one frame along path
+float Route_Cache_Cost(const route_path_t *path);
+
+const route_cache_stats_t *Route_Cache_Get_Stats();
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "uplink.h"
+
+/* Store-and-forward spool for uplink batches that could not be delivered.
+
+   The backing store is a ring of SPOOL_SLOTS fixed-size slots. Each slot
+   holds one batch behind a header carrying a sequence number and a CRC, so
+   a torn write is simply an invalid slot after reboot. Replayed slots are
+   marked consumed by clearing a state byte (only 1 -> 0 bit flips, which
+   raw flash allows without an erase). On start the log is rebuilt from
+   the slot headers alone. */
+
+#ifndef SPOOL_PATH
+#define SPOOL_PATH "/spool.bin" // Spool File
+#endif
+
+#ifndef SPOOL_SLOTS
+#define SPOOL_SLOTS 32 // Batches Kept on Flash
+#endif
+
+#define SPOOL_HEADER_SIZE 16
+#define SPOOL_SLOT_SIZE (SPOOL_HEADER_SIZE + UPLINK_BATCH_BYTES)
+#define SPOOL_STORAGE_SIZE ((uint32_t)SPOOL_SLOTS * SPOOL_SLOT_SIZE)
+
+#ifndef SPOOL_REPLAY_INTERVAL_MS
+#define SPOOL_REPLAY_INTERVAL_MS 100 // Min Gap between Replayed Batches
+#endif
+
+#ifndef SPOOL_RETRY_MS
+#define SPOOL_RETRY_MS 5000 // Back-off after a Failed Replay
+#endif
+
+// Byte-addressable backing store (flash file, raw partition or host file)
+typedef struct {
+  bool (*read)(void *ctx, uint32_t offset, void *buf, size_t len);
+  bool (*write)(void *ctx, uint32_t offset, const void *buf, size_t len);
+  void *ctx;
+} spool_storage_t;
+
+typedef struct {
+  uint32_t depth; // Batches Waiting
+  uint32_t bytes; // Payload Bytes Waiting
+  uint32_t spooled; // Batches Written to the Spool
+  uint32_t replayed; // Batches Delivered from the Spool
+  uint32_t replayedBytes; // Payload Bytes Delivered from the Spool
+  uint32_t overwritten; // Oldest Batches Lost to a Full Spool
+  uint32_t storageErrors; // Failed Reads/Writes
+  uint32_t replayBytesPerSec; // Replay Throughput over the Last Drain
+} spool_stats_t;
+
+// Storage backends (see spool_storage_*.cpp)
+bool Spool_Storage_Open(spool_storage_t *storage, const char *path, uint32_t size);
+
+// Recover the log from storage. transport delivers a batch to the server
+bool Spool_Init(spool_storage_t *storage, uplink_send_fn transport);
+
+// uplink_send_fn for the batcher: sends directly while the spool is empty,
+// otherwise (or on failure) appends to the spool to keep order
+bool Spool_Send(const uint8_t *body, size_t len);
+
+// Append without trying the transport first (a batch it gave up on after accepting it)
+bool Spool_Store(const uint8_t *body, size_t len);
+
+// Replay spooled batches in order, rate-limited. Call from loop()
+void Spool_Drain(uint32_t now);
+
+const spool_stats_t *Spool_Get_Stats();
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stdint.h>
+
+/* Lock-free single-producer / single-consumer ring of fixed-size slots.
+   Storage is a plain array inside the object, so a global instance is
+   statically allocated. One context may call Push (e.g. the Wi-Fi receive
+   callback) while one other context calls Pop (e.g. loop()). */
+
+#ifndef CACHE_LINE_SIZE
+#ifdef ARDUINO
+#define CACHE_LINE_SIZE 32  // ESP32 cache line
+#else
+#define CACHE_LINE_SIZE 64
+#endif
+#endif
+
+enum RingOverflow {
+  RING_DROP_NEWEST, // Reject the incoming item when full
+  RING_DROP_OLDEST, // Discard the oldest queued item to make room
+};
+
+template <typename T, uint32_t N, RingOverflow Policy = RING_DROP_NEWEST>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "Ring capacity must be a power of two");
+
+public:
+  SpscRing() : head(0), tail(0), dropped(0) {}
+
+  // Producer side. Returns false only when the new item itself was dropped.
+  bool Push(const T &item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+
+    if(h - t >= N) {
+      if(Policy == RING_DROP_NEWEST) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      // Claim the oldest slot. If the consumer took it first the CAS fails
+      // and the ring is no longer full either way.
+      if(tail.compare_exchange_strong(t, t + 1, std::memory_order_acq_rel)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    slots[h & (N - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when the ring is empty.
+  bool Pop(T &out) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    for(;;) {
+      uint32_t h = head.load(std::memory_order_acquire);
+      if(t == h) {
+        return false;
+      }
+      out = slots[t & (N - 1)];
+      if(Policy == RING_DROP_NEWEST) {
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+      }
+      // Under drop-oldest the producer may have advanced tail and started
+      // overwriting this slot while we copied it; retry from the new tail.
+      if(tail.compare_exchange_strong(t, t + 1, std::memory_order_acq_rel)) {
+        return true;
+      }
+    }
+  }
+
+  uint32_t Size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  bool Empty() const { return Size() == 0; }
+  uint32_t Capacity() const { return N; }
+  uint32_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> head; // Written by producer only
+  alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> tail; // Written by consumer (and producer on drop-oldest)
+  alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> dropped; // Overflow Count
+  alignas(CACHE_LINE_SIZE) T slots[N];
+};
+
+#endif
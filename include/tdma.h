@@ -0,0 +1,130 @@
+#ifndef TDMA_H
+#define TDMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+
+/* Time sync beacons and TDMA transmit slots.
+
+   The gateway's clock is the network clock. Every TDMA_BEACON_MS it
+   broadcasts a beacon carrying its time, the superframe layout and one
+   slot grant per source it has heard from recently. Each node sets its
+   clock offset from the first copy of a beacon it hears and repeats
+   that copy once, restamped with its own synced time, so the error
+   stays at one hop's delay rather than piling up along the path.
+
+   A superframe is [beacon slot][granted slot 0 .. slots-1][contention
+   slot], each slotUs wide, and starts over at every beacon. A source
+   starts frames only inside its own slot (the contention slot when it
+   has no grant, or any time while it is not synced). A slot covers the
+   whole path: relays forward at once and the gateway's acks come back
+   within it, so no frame is started in the last round trip of a slot.
+   Nodes without a grant share the contention slot, each using it in
+   one superframe out of TDMA_CONTENTION_SPREAD picked by a hash of its
+   MAC and the superframe number, so newcomers rarely pick the same one
+   twice running. Grants are handed out lowest free slot first when a
+   source is first heard, and released after TDMA_IDLE_MS of silence, so the superframe
+   tracks the number of active nodes. */
+
+#ifndef TDMA_BEACON_MS
+#define TDMA_BEACON_MS 1000 // Beacon Interval (0 -> no beacons, nodes send at will)
+#endif
+
+#ifndef TDMA_SLOT_US
+#define TDMA_SLOT_US 10000 // Slot Width: one source's frames and their acks across the whole path
+#endif
+
+#ifndef TDMA_IDLE_MS
+#define TDMA_IDLE_MS 10000 // A Source Silent this Long Gives up its Slot
+#endif
+
+#ifndef TDMA_BEACON_TTL
+#define TDMA_BEACON_TTL 8 // Hops a Beacon Travels
+#endif
+
+#ifndef TDMA_CONTENTION_SPREAD
+#define TDMA_CONTENTION_SPREAD 4 // Superframes per Contention Slot Use by a Node without a Grant
+#endif
+
+#ifndef TDMA_SYNC_TIMEOUT_MS
+#define TDMA_SYNC_TIMEOUT_MS 5000 // Nodes Fall Back to Sending at Will without a Beacon this Long
+#endif
+
+// Broadcast an encoded frame. Returns true if the radio accepted it
+typedef bool (*tdma_send_fn)(void *ctx, const uint8_t *frame, size_t len);
+
+typedef struct {
+  bool used;
+  uint8_t mac[MAC_SIZE];
+  uint32_t lastUs; // Last Heard
+} tdma_grant_t;
+
+typedef struct {
+  uint32_t beacons; // Sent
+  uint32_t granted; // Slots Handed Out
+  uint32_t released; // Slots Freed after TDMA_IDLE_MS
+  uint32_t full; // Sources Left in the Contention Slot for Lack of a Free One
+} tdma_stats_t;
+
+typedef struct {
+  tdma_send_fn send;
+  void *ctx;
+  uint32_t beaconMs; // 0 -> off
+  uint32_t slotUs;
+  tdma_grant_t grants[BEACON_MAX_GRANTS]; // Index is the Slot
+  uint8_t slots; // Announced in the Last Beacon
+  uint16_t seq;
+  bool started;
+  uint32_t epochUs; // Start of the Current Superframe Layout (time of the last beacon)
+  tdma_stats_t stats;
+} tdma_schedule_t;
+
+typedef struct {
+  uint32_t beacons; // First Copies Heard
+  uint32_t repeats; // Later Copies Heard
+} tdma_node_stats_t;
+
+typedef struct {
+  uint8_t self[MAC_SIZE];
+  uint32_t hopDelayUs; // Expected Time from Stamping a Beacon to Hearing it (airtime and stack)
+  bool synced;
+  uint32_t offsetUs; // Network Time - Local Time (mod 2^32)
+  uint32_t beaconAt; // Local Time of the Last Beacon
+  uint16_t seq;
+  uint8_t depth; // Hops from the Gateway
+  uint32_t epochUs;
+  uint32_t slotUs;
+  uint8_t slots;
+  int slot; // Own Grant, -1 -> contention slot
+  tdma_node_stats_t stats;
+} tdma_node_t;
+
+/* Gateway */
+void Tdma_Init(tdma_schedule_t *t, tdma_send_fn send, void *ctx);
+
+// Data heard from source: keep or hand out its slot
+void Tdma_Register(tdma_schedule_t *t, const uint8_t *source, uint32_t nowUs);
+
+// Send the next beacon when it is due (at a superframe boundary)
+void Tdma_Poll(tdma_schedule_t *t, uint32_t nowUs);
+
+// Sources currently holding a slot
+int Tdma_Active(const tdma_schedule_t *t);
+
+/* Node */
+void Tdma_Node_Init(tdma_node_t *n, const uint8_t *self, uint32_t hopDelayUs);
+
+// Beacon heard at localUs. True for the first copy: repeat it if its TTL is above 1
+bool Tdma_Node_On_Beacon(tdma_node_t *n, const beacon_t *beacon, uint32_t localUs);
+
+// Turn a first copy into this node's repeat, sent at localUs (one hop less, time restamped)
+void Tdma_Node_Restamp(const tdma_node_t *n, beacon_t *beacon, uint32_t localUs);
+
+// Network time for a local time (local time itself until synced)
+uint32_t Tdma_Node_Time(const tdma_node_t *n, uint32_t localUs);
+
+// True if a frame may be started now
+bool Tdma_Node_May_Send(const tdma_node_t *n, uint32_t localUs);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+#include "record_writer.h"
+
+/* Uplink batching: records are gathered into one array body (a JSON array,
+   or a MessagePack array16) and handed to the transport when the batch is
+   full or a record has waited as long as its class allows: alarms
+   UPLINK_ALARM_LATENCY_MS, everything else UPLINK_MAX_LATENCY_MS. */
+
+#ifndef UPLINK_BATCH_BYTES
+#define UPLINK_BATCH_BYTES 8192 // Batch Body Buffer (fits a base64 REASSEMBLY_MAX_BYTES payload)
+#endif
+
+#ifndef UPLINK_BATCH_RECORDS
+#define UPLINK_BATCH_RECORDS 8 // Records per Batch
+#endif
+
+#ifndef UPLINK_FORMAT
+#define UPLINK_FORMAT RECORD_JSON // Record Encoding (RECORD_JSON / RECORD_MSGPACK)
+#endif
+
+#ifndef UPLINK_MAX_LATENCY_MS
+#define UPLINK_MAX_LATENCY_MS 500 // Max Time a Record Waits
+#endif
+
+#ifndef UPLINK_ALARM_LATENCY_MS
+#define UPLINK_ALARM_LATENCY_MS 0 // Max Time an Alarm Record Waits (0 -> flushed by the next Uplink_Poll)
+#endif
+
+// Transport: POST body (see Uplink_Content_Type). Returns true on success
+typedef bool (*uplink_send_fn)(const uint8_t *body, size_t len);
+
+enum uplink_transport {
+  UPLINK_HTTP, // POST per Batch over a Kept-Alive Connection
+  UPLINK_UDP,  // Sequenced Datagram per Batch, Cumulative Acks (datagram.h)
+};
+
+#ifndef UPLINK_TRANSPORT
+#define UPLINK_TRANSPORT UPLINK_HTTP // Default Transport (may be changed at run time before setup)
+#endif
+
+enum uplink_flush_reason {
+  UPLINK_FLUSH_SIZE,     // Next record would not fit
+  UPLINK_FLUSH_COUNT,    // UPLINK_BATCH_RECORDS reached
+  UPLINK_FLUSH_DEADLINE, // UPLINK_MAX_LATENCY_MS reached
+  UPLINK_FLUSH_ALARM,    // UPLINK_ALARM_LATENCY_MS reached
+  UPLINK_FLUSH_FORCED,   // Explicit Uplink_Flush
+  UPLINK_FLUSH_REASONS,
+};
+
+typedef struct {
+  uint32_t records; // Records Accepted
+  uint32_t alarms; // Alarm Records Accepted
+  uint32_t batches; // Batches Sent
+  uint32_t failures; // Batches the Transport Rejected
+  uint32_t oversize; // Records Larger than the Batch Buffer
+  uint32_t flushes[UPLINK_FLUSH_REASONS]; // Flush Count per Reason
+  uint16_t lastBatchRecords; // Size of Most Recent Batch
+  uint16_t maxBatchRecords; // Largest Batch Sent
+} uplink_stats_t;
+
+void Uplink_Init(uplink_send_fn send, record_format format);
+
+// Serialize msg directly into the batch (its deadline set by msg->priority). May flush first (size) or after (count)
+bool Uplink_Add_Message(const message_t *msg, uint32_t now);
+
+// Same, with a reassembled payload
+bool Uplink_Add_Payload(const message_t *msg, const uint8_t *payload, size_t len, uint32_t now);
+
+// Serialize an aggregation window summary into the batch
+bool Uplink_Add_Summary(const aggregate_summary_t *summary, uint32_t now);
+
+// Queue one already encoded record (in the batch format)
+bool Uplink_Add_Record(const uint8_t *record, size_t len, uint32_t now);
+
+// Flush if a pending record has reached its deadline
+void Uplink_Poll(uint32_t now);
+
+void Uplink_Flush(uplink_flush_reason reason);
+
+uint16_t Uplink_Pending();
+const char *Uplink_Content_Type();
+const uplink_stats_t *Uplink_Get_Stats();
+
+#endif
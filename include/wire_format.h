@@ -0,0 +1,100 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+
+/* Compact over-the-air encoding of message_t (all multi-byte fields little-endian)
+
+   off  size  field
+   0    1     version (WIRE_VERSION)
+   1    1     flags (WIRE_FLAG_*)
+   2    1     identification
+   3    1     TTL
+   4    4     packetID
+   8    6     destination_mac
+   14   6     source_mac
+   20   1     Path_Index
+   21   1     Path_Length
+   22   1     hop count H
+   23   6*H   Path_Array rows 0..H-1 (trailing all-zero rows are not sent)
+   ..   1     text length T (terminator not sent)
+   ..   T     text
+   ..   4     ackID, only with WIRE_FLAG_ACK_ID (older decoders ignore it)
+   ..   4     captured (network time, ms), only with WIRE_FLAG_CAPTURED
+
+   Fragment frames (version WIRE_VERSION_FRAGMENT, so older decoders
+   reject them) carry the same header and path, and in place of the text:
+
+   ..   2     messageID
+   ..   1     index
+   ..   1     count
+   ..   2     total payload length
+   ..   2     offset of this chunk
+   ..   1     chunk length C
+   ..   C     chunk
+
+   Beacon frames (version WIRE_VERSION_BEACON) carry no message_t:
+
+   0    1     version
+   1    1     TTL
+   2    1     hops travelled
+   3    2     seq
+   5    4     network time when sent (us)
+   9    4     superframe epoch (us)
+   13   4     slot width (us)
+   17   1     granted slots
+   18   1     grant count G
+   19   7*G   grants: MAC, slot
+
+   Frames exactly WIRE_LEGACY_SIZE long are taken as the legacy raw struct
+   layout (message_t up to ackID), which is larger than any compact data
+   frame, unless their first byte is WIRE_VERSION_FRAGMENT or
+   WIRE_VERSION_BEACON: fragments and beacons can be that long too, and
+   legacy text never starts with those control bytes. */
+
+#define WIRE_VERSION 1
+#define WIRE_VERSION_FRAGMENT 2
+#define WIRE_VERSION_BEACON 3
+
+#define WIRE_FLAG_BROADCAST_ACK 0x01
+#define WIRE_FLAG_DATA_ACK      0x02
+#define WIRE_FLAG_PATH_EXIST    0x04
+#define WIRE_FLAG_ACK_ID        0x08
+#define WIRE_PRIORITY_SHIFT     4
+#define WIRE_PRIORITY_MASK      0x30 // Older decoders ignore it: their frames decode as PRIORITY_NORMAL
+#define WIRE_FLAG_CAPTURED      0x40
+
+#define WIRE_HEADER_SIZE 23
+#define WIRE_TEXT_MAX (sizeof(((message_t *)0)->text) - 1)
+#define WIRE_MAX_FRAME (WIRE_HEADER_SIZE + MAX_NODES * MAC_SIZE + 1 + WIRE_TEXT_MAX + 4 + 4)
+#define WIRE_LEGACY_SIZE offsetof(message_t, ackID)
+#define WIRE_FRAGMENT_HEADER_SIZE 9
+#define WIRE_BEACON_HEADER_SIZE 19
+#define WIRE_BEACON_GRANT_SIZE (MAC_SIZE + 1)
+
+#ifndef WIRE_LEGACY_TX
+#define WIRE_LEGACY_TX 0 // 1 -> Transmit raw message_t for nodes without the codec
+#endif
+
+// Encode packet into out. Returns frame length, or 0 if cap is too small
+size_t Wire_Encode(const message_t *msg, uint8_t *out, size_t cap);
+
+// Decode compact or legacy frame into msg. Returns false on malformed input
+bool Wire_Decode(const uint8_t *data, size_t len, message_t *msg);
+
+// Largest chunk that still fits ESPNOW_MTU once the path holds reserveHops rows
+size_t Wire_Fragment_Chunk(uint8_t reserveHops);
+
+bool Wire_Is_Fragment(const uint8_t *data, size_t len);
+
+// Fragment frame: msg supplies header and path (text is not sent)
+size_t Wire_Encode_Fragment(const message_t *msg, const fragment_t *fragment, uint8_t *out, size_t cap);
+bool Wire_Decode_Fragment(const uint8_t *data, size_t len, message_t *msg, fragment_t *fragment);
+
+bool Wire_Is_Beacon(const uint8_t *data, size_t len);
+size_t Wire_Encode_Beacon(const beacon_t *beacon, uint8_t *out, size_t cap);
+bool Wire_Decode_Beacon(const uint8_t *data, size_t len, beacon_t *beacon);
+
+#endif
@@ -0,0 +1,216 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aggregate.h"
+
+typedef struct {
+  uint8_t mac[MAC_SIZE];
+  bool used;
+  bool passthrough;
+  uint32_t count; // Readings in the Open Window (0 -> no window)
+  double min;
+  double max;
+  double sum;
+  double last;
+  uint32_t firstMs;
+  uint32_t lastMs;
+  int32_t lastPacketID;
+} aggregate_entry_t;
+
+/* Aggregate Variables */
+static aggregate_entry_t entries[AGGREGATE_SOURCES];
+static aggregate_emit_fn emitSummary = NULL;
+static uint32_t windowMs = AGGREGATE_WINDOW_MS;
+static uint32_t windowCount = AGGREGATE_WINDOW_COUNT;
+static aggregate_stats_t stats;
+
+void Aggregate_Init(aggregate_emit_fn emit) {
+  memset(entries, 0, sizeof(entries));
+  memset(&stats, 0, sizeof(stats));
+  emitSummary = emit;
+}
+
+// Entry for source; claims a free one if create is set
+static aggregate_entry_t *Aggregate_Find(const uint8_t *source, bool create) {
+  aggregate_entry_t *vacant = NULL;
+  for(int i = 0; i < AGGREGATE_SOURCES; i++) {
+    if(entries[i].used) {
+      if(memcmp(entries[i].mac, source, MAC_SIZE) == 0) {
+        return &entries[i];
+      }
+    } else if(vacant == NULL) {
+      vacant = &entries[i];
+    }
+  }
+  if(!create || vacant == NULL) {
+    return NULL;
+  }
+  memset(vacant, 0, sizeof(*vacant));
+  memcpy(vacant->mac, source, MAC_SIZE);
+  vacant->used = true;
+  return vacant;
+}
+
+static void Aggregate_Emit(aggregate_entry_t *entry, uint32_t now) {
+  aggregate_summary_t summary;
+  memcpy(summary.source, entry->mac, MAC_SIZE);
+  summary.count = entry->count;
+  summary.min = entry->min;
+  summary.max = entry->max;
+  summary.mean = entry->sum / entry->count;
+  summary.last = entry->last;
+  summary.firstMs = entry->firstMs;
+  summary.lastMs = entry->lastMs;
+  summary.lastPacketID = entry->lastPacketID;
+  entry->count = 0;
+
+  stats.summaries++;
+  if(emitSummary == NULL || !emitSummary(&summary, now)) {
+    stats.lost++;
+  }
+}
+
+// Emit the window and give the entry back unless the source is marked
+static void Aggregate_Close(aggregate_entry_t *entry, uint32_t now) {
+  Aggregate_Emit(entry, now);
+  if(!entry->passthrough) {
+    entry->used = false; // A Quiet Source must not Hold an Entry
+  }
+}
+
+void Aggregate_Configure(uint32_t ms, uint32_t count) {
+  for(int i = 0; i < AGGREGATE_SOURCES; i++) {
+    if(entries[i].used && entries[i].count > 0) {
+      Aggregate_Close(&entries[i], entries[i].lastMs); // Windows Closed under the Old Rules
+    }
+  }
+  windowMs = ms;
+  windowCount = count;
+}
+
+bool Aggregate_Set_Passthrough(const uint8_t *source, bool passthrough) {
+  aggregate_entry_t *entry = Aggregate_Find(source, true);
+  if(entry == NULL) {
+    return false;
+  }
+  entry->passthrough = passthrough;
+  if(passthrough && entry->count > 0) {
+    Aggregate_Close(entry, entry->lastMs); // Close what was gathered so far
+  }
+  if(!passthrough && entry->count == 0) {
+    entry->used = false;
+  }
+  return true;
+}
+
+int Aggregate_Set_Passthrough_List(const char *list) {
+  int marked = 0;
+  while(*list != '\0') {
+    unsigned int mac[MAC_SIZE];
+    int used = 0;
+    if(sscanf(list, " %2x:%2x:%2x:%2x:%2x:%2x%n", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5], &used) != MAC_SIZE) {
+      return -1;
+    }
+    uint8_t source[MAC_SIZE];
+    for(int i = 0; i < MAC_SIZE; i++) {
+      source[i] = (uint8_t)mac[i];
+    }
+    if(!Aggregate_Set_Passthrough(source, true)) {
+      return -1; // More Sources than Entries
+    }
+    marked++;
+    list += used;
+    while(*list == ' ') {
+      list++;
+    }
+    if(*list == ',') {
+      list++;
+    } else if(*list != '\0') {
+      return -1;
+    }
+  }
+  return marked;
+}
+
+bool Aggregate_Parse(const unsigned char *text, size_t max, double *value) {
+  char buffer[sizeof(((message_t *)0)->text) + 1];
+  size_t len = strnlen((const char *)text, max < sizeof(buffer) - 1 ? max : sizeof(buffer) - 1);
+  memcpy(buffer, text, len);
+  buffer[len] = '\0';
+
+  char *end;
+  double parsed = strtod(buffer, &end);
+  if(end == buffer) {
+    return false;
+  }
+  while(*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n') {
+    end++;
+  }
+  if(*end != '\0' || !isfinite(parsed)) {
+    return false;
+  }
+  *value = parsed;
+  return true;
+}
+
+bool Aggregate_Add(const message_t *msg, uint32_t now) {
+  double value;
+  if((windowMs == 0 && windowCount == 0) || !Aggregate_Parse(msg->text, sizeof(msg->text), &value)) {
+    stats.raw++;
+    return false;
+  }
+
+  aggregate_entry_t *entry = Aggregate_Find(msg->source_mac, true);
+  if(entry == NULL || entry->passthrough) {
+    stats.raw++;
+    return false;
+  }
+
+  if(windowMs > 0 && entry->count > 0 && (uint32_t)(now - entry->firstMs) >= windowMs) {
+    Aggregate_Emit(entry, now); // Window Ran Out before Poll Saw it, this Reading Opens the Next
+  }
+  if(entry->count == 0) {
+    entry->min = value;
+    entry->max = value;
+    entry->sum = 0;
+    entry->firstMs = now;
+  }
+  entry->count++;
+  entry->sum += value;
+  entry->min = value < entry->min ? value : entry->min;
+  entry->max = value > entry->max ? value : entry->max;
+  entry->last = value;
+  entry->lastMs = now;
+  entry->lastPacketID = msg->packetID;
+  stats.readings++;
+
+  if(windowCount > 0 && entry->count >= windowCount) {
+    Aggregate_Close(entry, now);
+  }
+  return true;
+}
+
+void Aggregate_Poll(uint32_t now) {
+  if(windowMs == 0) {
+    return;
+  }
+  for(int i = 0; i < AGGREGATE_SOURCES; i++) {
+    aggregate_entry_t *entry = &entries[i];
+    if(entry->used && entry->count > 0 && (uint32_t)(now - entry->firstMs) >= windowMs) {
+      Aggregate_Close(entry, now);
+    }
+  }
+}
+
+void Aggregate_Flush(uint32_t now) {
+  for(int i = 0; i < AGGREGATE_SOURCES; i++) {
+    if(entries[i].used && entries[i].count > 0) {
+      Aggregate_Close(&entries[i], now);
+    }
+  }
+}
+
+const aggregate_stats_t *Aggregate_Get_Stats() {
+  return &stats;
+}
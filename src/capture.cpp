@@ -0,0 +1,123 @@
+#include <atomic>
+#include <string.h>
+#include "capture.h"
+#include "spsc_ring.h"
+
+static const uint8_t captureMagic[5] = {'E', 'N', 'C', 'P', CAPTURE_VERSION};
+
+/* Capture Variables */
+static SpscRing<capture_frame_t, CAPTURE_RING_SIZE> ring;
+static capture_write_fn writeSink = NULL;
+static uint8_t gatewayMac[MAC_SIZE];
+static uint32_t lastStamp = 0; // Producer Only
+static bool stampValid = false;
+static std::atomic<uint32_t> captured(0);
+static std::atomic<uint32_t> written(0);
+
+/* Consumer State: one record in flight at a time, so a sink that takes
+   part of it never splits the stream */
+static uint8_t pending[CAPTURE_RECORD_MAX];
+static size_t pendingLen = 0;
+static size_t pendingSent = 0;
+static bool pendingRecord = false; // pending Holds a Record (not the Header)
+
+void Capture_Init(capture_write_fn write, const uint8_t *self) {
+  writeSink = write;
+  memcpy(gatewayMac, self, MAC_SIZE);
+  pendingLen = 0;
+  pendingSent = 0;
+}
+
+void Capture_Frame(const uint8_t *mac, const uint8_t *data, int len, uint32_t nowUs) {
+  if(writeSink == NULL || len <= 0 || len > ESPNOW_MTU) {
+    return;
+  }
+  capture_frame_t frame;
+  frame.deltaUs = stampValid ? nowUs - lastStamp : 0;
+  lastStamp = nowUs;
+  stampValid = true;
+  memcpy(frame.mac, mac, MAC_SIZE);
+  frame.len = (uint8_t)len;
+  memcpy(frame.data, data, (size_t)len);
+  if(ring.Push(frame)) {
+    captured.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Capture_Start_Stream() {
+  // A record cut short by the old sink is abandoned; the header leads the new stream
+  memcpy(pending, captureMagic, sizeof(captureMagic));
+  pending[5] = 0;
+  memcpy(&pending[6], gatewayMac, MAC_SIZE);
+  pendingLen = CAPTURE_HEADER_SIZE;
+  pendingSent = 0;
+  pendingRecord = false;
+}
+
+static void Put_U32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t Get_U32(const uint8_t *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+void Capture_Drain() {
+  if(writeSink == NULL) {
+    return;
+  }
+  for(;;) {
+    if(pendingSent == pendingLen) {
+      if(pendingRecord && pendingLen > 0) {
+        written.fetch_add(1, std::memory_order_relaxed);
+      }
+      capture_frame_t frame;
+      if(!ring.Pop(frame)) {
+        pendingLen = pendingSent = 0;
+        return;
+      }
+      Put_U32(pending, frame.deltaUs);
+      memcpy(&pending[4], frame.mac, MAC_SIZE);
+      pending[10] = frame.len;
+      memcpy(&pending[CAPTURE_RECORD_HEADER_SIZE], frame.data, frame.len);
+      pendingLen = CAPTURE_RECORD_HEADER_SIZE + frame.len;
+      pendingSent = 0;
+      pendingRecord = true;
+    }
+    size_t n = writeSink(&pending[pendingSent], pendingLen - pendingSent);
+    if(n == 0) {
+      return; // Sink Busy (or no client): retry on the next drain
+    }
+    pendingSent += n;
+  }
+}
+
+bool Capture_Check_Header(const uint8_t *buf, size_t len, uint8_t *gateway) {
+  if(len < CAPTURE_HEADER_SIZE || memcmp(buf, captureMagic, sizeof(captureMagic)) != 0) {
+    return false;
+  }
+  memcpy(gateway, &buf[6], MAC_SIZE);
+  return true;
+}
+
+size_t Capture_Parse(const uint8_t *buf, size_t len, capture_frame_t *frame) {
+  if(len < CAPTURE_RECORD_HEADER_SIZE || len < (size_t)CAPTURE_RECORD_HEADER_SIZE + buf[10]) {
+    return 0;
+  }
+  frame->deltaUs = Get_U32(buf);
+  memcpy(frame->mac, &buf[4], MAC_SIZE);
+  frame->len = buf[10];
+  memcpy(frame->data, &buf[CAPTURE_RECORD_HEADER_SIZE], frame->len);
+  return CAPTURE_RECORD_HEADER_SIZE + frame->len;
+}
+
+capture_stats_t Capture_Get_Stats() {
+  capture_stats_t stats;
+  stats.captured = captured.load(std::memory_order_relaxed);
+  stats.dropped = ring.Dropped();
+  stats.written = written.load(std::memory_order_relaxed);
+  return stats;
+}
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "command.h"
+#include "metrics.h"
+#include "spsc_ring.h"
+
+#define COMMAND_REPORT_RING 16 // Outcomes Waiting for loop() (power of two)
+#define COMMAND_OUTBOX (COMMAND_REPORT_MAX * 8) // Report Text Waiting for the Client
+
+typedef struct {
+  uint32_t id;
+  uint8_t status; // command_status
+  uint32_t latency; // Delivered / Failed (us)
+} command_report_t;
+
+typedef struct {
+  bool used;
+  uint32_t id;
+  uint8_t mac[MAC_SIZE];
+  int32_t packetID;
+  uint32_t received;
+} command_pending_t;
+
+/* Command Variables */
+static SpscRing<command_t, COMMAND_QUEUE_SIZE> commands; // loop() -> Route Stage
+static SpscRing<command_report_t, COMMAND_REPORT_RING> reports; // Route Stage -> loop()
+static command_pending_t pending[COMMAND_PENDING]; // Route Stage Only
+static command_read_fn readClient = NULL;
+static command_write_fn writeClient = NULL;
+static command_stats_t stats;
+
+/* loop() State */
+static char line[COMMAND_LINE_MAX + 1];
+static size_t lineLen = 0;
+static bool lineTooLong = false; // Discarding up to the Next Newline
+static char outbox[COMMAND_OUTBOX];
+static size_t outboxLen = 0;
+
+void Command_Init(command_read_fn read, command_write_fn write) {
+  readClient = read;
+  writeClient = write;
+  memset(pending, 0, sizeof(pending));
+  memset(&stats, 0, sizeof(stats));
+  lineLen = 0;
+  lineTooLong = false;
+  outboxLen = 0;
+}
+
+void Command_Start_Stream() {
+  lineLen = 0;
+  lineTooLong = false;
+  outboxLen = 0;
+}
+
+// Format one outcome into the outbox. False if it does not fit yet
+static bool Command_Report_Line(uint32_t id, command_status status, uint32_t latency) {
+  static const char *const names[] = {"delivered", "failed", "noroute", "busy", "malformed"};
+  char text[COMMAND_REPORT_MAX];
+  int n = status == COMMAND_DELIVERED || status == COMMAND_FAILED
+              ? snprintf(text, sizeof(text), "%lu %s %lu\n", (unsigned long)id, names[status], (unsigned long)latency)
+              : snprintf(text, sizeof(text), "%lu %s\n", (unsigned long)id, names[status]);
+  if(n <= 0 || (size_t)n > sizeof(outbox) - outboxLen) {
+    return false;
+  }
+  memcpy(&outbox[outboxLen], text, (size_t)n);
+  outboxLen += (size_t)n;
+
+  switch(status) {
+    case COMMAND_DELIVERED:
+      stats.delivered++;
+      stats.latency += latency;
+      stats.lastLatency = latency;
+      break;
+    case COMMAND_FAILED: stats.failed++; break;
+    case COMMAND_NO_ROUTE: stats.noRoute++; break;
+    case COMMAND_BUSY: stats.busy++; break;
+    case COMMAND_MALFORMED: stats.malformed++; break;
+  }
+  return true;
+}
+
+// "<id> <aa:bb:cc:dd:ee:ff> <text>"
+static bool Command_Parse(const char *text, command_t *command) {
+  char *end;
+  unsigned long id = strtoul(text, &end, 10);
+  if(end == text || *end != ' ' || id > 0xFFFFFFFFul) {
+    return false;
+  }
+  command->id = (uint32_t)id;
+  unsigned int mac[MAC_SIZE];
+  int used = 0;
+  if(sscanf(end + 1, "%2x:%2x:%2x:%2x:%2x:%2x%n", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5], &used) != MAC_SIZE ||
+     end[1 + used] != ' ') {
+    return false;
+  }
+  for(int i = 0; i < MAC_SIZE; i++) {
+    command->mac[i] = (uint8_t)mac[i];
+  }
+  const char *body = end + 2 + used;
+  size_t len = strlen(body);
+  if(len == 0 || len > COMMAND_TEXT_MAX) {
+    return false;
+  }
+  memcpy(command->text, body, len + 1);
+  return true;
+}
+
+// A complete line: queue it, or answer it straight away
+static bool Command_Line(uint32_t nowUs) {
+  while(lineLen > 0 && line[lineLen - 1] == '\r') {
+    lineLen--;
+  }
+  line[lineLen] = '\0';
+  if(lineLen == 0) {
+    return false; // Blank Line (keepalive)
+  }
+
+  command_t command;
+  memset(&command, 0, sizeof(command));
+  if(lineTooLong || !Command_Parse(line, &command)) {
+    Command_Report_Line((uint32_t)strtoul(line, NULL, 10), COMMAND_MALFORMED, 0);
+    return false;
+  }
+  command.received = nowUs;
+  if(!commands.Push(command)) {
+    Command_Report_Line(command.id, COMMAND_BUSY, 0);
+    return false;
+  }
+  stats.received++;
+  return true;
+}
+
+int Command_Service(uint32_t nowUs) {
+  int queued = 0;
+  uint8_t chunk[64];
+  size_t n;
+  while(readClient != NULL && (n = readClient(chunk, sizeof(chunk))) > 0) {
+    for(size_t i = 0; i < n; i++) {
+      if(chunk[i] == '\n') {
+        queued += Command_Line(nowUs);
+        lineLen = 0;
+        lineTooLong = false;
+      } else if(lineLen < COMMAND_LINE_MAX) {
+        line[lineLen++] = (char)chunk[i];
+      } else {
+        lineTooLong = true; // Keep the head for the id in the report
+      }
+    }
+  }
+
+  // Outcomes from the route stage, as many as the outbox holds
+  command_report_t report;
+  while(sizeof(outbox) - outboxLen >= COMMAND_REPORT_MAX && reports.Pop(report)) {
+    Command_Report_Line(report.id, (command_status)report.status, report.latency);
+  }
+
+  if(writeClient != NULL && outboxLen > 0) {
+    size_t sent = writeClient((const uint8_t *)outbox, outboxLen);
+    memmove(outbox, &outbox[sent], outboxLen - sent);
+    outboxLen -= sent;
+  }
+  return queued;
+}
+
+bool Command_Next(command_t *command) {
+  for(int i = 0; i < COMMAND_PENDING; i++) {
+    if(!pending[i].used) {
+      return commands.Pop(*command);
+    }
+  }
+  return false; // Every Slot Awaiting an Ack
+}
+
+static void Command_Report(uint32_t id, command_status status, uint32_t latency) {
+  command_report_t report = {id, (uint8_t)status, latency};
+  if(!reports.Push(report)) {
+    stats.reportsDropped++;
+  }
+}
+
+void Command_Sent(const command_t *command, int32_t packetID) {
+  for(int i = 0; i < COMMAND_PENDING; i++) {
+    command_pending_t *slot = &pending[i];
+    if(!slot->used) {
+      slot->used = true;
+      slot->id = command->id;
+      memcpy(slot->mac, command->mac, MAC_SIZE);
+      slot->packetID = packetID;
+      slot->received = command->received;
+      stats.sent++;
+      return;
+    }
+  }
+}
+
+void Command_Rejected(const command_t *command, command_status status) {
+  Command_Report(command->id, status, 0);
+}
+
+static command_pending_t *Command_Find(const uint8_t *node, int32_t packetID) {
+  for(int i = 0; i < COMMAND_PENDING; i++) {
+    command_pending_t *slot = &pending[i];
+    if(slot->used && slot->packetID == packetID && memcmp(slot->mac, node, MAC_SIZE) == 0) {
+      return slot;
+    }
+  }
+  return NULL;
+}
+
+bool Command_On_Ack(const uint8_t *node, int32_t packetID, uint32_t nowUs) {
+  command_pending_t *slot = Command_Find(node, packetID);
+  if(slot == NULL) {
+    return false;
+  }
+  slot->used = false;
+  Metrics_Observe(HIST_COMMAND_RTT, nowUs - slot->received);
+  Command_Report(slot->id, COMMAND_DELIVERED, nowUs - slot->received);
+  return true;
+}
+
+bool Command_On_Failed(const uint8_t *node, int32_t packetID, uint32_t nowUs) {
+  command_pending_t *slot = Command_Find(node, packetID);
+  if(slot == NULL) {
+    return false;
+  }
+  slot->used = false;
+  Command_Report(slot->id, COMMAND_FAILED, nowUs - slot->received);
+  return true;
+}
+
+const command_stats_t *Command_Get_Stats() {
+  return &stats;
+}
@@ -0,0 +1,182 @@
+#include <string.h>
+#include "compress.h"
+
+#define COMPRESS_MIN_MATCH 3
+#define COMPRESS_MAX_MATCH 258
+#define COMPRESS_MAX_DISTANCE 32768
+#define GZIP_HEADER_SIZE 10
+#define GZIP_TRAILER_SIZE 8
+
+/* Compress Variables */
+static uint16_t head[1u << COMPRESS_HASH_BITS]; // Position + 1 of the Latest Prefix (0 -> none)
+static compress_stats_t stats;
+
+/* Deflate length and distance code tables (RFC 1951 3.2.5) */
+static const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                          513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/* LSB-first bit writer into a bounded buffer; stays failed once full */
+typedef struct {
+  uint8_t *p;
+  uint8_t *end;
+  uint32_t bits;
+  int count;
+  bool ok;
+} bit_writer_t;
+
+static void Put_Bits(bit_writer_t *w, uint32_t value, int n) {
+  w->bits |= value << w->count;
+  w->count += n;
+  while(w->count >= 8) {
+    if(w->p == w->end) {
+      w->ok = false;
+      w->count = 0;
+      return;
+    }
+    *w->p++ = (uint8_t)w->bits;
+    w->bits >>= 8;
+    w->count -= 8;
+  }
+}
+
+// Huffman codes go out most significant bit first
+static void Put_Code(bit_writer_t *w, uint32_t code, int n) {
+  uint32_t reversed = 0;
+  for(int i = 0; i < n; i++) {
+    reversed = (reversed << 1) | ((code >> i) & 1u);
+  }
+  Put_Bits(w, reversed, n);
+}
+
+// Fixed literal/length code (RFC 1951 3.2.6)
+static void Put_Symbol(bit_writer_t *w, int symbol) {
+  if(symbol < 144) {
+    Put_Code(w, 0x30 + symbol, 8);
+  } else if(symbol < 256) {
+    Put_Code(w, 0x190 + symbol - 144, 9);
+  } else if(symbol < 280) {
+    Put_Code(w, symbol - 256, 7);
+  } else {
+    Put_Code(w, 0xC0 + symbol - 280, 8);
+  }
+}
+
+static void Put_Match(bit_writer_t *w, int length, int distance) {
+  int code = 0;
+  while(code < 28 && lengthBase[code + 1] <= length) {
+    code++;
+  }
+  Put_Symbol(w, 257 + code);
+  Put_Bits(w, length - lengthBase[code], lengthExtra[code]);
+
+  code = 0;
+  while(code < 29 && distanceBase[code + 1] <= distance) {
+    code++;
+  }
+  Put_Code(w, code, 5);
+  Put_Bits(w, distance - distanceBase[code], distanceExtra[code]);
+}
+
+static inline uint32_t Prefix_Hash(const uint8_t *p) {
+  uint32_t v = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16;
+  return (v * 2654435761u) >> (32 - COMPRESS_HASH_BITS);
+}
+
+static uint32_t Crc32(const uint8_t *data, size_t len) {
+  static const uint32_t nibble[16] = {0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+                                      0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+                                      0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  uint32_t crc = 0xFFFFFFFF;
+  for(size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ nibble[crc & 0x0F];
+    crc = (crc >> 4) ^ nibble[crc & 0x0F];
+  }
+  return crc ^ 0xFFFFFFFF;
+}
+
+static void Put_U32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+size_t Compress_Gzip(const uint8_t *in, size_t len, uint8_t *out, size_t cap) {
+  stats.batches++;
+  if(len > COMPRESS_MAX_INPUT || cap <= GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE) {
+    stats.skipped++;
+    return 0;
+  }
+
+  static const uint8_t header[GZIP_HEADER_SIZE] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF}; // Deflate, no name, OS unknown
+  memcpy(out, header, sizeof(header));
+
+  bit_writer_t w = {out + GZIP_HEADER_SIZE, out + cap - GZIP_TRAILER_SIZE, 0, 0, true};
+  Put_Bits(&w, 1, 1); // BFINAL
+  Put_Bits(&w, 1, 2); // BTYPE = Fixed Huffman
+
+  memset(head, 0, sizeof(head));
+  size_t pos = 0;
+  while(pos < len && w.ok) {
+    int best = 0;
+    size_t bestFrom = 0;
+    if(pos + COMPRESS_MIN_MATCH <= len) {
+      uint32_t h = Prefix_Hash(&in[pos]);
+      size_t from = head[h];
+      head[h] = (uint16_t)(pos + 1);
+      if(from != 0 && pos - (from - 1) <= COMPRESS_MAX_DISTANCE) {
+        from--;
+        size_t limit = len - pos < COMPRESS_MAX_MATCH ? len - pos : COMPRESS_MAX_MATCH;
+        size_t n = 0;
+        while(n < limit && in[from + n] == in[pos + n]) {
+          n++;
+        }
+        if(n >= COMPRESS_MIN_MATCH) {
+          best = (int)n;
+          bestFrom = from;
+        }
+      }
+    }
+
+    if(best == 0) {
+      Put_Symbol(&w, in[pos]);
+      pos++;
+      continue;
+    }
+
+    Put_Match(&w, best, (int)(pos - bestFrom));
+    // Index the prefixes inside the match so later records find them
+    size_t stop = pos + best;
+    for(pos++; pos < stop; pos++) {
+      if(pos + COMPRESS_MIN_MATCH <= len) {
+        head[Prefix_Hash(&in[pos])] = (uint16_t)(pos + 1);
+      }
+    }
+  }
+
+  Put_Symbol(&w, 256); // End of Block
+  if(w.count > 0) {
+    Put_Bits(&w, 0, 8 - w.count); // Pad the Last Byte
+  }
+  size_t used = (size_t)(w.p - out);
+  if(!w.ok || used + GZIP_TRAILER_SIZE >= len) {
+    stats.skipped++;
+    return 0; // Raw is as small
+  }
+
+  Put_U32(out + used, Crc32(in, len));
+  Put_U32(out + used + 4, (uint32_t)len);
+  used += GZIP_TRAILER_SIZE;
+  stats.bytesIn += len;
+  stats.bytesOut += used;
+  return used;
+}
+
+const compress_stats_t *Compress_Get_Stats() {
+  return &stats;
+}
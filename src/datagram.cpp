@@ -0,0 +1,201 @@
+#include <string.h>
+#include "compress.h"
+#include "datagram.h"
+#include "metrics.h"
+
+static_assert(DATAGRAM_BUFFER_BYTES >= UPLINK_BATCH_BYTES && DATAGRAM_BUFFER_BYTES <= 65535, "DATAGRAM_BUFFER_BYTES out of range");
+
+static uint8_t frame[DATAGRAM_MAX]; // Built just before each Send, then Handed Off
+
+static void Put_U32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t Get_U32(const uint8_t *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+void Datagram_Init(datagram_t *d, datagram_send_fn send, datagram_recv_fn recv, uint32_t session) {
+  memset(d, 0, sizeof(*d));
+  d->send = send;
+  d->recv = recv;
+  d->session = session;
+  d->nextSeq = 1;
+}
+
+// First gap in the shared buffer that fits len bytes (-1 -> none)
+static int32_t Datagram_Place(const datagram_t *d, size_t len) {
+  for(int c = -1; c < DATAGRAM_WINDOW; c++) {
+    if(c >= 0 && !d->slots[c].used) {
+      continue;
+    }
+    size_t start = c < 0 ? 0 : (size_t)d->slots[c].offset + d->slots[c].len; // Buffer Start, or just past a Batch
+    bool fits = start + len <= DATAGRAM_BUFFER_BYTES;
+    for(int i = 0; i < DATAGRAM_WINDOW && fits; i++) {
+      const datagram_slot_t *slot = &d->slots[i];
+      fits = !slot->used || start + len <= slot->offset || slot->offset + slot->len <= start;
+    }
+    if(fits) {
+      return (int32_t)start;
+    }
+  }
+  return -1;
+}
+
+bool Datagram_Can_Send(const datagram_t *d) {
+  return Datagram_In_Flight(d) < DATAGRAM_WINDOW && Datagram_Place(d, UPLINK_BATCH_BYTES) >= 0;
+}
+
+uint8_t Datagram_In_Flight(const datagram_t *d) {
+  uint8_t used = 0;
+  for(int i = 0; i < DATAGRAM_WINDOW; i++) {
+    used += d->slots[i].used;
+  }
+  return used;
+}
+
+// Every seq below the oldest still in the window is settled (acked or given up)
+static uint32_t Datagram_Floor(const datagram_t *d) {
+  uint32_t floor = d->nextSeq - 1;
+  for(int i = 0; i < DATAGRAM_WINDOW; i++) {
+    if(d->slots[i].used && (int32_t)(d->slots[i].seq - 1 - floor) < 0) {
+      floor = d->slots[i].seq - 1;
+    }
+  }
+  return floor;
+}
+
+// Frame a slot's batch (gzipped if asked and it shrinks) and hand it to the network
+static void Datagram_Transmit(datagram_t *d, const datagram_slot_t *slot) {
+  uint8_t flags = slot->flags;
+  size_t len = 0;
+  if(flags & DATAGRAM_FLAG_GZIP) {
+    uint32_t started = Metrics_Clock();
+    len = Compress_Gzip(&d->buffer[slot->offset], slot->len, &frame[DATAGRAM_HEADER_SIZE], UPLINK_BATCH_BYTES);
+    Metrics_Observe(HIST_COMPRESS, Metrics_Clock() - started);
+  }
+  if(len == 0) {
+    flags &= (uint8_t)~DATAGRAM_FLAG_GZIP;
+    len = slot->len;
+    memcpy(&frame[DATAGRAM_HEADER_SIZE], &d->buffer[slot->offset], len);
+  }
+  frame[0] = DATAGRAM_DATA;
+  frame[1] = flags;
+  Put_U32(&frame[2], d->session);
+  Put_U32(&frame[6], slot->seq);
+  Put_U32(&frame[10], Datagram_Floor(d));
+  d->send(frame, DATAGRAM_HEADER_SIZE + len); // A Datagram the Stack Drops is Resent on Timeout
+}
+
+bool Datagram_Send(datagram_t *d, const uint8_t *body, size_t len, uint8_t flags, uint32_t now) {
+  if(len > UPLINK_BATCH_BYTES) {
+    return false;
+  }
+  datagram_slot_t *slot = NULL;
+  for(int i = 0; i < DATAGRAM_WINDOW && slot == NULL; i++) {
+    if(!d->slots[i].used) {
+      slot = &d->slots[i];
+    }
+  }
+  int32_t offset = slot != NULL ? Datagram_Place(d, len) : -1;
+  if(offset < 0) {
+    d->stats.full++;
+    return false;
+  }
+
+  memcpy(&d->buffer[offset], body, len);
+  slot->offset = (uint16_t)offset;
+  slot->flags = flags;
+  slot->len = (uint16_t)len;
+  slot->seq = d->nextSeq++;
+  slot->tries = 1;
+  slot->due = now + DATAGRAM_RTO_MS;
+  slot->stamp = Metrics_Clock();
+  slot->used = true;
+  d->stats.sent++;
+  Datagram_Transmit(d, slot);
+  return true;
+}
+
+static void Datagram_On_Ack(datagram_t *d, uint32_t cumulative) {
+  if((int32_t)(cumulative - d->acked) < 0) {
+    // Receiver Lost its State: Resend the Window now (each Datagram Carries the Floor), Tries Untouched
+    d->acked = cumulative;
+    d->stats.resyncs++;
+    for(int i = 0; i < DATAGRAM_WINDOW; i++) {
+      if(d->slots[i].used) {
+        d->stats.resent++;
+        Datagram_Transmit(d, &d->slots[i]);
+      }
+    }
+    return;
+  }
+  if(cumulative == d->acked) {
+    return; // Old News
+  }
+  d->acked = cumulative;
+  for(int i = 0; i < DATAGRAM_WINDOW; i++) {
+    datagram_slot_t *slot = &d->slots[i];
+    if(slot->used && (int32_t)(slot->seq - cumulative) <= 0) {
+      slot->used = false;
+      d->stats.acked++;
+      Metrics_Observe(HIST_DATAGRAM_RTT, Metrics_Clock() - slot->stamp);
+    }
+  }
+}
+
+// Tell the receiver to step over a seq given up on
+static void Datagram_Skip(datagram_t *d) {
+  uint32_t floor = Datagram_Floor(d);
+  memset(frame, 0, DATAGRAM_HEADER_SIZE);
+  frame[0] = DATAGRAM_SKIP;
+  Put_U32(&frame[2], d->session);
+  Put_U32(&frame[6], floor);
+  Put_U32(&frame[10], floor);
+  d->send(frame, DATAGRAM_HEADER_SIZE);
+  d->stats.skips++;
+}
+
+void Datagram_Poll(datagram_t *d, uint32_t now) {
+  uint8_t ack[DATAGRAM_ACK_SIZE + 1];
+  size_t len;
+  while((len = d->recv(ack, sizeof(ack))) > 0) {
+    if(len != DATAGRAM_ACK_SIZE || ack[0] != DATAGRAM_ACK || Get_U32(&ack[2]) != d->session) {
+      d->stats.stray++;
+      continue;
+    }
+    Datagram_On_Ack(d, Get_U32(&ack[6]));
+  }
+
+  bool gaveUp = false;
+  for(int i = 0; i < DATAGRAM_WINDOW; i++) {
+    datagram_slot_t *slot = &d->slots[i];
+    if(!slot->used || (int32_t)(now - slot->due) < 0) {
+      continue;
+    }
+    if(slot->tries >= DATAGRAM_TRIES && (gaveUp || slot->seq != Datagram_Floor(d) + 1)) {
+      slot->due = now + DATAGRAM_RTO_MS; // Maybe Held but Unacked behind the Hole: Wait for the Skip's Ack
+      continue;
+    }
+    if(slot->tries >= DATAGRAM_TRIES) {
+      slot->used = false;
+      gaveUp = true;
+      d->stats.failed++;
+      if(d->failed != NULL) {
+        d->failed(&d->buffer[slot->offset], slot->len); // Uncompressed: Replay Gzips it Again
+      }
+      continue;
+    }
+    slot->tries++;
+    slot->due = now + (DATAGRAM_RTO_MS << (slot->tries - 1)); // Double per Try
+    d->stats.resent++;
+    Datagram_Transmit(d, slot);
+  }
+
+  if(gaveUp) {
+    Datagram_Skip(d);
+  }
+}
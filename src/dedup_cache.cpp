@@ -0,0 +1,70 @@
+#include <string.h>
+#include "dedup_cache.h"
+
+static_assert((DEDUP_CACHE_SIZE & (DEDUP_CACHE_SIZE - 1)) == 0, "DEDUP_CACHE_SIZE must be a power of two");
+static_assert(DEDUP_PROBE_LIMIT <= DEDUP_CACHE_SIZE, "DEDUP_PROBE_LIMIT larger than cache");
+
+// Mix MAC and Packet ID into a Table Index
+static uint32_t Dedup_Hash(const uint8_t *mac, int32_t packetID) {
+  uint64_t key = 0;
+  for(int i = 0; i < MAC_SIZE; i++) {
+    key = (key << 8) | mac[i];
+  }
+  key ^= (uint64_t)(uint32_t)packetID << 16;
+  key *= 0x9E3779B97F4A7C15ULL;
+  return (uint32_t)(key >> 32);
+}
+
+static bool Dedup_Expired(const dedup_entry_t *entry, uint32_t now) {
+  return (uint32_t)(now - entry->stamp) > DEDUP_MAX_AGE_MS;
+}
+
+void Dedup_Init(dedup_cache_t *cache) {
+  memset(cache, 0, sizeof(*cache));
+}
+
+bool Dedup_Check_And_Insert(dedup_cache_t *cache, const uint8_t *mac, int32_t packetID, uint32_t now) {
+  uint32_t index = Dedup_Hash(mac, packetID);
+  dedup_entry_t *victim = NULL;
+
+  for(int i = 0; i < DEDUP_PROBE_LIMIT; i++) {
+    dedup_entry_t *entry = &cache->slots[(index + i) & (DEDUP_CACHE_SIZE - 1)];
+
+    if(!entry->used) {
+      // Slots are never emptied once used, so the key cannot be further on.
+      // An empty slot beats evicting a live entry met earlier in the window
+      if(victim == NULL || !Dedup_Expired(victim, now)) {
+        victim = entry;
+      }
+      break;
+    }
+
+    if(entry->packetID == packetID && memcmp(entry->mac, mac, MAC_SIZE) == 0) {
+      if(!Dedup_Expired(entry, now)) {
+        cache->duplicates++;
+        return true;
+      }
+      victim = entry; // Same key but stale: refresh in place
+      break;
+    }
+
+    // Prefer an expired slot, otherwise the oldest one in the window
+    if(Dedup_Expired(entry, now)) {
+      if(victim == NULL || !Dedup_Expired(victim, now)) {
+        victim = entry;
+      }
+    } else if(victim == NULL || (!Dedup_Expired(victim, now) && (int32_t)(entry->stamp - victim->stamp) < 0)) {
+      victim = entry;
+    }
+  }
+
+  if(victim->used && !Dedup_Expired(victim, now) && !(victim->packetID == packetID && memcmp(victim->mac, mac, MAC_SIZE) == 0)) {
+    cache->evictions++;
+  }
+
+  memcpy(victim->mac, mac, MAC_SIZE);
+  victim->packetID = packetID;
+  victim->stamp = now;
+  victim->used = 1;
+  return false;
+}
@@ -0,0 +1,114 @@
+#include <string.h>
+#include "flood.h"
+#include "hal.h"
+#include "wire_format.h"
+
+static const uint8_t broadcastMac[MAC_SIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+void Flood_Init(flood_t *f, flood_send_fn send, void *ctx, const uint8_t *self, dedup_cache_t *seen) {
+  memset(f, 0, sizeof(*f));
+  f->send = send;
+  f->ctx = ctx;
+  memcpy(f->self, self, MAC_SIZE);
+  f->seen = seen;
+  f->k = FLOOD_K;
+  f->jitterUs = FLOOD_JITTER_US;
+  f->relay = true;
+}
+
+bool Flood_Is_Broadcast(const uint8_t *mac) {
+  return memcmp(mac, broadcastMac, MAC_SIZE) == 0;
+}
+
+bool Flood_Originate(flood_t *f, const message_t *packet, uint32_t nowMs) {
+  uint8_t frame[ESPNOW_MTU];
+  size_t len = Wire_Encode(packet, frame, sizeof(frame));
+  if(len == 0) {
+    return false;
+  }
+  Dedup_Check_And_Insert(f->seen, packet->source_mac, packet->packetID, nowMs); // Our Own Echoes are Repeats
+  f->stats.originated++;
+  return f->send(f->ctx, frame, len);
+}
+
+static flood_pending_t *Flood_Find(flood_t *f, const uint8_t *source, int32_t packetID) {
+  for(int i = 0; i < FLOOD_PENDING; i++) {
+    flood_pending_t *pending = &f->pending[i];
+    if(pending->used && pending->packetID == packetID && memcmp(pending->source, source, MAC_SIZE) == 0) {
+      return pending;
+    }
+  }
+  return NULL;
+}
+
+bool Flood_On_Receive(flood_t *f, const message_t *packet, uint32_t nowUs, uint32_t nowMs) {
+  if(Dedup_Check_And_Insert(f->seen, packet->source_mac, packet->packetID, nowMs)) {
+    f->stats.duplicates++;
+    flood_pending_t *pending = Flood_Find(f, packet->source_mac, packet->packetID);
+    if(pending != NULL && pending->copies < 255) {
+      pending->copies++;
+    }
+    return false;
+  }
+  f->stats.delivered++;
+
+  if(!f->relay) {
+    return true;
+  }
+  if(packet->TTL <= 1) {
+    f->stats.expired++; // This Hop was its Last
+    return true;
+  }
+
+  message_t copy = *packet;
+  copy.TTL--;
+  if(!copy.Path_Exist && copy.Path_Index < MAX_NODES) {
+    memcpy(copy.Path_Array[copy.Path_Index], f->self, MAC_SIZE); // Record the Hop
+    copy.Path_Index++;
+    copy.Path_Length++;
+  }
+
+  flood_pending_t *slot = NULL;
+  for(int i = 0; i < FLOOD_PENDING && slot == NULL; i++) {
+    if(!f->pending[i].used) {
+      slot = &f->pending[i];
+    }
+  }
+  if(slot == NULL) {
+    // No room to wait: repeat now rather than drop the flood
+    uint8_t frame[ESPNOW_MTU];
+    size_t len = Wire_Encode(&copy, frame, sizeof(frame));
+    f->stats.overflow++;
+    if(len > 0 && f->send(f->ctx, frame, len)) {
+      f->stats.rebroadcasts++;
+    }
+    return true;
+  }
+
+  size_t len = Wire_Encode(&copy, slot->frame, sizeof(slot->frame));
+  if(len == 0) {
+    return true;
+  }
+  slot->used = true;
+  slot->copies = 1;
+  slot->len = (uint8_t)len;
+  memcpy(slot->source, packet->source_mac, MAC_SIZE);
+  slot->packetID = packet->packetID;
+  slot->due = nowUs + (f->jitterUs ? Hal_Random() % (f->jitterUs + 1) : 0);
+  return true;
+}
+
+void Flood_Poll(flood_t *f, uint32_t nowUs) {
+  for(int i = 0; i < FLOOD_PENDING; i++) {
+    flood_pending_t *pending = &f->pending[i];
+    if(!pending->used || (int32_t)(nowUs - pending->due) < 0) {
+      continue;
+    }
+    pending->used = false;
+    if(f->k > 0 && pending->copies >= f->k) {
+      f->stats.suppressed++;
+    } else if(f->send(f->ctx, pending->frame, pending->len)) {
+      f->stats.rebroadcasts++;
+    }
+  }
+}
@@ -0,0 +1,337 @@
+#ifdef ARDUINO
+
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_now.h>
+#include <ETH.h>
+#include <HTTPClient.h>
+#include <lwip/sockets.h>
+#include <string.h>
+#include "hal.h"
+#include "log.h"
+
+static hal_sent_cb_t sentCallback = NULL;
+#if LINK_RSSI_PROMISCUOUS
+static volatile int8_t lastRssi = 0; // Latest Management Frame (ESP-NOW is an action frame)
+static uint8_t lastRssiMac[6];
+#endif
+
+static WiFiClient httpClient; // Persistent TCP Connection to Server
+static HTTPClient http;
+static int udpSocket = -1; // lwIP socket: WiFiUDP caps a datagram at one 1460 byte buffer
+
+#define HAL_HTTP_SERVE_TIMEOUT_MS 200 // Max Wait for a Request Head
+
+static WiFiServer scrapeServer; // Metrics Endpoint (ETH)
+static hal_http_handler_t scrapeHandler = NULL;
+static char scrapeBody[HAL_HTTP_RESPONSE_MAX];
+static WiFiServer streamServer; // Capture Stream (ETH)
+static WiFiClient streamClient;
+static bool streamServing = false;
+static WiFiServer commandServer; // Downlink Commands (ETH)
+static WiFiClient commandClient;
+static bool commandServing = false;
+
+uint32_t Hal_Millis() {
+  return millis();
+}
+
+uint32_t Hal_Micros() {
+  return micros();
+}
+
+void Hal_Delay(uint32_t ms) {
+  delay(ms);
+}
+
+uint32_t Hal_Random() {
+  return esp_random();
+}
+
+static void Hal_On_Sent(const uint8_t *mac, esp_now_send_status_t status) {
+  if(sentCallback != NULL) {
+    sentCallback(mac, status == ESP_NOW_SEND_SUCCESS);
+  }
+}
+
+#if LINK_RSSI_PROMISCUOUS
+// Sniffs the RSSI the ESP-NOW receive callback does not report; runs in the Wi-Fi task just before it
+static void Hal_On_Sniffed(void *buf, wifi_promiscuous_pkt_type_t type) {
+  if(type != WIFI_PKT_MGMT) {
+    return;
+  }
+  const wifi_promiscuous_pkt_t *pkt = (const wifi_promiscuous_pkt_t *)buf;
+  memcpy(lastRssiMac, &pkt->payload[10], 6); // Addr2: Transmitter
+  lastRssi = pkt->rx_ctrl.rssi;
+}
+#endif
+
+bool Hal_Radio_Init(const char *pmk, hal_recv_cb_t onReceive, hal_sent_cb_t onSent) {
+  WiFi.disconnect();
+  WiFi.mode(WIFI_STA);  
+
+  if(esp_wifi_init(NULL) != ESP_OK) {
+    LOG_ERROR("Failed to initialize WiFi");
+  }
+
+  esp_wifi_set_mode(WIFI_MODE_STA);
+  esp_wifi_start(); 
+
+  if(esp_now_init() != ESP_OK) { // Initialize ESP-NOW
+    return false;
+  }
+
+  esp_now_set_pmk((const uint8_t *) pmk); // Set PMK Key
+
+  sentCallback = onSent;
+  esp_now_register_send_cb(Hal_On_Sent); // Register send_cb function
+  esp_now_register_recv_cb(onReceive); // Register receive_cb function
+
+#if LINK_RSSI_PROMISCUOUS
+  // RSSI per Received Frame (link quality); sniffs every management frame on the channel
+  wifi_promiscuous_filter_t filter = {WIFI_PROMIS_FILTER_MASK_MGMT};
+  esp_wifi_set_promiscuous_filter(&filter);
+  esp_wifi_set_promiscuous_rx_cb(Hal_On_Sniffed);
+  esp_wifi_set_promiscuous(true);
+#endif
+  return true;
+}
+
+bool Hal_Radio_Read_MAC(uint8_t *mac) {
+  return esp_read_mac(mac, ESP_MAC_WIFI_STA) == ESP_OK;
+}
+
+hal_err_t Hal_Radio_Send(const uint8_t *mac, const uint8_t *data, size_t len) {
+  return esp_now_send(mac, data, len);
+}
+
+bool Hal_Radio_Peer_Exists(const uint8_t *mac) {
+  return esp_now_is_peer_exist(mac);
+}
+
+hal_err_t Hal_Radio_Peer_Encrypted(const uint8_t *mac, bool *encrypted) {
+  esp_now_peer_info_t peerInfo = {};
+  esp_err_t err = esp_now_get_peer(mac, &peerInfo);
+  if(err == ESP_OK) {
+    *encrypted = peerInfo.encrypt;
+  }
+  return err;
+}
+
+hal_err_t Hal_Radio_Add_Peer(const uint8_t *mac, const char *lmk) {
+  esp_now_peer_info_t peerInfo = {};
+  memcpy(peerInfo.peer_addr, mac, 6);
+  peerInfo.channel = 0;
+  if(lmk != NULL) {
+    memcpy(peerInfo.lmk, lmk, HAL_KEY_LEN);
+  }
+  peerInfo.encrypt = lmk != NULL;
+  return esp_now_add_peer(&peerInfo);
+}
+
+hal_err_t Hal_Radio_Del_Peer(const uint8_t *mac) {
+  return esp_now_del_peer(mac);
+}
+
+int8_t Hal_Radio_RSSI(const uint8_t *mac) {
+#if LINK_RSSI_PROMISCUOUS
+  return memcmp(mac, lastRssiMac, 6) == 0 ? lastRssi : 0;
+#else
+  (void)mac;
+  return 0; // Unknown: ETX from Send Status alone
+#endif
+}
+
+const char *Hal_Err_Name(hal_err_t err) {
+  return esp_err_to_name(err);
+}
+
+bool Hal_Network_Init(const uint8_t localIP[4], const uint8_t gateway[4], const uint8_t subnet[4]) {
+  if(!ETH.begin()) {
+    LOG_ERROR("Ethernet initialization failed");
+    return false;
+  }
+  LOG_INFO("Ethernet initialized");
+
+  // Configure Ethernet with static IP
+  if(!ETH.config(IPAddress(localIP[0], localIP[1], localIP[2], localIP[3]),
+                 IPAddress(gateway[0], gateway[1], gateway[2], gateway[3]),
+                 IPAddress(subnet[0], subnet[1], subnet[2], subnet[3]))) {
+    LOG_ERROR("Failed to configure Ethernet with static IP");
+    return false;
+  }
+  LOG_INFO("Ethernet configured with static IP");
+  return true;
+}
+
+int Hal_Http_Post(const char *url, const char *contentType, const char *contentEncoding, const uint8_t *body, size_t len) {
+  http.setReuse(true); // Keep-Alive
+  http.begin(httpClient, url); // Reuses the open TCP connection if still up
+  http.addHeader("Content-Type", contentType);
+  if(contentEncoding != NULL) {
+    http.addHeader("Content-Encoding", contentEncoding);
+  }
+
+  int httpResponseCode = http.POST((uint8_t *) body, len);
+
+  if(httpResponseCode > 0) {
+    http.getString(); // Drain the response so the connection can be reused
+  }
+
+  http.end(); // Release request state (socket stays open with reuse)
+  return httpResponseCode;
+}
+
+bool Hal_Udp_Open(const char *host, uint16_t port) {
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if(inet_aton(host, &addr.sin_addr) == 0) {
+    return false; // Dotted Quad Only
+  }
+  int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if(fd < 0) {
+    return false;
+  }
+  if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return false;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  udpSocket = fd;
+  return true;
+}
+
+bool Hal_Udp_Send(const uint8_t *data, size_t len) {
+  return udpSocket >= 0 && send(udpSocket, data, len, 0) == (ssize_t)len; // lwIP Fragments Batches over the Ethernet MTU
+}
+
+size_t Hal_Udp_Recv(uint8_t *data, size_t cap) {
+  if(udpSocket < 0) {
+    return 0;
+  }
+  ssize_t n = recv(udpSocket, data, cap, 0);
+  return n > 0 ? (size_t)n : 0;
+}
+
+bool Hal_Http_Serve(uint16_t port, hal_http_handler_t handler) {
+  scrapeHandler = handler;
+  scrapeServer.begin(port);
+  scrapeServer.setNoDelay(true);
+  return true;
+}
+
+void Hal_Http_Serve_Poll() {
+  if(scrapeHandler == NULL) {
+    return;
+  }
+  WiFiClient client = scrapeServer.available();
+  if(!client) {
+    return;
+  }
+
+  // Keep the request line, read up to the blank line ending the head
+  char request[128];
+  size_t used = 0;
+  uint32_t tail = 0;
+  uint32_t started = millis();
+  while(tail != 0x0D0A0D0A && millis() - started < HAL_HTTP_SERVE_TIMEOUT_MS) {
+    if(!client.available()) {
+      delay(1);
+      continue;
+    }
+    char c = (char)client.read();
+    tail = (tail << 8) | (uint8_t)c;
+    if(used < sizeof(request) - 1) {
+      request[used++] = c;
+    }
+  }
+  request[used] = '\0';
+
+  char path[64] = "";
+  size_t len = 0;
+  const char *contentType = "text/plain";
+  if(sscanf(request, "GET %63s HTTP/", path) == 1) {
+    len = scrapeHandler(path, scrapeBody, sizeof(scrapeBody), &contentType);
+  }
+
+  if(len > 0) {
+    client.printf("HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n\r\n", contentType, (unsigned)len);
+    client.write((const uint8_t *)scrapeBody, len);
+  } else {
+    client.print("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+  }
+  client.stop();
+}
+
+bool Hal_Stream_Serve(uint16_t port) {
+  streamServer.begin(port);
+  streamServer.setNoDelay(true);
+  streamServing = true;
+  return true;
+}
+
+bool Hal_Stream_Accept() {
+  if(!streamServing || !streamServer.hasClient()) {
+    return false;
+  }
+  if(streamClient) {
+    streamClient.stop();
+  }
+  streamClient = streamServer.available();
+  return (bool)streamClient;
+}
+
+size_t Hal_Stream_Write(const uint8_t *data, size_t len) {
+  if(!streamClient || !streamClient.connected()) {
+    return 0;
+  }
+  int room = streamClient.availableForWrite();
+  if(room <= 0) {
+    return 0;
+  }
+  return streamClient.write(data, len < (size_t)room ? len : (size_t)room);
+}
+
+bool Hal_Command_Serve(uint16_t port) {
+  commandServer.begin(port);
+  commandServer.setNoDelay(true);
+  commandServing = true;
+  return true;
+}
+
+bool Hal_Command_Accept() {
+  if(!commandServing || !commandServer.hasClient()) {
+    return false;
+  }
+  if(commandClient) {
+    commandClient.stop();
+  }
+  commandClient = commandServer.available();
+  return (bool)commandClient;
+}
+
+size_t Hal_Command_Read(uint8_t *data, size_t cap) {
+  if(!commandClient || !commandClient.connected()) {
+    return 0;
+  }
+  int waiting = commandClient.available();
+  if(waiting <= 0) {
+    return 0;
+  }
+  int n = commandClient.read(data, waiting < (int)cap ? (size_t)waiting : cap);
+  return n > 0 ? (size_t)n : 0;
+}
+
+size_t Hal_Command_Write(const uint8_t *data, size_t len) {
+  if(!commandClient || !commandClient.connected()) {
+    return 0;
+  }
+  int room = commandClient.availableForWrite();
+  if(room <= 0) {
+    return 0;
+  }
+  return commandClient.write(data, len < (size_t)room ? len : (size_t)room);
+}
+
+#endif
@@ -0,0 +1,586 @@
+#ifndef ARDUINO
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <vector>
+#include "hal.h"
+#include "radio_sim.h"
+
+/* Host implementation of the HAL: radio through the simulator, time from
+   the simulator clock, HTTP over a plain POSIX socket. */
+
+#define HAL_ERR_ARG -2
+#define HAL_ERR_NOT_FOUND -3
+#define HAL_ERR_FULL -4
+#define HAL_ERR_EXIST -5
+
+// ESP-NOW peer limits (ESP-IDF defaults)
+#define HAL_MAX_PEERS 20
+#define HAL_MAX_ENCRYPT_PEERS 7
+
+HalConsole Serial;
+
+int HalConsole::printf(const char *format, ...) {
+  if(!enabled) {
+    return 0;
+  }
+  va_list args;
+  va_start(args, format);
+  int n = vprintf(format, args);
+  va_end(args);
+  return n;
+}
+
+typedef struct {
+  uint8_t mac[6];
+  bool encrypt;
+} hal_peer_t;
+
+/* HAL Variables */
+static uint8_t halMac[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+static int halNode = -1;
+static hal_recv_cb_t recvCallback = NULL;
+static hal_sent_cb_t sentCallback = NULL;
+static int8_t lastRssi = 0; // Frame Being Delivered
+static uint8_t lastRssiMac[6];
+static std::vector<hal_peer_t> peers;
+static bool httpSink = true;
+static hal_native_post_fn httpHook = NULL;
+static uint32_t httpPosts = 0;
+static int httpSocket = -1;
+static int udpSocket = -1;
+static char httpHostPort[96] = "";
+
+uint32_t Hal_Millis() {
+  return (uint32_t)(Sim_Now_Us() / 1000);
+}
+
+uint32_t Hal_Micros() {
+  return (uint32_t)Sim_Now_Us();
+}
+
+void Hal_Delay(uint32_t ms) {
+  (void)ms; // Simulator owns the clock
+}
+
+uint32_t Hal_Random() {
+  return Sim_Random();
+}
+
+static void Hal_Sim_Receive(int node, const uint8_t *from, const uint8_t *data, int len) {
+  const sim_link_t *link = Sim_Get_Link(Sim_Find_Node(from), node);
+  lastRssi = link != NULL ? link->rssi : 0;
+  memcpy(lastRssiMac, from, 6);
+  if(recvCallback != NULL) {
+    recvCallback(from, data, len);
+  }
+}
+
+static void Hal_Sim_Sent(int node, const uint8_t *to, bool success) {
+  (void)node;
+  if(sentCallback != NULL) {
+    sentCallback(to, success);
+  }
+}
+
+void Hal_Native_Set_MAC(const uint8_t *mac) {
+  memcpy(halMac, mac, 6);
+}
+
+int Hal_Native_Node() {
+  return halNode;
+}
+
+bool Hal_Radio_Init(const char *pmk, hal_recv_cb_t onReceive, hal_sent_cb_t onSent) {
+  (void)pmk;
+  recvCallback = onReceive;
+  sentCallback = onSent;
+  peers.clear();
+  halNode = Sim_Add_Node(halMac, Hal_Sim_Receive, Hal_Sim_Sent);
+  return true;
+}
+
+bool Hal_Radio_Read_MAC(uint8_t *mac) {
+  memcpy(mac, halMac, 6);
+  return true;
+}
+
+static hal_peer_t *Hal_Find_Peer(const uint8_t *mac) {
+  for(auto &peer : peers) {
+    if(memcmp(peer.mac, mac, 6) == 0) {
+      return &peer;
+    }
+  }
+  return NULL;
+}
+
+hal_err_t Hal_Radio_Send(const uint8_t *mac, const uint8_t *data, size_t len) {
+  static const uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  if(halNode < 0 || len == 0 || len > SIM_MAX_FRAME) {
+    return HAL_ERR_ARG;
+  }
+  if(memcmp(mac, broadcastMac, 6) != 0 && Hal_Find_Peer(mac) == NULL) {
+    return HAL_ERR_NOT_FOUND; // ESP-NOW only sends to registered peers
+  }
+  return Sim_Send(halNode, mac, data, len) ? HAL_OK : HAL_FAIL;
+}
+
+bool Hal_Radio_Peer_Exists(const uint8_t *mac) {
+  return Hal_Find_Peer(mac) != NULL;
+}
+
+hal_err_t Hal_Radio_Peer_Encrypted(const uint8_t *mac, bool *encrypted) {
+  hal_peer_t *peer = Hal_Find_Peer(mac);
+  if(peer == NULL) {
+    return HAL_ERR_NOT_FOUND;
+  }
+  *encrypted = peer->encrypt;
+  return HAL_OK;
+}
+
+hal_err_t Hal_Radio_Add_Peer(const uint8_t *mac, const char *lmk) {
+  if(Hal_Find_Peer(mac) != NULL) {
+    return HAL_ERR_EXIST;
+  }
+  int encrypted = 0;
+  for(auto &peer : peers) {
+    encrypted += peer.encrypt;
+  }
+  if(peers.size() >= HAL_MAX_PEERS || (lmk != NULL && encrypted >= HAL_MAX_ENCRYPT_PEERS)) {
+    return HAL_ERR_FULL;
+  }
+  hal_peer_t peer;
+  memcpy(peer.mac, mac, 6);
+  peer.encrypt = lmk != NULL;
+  peers.push_back(peer);
+  return HAL_OK;
+}
+
+hal_err_t Hal_Radio_Del_Peer(const uint8_t *mac) {
+  for(size_t i = 0; i < peers.size(); i++) {
+    if(memcmp(peers[i].mac, mac, 6) == 0) {
+      peers.erase(peers.begin() + i);
+      return HAL_OK;
+    }
+  }
+  return HAL_ERR_NOT_FOUND;
+}
+
+int8_t Hal_Radio_RSSI(const uint8_t *mac) {
+  return memcmp(mac, lastRssiMac, 6) == 0 ? lastRssi : 0;
+}
+
+const char *Hal_Err_Name(hal_err_t err) {
+  switch(err) {
+    case HAL_OK: return "ESP_OK";
+    case HAL_ERR_ARG: return "ESP_ERR_ESPNOW_ARG";
+    case HAL_ERR_NOT_FOUND: return "ESP_ERR_ESPNOW_NOT_FOUND";
+    case HAL_ERR_FULL: return "ESP_ERR_ESPNOW_FULL";
+    case HAL_ERR_EXIST: return "ESP_ERR_ESPNOW_EXIST";
+    default: return "ESP_FAIL";
+  }
+}
+
+bool Hal_Network_Init(const uint8_t localIP[4], const uint8_t gateway[4], const uint8_t subnet[4]) {
+  (void)localIP;
+  (void)gateway;
+  (void)subnet;
+  return true; // Host network is already up
+}
+
+void Hal_Native_Http_Sink(bool sink) {
+  httpSink = sink;
+}
+
+void Hal_Native_Http_Hook(hal_native_post_fn hook) {
+  httpHook = hook;
+}
+
+uint32_t Hal_Native_Http_Posts() {
+  return httpPosts;
+}
+
+// Split "http://host[:port]/path"
+static bool Hal_Parse_Url(const char *url, char *host, size_t hostCap, char *port, size_t portCap, const char **path) {
+  if(strncmp(url, "http://", 7) != 0) {
+    return false;
+  }
+  const char *start = url + 7;
+  const char *slash = strchr(start, '/');
+  *path = slash ? slash : "/";
+  size_t authority = slash ? (size_t)(slash - start) : strlen(start);
+  const char *colon = (const char *)memchr(start, ':', authority);
+  size_t hostLen = colon ? (size_t)(colon - start) : authority;
+  size_t portLen = colon ? authority - hostLen - 1 : 2;
+  if(hostLen == 0 || hostLen >= hostCap || portLen >= portCap) {
+    return false;
+  }
+  memcpy(host, start, hostLen);
+  host[hostLen] = '\0';
+  if(colon) {
+    memcpy(port, colon + 1, portLen);
+    port[portLen] = '\0';
+  } else {
+    strcpy(port, "80");
+  }
+  return true;
+}
+
+static int Hal_Connect(const char *host, const char *port) {
+  struct addrinfo hints = {}, *res = NULL;
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if(getaddrinfo(host, port, &hints, &res) != 0) {
+    return -1;
+  }
+  int fd = -1;
+  for(struct addrinfo *ai = res; ai != NULL; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if(fd < 0) {
+      continue;
+    }
+    struct timeval tv = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Head and Body go as Two Writes: no Delayed-ACK Stall
+    if(connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  return fd;
+}
+
+static bool Hal_Write_All(int fd, const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  while(len > 0) {
+    ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+    if(n <= 0) {
+      return false;
+    }
+    p += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+// Read one response; returns status or -1. Leaves the socket at the next response
+static int Hal_Read_Response(int fd) {
+  char head[2048];
+  size_t used = 0;
+  char *end = NULL;
+  while(end == NULL) {
+    if(used == sizeof(head) - 1) {
+      return -1;
+    }
+    ssize_t n = recv(fd, head + used, sizeof(head) - 1 - used, 0);
+    if(n <= 0) {
+      return -1;
+    }
+    used += (size_t)n;
+    head[used] = '\0';
+    end = strstr(head, "\r\n\r\n");
+  }
+
+  int status = -1;
+  if(sscanf(head, "HTTP/%*s %d", &status) != 1) {
+    return -1;
+  }
+
+  size_t contentLength = 0;
+  for(char *line = strstr(head, "\r\n"); line != NULL && line < end; line = strstr(line + 2, "\r\n")) {
+    if(strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+      contentLength = strtoul(line + 17, NULL, 10);
+    }
+  }
+
+  // Discard the body
+  size_t have = used - (size_t)(end + 4 - head);
+  char sink[512];
+  while(have < contentLength) {
+    size_t want = contentLength - have < sizeof(sink) ? contentLength - have : sizeof(sink);
+    ssize_t n = recv(fd, sink, want, 0);
+    if(n <= 0) {
+      return -1;
+    }
+    have += (size_t)n;
+  }
+  return status;
+}
+
+int Hal_Http_Post(const char *url, const char *contentType, const char *contentEncoding, const uint8_t *body, size_t len) {
+  httpPosts++;
+  if(httpSink) {
+    return httpHook != NULL ? httpHook(contentType, contentEncoding, body, len) : 200;
+  }
+
+  char host[64], port[16], request[512];
+  const char *path;
+  if(!Hal_Parse_Url(url, host, sizeof(host), port, sizeof(port), &path)) {
+    return -1;
+  }
+
+  // Reconnect if the server changed
+  char hostPort[96];
+  snprintf(hostPort, sizeof(hostPort), "%s:%s", host, port);
+  if(httpSocket >= 0 && strcmp(hostPort, httpHostPort) != 0) {
+    close(httpSocket);
+    httpSocket = -1;
+  }
+
+  char encoding[64] = "";
+  if(contentEncoding != NULL) {
+    snprintf(encoding, sizeof(encoding), "Content-Encoding: %s\r\n", contentEncoding);
+  }
+  int header = snprintf(request, sizeof(request),
+                        "POST %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\nContent-Type: %s\r\n%sContent-Length: %zu\r\n\r\n",
+                        path, hostPort, contentType, encoding, len);
+
+  // A kept-alive socket may have been closed by the server: retry once on a fresh one
+  for(int attempt = 0; attempt < 2; attempt++) {
+    if(httpSocket < 0) {
+      httpSocket = Hal_Connect(host, port);
+      if(httpSocket < 0) {
+        return -1;
+      }
+      strcpy(httpHostPort, hostPort);
+    }
+    if(Hal_Write_All(httpSocket, request, (size_t)header) && Hal_Write_All(httpSocket, body, len)) {
+      int status = Hal_Read_Response(httpSocket);
+      if(status > 0) {
+        return status;
+      }
+    }
+    close(httpSocket);
+    httpSocket = -1;
+  }
+  return -1;
+}
+
+bool Hal_Udp_Open(const char *host, uint16_t port) {
+  char service[8];
+  snprintf(service, sizeof(service), "%u", (unsigned)port);
+  struct addrinfo hints = {}, *res = NULL;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if(getaddrinfo(host, service, &hints, &res) != 0) {
+    return false;
+  }
+  int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  if(fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  if(fd < 0) {
+    return false;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  if(udpSocket >= 0) {
+    close(udpSocket);
+  }
+  udpSocket = fd;
+  return true;
+}
+
+bool Hal_Udp_Send(const uint8_t *data, size_t len) {
+  return udpSocket >= 0 && send(udpSocket, data, len, 0) == (ssize_t)len;
+}
+
+size_t Hal_Udp_Recv(uint8_t *data, size_t cap) {
+  if(udpSocket < 0) {
+    return 0;
+  }
+  ssize_t n = recv(udpSocket, data, cap, 0);
+  return n > 0 ? (size_t)n : 0; // Nothing Waiting, or ICMP Unreachable Reported as an Error
+}
+
+static int scrapeSocket = -1; // Listening Socket (non-blocking)
+static hal_http_handler_t scrapeHandler = NULL;
+static char scrapeBody[HAL_HTTP_RESPONSE_MAX];
+
+bool Hal_Http_Serve(uint16_t port, hal_http_handler_t handler) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if(fd < 0) {
+    return false;
+  }
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+    close(fd);
+    return false;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  scrapeSocket = fd;
+  scrapeHandler = handler;
+  return true;
+}
+
+void Hal_Http_Serve_Poll() {
+  if(scrapeSocket < 0) {
+    return;
+  }
+  int fd = accept(scrapeSocket, NULL, NULL);
+  if(fd < 0) {
+    return;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+  struct timeval tv = {0, 200000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  char request[1024];
+  size_t used = 0;
+  while(used < sizeof(request) - 1) {
+    ssize_t n = recv(fd, request + used, sizeof(request) - 1 - used, 0);
+    if(n <= 0) {
+      break;
+    }
+    used += (size_t)n;
+    request[used] = '\0';
+    if(strstr(request, "\r\n\r\n") != NULL) {
+      break;
+    }
+  }
+  request[used] = '\0';
+
+  char path[64] = "";
+  size_t len = 0;
+  const char *contentType = "text/plain";
+  if(sscanf(request, "GET %63s HTTP/", path) == 1) {
+    len = scrapeHandler(path, scrapeBody, sizeof(scrapeBody), &contentType);
+  }
+
+  char head[256];
+  int headLen;
+  if(len > 0) {
+    headLen = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", contentType, len);
+  } else {
+    headLen = snprintf(head, sizeof(head), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+  }
+  if(Hal_Write_All(fd, head, (size_t)headLen) && len > 0) {
+    Hal_Write_All(fd, scrapeBody, len);
+  }
+  close(fd);
+}
+
+typedef struct {
+  int listener; // Listening Socket (non-blocking)
+  int client;
+} hal_stream_t;
+
+static hal_stream_t captureStream = {-1, -1};
+static hal_stream_t commandStream = {-1, -1};
+
+static bool Hal_Listen(hal_stream_t *stream, uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if(fd < 0) {
+    return false;
+  }
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+    close(fd);
+    return false;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  stream->listener = fd;
+  return true;
+}
+
+static bool Hal_Accept(hal_stream_t *stream) {
+  if(stream->listener < 0) {
+    return false;
+  }
+  int fd = accept(stream->listener, NULL, NULL);
+  if(fd < 0) {
+    return false;
+  }
+  if(stream->client >= 0) {
+    close(stream->client);
+  }
+  stream->client = fd;
+  return true;
+}
+
+static void Hal_Drop_Client(hal_stream_t *stream) {
+  close(stream->client); // Client Gone
+  stream->client = -1;
+}
+
+static size_t Hal_Stream_Send(hal_stream_t *stream, const uint8_t *data, size_t len) {
+  if(stream->client < 0) {
+    return 0;
+  }
+  ssize_t n = send(stream->client, data, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if(n < 0) {
+    if(errno != EAGAIN && errno != EWOULDBLOCK) {
+      Hal_Drop_Client(stream);
+    }
+    return 0;
+  }
+  return (size_t)n;
+}
+
+bool Hal_Stream_Serve(uint16_t port) {
+  return Hal_Listen(&captureStream, port);
+}
+
+bool Hal_Stream_Accept() {
+  return Hal_Accept(&captureStream);
+}
+
+size_t Hal_Stream_Write(const uint8_t *data, size_t len) {
+  return Hal_Stream_Send(&captureStream, data, len);
+}
+
+bool Hal_Command_Serve(uint16_t port) {
+  return Hal_Listen(&commandStream, port);
+}
+
+bool Hal_Command_Accept() {
+  if(!Hal_Accept(&commandStream)) {
+    return false;
+  }
+  int one = 1;
+  setsockopt(commandStream.client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Reports are Short Lines
+  return true;
+}
+
+size_t Hal_Command_Read(uint8_t *data, size_t cap) {
+  if(commandStream.client < 0) {
+    return 0;
+  }
+  ssize_t n = recv(commandStream.client, data, cap, MSG_DONTWAIT);
+  if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    Hal_Drop_Client(&commandStream);
+  }
+  return n > 0 ? (size_t)n : 0;
+}
+
+size_t Hal_Command_Write(const uint8_t *data, size_t len) {
+  return Hal_Stream_Send(&commandStream, data, len);
+}
+
+#endif
@@ -0,0 +1,107 @@
+#include <string.h>
+#include "link_quality.h"
+
+/* Link Quality Variables */
+static link_entry_t links[LINK_NEIGHBORS];
+static link_stats_t stats;
+
+void Link_Init() {
+  memset(links, 0, sizeof(links));
+  memset(&stats, 0, sizeof(stats));
+}
+
+// Delivery expected at this signal strength: 1 down to LINK_RSSI_GOOD, 0.5 at LINK_RSSI_BAD
+static float Link_RSSI_Delivery(float rssi) {
+  if(rssi == 0.0f) {
+    return LINK_DELIVERY_PRIOR;
+  }
+  if(rssi >= LINK_RSSI_GOOD) {
+    return 1.0f;
+  }
+  float delivery = 1.0f - 0.5f * (LINK_RSSI_GOOD - rssi) / (float)(LINK_RSSI_GOOD - LINK_RSSI_BAD);
+  return delivery > LINK_DELIVERY_MIN ? delivery : LINK_DELIVERY_MIN;
+}
+
+static link_entry_t *Link_Lookup(const uint8_t *mac) {
+  for(int i = 0; i < LINK_NEIGHBORS; i++) {
+    if(links[i].used && memcmp(links[i].mac, mac, MAC_SIZE) == 0) {
+      return &links[i];
+    }
+  }
+  return NULL;
+}
+
+// Entry for neighbour, taking a free or the least recently active one
+static link_entry_t *Link_Claim(const uint8_t *mac, uint32_t now) {
+  link_entry_t *entry = Link_Lookup(mac);
+  if(entry != NULL) {
+    return entry;
+  }
+  link_entry_t *oldest = NULL;
+  for(int i = 0; i < LINK_NEIGHBORS; i++) {
+    if(!links[i].used) {
+      entry = &links[i];
+      break;
+    }
+    if(oldest == NULL || (int32_t)(links[i].stamp - oldest->stamp) < 0) {
+      oldest = &links[i];
+    }
+  }
+  if(entry == NULL) {
+    entry = oldest;
+    stats.evictions++;
+  }
+  memset(entry, 0, sizeof(*entry));
+  memcpy(entry->mac, mac, MAC_SIZE);
+  entry->used = true;
+  entry->delivery = LINK_DELIVERY_PRIOR;
+  entry->stamp = now;
+  return entry;
+}
+
+void Link_On_Receive(const uint8_t *mac, int8_t rssi, uint32_t now) {
+  link_entry_t *entry = Link_Claim(mac, now);
+  entry->stamp = now;
+  if(rssi == 0) {
+    return;
+  }
+  stats.samples++;
+  entry->rssi = entry->rssi == 0.0f ? rssi : entry->rssi + (rssi - entry->rssi) / LINK_EWMA_DIV;
+  if(entry->sent == 0) {
+    entry->delivery = Link_RSSI_Delivery(entry->rssi); // Until Sends Tell Better
+  }
+}
+
+void Link_On_Sent(const uint8_t *mac, bool success, uint32_t now) {
+  if(memcmp(mac, "\xFF\xFF\xFF\xFF\xFF\xFF", MAC_SIZE) == 0) {
+    return; // Broadcasts are Never Acked
+  }
+  link_entry_t *entry = Link_Claim(mac, now);
+  entry->stamp = now;
+  entry->sent++;
+  if(!success) {
+    entry->failed++;
+  }
+  stats.samples++;
+  entry->delivery += ((success ? 1.0f : 0.0f) - entry->delivery) / LINK_EWMA_DIV;
+}
+
+float Link_Delivery(const uint8_t *mac) {
+  const link_entry_t *entry = Link_Lookup(mac);
+  if(entry == NULL) {
+    return LINK_DELIVERY_PRIOR;
+  }
+  return entry->delivery > LINK_DELIVERY_MIN ? entry->delivery : LINK_DELIVERY_MIN;
+}
+
+float Link_ETX(const uint8_t *mac) {
+  return 1.0f / Link_Delivery(mac);
+}
+
+const link_entry_t *Link_Find(const uint8_t *mac) {
+  return Link_Lookup(mac);
+}
+
+const link_stats_t *Link_Get_Stats() {
+  return &stats;
+}
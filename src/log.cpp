@@ -0,0 +1,198 @@
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include "hal.h"
+#include "log.h"
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+#ifndef LOG_DRAIN_IDLE_MS
+#define LOG_DRAIN_IDLE_MS 20 // Drainer Sleep when the Ring is Empty
+#endif
+
+/* Bounded multi-producer / single-consumer ring: each cell carries a
+   sequence number telling producers and the consumer whose turn it is.
+   The stored value is offset by the cell index so that the zero-filled
+   static array is already a valid empty ring. */
+typedef struct {
+  std::atomic<uint32_t> seq;
+  log_entry_t entry;
+} log_cell_t;
+
+/* Log Variables */
+static log_cell_t cells[LOG_RING_SIZE];
+static std::atomic<uint32_t> enqueuePos(0);
+static uint32_t dequeuePos = 0; // Consumer Only
+static std::atomic<uint32_t> dropped(0);
+static std::atomic<uint32_t> written(0);
+static uint32_t droppedReported = 0;
+static log_stats_t stats;
+static bool drainerRunning = false;
+
+static const char levelTag[] = "-EWID";
+
+static uint32_t Cell_Seq(uint32_t index) {
+  return cells[index].seq.load(std::memory_order_acquire) + index;
+}
+
+static void Cell_Set_Seq(uint32_t index, uint32_t seq) {
+  cells[index].seq.store(seq - index, std::memory_order_release);
+}
+
+uint32_t Log_Clock() {
+  return Hal_Millis();
+}
+
+void Log_Capture(log_entry_t *entry, int index, log_str_t value) {
+  strncpy(entry->text, value.s ? value.s : "", sizeof(entry->text) - 1);
+  entry->text[sizeof(entry->text) - 1] = '\0';
+  entry->args[index] = 0;
+  entry->inlineArg = (int8_t)index;
+}
+
+void Log_Push(const log_entry_t *entry) {
+  uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+  for(;;) {
+    uint32_t index = pos & (LOG_RING_SIZE - 1);
+    int32_t diff = (int32_t)(Cell_Seq(index) - pos);
+    if(diff == 0) {
+      if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        cells[index].entry = *entry;
+        Cell_Set_Seq(index, pos + 1);
+        written.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    } else if(diff < 0) {
+      dropped.fetch_add(1, std::memory_order_relaxed); // Full: never block the caller
+      return;
+    } else {
+      pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// Minimal printf over captured arguments
+static size_t Log_Format(const log_entry_t *entry, char *out, size_t cap) {
+  size_t len = 0;
+  int arg = 0;
+  const char *p = entry->format;
+
+  while(*p && len + 1 < cap) {
+    if(*p != '%') {
+      out[len++] = *p++;
+      continue;
+    }
+    if(p[1] == '%') {
+      out[len++] = '%';
+      p += 2;
+      continue;
+    }
+
+    // Copy one conversion spec (flags, width, precision, length)
+    char spec[16];
+    size_t n = 0;
+    spec[n++] = *p++;
+    while(*p && strchr("-+ #0123456789.lhz", *p) && n < sizeof(spec) - 2) {
+      spec[n++] = *p++;
+    }
+    char conv = *p ? *p++ : 's';
+
+    // Arguments are stored as uintptr_t, so drop any length modifier
+    while(n > 1 && strchr("lhz", spec[n - 1])) {
+      n--;
+    }
+
+    uintptr_t value = arg < entry->argCount ? entry->args[arg] : 0;
+    int written;
+    if(conv == 's') {
+      spec[n++] = 's';
+      spec[n] = '\0';
+      const char *str = arg == entry->inlineArg ? entry->text : (const char *)value;
+      written = snprintf(out + len, cap - len, spec, str ? str : "(null)");
+    } else if(conv == 'p') {
+      spec[n++] = 'p';
+      spec[n] = '\0';
+      written = snprintf(out + len, cap - len, spec, (void *)value);
+    } else if(conv == 'c') {
+      spec[n++] = 'c';
+      spec[n] = '\0';
+      written = snprintf(out + len, cap - len, spec, (int)value);
+    } else if(conv == 'd' || conv == 'i') {
+      spec[n++] = 'l';
+      spec[n++] = 'd';
+      spec[n] = '\0';
+      written = snprintf(out + len, cap - len, spec, (long)(intptr_t)value);
+    } else {
+      // u, x, X, o of a C int: keep 32-bit width
+      spec[n++] = 'l';
+      spec[n++] = conv;
+      spec[n] = '\0';
+      written = snprintf(out + len, cap - len, spec, (unsigned long)(uint32_t)value);
+    }
+    arg++;
+    if(written > 0) {
+      len += (size_t)written < cap - len ? (size_t)written : cap - len - 1;
+    }
+  }
+
+  out[len] = '\0';
+  return len;
+}
+
+int Log_Drain(int max) {
+  int printed = 0;
+  char line[192];
+  while(printed < max) {
+    uint32_t index = dequeuePos & (LOG_RING_SIZE - 1);
+    if(Cell_Seq(index) != dequeuePos + 1) {
+      break; // Empty
+    }
+    log_entry_t entry = cells[index].entry;
+    Cell_Set_Seq(index, dequeuePos + LOG_RING_SIZE);
+    dequeuePos++;
+
+    Log_Format(&entry, line, sizeof(line));
+    Serial.printf("%lu %c %s\n", (unsigned long)entry.stamp, levelTag[entry.level], line);
+    printed++;
+  }
+
+  uint32_t lost = dropped.load(std::memory_order_relaxed);
+  if(lost != droppedReported) {
+    Serial.printf("Log Overflow: %lu records dropped\n", (unsigned long)(lost - droppedReported));
+    droppedReported = lost;
+  }
+  return printed;
+}
+
+#ifdef ARDUINO
+static void Log_Task(void *arg) {
+  (void)arg;
+  for(;;) {
+    if(Log_Drain(LOG_RING_SIZE) == 0) {
+      vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_IDLE_MS));
+    }
+  }
+}
+
+bool Log_Start() {
+  // Just above idle: formatting and Serial writes only run when nothing else wants the CPU
+  drainerRunning = xTaskCreate(Log_Task, "log", 4096, NULL, tskIDLE_PRIORITY + 1, NULL) == pdPASS;
+  return drainerRunning;
+}
+#else
+bool Log_Start() {
+  return false;
+}
+#endif
+
+void Log_Service() {
+  if(!drainerRunning) {
+    Log_Drain(LOG_RING_SIZE);
+  }
+}
+
+const log_stats_t *Log_Get_Stats() {
+  stats.written = written.load(std::memory_order_relaxed);
+  stats.dropped = dropped.load(std::memory_order_relaxed);
+  return &stats;
+}
@@ -1,16 +1,52 @@
-#include <WiFi.h>
-#include <esp_wifi.h>
-#include <esp_now.h>
-#include <map>
-#include <ETH.h>
-#include <HTTPClient.h>
-#include <ArduinoJson.h>
 #include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "hal.h"
+#include "message.h"
+#include "spsc_ring.h"
+#include "dedup_cache.h"
+#include "wire_format.h"
+#include "uplink.h"
+#include "spool.h"
+#include "route_cache.h"
+#include "log.h"
+#include "metrics.h"
+#include "reliable.h"
+#include "reassembly.h"
+#include "peer_cache.h"
+#include "pipeline.h"
+#include "aggregate.h"
+#include "compress.h"
+#include "capture.h"
+#include "link_quality.h"
+#include "flood.h"
+#include "command.h"
+#include "qos.h"
+#include "tdma.h"
+#include "datagram.h"
 
-#define MAX_TRIES 3
 #define EEPROM_SIZE 512
-#define MAX_NODES 9
-#define MAC_SIZE 6
+
+#ifndef RX_QUEUE_SIZE
+#define RX_QUEUE_SIZE 16 // Receive Queue Slots per Priority Class (power of two)
+#endif
+
+#ifndef RX_QUEUE_POLICY
+#define RX_QUEUE_POLICY RING_DROP_NEWEST // Overflow Policy (RING_DROP_NEWEST / RING_DROP_OLDEST)
+#endif
+
+#ifndef UPLINK_COMPRESS
+#define UPLINK_COMPRESS 0 // Gzip Batches (Content-Encoding: gzip)
+#endif
+
+#ifndef LINK_REPORT_QUEUE_SIZE
+#define LINK_REPORT_QUEUE_SIZE 32 // Send Results Waiting for the Route Stage (power of two)
+#endif
+
+#ifndef UPLINK_QUEUE_SIZE
+#define UPLINK_QUEUE_SIZE 16 // Records per Priority Class Waiting for the Uplink Stage (power of two)
+#endif
 
 /* NOTE: In order for your Node to communicate with any other node. The two must be connected to eath other with encryption enabled.
 Refer to this https://github.com/FarhanKashif/Scalable-ESP32-Mesh-Network-Using-ESP-NOW for more information. */
@@ -18,7 +54,10 @@ Refer to this https://github.com/FarhanKashif/Scalable-ESP32-Mesh-Network-Using-
 const uint8_t node3[] = {0x24, 0xDC, 0xC3, 0xC6, 0xAE, 0xCC}; // Replace with MAC of Node from where you want to receive data 
 
 /* Server URL */
-const char serverURL[] = "http://192.168.1.1:5000/receive_data";  // replace with your local host (Ensure Port 5000 is not being used)
+#ifndef SERVER_URL
+#define SERVER_URL "http://192.168.1.1:5000/receive_data"  // replace with your local host (Ensure Port 5000 is not being used)
+#endif
+const char serverURL[] = SERVER_URL;
 
 // PMK & LMK Keys
 static const char *PMK_KEY = "Connection_ESP32"; // 16-byte PMK
@@ -26,166 +65,203 @@ static const char *LMK_KEY = "LMK@ESP32_123456"; // 16-byte LMK
 
 /* Project Variables */
 uint8_t baseMac[6]; // Base MAC Address of Sender
-unsigned long startTime, endTime; // Timer Variables
-int incoming_data_count = 0; // Incoming Data Count
-std::map<int, bool> receivedpackets;  // Track of Packet ID's
+dedup_cache_t receivedpackets;  // Track of (Source MAC, Packet ID)'s
 int counter = 1;  // Session Counter
 
-/* PACKET STRUCTURE */
-typedef struct message {
-  unsigned char text[64]; // 64 bytes of text
-  //int value; 
-  //float temperature;
-  int TTL; // Time to live for packet 
-  int identification; // 1-> BROADCAST, 2-> DATA
-  bool broadcast_Ack; //  0 -> Default Communication, 1 -> Acknowledgement of Broadcast
-  bool Data_Ack; // 0 -> Default Communication, 1 -> Acknowledgement of Data
-  uint8_t destination_mac[6]; // MAC Address of Receiver
-  uint8_t source_mac[6]; // MAC Address of Sender
-  int packetID; // Packet ID
-  uint8_t Path_Array[MAX_NODES][MAC_SIZE]; // Path Array
-  uint8_t Path_Index; // Index of Path Array
-  uint8_t Path_Length;  // Length of Path Array
-  bool Path_Exist;  // Check if Path Exists
-} message_t;
-
-message_t msg, copy_msg;
-
-enum State {
-  WAITING_FOR_ACK,
-  READY_TO_SEND,
-};
-
-State currentState = READY_TO_SEND; // Initial State of Device
-
-// Queue Structure
-typedef struct queue_node {
-  message_t data;
-  uint8_t mac[6];
-  struct queue_node *next;
-} queue_node_t;
+/* Uplink Variables */
+spool_storage_t spoolStorage; // Flash Backing for Undelivered Batches
+const char spoolPath[] = SPOOL_PATH;
+bool uplinkCompress = UPLINK_COMPRESS; // Spooled batches stay raw; compressed on every send
+static uint8_t compressedBody[UPLINK_BATCH_BYTES];
+uplink_transport uplinkTransport = UPLINK_TRANSPORT; // Batches go by POST or by Datagram
+datagram_t datagrams; // Batches Sent by Datagram Awaiting their Ack
+
+message_t msg;
+
+reliable_t outbound; // Gateway-Originated Packets Awaiting Data_Ack
+flood_t flooding; // Broadcast Packets Repeated for Neighbours
+tdma_schedule_t tdma; // Time Sync Beacons and Transmit Slot Grants
+static const uint8_t broadcastMac[MAC_SIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+/* Receive Queues, one per priority_class (filled by On_Data_Receive, drained by the route stage in Qos_Pick order) */
+SpscRing<queue_node_t, RX_QUEUE_SIZE, RX_QUEUE_POLICY> rxQueue[PRIORITY_CLASSES];
+qos_scheduler_t rxScheduler;
+uint32_t rxDropsReported = 0; // Overflow Count Last Printed
+
+/* Send Results (filled by On_Data_Sent, drained into link quality by the route stage) */
+typedef struct {
+  uint8_t mac[MAC_SIZE];
+  bool success;
+} link_report_t;
+SpscRing<link_report_t, LINK_REPORT_QUEUE_SIZE> linkReports;
+
+/* Uplink Queues, one per priority_class (filled by the route stage, drained by the uplink stage in Qos_Pick order) */
+typedef struct {
+  message_t data; // As Acknowledged (reversed path)
+  const uint8_t *payload; // Held Reassembly Buffer, or NULL
+  uint16_t len;
+} uplink_job_t;
+SpscRing<uplink_job_t, UPLINK_QUEUE_SIZE> uplinkQueue[PRIORITY_CLASSES];
+qos_scheduler_t uplinkScheduler;
+
+// Bit per class with an item waiting
+template <typename Ring>
+uint8_t Ready_Classes(const Ring *rings) {
+  uint8_t ready = 0;
+  for(int c = 0; c < PRIORITY_CLASSES; c++) {
+    ready |= rings[c].Empty() ? 0 : (uint8_t)(1u << c);
+  }
+  return ready;
+}
+
+template <typename Ring>
+uint32_t Dropped_Total(const Ring *rings) {
+  uint32_t dropped = 0;
+  for(int c = 0; c < PRIORITY_CLASSES; c++) {
+    dropped += rings[c].Dropped();
+  }
+  return dropped;
+}
+
+/* Pipeline Stages: route/ack next to the radio on core 0, uplink on core 1 so a slow POST never delays an ack */
+void RouteStage();
+void UplinkStage();
+pipeline_stage_t routeStage = {"route", RouteStage, 0, 5, 6144, 10, NULL, 0, 0}; // 10 ms Tick for Retransmits
+pipeline_stage_t uplinkStage = {"uplink", UplinkStage, 1, 2, 8192, 50, NULL, 0, 0}; // 50 ms Tick for Batch Deadlines
 
 /* FUNCTION DEFINITIONS */
-void Add_Peer(const uint8_t* mac);
-void SwitchToEncryption(const uint8_t *mac);
 void On_Data_Receive(const uint8_t* mac, const uint8_t* data, int len);
 void readMAC();
-void On_Data_Sent(const uint8_t *mac_addr, esp_now_send_status_t status);
-void ProcessReceivedData();
+void On_Data_Sent(const uint8_t *mac_addr, bool success);
+void ProcessReceivedData(queue_node_t *temp);
+void Acknowledge_Data(queue_node_t *temp);
+void ReassembleFragment(queue_node_t *temp);
 bool AppendBaseMAC(uint8_t index);
 void ReverseArray(uint8_t index, uint8_t path_arr[MAX_NODES][MAC_SIZE]);
 void FollowPathArray(queue_node_t *temp);
 void PrintArray(uint8_t path_arr[MAX_NODES][MAC_SIZE], uint8_t index);
 bool Configure_Packet(const char *text, int TTL, int identification, bool broadcast_Ack, bool Data_Ack, const uint8_t *destination_mac, const uint8_t *source_mac, bool path_exist);
-void Check_Existing_Peer(const uint8_t* mac);
+bool Check_Existing_Peer(const uint8_t* mac);
+hal_err_t Send_Packet(const uint8_t *mac, const message_t *packet);
+bool Transmit_Frame(void *ctx, const uint8_t *nextHop, const uint8_t *frame, size_t len);
+bool Broadcast_Frame(void *ctx, const uint8_t *frame, size_t len);
+void Outbound_Failed(void *ctx, const uint8_t *destination, int32_t packetID, uint32_t now);
+void SendCommand(const command_t *command);
 void SerializeData(queue_node_t *temp);
-void SendDataToServer(String jsonString);
+bool SendDataToServer(const uint8_t *body, size_t len);
+void Datagram_Given_Up(const uint8_t *body, size_t len);
+bool Uplink_Transport_Ready();
 void InitializeEthernet();
+size_t Serve_Metrics(const char *path, char *body, size_t cap, const char **contentType);
 void TestEthernetConnection();
 
-/* Queue Variables */
-queue_node_t *front = NULL;
-queue_node_t *rear = NULL;
-
 // Append Base MAC to Path Array
 bool AppendBaseMAC(uint8_t index) {
   
-  Serial.printf("Inside Append MAC\n");
+  LOG_DEBUG("Inside Append MAC");
 
   if(index >= MAX_NODES) {
-    Serial.println("Max Nodes Reached. Cannot Append MAC Address.");
+    LOG_WARN("Max Nodes Reached. Cannot Append MAC Address.");
     return false;
   }
 
   // Copy Base MAC Address to Path Array
   memcpy(msg.Path_Array[index], baseMac, 6);
-  Serial.printf("Appended MAC at index: %d\n", index);
+  LOG_DEBUG("Appended MAC at index: %d", index);
   msg.Path_Index = ++index; // Increment Index of Path Array
   ++msg.Path_Length; // Increment Length of Path Array
   return true;
 }
 
-// Send Data to Flask Server
-void SendDataToServer(String jsonString) {
+// Send Batch to the Server: POST to Flask (connection is kept open between batches), or one datagram
+bool SendDataToServer(const uint8_t *body, size_t len) {
+
+  // Datagram: accepted into the window now, acked later (batches given up on are spooled uncompressed)
+  if(uplinkTransport == UPLINK_UDP) {
+    uint8_t flags = (uplinkCompress ? DATAGRAM_FLAG_GZIP : 0) | (UPLINK_FORMAT == RECORD_MSGPACK ? DATAGRAM_FLAG_MSGPACK : 0);
+    return Datagram_Send(&datagrams, body, len, flags, Hal_Millis()); // Gzipped per Send, as Framed
+  }
 
-  HTTPClient http;
-  http.begin(serverURL);
-  http.addHeader("Content-Type", "application/json"); // Set the content type to JSON
+  // Gzip the batch when enabled and it shrinks
+  const char *encoding = NULL;
+  if(uplinkCompress) {
+    uint32_t started = Metrics_Clock();
+    size_t packed = Compress_Gzip(body, len, compressedBody, sizeof(compressedBody));
+    Metrics_Observe(HIST_COMPRESS, Metrics_Clock() - started);
+    if(packed > 0) {
+      body = compressedBody;
+      len = packed;
+      encoding = "gzip";
+    }
+  }
 
-  // Send the JSON string via POST request
-  int httpResponseCode = http.POST(jsonString);
+  // Send the batch via POST request (JSON or MessagePack)
+  uint32_t sentAt = Metrics_Clock();
+  int httpResponseCode = Hal_Http_Post(serverURL, Uplink_Content_Type(), encoding, body, len);
+  Metrics_Observe(HIST_HTTP_RTT, Metrics_Clock() - sentAt);
 
   // Check the response code
   if (httpResponseCode > 0) {
-    String response = http.getString(); // Get the response from the server
-    Serial.print("POST Response code: "); // Print the response code
-    Serial.println(httpResponseCode); // Print the HTTP response code
-    Serial.println(response); // Print the server response
+    LOG_INFO("POST Response code: %d", httpResponseCode); // Print the HTTP response code
   } else {
-    Serial.print("Error on sending POST: "); // Print error message
-    Serial.println(httpResponseCode); // Print the error code
+    LOG_ERROR("Error on sending POST: %d", httpResponseCode); // Print the error code
   }
 
-  http.end(); // End Connection
-
+  bool delivered = httpResponseCode >= 200 && httpResponseCode < 300;
+  if(!delivered) {
+    Metrics_Add(METRIC_HTTP_ERRORS);
+  }
+  return delivered;
 }
-// Serialize data
-void SerializeData(queue_node_t *temp) {
 
-  //StaticJsonDocument<200> jsonDoc; 
-  DynamicJsonDocument jsonDoc(200);
-
-  jsonDoc["text"] = (const char*)temp->data.text;
-  jsonDoc["TTL"] = temp->data.TTL;
-  jsonDoc["identification"] = temp->data.identification;
-  jsonDoc["broadcast_Ack"] = temp->data.broadcast_Ack;
-  jsonDoc["Data_Ack"] = temp->data.Data_Ack;
-  jsonDoc["packetID"] = temp->data.packetID;
-  jsonDoc["Path_Index"] = temp->data.Path_Index;
-  jsonDoc["Path_Length"] = temp->data.Path_Length;
-  jsonDoc["Path_Exist"] = temp->data.Path_Exist;
-
-  // Serialize the Path_Array
-  JsonArray pathArray = jsonDoc["Path_Array"].to<JsonArray>();
-  for (int i = 0; i <= temp->data.Path_Index; i++) {
-    JsonArray pathElement = pathArray.add<JsonArray>();
-    for (int j = 0; j < MAC_SIZE; j++) {
-      pathElement.add(temp->data.Path_Array[i][j]);
-    }
+// Datagram Receiver Never Acked the Batch: Keep it for Replay
+void Datagram_Given_Up(const uint8_t *body, size_t len) {
+  LOG_WARN("Uplink Datagram Unacknowledged. Spooling Batch.");
+  if(!Spool_Store(body, len)) {
+    LOG_ERROR("Failed to Spool Batch. Batch Lost.");
   }
+}
 
-  // Serialize Source MAC
-  JsonArray sourceMAC = jsonDoc["SourceMAC"].to<JsonArray>();
-  for(int i=0;i<MAC_SIZE;i++) {
-    sourceMAC.add(temp->data.source_mac[i]);
+// False while every datagram slot awaits its ack: records then wait in the uplink queues
+bool Uplink_Transport_Ready() {
+  return uplinkTransport != UPLINK_UDP || Datagram_Can_Send(&datagrams);
+}
+// Hand a record (and its reassembled payload, if any) to the uplink stage
+bool QueueUplink(const message_t *data, const uint8_t *payload, uint16_t len) {
+  uplink_job_t job;
+  job.data = *data;
+  job.payload = payload;
+  job.len = len;
+  if(!uplinkQueue[data->priority].Push(job)) {
+    LOG_WARN("Uplink Queue Full. Dropping Record.");
+    return false;
   }
- 
-  String jsonString;
-  serializeJson(jsonDoc, jsonString);
-
-  // Send Data to Flask Server
-  SendDataToServer(jsonString);
+  Pipeline_Wake(&uplinkStage);
+  return true;
+}
 
+void SerializeData(queue_node_t *temp) {
+  QueueUplink(&temp->data, NULL, 0); // Serialized by the uplink stage
 }
 // Callback when data is sent
-void On_Data_Sent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-  Serial.print("Packet Successfully Sent to: ");
-  startTime = millis(); // Start Timer
-  for(int i=0;i<5;i++) {
-    Serial.print(mac_addr[i], HEX);
-    if(i < 5) {
-      Serial.print(":");
-    }
-    if(i==5) {
-      Serial.println(""); // Print Next Line
-    }
+void On_Data_Sent(const uint8_t *mac_addr, bool success) {
+  link_report_t report;
+  memcpy(report.mac, mac_addr, MAC_SIZE);
+  report.success = success;
+  linkReports.Push(report); // A lost report only delays the link estimate
+
+  if(success) {
+    LOG_DEBUG("Packet Successfully Sent to: " MAC_FMT, MAC_ARGS(mac_addr));
+  } else {
+    Metrics_Add(METRIC_TX_FAILURES);
+    LOG_WARN("Packet Delivery Failed to: " MAC_FMT, MAC_ARGS(mac_addr));
   }
 
 }
 
 void PrintArray(uint8_t path_arr[MAX_NODES][MAC_SIZE], uint8_t index) {
   for(int i=0;i<=index;i++) {
-    Serial.printf("MAC at index %d: %02X:%02X:%02X:%02X:%02X:%02X\n",i, path_arr[i][0], path_arr[i][1], path_arr[i][2], path_arr[i][3], path_arr[i][4], path_arr[i][5]);
+    LOG_DEBUG("MAC at index %d: " MAC_FMT, i, MAC_ARGS(path_arr[i]));
   }
 }
 
@@ -200,126 +276,118 @@ void ReverseArray(uint8_t index, uint8_t path_arr[MAX_NODES][MAC_SIZE]) {
       memcpy(path_arr[size - 1 - i], temp, MAC_SIZE);  // Copy current element to last index
   }
 
-  Serial.println("Row reversed Successfully.");
+  LOG_DEBUG("Row reversed Successfully.");
 }
 
 
 // Read MAC Address of ESP32
 void readMAC()
 {
-  if(esp_read_mac(baseMac, ESP_MAC_WIFI_STA) == ESP_OK)
+  if(Hal_Radio_Read_MAC(baseMac))
   {
-    Serial.printf("MAC Address: %02X:%02X:%02X:%02X:%02X:%02X\n", baseMac[0], baseMac[1], baseMac[2], baseMac[3], baseMac[4], baseMac[5]);
+    LOG_INFO("MAC Address: " MAC_FMT, MAC_ARGS(baseMac));
   } else {
-    Serial.println("Failed to read MAC address..");
+    LOG_ERROR("Failed to read MAC address..");
+  }
+}
+
+
+// Encode Packet and Send over ESP-NOW
+hal_err_t Send_Packet(const uint8_t *mac, const message_t *packet) {
+  if(!Check_Existing_Peer(mac)) {
+    return HAL_FAIL;
+  }
+#if WIRE_LEGACY_TX
+  return Hal_Radio_Send(mac, (const uint8_t *) packet, WIRE_LEGACY_SIZE);
+#else
+  uint8_t frame[WIRE_MAX_FRAME];
+  size_t len = Wire_Encode(packet, frame, sizeof(frame));
+  if(len == 0) {
+    return HAL_FAIL;
   }
+  return Hal_Radio_Send(mac, frame, len);
+#endif
 }
 
+// Transmit Hook for the Reliable Delivery Engine
+bool Transmit_Frame(void *ctx, const uint8_t *nextHop, const uint8_t *frame, size_t len) {
+  (void)ctx;
+  hal_err_t result = Check_Existing_Peer(nextHop) ? Hal_Radio_Send(nextHop, frame, len) : HAL_FAIL;
+  if(result != HAL_OK) {
+    LOG_ERROR("Error while sending Data to Path: %s", Hal_Err_Name(result));
+  }
+  return result == HAL_OK;
+}
+
+// Transmit Hook for the Flooding Layer (broadcast peer is unencrypted)
+bool Broadcast_Frame(void *ctx, const uint8_t *frame, size_t len) {
+  (void)ctx;
+  hal_err_t result = Hal_Radio_Send(broadcastMac, frame, len);
+  if(result != HAL_OK) {
+    LOG_ERROR("Error while Broadcasting: %s", Hal_Err_Name(result));
+  }
+  return result == HAL_OK;
+}
+
+// Reliable Engine Gave Up on a Gateway-Originated Packet
+void Outbound_Failed(void *ctx, const uint8_t *destination, int32_t packetID, uint32_t now) {
+  (void)ctx;
+  if(Command_On_Failed(destination, packetID, now)) {
+    LOG_WARN("Command to " MAC_FMT " Never Acknowledged.", MAC_ARGS(destination));
+  }
+}
+
+// Send a Server Command to its Node along the Cheapest Known Path, Retransmitted until its Data_Ack
+void SendCommand(const command_t *command) {
+  const route_path_t *route = Route_Cache_Lookup(command->mac, Hal_Millis());
+  if(route == NULL) {
+    LOG_WARN("No Route to " MAC_FMT ". Command Rejected.", MAC_ARGS(command->mac));
+    Command_Rejected(command, COMMAND_NO_ROUTE);
+    return;
+  }
+
+  Configure_Packet(command->text, 10, 2, false, false, command->mac, baseMac, true); // Configure Packet
+  memcpy(msg.Path_Array, route->reverse, sizeof(msg.Path_Array)); // Gateway First, Node Last
+  msg.Path_Index = 1; // Next Hop
+  if(!Reliable_Send(&outbound, msg.Path_Array[1], &msg, NULL, Hal_Micros())) {
+    Command_Rejected(command, COMMAND_BUSY); // Node's Window Full
+    return;
+  }
+  LOG_DEBUG("Command %u Sent to " MAC_FMT " as Packet %d", (unsigned)command->id, MAC_ARGS(command->mac), msg.packetID);
+  Command_Sent(command, msg.packetID);
+}
 
 // Send Data to Next Hop in Path
 void FollowPathArray(queue_node_t *temp) {
 
     // Copy Path Array to Packet Path Array
-    Serial.println("Inside Follow Path Array.");
-    PrintArray(msg.Path_Array, MAX_NODES);
+    LOG_DEBUG("Inside Follow Path Array.");
+    PrintArray(msg.Path_Array, MAX_NODES - 1);
 
     ++temp->data.Path_Index; // Increment Path Index (1)
     msg.Path_Index = temp->data.Path_Index; // Copy Index to Packet Path Index (copies 1 to msg.Path_Index)
 
-    Serial.printf("Sending to MAC: %02X:%02X:%02X:%02X:%02X:%02X at index %d\n", temp->data.Path_Array[temp->data.Path_Index][0], temp->data.Path_Array[temp->data.Path_Index][1], temp->data.Path_Array[temp->data.Path_Index][2], temp->data.Path_Array[temp->data.Path_Index][3], temp->data.Path_Array[temp->data.Path_Index][4], temp->data.Path_Array[temp->data.Path_Index][5], temp->data.Path_Index);
+    LOG_DEBUG("Sending to MAC: " MAC_FMT " at index %d", MAC_ARGS(temp->data.Path_Array[temp->data.Path_Index]), temp->data.Path_Index);
 
     // Send Packet to Next MAC in Path Array
-    esp_err_t result = esp_now_send(temp->data.Path_Array[temp->data.Path_Index], (uint8_t *) &msg, sizeof(msg));
-    if(result == ESP_OK) {
-      Serial.printf("Acknowledgement Sent with Success to MAC: %02X:%02X:%02X:%02X:%02X:%02X\n", temp->data.Path_Array[temp->data.Path_Index][0], temp->data.Path_Array[temp->data.Path_Index][1], temp->data.Path_Array[temp->data.Path_Index][2], temp->data.Path_Array[temp->data.Path_Index][3], temp->data.Path_Array[temp->data.Path_Index][4], temp->data.Path_Array[temp->data.Path_Index][5]);
+    hal_err_t result = Send_Packet(temp->data.Path_Array[temp->data.Path_Index], &msg);
+    if(result == HAL_OK) {
+      LOG_DEBUG("Acknowledgement Sent with Success to MAC: " MAC_FMT, MAC_ARGS(temp->data.Path_Array[temp->data.Path_Index]));
     } else {
-      Serial.println("Error while sending Data to Path.");
-      Serial.println(esp_err_to_name(result));
+      LOG_ERROR("Error while sending Data to Path: %s", Hal_Err_Name(result));
     }
 
 }
 
-// Enable Encryption for MAC Address
-void SwitchToEncryption(const uint8_t *mac) {
-  if(esp_now_is_peer_exist(mac)) {
-    esp_now_peer_info_t peerInfo = {};
-
-    if(esp_now_get_peer(mac, &peerInfo) == ESP_OK) {
-      if(peerInfo.encrypt) {
-        Serial.println("Encryption Mode Already Enabled.");
-        Serial.printf("Peer MAC: %02X:%02X:%02X:%02X:%02X:%02X\n", peerInfo.peer_addr[0], peerInfo.peer_addr[1], peerInfo.peer_addr[2], peerInfo.peer_addr[3], peerInfo.peer_addr[4], peerInfo.peer_addr[5]);
-        return; // Return if Encryption Mode is already enabled
-      } else {
-        Serial.println("Encryption Mode Not Enabled. Enabling Encryption Mode.");
-        memset(&peerInfo, 0, sizeof(peerInfo));
-        memcpy(peerInfo.peer_addr, mac, 6);
-        peerInfo.channel = 0;
-        
-        for(uint8_t i = 0; i<16; i++) {
-          peerInfo.lmk[i] = LMK_KEY[i];
-        }
-        peerInfo.encrypt = true;
-        if(esp_now_del_peer(mac) == ESP_OK) {
-          Serial.println("Peer Deleted Successfully.");
-        } else {
-          Serial.println("Failed to Delete Peer.");
-        }
-        
-        if(esp_now_add_peer(&peerInfo) == ESP_OK) {
-          Serial.println("Encryption Mode Successfully Enabled.");
-        } else {
-          Serial.println("Failed to Add Peer With Encryption.");
-        }
-      }
-    } else {
-      Serial.println("Failed to Fetch Peer Information.");
-    }
-  }
-}
-
-// Add Peer in Routing Table
-void Add_Peer(const uint8_t* mac) {
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, mac, 6);
-  peerInfo.channel = 0;
-  
-  for(uint8_t i = 0; i<16; i++) {
-    peerInfo.lmk[i] = LMK_KEY[i];
-  }
-
-  peerInfo.encrypt = false; // Enable Encryption Mode
-
-  esp_err_t status = esp_now_add_peer(&peerInfo);
-
-  // Print MAC Address
-  if (status == ESP_OK) {
-    Serial.println("Peer Added Successfully");
-    Serial.print("Peer MAC: ");
-    for (int i = 0; i < 6; i++) {
-      Serial.print(mac[i], HEX);
-      if (i < 5) {
-        Serial.print(":");
-      } 
-      if (i == 5) {
-        Serial.println(""); // print a new line
-      }
-    }
-  } else {
-    Serial.println("Error Adding Peer.");
-    Serial.println(esp_err_to_name(status));
-  }
-}
-
-// Check if Peer Already Exists
-void Check_Existing_Peer(const uint8_t* mac)
+// Make Sure the Next Hop is a Registered Encrypted Peer
+bool Check_Existing_Peer(const uint8_t* mac)
 {
-  bool exists = esp_now_is_peer_exist(mac);
-  if(!exists) {
-    Serial.println("New Peer Found.");
-    Serial.println("Adding Peer");
-    Add_Peer(mac);  // Add New Peer to network
-    SwitchToEncryption(mac);  // Switch to Encryption Mode
+  hal_err_t status = Peer_Cache_Acquire(mac, Hal_Millis()); // Swaps out the Least Recently Used Peer if the Radio is Full
+  if(status != HAL_OK) {
+    LOG_ERROR("Error Adding Peer " MAC_FMT ": %s", MAC_ARGS(mac), Hal_Err_Name(status));
+    return false;
   }
+  return true;
 }
 
 // Configure Packet
@@ -336,7 +404,7 @@ bool Configure_Packet(const char *text, int TTL, int identification, bool broadc
   msg.identification = identification; // Set Identification
   msg.broadcast_Ack = broadcast_Ack; // Set Acknowledgement
   msg.Data_Ack = Data_Ack; // Set Data Acknowledgement
-  int random = esp_random(); // Generate Random Packet ID
+  int random = Hal_Random(); // Generate Random Packet ID
   msg.packetID = random; // Set Packet ID
   memcpy(msg.destination_mac, destination_mac, 6); // Set Destination MAC Address
   memcpy(msg.source_mac, source_mac, 6); // Set Source MAC Address
@@ -346,265 +414,480 @@ bool Configure_Packet(const char *text, int TTL, int identification, bool broadc
   if(!path_exist && !broadcast_Ack && (identification == 2) && (!Data_Ack)) {  
     bool result = AppendBaseMAC(0); // Append Base MAC Address to Path Array
     if(result) {
-      Serial.println("Appended MAC Successfully.");
+      LOG_DEBUG("Appended MAC Successfully.");
     } else {
-      Serial.println("Failed to Append MAC.");
+      LOG_WARN("Failed to Append MAC.");
     }
   }
 
-  memcpy(&copy_msg, &msg, sizeof(msg)); // Make a Buffer of Packet
-
   return true;
 }
 
 // Callback when data is received
 void On_Data_Receive(const uint8_t* mac, const uint8_t* data, int len) {
-  Serial.println("Inside On_Data_Receive Function");
-  // Copy data to msg structure
-  endTime = millis(); // Stop Timer
-  memcpy(&msg, data, sizeof(msg)); 
-
-  // Handle Incoming Data 
-  queue_node_t *new_node = (queue_node_t *)malloc(sizeof(queue_node_t));
-  if(new_node == NULL) {
-    Serial.println("Memory Allocation Failed.");
+  LOG_DEBUG("Inside On_Data_Receive Function");
+  Metrics_Add(METRIC_RX_FRAMES);
+  Capture_Frame(mac, data, len, Hal_Micros()); // Raw Copy Before Decode (no-op unless a sink is set)
+  if(len > 0 && Wire_Is_Beacon(data, (size_t)len)) {
+    return; // Neighbours Repeating our Own Beacon
+  }
+
+  // Decode packet straight into a queue slot (no shared buffer, no heap)
+  queue_node_t new_node;
+  new_node.rxStamp = Metrics_Clock();
+  new_node.rssi = Hal_Radio_RSSI(mac);
+  new_node.fragmented = len > 0 && Wire_Is_Fragment(data, (size_t)len);
+  bool decoded = new_node.fragmented ? Wire_Decode_Fragment(data, (size_t)len, &new_node.data, &new_node.fragment)
+                                     : len > 0 && Wire_Decode(data, (size_t)len, &new_node.data);
+  if(!decoded) {
+    LOG_WARN("Malformed Packet (%d bytes). Discarding Packet.", len);
+    Metrics_Add(METRIC_RX_MALFORMED);
     return;
   }
-  
-  // Copy message details to new node
-  strncpy((char*)new_node->data.text, (char*)data, sizeof(new_node->data.text) - 1);
-  new_node->data.text[sizeof(new_node->data.text) - 1] = '\0';
-  memcpy(new_node->mac, mac, 6); 
-  new_node->data.identification = msg.identification;
-  new_node->data.broadcast_Ack = msg.broadcast_Ack; 
-  new_node->data.Data_Ack = msg.Data_Ack;
-  new_node->data.TTL = msg.TTL;  
-  new_node->data.packetID = msg.packetID;
-  memcpy(new_node->data.destination_mac, msg.destination_mac, 6); // Set Destination MAC Address
-  memcpy(new_node->data.source_mac, msg.source_mac, 6); // Set Source MAC Address
-  new_node->data.Path_Index = (uint8_t)msg.Path_Index;  // Set Path Index
-  new_node->data.Path_Length = (uint8_t)msg.Path_Length;  // Set Path Length
-  new_node->data.Path_Exist = msg.Path_Exist;  // Set Path Exist Flag
-  // Store Path Array in new node
-  for(int i=0;i<MAX_NODES;i++) {
-    memcpy(new_node->data.Path_Array[i], msg.Path_Array[i], MAC_SIZE);
-  }
-  new_node->next = NULL;
-
-  //Configure_Packet((char*)new_node->data.text, new_node->data.TTL, new_node->data.identification, new_node->data.broadcast_Ack, new_node->data.Data_Ack, new_node->data.destination_mac, new_node->data.source_mac, new_node->data.Path_Exist);
-
-  if(front == NULL && rear == NULL) {
-    front = rear = new_node;
-  } else {
-    rear->next = new_node;
-    rear = new_node;
+  memcpy(new_node.mac, mac, 6); 
+  if(new_node.data.captured == 0) {
+    new_node.data.captured = Hal_Millis(); // Unsynced or Older Node: Received Time is the Best Capture Time
   }
-  Serial.print("TTL: ");
-  Serial.println(msg.TTL);
-  Serial.printf("Destionation MAC Address: %02X:%02X:%02X:%02X:%02X:%02X\n", msg.destination_mac[0], msg.destination_mac[1], msg.destination_mac[2], msg.destination_mac[3], msg.destination_mac[4], msg.destination_mac[5]);
+
+  LOG_DEBUG("TTL: %d Destination MAC Address: " MAC_FMT, new_node.data.TTL, MAC_ARGS(new_node.data.destination_mac));
 
   // Check if the message is for this node
-  if(memcmp(baseMac, msg.destination_mac, 6) == 0) {
-    ++incoming_data_count; // Increment Incoming Data Count
+  if(memcmp(baseMac, new_node.data.destination_mac, 6) == 0) {
+    // Addressed to this node
   } 
   // Handle Broadcast Messages
-  else if(memcmp(msg.destination_mac, "\xFF\xFF\xFF\xFF\xFF\xFF", 6) == 0) {
-    Serial.println("Broadcast Message Received.");
-    ++incoming_data_count; // Increment Incoming Data Count
+  else if(Flood_Is_Broadcast(new_node.data.destination_mac)) {
+    LOG_DEBUG("Broadcast Message Received.");
   } else {
-    Serial.println("TTL Expired. Discarding Packet.");
-    memset(&msg, 0, sizeof(msg)); // Clear Message
-    free(new_node); // Free Memory
+    LOG_DEBUG("TTL Expired. Discarding Packet.");
+    return;
   }
-}
 
-void ProcessReceivedData() {
-  Serial.print("Packet ID: ");
-  Serial.println(msg.packetID);
-  // Check if Packet is already received
-  if(receivedpackets[msg.packetID]) {
-    Serial.println("Packet Already Received. Discarding Duplicate Packet.");
+  if(!rxQueue[new_node.data.priority].Push(new_node)) {
+    LOG_WARN("Receive Queue Full. Dropping Packet.");
     return;
   }
+  Pipeline_Wake(&routeStage);
+}
 
-  receivedpackets[msg.packetID] = true; // Mark Packet as Received
-
-  if(front == NULL) {
-    Serial.println("Queue is empty. No Data to Process");
+void ProcessReceivedData(queue_node_t *temp) {
+  LOG_DEBUG("Packet ID: %d", temp->data.packetID);
+  if(temp->data.identification == 2 && !temp->data.broadcast_Ack && !temp->data.Data_Ack) {
+    Tdma_Register(&tdma, temp->data.source_mac, Hal_Micros()); // Sources Keep a Transmit Slot while Heard
+  }
+  // Fragments are de-duplicated by the reassembly bitmap, not the packet cache
+  if(temp->fragmented && temp->data.identification == 2 && !temp->data.broadcast_Ack && !temp->data.Data_Ack) {
+    ReassembleFragment(temp);
     return;
   }
 
-  queue_node_t *temp = front;
-
-  Serial.println("Inside Processing Function");
-
-  front = front->next;  // Point to next node in queue
-
-  if(front == NULL) {
-    rear = NULL;
+  // Broadcasts: first copy is processed (and repeated for neighbours while TTL lasts), later copies only counted
+  if(Flood_Is_Broadcast(temp->data.destination_mac)) {
+    if(!Flood_On_Receive(&flooding, &temp->data, Hal_Micros(), Hal_Millis())) {
+      LOG_DEBUG("Broadcast Already Received. Discarding Copy.");
+      return;
+    }
+  }
+  // Check if Packet is already received
+  else if(Dedup_Check_And_Insert(&receivedpackets, temp->data.source_mac, temp->data.packetID, Hal_Millis())) {
+    if(temp->data.identification == 2 && !temp->data.broadcast_Ack && !temp->data.Data_Ack) {
+      // Retransmitted Data: our ack was lost, so ack again but do not upload twice
+      LOG_DEBUG("Packet Already Received. Acknowledging Duplicate Packet.");
+      Route_Cache_Ack_Lost(temp->data.source_mac, temp->data.packetID); // Count Against the Path it was Acked on
+      Acknowledge_Data(temp);
+    } else {
+      LOG_DEBUG("Packet Already Received. Discarding Duplicate Packet.");
+    }
+    return;
   }
 
+  LOG_DEBUG("Inside Processing Function");
+
   switch(temp->data.identification) {
     case 2: // DATA is Received 
-      Serial.println("*************************************************");
-      Serial.println("");
-      Serial.print("Session: ");
-      Serial.println(counter);
-      Serial.println("Session Started");
-      Serial.print("Sender MAC Address: ");
-
-      for (int i = 0; i < 6; i++) {
-        Serial.print(temp->data.source_mac[i], HEX);
-        if (i < 5) {
-          Serial.print(":");
-        } 
-        if( i == 5) {
-          Serial.println(""); // print a new line
-        }
-      }
-      Serial.print("Packet ID: ");
-      Serial.println(temp->data.packetID);
+      LOG_INFO("Session %d Started. Sender MAC Address: " MAC_FMT " Packet ID: %d", counter, MAC_ARGS(temp->data.source_mac), temp->data.packetID);
       if((bool *)temp->data.broadcast_Ack) {  // Process Broadcast Acknowledgement
-        Serial.print("Broadcast Acknowldgement Received: ");
-        Serial.println(temp->data.broadcast_Ack);
-        Serial.println((char *) temp->data.text);
-        Serial.println("*************************************************");
-        memset(&copy_msg, 0, sizeof(copy_msg)); // Clear the Buffer After Successful Broadcast Acknowledgement
+        LOG_INFO("Broadcast Acknowldgement Received: %s", Log_Str(temp->data.text));
       } else if((bool *)temp->data.Data_Ack) {  // Process Data Acknowledgement
-        Serial.print("Data Acknowledgement Received: ");
-        Serial.println(temp->data.Data_Ack);
-        Serial.println((char *) temp->data.text);
-        Serial.println("Session Terminated");
-        Serial.println("");
-        Serial.println("*************************************************");
-        memset(&copy_msg, 0, sizeof(copy_msg)); // Clear the Buffer After Successful Data Acknowledgement
-        currentState = READY_TO_SEND; // Change State to READY_TO_SEND
+        LOG_INFO("Data Acknowledgement Received: %s. Session Terminated", Log_Str(temp->data.text));
+        if(Reliable_On_Ack(&outbound, temp->data.source_mac, temp->data.ackID, Hal_Micros())) { // Release the Retransmit Copy
+          Command_On_Ack(temp->data.source_mac, temp->data.ackID, Hal_Micros()); // Report Delivery if it was a Command
+        }
       }
       else {
-        Serial.print("Data Received: ");
-        Serial.println((char*) temp->data.text);
-        Serial.println("Session Terminated");
-        Serial.println("");
-        Serial.println("*************************************************");
+        LOG_INFO("Data Received: %s. Session Terminated", Log_Str(temp->data.text));
         // Handle Sending Acknowledgement here for Data
-        AppendBaseMAC(temp->data.Path_Index); // Append Dst Base MAC Address to Path Array
-        PrintArray(msg.Path_Array, temp->data.Path_Index);  // Print Path Array
-        memset(&temp->data.Path_Array,0,sizeof(temp->data.Path_Array)); // Clear Path Array
-        for(int i=0;i<=temp->data.Path_Index;i++) {
-          memcpy(temp->data.Path_Array[i], msg.Path_Array[i], MAC_SIZE);  // Updated with Dst MAC to Path Array
-        }
-        ReverseArray(temp->data.Path_Index, temp->data.Path_Array); // Reverse the Path Array
-        PrintArray(temp->data.Path_Array, temp->data.Path_Index);  // Print Reversed Array
-        //PrintArray(temp->data.Path_Array, temp->data.Path_Index);  // Print Reversed Array
-        Check_Existing_Peer(temp->data.Path_Array[1]);  // Check if Next Hop Exists Else Add in Encryption Mode
-        Configure_Packet("Ack from Node 3", 10, 2, false, true, temp->data.source_mac, baseMac, true); // Configure Packet
-        msg.Path_Index = temp->data.Path_Index;  // Copy Path Index to Packet
-        // Copy Path to Packet
-        for(int i=0;i<=msg.Path_Index;i++) {
-          Serial.printf("Copying data at index: %d\n", i);
-          memcpy(msg.Path_Array[i], temp->data.Path_Array[i], MAC_SIZE);
-        } 
-        
-        // Reset index to 0
-        temp->data.Path_Index = 0;  // Reset Path Index
-        //Serial.printf("Total Path Index (msg): %d", msg.Path_Index);
-        //Serial.printf("Total Path Index (temp): %d", temp->data.Path_Index);
-        // Send Data according to Path
-        FollowPathArray(temp);
+        Acknowledge_Data(temp);
         // Serialize Data and Send to Server
         SerializeData(temp);
       }
     break;
     default:  // Unknown Message
-      Serial.println("Unknown Message Received");
+      LOG_WARN("Unknown Message Received");
     break;
   }
 
   counter++;  // Increment session counter
+}
+
+// Collect a fragment and acknowledge it once stored; upload the payload when all fragments are in
+void ReassembleFragment(queue_node_t *temp) {
+  const uint8_t *payload;
+  uint16_t len;
+  LOG_DEBUG("Fragment %d/%d of Message %u Received", temp->fragment.index + 1, temp->fragment.count, temp->fragment.messageID);
+  reassembly_result result = Reassembly_Add(temp->data.source_mac, &temp->fragment, Hal_Millis(), &payload, &len);
+
+  if(result == REASSEMBLY_REJECTED) {
+    LOG_WARN("Inconsistent Fragment from " MAC_FMT ". Discarding Fragment.", MAC_ARGS(temp->data.source_mac));
+    return;
+  }
+  if(result == REASSEMBLY_NO_ROOM) {
+    LOG_WARN("Reassembly Buffers Awaiting Uplink. Fragment Left Unacknowledged.");
+    return; // Sender retries after its timeout
+  }
 
-  free(temp); // Free memory
+  if(result == REASSEMBLY_DUPLICATE) {
+    Route_Cache_Ack_Lost(temp->data.source_mac, temp->data.packetID); // Sent Again: our Ack was Lost
+  }
+  Acknowledge_Data(temp); // Stored (or already held): every fragment is acknowledged on its own
+
+  if(result == REASSEMBLY_COMPLETE) {
+    LOG_INFO("Payload Received: %u bytes in %d fragments. Session Terminated", len, temp->fragment.count);
+    if(!QueueUplink(&temp->data, payload, len)) {
+      Reassembly_Release(payload);
+    }
+  }
 }
 
-void InitializeEthernet() {
-  if (ETH.begin()) {
-    Serial.println("Ethernet initialized");
-    
-    // Set static IP address for WT32-ETH01
-    IPAddress localIP(192, 168, 1, 100); // Desired static IP of WT32
-    IPAddress gateway(192, 168, 1, 1);   // Host Ethernet IP
-    IPAddress subnet(255, 255, 255, 0);  // Subnet mask
-
-    // Configure Ethernet with static IP
-    if (!ETH.config(localIP, gateway, subnet)) {
-      Serial.println("Failed to configure Ethernet with static IP");
-    } else {
-      Serial.println("Ethernet configured with static IP");
+// Send Data_Ack for temp back along the cheapest known path to its source
+void Acknowledge_Data(queue_node_t *temp) {
+  const route_path_t *route = Route_Cache_Match(temp->data.source_mac, temp->data.Path_Array, temp->data.Path_Index, Hal_Millis());
+  if(route == NULL) {
+    // New path: reverse it and add it to the source's candidates
+    memcpy(msg.Path_Array, temp->data.Path_Array, sizeof(msg.Path_Array)); // Load Received Path into Packet
+    msg.Path_Length = temp->data.Path_Length;
+    AppendBaseMAC(temp->data.Path_Index); // Append Dst Base MAC Address to Path Array
+    PrintArray(msg.Path_Array, temp->data.Path_Index);  // Print Path Array
+    memset(&temp->data.Path_Array,0,sizeof(temp->data.Path_Array)); // Clear Path Array
+    for(int i=0;i<=temp->data.Path_Index;i++) {
+      memcpy(temp->data.Path_Array[i], msg.Path_Array[i], MAC_SIZE);  // Updated with Dst MAC to Path Array
     }
-  } else {
-    Serial.println("Ethernet initialization failed");
+    ReverseArray(temp->data.Path_Index, temp->data.Path_Array); // Reverse the Path Array
+    PrintArray(temp->data.Path_Array, temp->data.Path_Index);  // Print Reversed Array
+    route = Route_Cache_Store(temp->data.source_mac, temp->data.Path_Array, temp->data.Path_Index, Hal_Millis()); // Learn the Route
+  }
+  if(route != NULL) {
+    // Lowest ETX candidate, which need not be the path this packet took
+    memcpy(temp->data.Path_Array, route->reverse, sizeof(temp->data.Path_Array));
+    temp->data.Path_Index = route->hops;
   }
+
+  Configure_Packet("Ack from Node 3", 10, 2, false, true, temp->data.source_mac, baseMac, true); // Configure Packet
+  msg.ackID = temp->data.packetID; // Packet Being Acknowledged
+  msg.priority = temp->data.priority; // Ack Travels in the Same Class
+  msg.Path_Index = temp->data.Path_Index;  // Copy Path Index to Packet
+  memcpy(msg.Path_Array, temp->data.Path_Array, sizeof(msg.Path_Array));  // Copy Path to Packet
+  Route_Cache_Ack_Sent(temp->data.source_mac, route, temp->data.packetID, Hal_Millis());
+  
+  // Reset index to 0
+  temp->data.Path_Index = 0;  // Reset Path Index
+  // Send Data according to Path
+  FollowPathArray(temp);
+  Metrics_Observe(HIST_RX_TO_ACK, Metrics_Clock() - temp->rxStamp);
+}
+
+void InitializeEthernet() {
+  // Set static IP address for WT32-ETH01
+  const uint8_t localIP[4] = {192, 168, 1, 100}; // Desired static IP of WT32
+  const uint8_t gateway[4] = {192, 168, 1, 1};   // Host Ethernet IP
+  const uint8_t subnet[4] = {255, 255, 255, 0};  // Subnet mask
+
+  Hal_Network_Init(localIP, gateway, subnet);
 }
 
 void TestEthernetConnection() {
-    String jsonString = "{\"sensor_data\": {\"temperature\": 25.5, \"humidity\": 60.2}, \"timestamp\": 1624471200}";
+    const char jsonString[] = "{\"sensor_data\": {\"temperature\": 25.5, \"humidity\": 60.2}, \"timestamp\": 1624471200}";
 
-    HTTPClient http;
-    http.begin("http://192.168.1.1:5000/receive_data"); // Change to your endpoint
-    http.addHeader("Content-Type", "application/json");
-    int httpResponseCode = http.POST(jsonString); // Perform a GET request
+    int httpResponseCode = Hal_Http_Post(serverURL, "application/json", NULL, (const uint8_t *) jsonString, strlen(jsonString));
 
     if (httpResponseCode > 0) {
-      String response = http.getString();
-      Serial.print("GET Response code: ");
-      Serial.println(httpResponseCode);
-      Serial.println(response);
+      LOG_INFO("POST Response code: %d", httpResponseCode);
     } else {
-      Serial.print("Error on sending GET: ");
-      Serial.println(httpResponseCode);
+      LOG_ERROR("Error on sending POST: %d", httpResponseCode);
     }
-    http.end();
 
 }
 
+// Mirror module statistics into the metrics registry
+void CollectMetrics() {
+  const uplink_stats_t *uplink = Uplink_Get_Stats();
+  const spool_stats_t *spool = Spool_Get_Stats();
+  const route_cache_stats_t *routes = Route_Cache_Get_Stats();
+
+  Metrics_Set(METRIC_RX_DROPPED, Dropped_Total(rxQueue));
+  Metrics_Set(METRIC_DUPLICATES, receivedpackets.duplicates);
+  Metrics_Set(METRIC_UPLINK_RECORDS, uplink->records);
+  Metrics_Set(METRIC_UPLINK_BATCHES, uplink->batches);
+  Metrics_Set(METRIC_UPLINK_FAILURES, uplink->failures);
+  Metrics_Set(METRIC_UPLINK_OVERSIZE, uplink->oversize);
+  Metrics_Set(METRIC_SPOOL_SPOOLED, spool->spooled);
+  Metrics_Set(METRIC_SPOOL_REPLAYED, spool->replayed);
+  Metrics_Set(METRIC_SPOOL_OVERWRITTEN, spool->overwritten);
+  Metrics_Set(METRIC_ROUTE_HITS, routes->hits);
+  Metrics_Set(METRIC_ROUTE_MISSES, routes->misses);
+  Metrics_Set(METRIC_ROUTE_SWITCHES, routes->switches);
+  Metrics_Set(METRIC_ROUTE_ACKS_LOST, routes->acksLost);
+  Metrics_Set(METRIC_FLOOD_REBROADCASTS, flooding.stats.rebroadcasts);
+  Metrics_Set(METRIC_FLOOD_SUPPRESSED, flooding.stats.suppressed);
+  Metrics_Set(METRIC_LOG_DROPPED, Log_Get_Stats()->dropped);
+  Metrics_Set(METRIC_RELIABLE_RETRANSMITS, outbound.stats.retransmits);
+  Metrics_Set(METRIC_RELIABLE_FAILED, outbound.stats.failed);
+  Metrics_Set(METRIC_REASSEMBLY_COMPLETED, Reassembly_Get_Stats()->completed);
+  Metrics_Set(METRIC_REASSEMBLY_TIMEOUTS, Reassembly_Get_Stats()->timedOut);
+  Metrics_Set(METRIC_PEER_EVICTIONS, Peer_Cache_Get_Stats()->evictions);
+  Metrics_Set(METRIC_UPLINK_QUEUE_DROPPED, Dropped_Total(uplinkQueue));
+  Metrics_Set(METRIC_AGGREGATE_READINGS, Aggregate_Get_Stats()->readings);
+  Metrics_Set(METRIC_AGGREGATE_SUMMARIES, Aggregate_Get_Stats()->summaries);
+  Metrics_Set(METRIC_COMPRESS_IN_BYTES, (uint32_t)Compress_Get_Stats()->bytesIn);
+  Metrics_Set(METRIC_COMPRESS_OUT_BYTES, (uint32_t)Compress_Get_Stats()->bytesOut);
+  Metrics_Set(METRIC_CAPTURE_FRAMES, Capture_Get_Stats().captured);
+  Metrics_Set(METRIC_CAPTURE_DROPPED, Capture_Get_Stats().dropped);
+  const command_stats_t *commands = Command_Get_Stats();
+  Metrics_Set(METRIC_COMMANDS_DELIVERED, commands->delivered);
+  Metrics_Set(METRIC_COMMANDS_FAILED, commands->failed);
+  Metrics_Set(METRIC_COMMANDS_REJECTED, commands->malformed + commands->noRoute + commands->busy);
+  Metrics_Set(METRIC_UPLINK_ALARMS, uplink->alarms);
+  Metrics_Set(METRIC_ALARMS_DROPPED, rxQueue[PRIORITY_ALARM].Dropped() + uplinkQueue[PRIORITY_ALARM].Dropped());
+  Metrics_Set(METRIC_TDMA_BEACONS, tdma.stats.beacons);
+  Metrics_Set(METRIC_DATAGRAM_RESENT, datagrams.stats.resent);
+  Metrics_Set(METRIC_DATAGRAM_FAILED, datagrams.stats.failed);
+
+  Metrics_Set(METRIC_RX_QUEUE_DEPTH, rxQueue[PRIORITY_ALARM].Size() + rxQueue[PRIORITY_NORMAL].Size() + rxQueue[PRIORITY_BULK].Size());
+  Metrics_Set(METRIC_UPLINK_PENDING, Uplink_Pending());
+  Metrics_Set(METRIC_SPOOL_DEPTH, spool->depth);
+  Metrics_Set(METRIC_PEERS_REGISTERED, Peer_Cache_Registered());
+  Metrics_Set(METRIC_TDMA_SLOTS, Tdma_Active(&tdma));
+  Metrics_Set(METRIC_UPTIME_SECONDS, Hal_Millis() / 1000);
+}
+
+// GET /metrics (Prometheus text format)
+size_t Serve_Metrics(const char *path, char *body, size_t cap, const char **contentType) {
+  if(strcmp(path, "/metrics") != 0) {
+    return 0;
+  }
+  CollectMetrics();
+  *contentType = Metrics_Content_Type();
+  return Metrics_Render(body, cap);
+}
+
+#if CAPTURE_SINK == CAPTURE_SERIAL
+// Never blocks the loop: takes what fits in the UART buffer
+static size_t Capture_Serial_Write(const uint8_t *data, size_t len) {
+  int room = Serial.availableForWrite();
+  if(room <= 0) {
+    return 0;
+  }
+  return Serial.write(data, len < (size_t)room ? len : (size_t)room);
+}
+#endif
+
 void setup() {  
   Serial.begin(115200);
+  Log_Start(); // Drainer Task Prints Deferred Log Records
 
-  WiFi.disconnect();
-  WiFi.mode(WIFI_STA);  
+  readMAC(); //Read MC MAC Addr
 
-  if(esp_wifi_init(NULL) != ESP_OK) {
-    Serial.println("Failed to initialize WiFi");
+  Dedup_Init(&receivedpackets); // Clear Duplicate Cache
+  Route_Cache_Init(); // Forget Learned Routes
+  Link_Init(); // Forget Neighbour Link Quality
+  Peer_Cache_Init(LMK_KEY); // Every Peer is Registered with the LMK
+  Reassembly_Init(); // Empty Fragment Buffers
+  Qos_Init(&rxScheduler); // Class Shares for the Route Stage
+  Qos_Init(&uplinkScheduler); // and for the Uplink Stage
+  Reliable_Init(&outbound, Transmit_Frame, NULL, Hal_Random()); // Random First Packet ID
+  outbound.failed = Outbound_Failed; // Failed Commands are Reported to the Server
+
+  // Initialize Wi-Fi + ESP-NOW, Set PMK Key, Register send_cb / receive_cb functions
+  if(!Hal_Radio_Init(PMK_KEY, On_Data_Receive, On_Data_Sent)) {
+    LOG_ERROR("Failed to initialize ESP-NOW");
   }
 
-  esp_wifi_set_mode(WIFI_MODE_STA);
-  esp_wifi_start(); 
+  Check_Existing_Peer(node3); // Register Node 3 in Encryption Mode
+  Hal_Radio_Add_Peer(broadcastMac, NULL); // Floods go out Unencrypted
+  Flood_Init(&flooding, Broadcast_Frame, NULL, baseMac, &receivedpackets); // Repeats Share the Duplicate Cache
+  Tdma_Init(&tdma, Broadcast_Frame, NULL); // First Beacon on the First Route Stage Pass
 
-  readMAC(); //Read MC MAC Addr
+  InitializeEthernet(); // Assign Ethernet IP to WT32-ETH01
+
+  // Prometheus Scrape Endpoint on ETH
+  if(METRICS_PORT != 0) {
+    if(Hal_Http_Serve(METRICS_PORT, Serve_Metrics)) {
+      LOG_INFO("Metrics at http://<gateway>:%d/metrics", METRICS_PORT);
+    } else {
+      LOG_ERROR("Failed to Start Metrics Endpoint.");
+    }
+  }
 
-  esp_now_init(); // Initialize ESP-NOW
+  // Raw Frame Capture for Replay (off unless CAPTURE_SINK is set)
+#if CAPTURE_SINK == CAPTURE_TCP
+  if(Hal_Stream_Serve(CAPTURE_PORT)) {
+    Capture_Init(Hal_Stream_Write, baseMac);
+    LOG_INFO("Capture at tcp://<gateway>:%d", CAPTURE_PORT);
+  } else {
+    LOG_ERROR("Failed to Start Capture Stream.");
+  }
+#elif CAPTURE_SINK == CAPTURE_SERIAL
+  Capture_Init(Capture_Serial_Write, baseMac);
+  Capture_Start_Stream();
+#endif
+
+  // Downlink Commands from the Server on ETH
+  if(COMMAND_PORT != 0) {
+    if(Hal_Command_Serve(COMMAND_PORT)) {
+      Command_Init(Hal_Command_Read, Hal_Command_Write);
+      LOG_INFO("Commands at tcp://<gateway>:%d", COMMAND_PORT);
+    } else {
+      LOG_ERROR("Failed to Start Command Channel.");
+    }
+  }
 
-  esp_now_set_pmk((uint8_t *) PMK_KEY); // Set PMK Key
+  // Datagram Transport (UPLINK_UDP): random session so the receiver can tell a reboot from a repeat
+  if(uplinkTransport == UPLINK_UDP) {
+    if(Hal_Udp_Open(UPLINK_UDP_HOST, UPLINK_UDP_PORT)) {
+      LOG_INFO("Uplink by Datagram to %s:%d", UPLINK_UDP_HOST, UPLINK_UDP_PORT);
+    } else {
+      LOG_ERROR("Failed to Open Uplink Datagram Socket.");
+    }
+    Datagram_Init(&datagrams, Hal_Udp_Send, Hal_Udp_Recv, Hal_Random());
+    datagrams.failed = Datagram_Given_Up;
+  }
 
-  Check_Existing_Peer(node3); // Check if Node 3 Exists
+  // Batch Records to Server, spooling to flash while it is unreachable
+  if(Spool_Storage_Open(&spoolStorage, spoolPath, SPOOL_STORAGE_SIZE) && Spool_Init(&spoolStorage, SendDataToServer)) {
+    LOG_INFO("Spool Ready: %u batches pending", Spool_Get_Stats()->depth);
+    Uplink_Init(Spool_Send, UPLINK_FORMAT);
+  } else {
+    LOG_ERROR("Failed to Open Spool. Undelivered batches will be lost.");
+    Uplink_Init(SendDataToServer, UPLINK_FORMAT);
+  }
 
-  esp_now_register_send_cb(On_Data_Sent); // Register send_cb function
-  esp_now_register_recv_cb(On_Data_Receive); // Register receive_cb function
+  // Per-Source Summaries (off unless AGGREGATE_WINDOW_MS / AGGREGATE_WINDOW_COUNT is set)
+  Aggregate_Init(Uplink_Add_Summary);
+  if(Aggregate_Set_Passthrough_List(AGGREGATE_PASSTHROUGH) < 0) {
+    LOG_ERROR("AGGREGATE_PASSTHROUGH is not a list of at most %d MACs", AGGREGATE_SOURCES);
+  }
 
-  InitializeEthernet(); // Assign Ethernet IP to WT32-ETH01
+  // Route/Ack and Uplink Tasks (host builds run both stages from loop)
+  if(Pipeline_Start(&routeStage) && Pipeline_Start(&uplinkStage)) {
+    LOG_INFO("Pipeline Tasks Started.");
+  }
 
-  delay(1000);
+  Hal_Delay(1000);
   srand(time(NULL));
 }
 
+// Route/Ack Stage: link quality, dedup, acks, reassembly, downlink commands and gateway retransmits
+void RouteStage() {
+  link_report_t report;
+  while(linkReports.Pop(report)) {
+    Link_On_Sent(report.mac, report.success, Hal_Millis());
+  }
+
+  // Alarms first, then normal and bulk by weight
+  queue_node_t node;
+  int cls;
+  while((cls = Qos_Pick(&rxScheduler, Ready_Classes(rxQueue))) >= 0 && rxQueue[cls].Pop(node)) {
+    LOG_DEBUG("Queued Packets: %u (class %d)", rxQueue[cls].Size(), cls);
+    Metrics_Observe(HIST_RX_TO_PROCESS, Metrics_Clock() - node.rxStamp);
+    Link_On_Receive(node.mac, node.rssi, Hal_Millis());
+    ProcessReceivedData(&node);
+  }
+
+  command_t command;
+  while(Command_Next(&command)) {
+    SendCommand(&command);
+  }
+
+  Reliable_Poll(&outbound, Hal_Micros()); // Retransmit Unacknowledged Packets
+  Flood_Poll(&flooding, Hal_Micros()); // Repeat or Cancel Jittered Rebroadcasts
+  Tdma_Poll(&tdma, Hal_Micros()); // Time Sync Beacon at the Superframe Boundary
+  Reassembly_Expire(Hal_Millis()); // Drop Stale Partial Payloads
+}
+
+// Uplink Stage: serialize into the batch, POST, spool
+void UplinkStage() {
+  uplink_job_t job;
+  int cls;
+  uint32_t batches = Uplink_Get_Stats()->batches;
+  if(uplinkTransport == UPLINK_UDP) {
+    Datagram_Poll(&datagrams, Hal_Millis()); // Take Acks, Resend Overdue Batches
+  }
+  while(Uplink_Transport_Ready() && (cls = Qos_Pick(&uplinkScheduler, Ready_Classes(uplinkQueue))) >= 0 && uplinkQueue[cls].Pop(job)) {
+    // Record is written straight into the uplink batch buffer (no heap, no truncation)
+    // Numeric readings may be folded into a per-source summary instead, alarms never are
+    bool added = job.payload != NULL ? Uplink_Add_Payload(&job.data, job.payload, job.len, Hal_Millis())
+                                     : (cls != PRIORITY_ALARM && Aggregate_Add(&job.data, Hal_Millis())) ||
+                                           Uplink_Add_Message(&job.data, Hal_Millis());
+    if(job.payload != NULL) {
+      Reassembly_Release(job.payload);
+    }
+    if(!added) {
+      LOG_WARN("Record Too Large for Uplink Batch.");
+    }
+    if(cls == PRIORITY_ALARM && uplinkQueue[PRIORITY_ALARM].Empty()) {
+      Uplink_Poll(Hal_Millis()); // Send the Alarms Now, not after the Backlog behind them
+    }
+    if(Uplink_Get_Stats()->batches != batches) {
+      Pipeline_Wake(&uplinkStage); // One POST per Pass: Alarms Received Meanwhile go Ahead of the Rest
+      break;
+    }
+  }
+
+  if(!Uplink_Transport_Ready()) {
+    return; // Deadlines Wait for a Free Datagram Slot
+  }
+  Aggregate_Poll(Hal_Millis()); // Emit Windows whose Time is Up
+  Uplink_Poll(Hal_Millis()); // Flush Batch on Deadline
+  Spool_Drain(Hal_Millis()); // Replay Undelivered Batches
+}
+
 float current_time, prev_time = 0;
 
 void loop() {
-  //current_time = millis();
+  //current_time = Hal_Millis();
+
+  // Stages not running as tasks are driven from here
+  if(!Pipeline_Running(&routeStage)) {
+    RouteStage();
+  }
+  if(!Pipeline_Running(&uplinkStage)) {
+    UplinkStage();
+  }
+
+  // Report Receive Queue Overflows
+  uint32_t drops = Dropped_Total(rxQueue);
+  if(drops != rxDropsReported) {
+    LOG_WARN("Receive Queue Overflow: %u packets dropped", drops);
+    rxDropsReported = drops;
+  }
+
+  Hal_Http_Serve_Poll(); // Answer Metrics Scrapes
+#if CAPTURE_SINK == CAPTURE_TCP
+  if(Hal_Stream_Accept()) {
+    Capture_Start_Stream(); // Every Client Gets a File Header First
+  }
+#endif
+  Capture_Drain(); // Stream Captured Frames
+  if(Hal_Command_Accept()) {
+    Command_Start_Stream();
+  }
+  if(Command_Service(Hal_Micros()) > 0) {
+    Pipeline_Wake(&routeStage); // Send Commands Now, not on the Next Tick
+  }
+  Log_Service(); // Drain Log Records When No Drainer Task Runs
 
-  while(incoming_data_count > 0) {
-    Serial.println(incoming_data_count);
-    ProcessReceivedData();
-    incoming_data_count--;
+  if(Pipeline_Running(&routeStage) && Pipeline_Running(&uplinkStage)) {
+    Hal_Delay(10); // Only Scrapes and Reports Left Here
   }
 
   /*if(current_time - prev_time > 5000) {
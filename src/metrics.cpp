@@ -0,0 +1,184 @@
+#include <atomic>
+#include <stdarg.h>
+#include <stdio.h>
+#include "hal.h"
+#include "metrics.h"
+
+typedef struct {
+  std::atomic<uint32_t> buckets[METRICS_BUCKETS + 1]; // Per Bucket (last is +Inf)
+  std::atomic<uint32_t> sumLow; // Sum of Samples (us), Low Word
+  std::atomic<uint32_t> sumHigh; // Carries out of sumLow
+} metrics_hist_t;
+
+typedef struct {
+  const char *name;
+  const char *help;
+} metrics_desc_t;
+
+/* Metrics Variables */
+static metrics_hist_t histograms[METRICS_HISTOGRAMS];
+static std::atomic<uint32_t> values[METRICS_COUNT];
+
+static const metrics_desc_t histDesc[METRICS_HISTOGRAMS] = {
+  {"gateway_rx_to_process_seconds", "Time a received frame waits before processing."},
+  {"gateway_process_to_uplink_seconds", "Time a record waits in the uplink batch."},
+  {"gateway_http_rtt_seconds", "Uplink POST round trip."},
+  {"gateway_peer_register_seconds", "Time to swap an encrypted peer into the radio."},
+  {"gateway_rx_to_ack_seconds", "Time from frame received to its Data_Ack sent."},
+  {"gateway_compress_seconds", "Time to gzip one uplink batch."},
+  {"gateway_command_seconds", "Time from a downlink command received to its node's ack."},
+  {"gateway_alarm_to_uplink_seconds", "Time an alarm record waits in the uplink batch."},
+  {"gateway_datagram_rtt_seconds", "Uplink datagram sent to its cumulative ack."},
+};
+
+static const metrics_desc_t valueDesc[METRICS_COUNT] = {
+  {"gateway_rx_frames_total", "ESP-NOW frames received."},
+  {"gateway_rx_malformed_total", "Frames that failed to decode."},
+  {"gateway_rx_dropped_total", "Frames lost to a full receive queue."},
+  {"gateway_duplicates_total", "Packets suppressed as duplicates."},
+  {"gateway_tx_failures_total", "ESP-NOW sends without a MAC-level ack."},
+  {"gateway_uplink_records_total", "Records accepted for uplink."},
+  {"gateway_uplink_batches_total", "Batches handed to the transport."},
+  {"gateway_uplink_failures_total", "Batches the transport rejected."},
+  {"gateway_uplink_oversize_total", "Records too large for a batch."},
+  {"gateway_http_errors_total", "POSTs without a 2xx response."},
+  {"gateway_spool_spooled_total", "Batches written to the flash spool."},
+  {"gateway_spool_replayed_total", "Spooled batches delivered."},
+  {"gateway_spool_overwritten_total", "Spooled batches lost to a full spool."},
+  {"gateway_route_hits_total", "Acks that reused a cached reverse route."},
+  {"gateway_route_misses_total", "Acks that rebuilt the reverse route."},
+  {"gateway_route_switches_total", "Acks sent on a cheaper path than the one the packet took."},
+  {"gateway_route_acks_lost_total", "Acks found lost because the source sent the packet again."},
+  {"gateway_flood_rebroadcasts_total", "Broadcast packets repeated for neighbours."},
+  {"gateway_flood_suppressed_total", "Rebroadcasts cancelled after k copies were heard."},
+  {"gateway_log_dropped_total", "Log records lost to a full ring."},
+  {"gateway_reliable_retransmits_total", "Gateway packets sent again after a timeout."},
+  {"gateway_reliable_failed_total", "Gateway packets never acked within MAX_TRIES."},
+  {"gateway_reassembly_completed_total", "Fragmented payloads reassembled."},
+  {"gateway_reassembly_timeouts_total", "Partial payloads dropped for age."},
+  {"gateway_peer_evictions_total", "Encrypted peers unregistered to make room."},
+  {"gateway_uplink_queue_dropped_total", "Records lost to a full uplink queue."},
+  {"gateway_aggregate_readings_total", "Numeric readings folded into a summary."},
+  {"gateway_aggregate_summaries_total", "Summary records emitted."},
+  {"gateway_compress_in_bytes_total", "Batch bytes before gzip (batches that shrank)."},
+  {"gateway_compress_out_bytes_total", "Batch bytes after gzip."},
+  {"gateway_capture_frames_total", "Received frames queued for capture."},
+  {"gateway_capture_dropped_total", "Received frames lost to a full capture ring."},
+  {"gateway_commands_delivered_total", "Downlink commands acked by their node."},
+  {"gateway_commands_failed_total", "Downlink commands never acked within MAX_TRIES."},
+  {"gateway_commands_rejected_total", "Downlink commands refused: malformed, no route or busy."},
+  {"gateway_uplink_alarms_total", "Alarm-class records accepted for uplink."},
+  {"gateway_alarms_dropped_total", "Alarm-class frames or records lost to a full queue."},
+  {"gateway_tdma_beacons_total", "Time sync beacons broadcast."},
+  {"gateway_datagram_resent_total", "Uplink datagrams sent again after a timeout."},
+  {"gateway_datagram_failed_total", "Uplink datagrams given up on and spooled."},
+  {"gateway_rx_queue_depth", "Frames waiting in the receive queue."},
+  {"gateway_uplink_pending", "Records in the open uplink batch."},
+  {"gateway_spool_depth", "Batches waiting in the flash spool."},
+  {"gateway_peers_registered", "Encrypted peers registered with the radio."},
+  {"gateway_tdma_slots", "Sources holding a TDMA transmit slot."},
+  {"gateway_uptime_seconds", "Time since boot."},
+};
+
+#define METRICS_FIRST_GAUGE METRIC_RX_QUEUE_DEPTH
+
+uint32_t Metrics_Clock() {
+  return Hal_Micros();
+}
+
+static inline int Metrics_Bucket(uint32_t us) {
+  if(us <= METRICS_BUCKET_MIN_US) {
+    return 0;
+  }
+  int bits = 32 - __builtin_clz(us - 1); // Smallest power of two >= us
+  int index = bits - 4; // log2(METRICS_BUCKET_MIN_US)
+  return index < METRICS_BUCKETS ? index : METRICS_BUCKETS;
+}
+
+void Metrics_Observe(metrics_histogram hist, uint32_t us) {
+  metrics_hist_t *h = &histograms[hist];
+  h->buckets[Metrics_Bucket(us)].fetch_add(1, std::memory_order_relaxed);
+  uint32_t before = h->sumLow.fetch_add(us, std::memory_order_relaxed);
+  if((uint32_t)(before + us) < before) {
+    h->sumHigh.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Metrics_Add(metrics_id id, uint32_t n) {
+  values[id].fetch_add(n, std::memory_order_relaxed);
+}
+
+void Metrics_Set(metrics_id id, uint32_t value) {
+  values[id].store(value, std::memory_order_relaxed);
+}
+
+uint32_t Metrics_Get(metrics_id id) {
+  return values[id].load(std::memory_order_relaxed);
+}
+
+/* Rendering (scrape path, not time critical) */
+typedef struct {
+  char *out;
+  size_t cap;
+  size_t len;
+  bool full;
+} metrics_text_t;
+
+// Append one line; once a line does not fit, nothing further is written
+static void Metrics_Line(metrics_text_t *text, const char *format, ...) {
+  if(text->full) {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(text->out + text->len, text->cap - text->len, format, args);
+  va_end(args);
+  if(n < 0 || (size_t)n >= text->cap - text->len) {
+    text->out[text->len] = '\0';
+    text->full = true;
+    return;
+  }
+  text->len += (size_t)n;
+}
+
+static void Metrics_Render_Histogram(metrics_text_t *text, int index) {
+  const metrics_hist_t *h = &histograms[index];
+  const char *name = histDesc[index].name;
+
+  Metrics_Line(text, "# HELP %s %s\n# TYPE %s histogram\n", name, histDesc[index].help, name);
+  uint32_t cumulative = 0;
+  for(int i = 0; i < METRICS_BUCKETS; i++) {
+    cumulative += h->buckets[i].load(std::memory_order_relaxed);
+    uint32_t bound = (uint32_t)METRICS_BUCKET_MIN_US << i;
+    Metrics_Line(text, "%s_bucket{le=\"%lu.%06lu\"} %lu\n", name, (unsigned long)(bound / 1000000),
+                 (unsigned long)(bound % 1000000), (unsigned long)cumulative);
+  }
+  cumulative += h->buckets[METRICS_BUCKETS].load(std::memory_order_relaxed);
+  Metrics_Line(text, "%s_bucket{le=\"+Inf\"} %lu\n", name, (unsigned long)cumulative);
+
+  uint64_t sum = ((uint64_t)h->sumHigh.load(std::memory_order_relaxed) << 32) | h->sumLow.load(std::memory_order_relaxed);
+  Metrics_Line(text, "%s_sum %lu.%06lu\n%s_count %lu\n", name, (unsigned long)(sum / 1000000),
+               (unsigned long)(sum % 1000000), name, (unsigned long)cumulative);
+}
+
+size_t Metrics_Render(char *out, size_t cap) {
+  if(cap == 0) {
+    return 0;
+  }
+  metrics_text_t text = {out, cap, 0, false};
+  out[0] = '\0';
+
+  for(int i = 0; i < METRICS_HISTOGRAMS; i++) {
+    Metrics_Render_Histogram(&text, i);
+  }
+  for(int i = 0; i < METRICS_COUNT; i++) {
+    const char *name = valueDesc[i].name;
+    Metrics_Line(&text, "# HELP %s %s\n# TYPE %s %s\n%s %lu\n", name, valueDesc[i].help, name,
+                 i >= METRICS_FIRST_GAUGE ? "gauge" : "counter", name, (unsigned long)Metrics_Get((metrics_id)i));
+  }
+  return text.len;
+}
+
+const char *Metrics_Content_Type() {
+  return "text/plain; version=0.0.4";
+}
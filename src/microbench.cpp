@@ -0,0 +1,482 @@
+#ifndef ARDUINO
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "hal.h"
+#include "log.h"
+#include "message.h"
+#include "microbench.h"
+#include "radio_sim.h"
+#include "tdma.h"
+#include "wire_format.h"
+
+/* Gateway (main.cpp) */
+void setup();
+void On_Data_Receive(const uint8_t* mac, const uint8_t* data, int len);
+void ProcessReceivedData(queue_node_t *temp);
+void ReverseArray(uint8_t index, uint8_t path_arr[MAX_NODES][MAC_SIZE]);
+bool Configure_Packet(const char *text, int TTL, int identification, bool broadcast_Ack, bool Data_Ack, const uint8_t *destination_mac, const uint8_t *source_mac, bool path_exist);
+void SerializeData(queue_node_t *temp);
+void RouteStage();
+void UplinkStage();
+extern uint8_t baseMac[6];
+extern tdma_schedule_t tdma;
+
+#define MICROBENCH_MIX 1024 // Packets in the Mix (cycled)
+#define MICROBENCH_BATCH 8 // Calls between Drains (half a receive queue)
+#define MICROBENCH_PURE_BATCH 256 // Calls per Timing for Stages that Queue Nothing
+#define MICROBENCH_SOURCES 32
+#define MICROBENCH_RELAYS 4 // per Layer
+
+typedef enum {
+  MIX_DATA, // Reading from a Source
+  MIX_REPEAT, // Data Sent Again (our ack was lost)
+  MIX_ACK, // Data_Ack for a Command
+  MIX_FRAGMENT, // Half of a Two-Fragment Payload
+  MIX_BROADCAST, // Flood from a Node
+  MIX_ELSEWHERE, // Addressed to Another Node
+  MIX_KINDS,
+} mix_kind;
+
+static const char *mixNames[MIX_KINDS] = {"data", "repeat", "ack", "fragment", "broadcast", "elsewhere"};
+static const uint8_t mixShare[MIX_KINDS] = {60, 10, 10, 10, 5, 5}; // Percent of Draws (a repeat or fragment draw adds two packets)
+static const uint8_t hopShare[MAX_NODES - 1] = {25, 25, 20, 12, 8, 5, 3, 2}; // Percent of Sources 1..8 Hops Out
+
+typedef struct {
+  mix_kind kind;
+  uint8_t from[MAC_SIZE]; // Last Hop
+  uint8_t frame[ESPNOW_MTU]; // Fragments Fill the Frame
+  size_t len;
+  queue_node_t node; // As the Route Stage would Pop it
+} mix_packet_t;
+
+static std::vector<mix_packet_t> mix;
+static uint32_t mixState; // xorshift32, apart from the Simulator's Stream
+static uint32_t sourceHops[MICROBENCH_SOURCES];
+static int32_t nextPacketID; // Fresh IDs so Repeated Rounds are not Duplicates
+static uint16_t nextMessageID;
+
+static uint32_t Mix_Random() {
+  mixState ^= mixState << 13;
+  mixState ^= mixState >> 17;
+  mixState ^= mixState << 5;
+  return mixState;
+}
+
+// Index into shares (percent, summing to 100)
+static int Mix_Draw(const uint8_t *shares, int count) {
+  int roll = (int)(Mix_Random() % 100);
+  for(int i = 0; i < count; i++) {
+    roll -= shares[i];
+    if(roll < 0) {
+      return i;
+    }
+  }
+  return count - 1;
+}
+
+static void Source_MAC(int source, uint8_t *mac) {
+  const uint8_t base[MAC_SIZE] = {0x02, 0x00, 0x00, 0x01, 0x00, (uint8_t)source};
+  memcpy(mac, base, MAC_SIZE);
+}
+
+static void Relay_MAC(int layer, int relay, uint8_t *mac) {
+  const uint8_t base[MAC_SIZE] = {0x02, 0x00, 0x00, 0x02, (uint8_t)layer, (uint8_t)relay};
+  memcpy(mac, base, MAC_SIZE);
+}
+
+// Data as it Reaches the Gateway: source first, then a random relay of every layer on the way in
+static void Mix_Data(message_t *m, int source) {
+  static const char *formats[] = {"Temperature: %u.%02u C", "Humidity: %u.%u %%", "Reading %u from node %u"};
+  uint32_t hops = sourceHops[source];
+  memset(m, 0, sizeof(*m));
+  snprintf((char *)m->text, sizeof(m->text), formats[Mix_Random() % 3], (unsigned)(Mix_Random() % 40), (unsigned)(Mix_Random() % 100));
+  m->TTL = 10;
+  m->identification = 2;
+  m->packetID = (int32_t)Mix_Random();
+  int roll = (int)(Mix_Random() % 100);
+  m->priority = roll < 5 ? PRIORITY_ALARM : roll < 15 ? PRIORITY_BULK : PRIORITY_NORMAL;
+  memcpy(m->destination_mac, baseMac, MAC_SIZE);
+  Source_MAC(source, m->source_mac);
+  Source_MAC(source, m->Path_Array[0]);
+  for(uint32_t row = 1; row < hops; row++) {
+    Relay_MAC((int)(hops - row), (int)(Mix_Random() % MICROBENCH_RELAYS), m->Path_Array[row]);
+  }
+  m->Path_Index = (uint8_t)hops;
+  m->Path_Length = (uint8_t)hops;
+}
+
+static void Mix_Add(mix_kind kind, const message_t *m, const fragment_t *fragment, const uint8_t *from) {
+  mix_packet_t p;
+  memset(&p, 0, sizeof(p));
+  p.kind = kind;
+  memcpy(p.from, from, MAC_SIZE);
+  p.len = fragment != NULL ? Wire_Encode_Fragment(m, fragment, p.frame, sizeof(p.frame)) : Wire_Encode(m, p.frame, sizeof(p.frame));
+  p.node.fragmented = fragment != NULL;
+  bool decoded = fragment != NULL ? Wire_Decode_Fragment(p.frame, p.len, &p.node.data, &p.node.fragment)
+                                  : Wire_Decode(p.frame, p.len, &p.node.data);
+  if(p.len == 0 || !decoded) {
+    return;
+  }
+  memcpy(p.node.mac, from, MAC_SIZE);
+  mix.push_back(p);
+}
+
+static void Mix_Build(uint32_t seed) {
+  mixState = seed != 0 ? seed : 1;
+  for(int source = 0; source < MICROBENCH_SOURCES; source++) {
+    sourceHops[source] = (uint32_t)Mix_Draw(hopShare, MAX_NODES - 1) + 1;
+  }
+
+  mix.clear();
+  mix.reserve(MICROBENCH_MIX + 1);
+  message_t m;
+  while(mix.size() < MICROBENCH_MIX) {
+    int source = (int)(Mix_Random() % MICROBENCH_SOURCES);
+    uint32_t hops = sourceHops[source];
+    mix_kind kind = (mix_kind)Mix_Draw(mixShare, MIX_KINDS);
+    Mix_Data(&m, source);
+    switch(kind) {
+      case MIX_DATA:
+      case MIX_REPEAT: // Right after the Copy it Repeats
+        Mix_Add(MIX_DATA, &m, NULL, m.Path_Array[hops - 1]);
+        if(kind == MIX_REPEAT) {
+          Mix_Add(MIX_REPEAT, &m, NULL, m.Path_Array[hops - 1]);
+        }
+        break;
+      case MIX_ACK: {
+        // Command Path Reversed by the Node; each relay moved Path_Index on
+        uint8_t from[MAC_SIZE];
+        memcpy(from, m.Path_Array[hops - 1], MAC_SIZE);
+        memcpy(m.Path_Array[hops], baseMac, MAC_SIZE);
+        strcpy((char *)m.text, "Ack from Node");
+        m.Data_Ack = true;
+        m.Path_Exist = true;
+        m.ackID = (int32_t)Mix_Random();
+        Mix_Add(MIX_ACK, &m, NULL, from);
+        break;
+      }
+      case MIX_FRAGMENT: {
+        fragment_t fragment;
+        memset(&fragment, 0, sizeof(fragment));
+        uint16_t chunk = (uint16_t)Wire_Fragment_Chunk((uint8_t)hops);
+        m.text[0] = '\0';
+        fragment.messageID = (uint16_t)Mix_Random();
+        fragment.count = 2;
+        fragment.total = (uint16_t)(chunk + chunk / 2);
+        for(uint8_t i = 0; i < fragment.count; i++) {
+          fragment.index = i;
+          fragment.offset = (uint16_t)(i * chunk);
+          fragment.len = (uint8_t)(i == 0 ? chunk : fragment.total - chunk);
+          for(int b = 0; b < fragment.len; b++) {
+            fragment.data[b] = (uint8_t)Mix_Random();
+          }
+          m.packetID = (int32_t)Mix_Random();
+          Mix_Add(MIX_FRAGMENT, &m, &fragment, m.Path_Array[hops - 1]);
+        }
+        break;
+      }
+      case MIX_BROADCAST: {
+        // Flood Heard from the Source or from a Relay Repeating it
+        uint8_t from[MAC_SIZE];
+        memcpy(from, hops == 1 ? m.Path_Array[0] : m.Path_Array[hops - 1], MAC_SIZE);
+        memset(m.destination_mac, 0xFF, MAC_SIZE);
+        memset(m.Path_Array[1], 0, sizeof(m.Path_Array) - MAC_SIZE);
+        m.identification = 1;
+        m.TTL = 3;
+        m.Path_Index = 1;
+        m.Path_Length = 1;
+        Mix_Add(MIX_BROADCAST, &m, NULL, from);
+        break;
+      }
+      default: // Source-Routed to a Node Beyond us
+        m.destination_mac[5] ^= 0x5A;
+        Mix_Add(MIX_ELSEWHERE, &m, NULL, m.Path_Array[hops - 1]);
+        break;
+    }
+  }
+}
+
+// Next mix packet that would have reached the route stage, with fresh IDs
+static const mix_packet_t *Mix_Next_Node(uint32_t *cursor, queue_node_t *node) {
+  const mix_packet_t *p;
+  do {
+    p = &mix[(*cursor)++ % mix.size()];
+  } while(p->kind == MIX_ELSEWHERE);
+  *node = p->node;
+  if(p->kind == MIX_REPEAT) {
+    node->data.packetID = nextPacketID; // Same as the Data just Before
+  } else {
+    node->data.packetID = ++nextPacketID;
+  }
+  if(p->kind == MIX_FRAGMENT) {
+    node->fragment.messageID = node->fragment.index == 0 ? ++nextMessageID : nextMessageID;
+  }
+  return p;
+}
+
+static uint64_t Now_Ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+// Untimed: process what was queued, serialize and POST it, run the radio and timers on, empty the log ring
+static void Drain() {
+  RouteStage();
+  for(int i = 0; i < 4; i++) {
+    UplinkStage();
+  }
+  Sim_Run_Until(Sim_Now_Us() + 2000);
+  Log_Service();
+}
+
+/* Stages: each runs ops calls and returns the ns spent inside them */
+
+static uint64_t Bench_On_Data_Receive(uint32_t ops) {
+  static uint32_t cursor = 0;
+  uint64_t spent = 0;
+  for(uint32_t done = 0; done < ops; done += MICROBENCH_BATCH) {
+    uint64_t start = Now_Ns();
+    for(int i = 0; i < MICROBENCH_BATCH; i++) {
+      const mix_packet_t *p = &mix[cursor++ % mix.size()];
+      On_Data_Receive(p->from, p->frame, (int)p->len);
+    }
+    spent += Now_Ns() - start;
+    Drain();
+  }
+  return spent;
+}
+
+static uint64_t Bench_Process_Received_Data(uint32_t ops) {
+  static uint32_t cursor = 0;
+  queue_node_t batch[MICROBENCH_BATCH];
+  uint64_t spent = 0;
+  for(uint32_t done = 0; done < ops; done += MICROBENCH_BATCH) {
+    for(int i = 0; i < MICROBENCH_BATCH; i++) {
+      Mix_Next_Node(&cursor, &batch[i]);
+    }
+    uint64_t start = Now_Ns();
+    for(int i = 0; i < MICROBENCH_BATCH; i++) {
+      ProcessReceivedData(&batch[i]);
+    }
+    spent += Now_Ns() - start;
+    Drain();
+  }
+  return spent;
+}
+
+// Reversal as Acknowledge_Data does it: received path plus the gateway's row
+static uint64_t Bench_Reverse_Array(uint32_t ops) {
+  static uint32_t cursor = 0;
+  static uint8_t paths[MICROBENCH_PURE_BATCH][MAX_NODES][MAC_SIZE];
+  uint8_t index[MICROBENCH_PURE_BATCH];
+  uint64_t spent = 0;
+  for(uint32_t done = 0; done < ops; done += MICROBENCH_PURE_BATCH) {
+    for(int i = 0; i < MICROBENCH_PURE_BATCH; i++) {
+      queue_node_t node;
+      Mix_Next_Node(&cursor, &node);
+      index[i] = node.data.Path_Index < MAX_NODES ? node.data.Path_Index : MAX_NODES - 1;
+      memcpy(paths[i], node.data.Path_Array, sizeof(paths[i]));
+      memcpy(paths[i][index[i]], baseMac, MAC_SIZE);
+    }
+    uint64_t start = Now_Ns();
+    for(int i = 0; i < MICROBENCH_PURE_BATCH; i++) {
+      ReverseArray(index[i], paths[i]);
+    }
+    spent += Now_Ns() - start;
+    Log_Service();
+  }
+  return spent;
+}
+
+// Mostly Data_Acks, one call in ten a command
+static uint64_t Bench_Configure_Packet(uint32_t ops) {
+  static uint32_t cursor = 0;
+  static const char *commands[] = {"SET interval=60", "REBOOT", "SET threshold=35.5 hysteresis=2"};
+  uint8_t destination[MICROBENCH_PURE_BATCH][MAC_SIZE];
+  uint64_t spent = 0;
+  for(uint32_t done = 0; done < ops; done += MICROBENCH_PURE_BATCH) {
+    for(int i = 0; i < MICROBENCH_PURE_BATCH; i++) {
+      queue_node_t node;
+      Mix_Next_Node(&cursor, &node);
+      memcpy(destination[i], node.data.source_mac, MAC_SIZE);
+    }
+    uint64_t start = Now_Ns();
+    for(int i = 0; i < MICROBENCH_PURE_BATCH; i++) {
+      if(i % 10 == 9) {
+        Configure_Packet(commands[i % 3], 10, 2, false, false, destination[i], baseMac, true);
+      } else {
+        Configure_Packet("Ack from Node 3", 10, 2, false, true, destination[i], baseMac, true);
+      }
+    }
+    spent += Now_Ns() - start;
+    Log_Service();
+  }
+  return spent;
+}
+
+// Handing readings to the uplink stage plus the pass that writes them into the batch (and POSTs it when full)
+static uint64_t Bench_Serialize_Data(uint32_t ops) {
+  static uint32_t cursor = 0;
+  queue_node_t batch[MICROBENCH_BATCH];
+  uint64_t spent = 0;
+  for(uint32_t done = 0; done < ops; done += MICROBENCH_BATCH) {
+    for(int i = 0; i < MICROBENCH_BATCH; i++) {
+      const mix_packet_t *p;
+      do {
+        p = Mix_Next_Node(&cursor, &batch[i]);
+      } while(p->kind != MIX_DATA);
+      batch[i].data.Path_Index = 0; // As Acknowledge_Data Leaves it
+    }
+    uint64_t start = Now_Ns();
+    for(int i = 0; i < MICROBENCH_BATCH; i++) {
+      SerializeData(&batch[i]);
+    }
+    UplinkStage();
+    spent += Now_Ns() - start;
+    Drain();
+  }
+  return spent;
+}
+
+typedef struct {
+  const char *name;
+  uint64_t (*run)(uint32_t ops);
+  double median; // ns per Call
+  double best;
+  double baseline; // 0 -> none
+  bool regressed;
+} stage_t;
+
+static stage_t stages[] = {
+  {"on_data_receive", Bench_On_Data_Receive, 0, 0, 0, false},
+  {"process_received_data", Bench_Process_Received_Data, 0, 0, 0, false},
+  {"reverse_array", Bench_Reverse_Array, 0, 0, 0, false},
+  {"configure_packet", Bench_Configure_Packet, 0, 0, 0, false},
+  {"serialize_data", Bench_Serialize_Data, 0, 0, 0, false},
+};
+static const int stageCount = sizeof(stages) / sizeof(stages[0]);
+
+// microbench.<stage>.ns_per_op lines; anything else is ignored
+static bool Baseline_Load(const char *path) {
+  FILE *f = fopen(path, "r");
+  if(f == NULL) {
+    return false;
+  }
+  char line[256], name[64];
+  double value;
+  while(fgets(line, sizeof(line), f) != NULL) {
+    if(sscanf(line, "microbench.%63[^.].ns_per_op=%lf", name, &value) != 2) {
+      continue;
+    }
+    for(int s = 0; s < stageCount; s++) {
+      if(strcmp(stages[s].name, name) == 0) {
+        stages[s].baseline = value;
+      }
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// One report line to stdout and, if open, the results file
+static void Report_Line(FILE *results, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  if(results != NULL) {
+    va_start(args, format);
+    vfprintf(results, format, args);
+    va_end(args);
+  }
+}
+
+int Microbench_Run(const microbench_options_t *options) {
+  if(options->baseline != NULL && !Baseline_Load(options->baseline)) {
+    fprintf(stderr, "cannot read baseline %s\n", options->baseline);
+    return 2;
+  }
+
+  static const uint8_t gatewayMac[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+  Sim_Reset(options->seed);
+  Serial.enabled = false;
+  Hal_Native_Http_Sink(true);
+  Hal_Native_Set_MAC(gatewayMac);
+  setup();
+  tdma.beaconMs = 0; // No Mesh to Sync
+  Mix_Build(options->seed);
+
+  uint32_t counts[MIX_KINDS] = {0};
+  uint32_t hops = 0, routed = 0;
+  for(const mix_packet_t &p : mix) {
+    counts[p.kind]++;
+    if(p.kind != MIX_BROADCAST) {
+      hops += p.node.data.Path_Index;
+      routed++;
+    }
+  }
+
+  int regressed = 0;
+  for(int s = 0; s < stageCount; s++) {
+    stage_t *stage = &stages[s];
+    std::vector<double> rounds;
+    stage->run(MICROBENCH_OPS); // Warm Caches, Peers and Routes
+    for(int r = 0; r < MICROBENCH_ROUNDS; r++) {
+      rounds.push_back((double)stage->run(MICROBENCH_OPS) / MICROBENCH_OPS);
+    }
+    std::sort(rounds.begin(), rounds.end());
+    stage->median = rounds[rounds.size() / 2];
+    stage->best = rounds[0];
+    stage->regressed = stage->baseline > 0 && stage->median > stage->baseline * (1.0 + options->tolerance / 100.0) + MICROBENCH_SLACK_NS;
+    regressed += stage->regressed;
+  }
+
+  FILE *results = NULL;
+  if(options->results != NULL && (results = fopen(options->results, "w")) == NULL) {
+    fprintf(stderr, "cannot write results %s\n", options->results);
+    return 2;
+  }
+  if(results != NULL) {
+    fprintf(results, "# sim --microbench: gateway stages, ns per call (median of rounds). Read back with --baseline\n");
+  }
+  Report_Line(results, "microbench.ops=%u\nmicrobench.rounds=%u\nmicrobench.seed=%u\nmicrobench.mix.packets=%u\n",
+              (unsigned)MICROBENCH_OPS, (unsigned)MICROBENCH_ROUNDS, (unsigned)options->seed, (unsigned)mix.size());
+  for(int k = 0; k < MIX_KINDS; k++) {
+    Report_Line(results, "microbench.mix.%s=%u\n", mixNames[k], (unsigned)counts[k]);
+  }
+  Report_Line(results, "microbench.mix.mean_hops=%.2f\n", routed ? (double)hops / routed : 0.0);
+  for(int s = 0; s < stageCount; s++) {
+    const stage_t *stage = &stages[s];
+    Report_Line(results, "microbench.%s.ns_per_op=%.1f\nmicrobench.%s.ns_per_op_min=%.1f\n", stage->name, stage->median,
+                stage->name, stage->best);
+    if(options->baseline != NULL) {
+      Report_Line(results, "microbench.%s.baseline_ns=%.1f\nmicrobench.%s.regressed=%d\n", stage->name, stage->baseline,
+                  stage->name, stage->regressed ? 1 : 0);
+    }
+  }
+  if(options->baseline != NULL) {
+    Report_Line(results, "microbench.tolerance_pct=%u\nmicrobench.slack_ns=%u\nmicrobench.regressed=%d\n",
+                (unsigned)options->tolerance, (unsigned)MICROBENCH_SLACK_NS, regressed);
+  }
+  if(results != NULL) {
+    fclose(results);
+  }
+
+  for(int s = 0; s < stageCount; s++) {
+    if(stages[s].regressed) {
+      fprintf(stderr, "%s regressed: %.1f ns per call, baseline %.1f (+%u%% +%u ns allowed)\n", stages[s].name,
+              stages[s].median, stages[s].baseline, (unsigned)options->tolerance, (unsigned)MICROBENCH_SLACK_NS);
+    }
+  }
+  return regressed > 0 ? 1 : 0;
+}
+
+#endif
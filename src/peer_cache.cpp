@@ -0,0 +1,122 @@
+#include <string.h>
+#include "metrics.h"
+#include "peer_cache.h"
+
+/* Peer Cache Variables */
+static peer_entry_t peers[PEER_CACHE_SIZE];
+static peer_cache_stats_t stats;
+static int registered = 0;
+static const char *peerLmk = NULL;
+
+void Peer_Cache_Init(const char *lmk) {
+  memset(peers, 0, sizeof(peers));
+  memset(&stats, 0, sizeof(stats));
+  registered = 0;
+  peerLmk = lmk;
+}
+
+static peer_entry_t *Peer_Find(const uint8_t *mac) {
+  for(int i = 0; i < PEER_CACHE_SIZE; i++) {
+    if(peers[i].used && memcmp(peers[i].mac, mac, MAC_SIZE) == 0) {
+      return &peers[i];
+    }
+  }
+  return NULL;
+}
+
+// Least recently used entry with the given registration state, or NULL
+static peer_entry_t *Peer_Oldest(bool isRegistered) {
+  peer_entry_t *oldest = NULL;
+  for(int i = 0; i < PEER_CACHE_SIZE; i++) {
+    peer_entry_t *entry = &peers[i];
+    if(entry->used && entry->registered == isRegistered &&
+       (oldest == NULL || (int32_t)(entry->stamp - oldest->stamp) < 0)) {
+      oldest = entry;
+    }
+  }
+  return oldest;
+}
+
+// Table entry for a new peer: free, else the least recently used unregistered one
+static peer_entry_t *Peer_Claim() {
+  for(int i = 0; i < PEER_CACHE_SIZE; i++) {
+    if(!peers[i].used) {
+      return &peers[i];
+    }
+  }
+  peer_entry_t *victim = Peer_Oldest(false);
+  if(victim != NULL) {
+    stats.forgotten++;
+  }
+  return victim; // NULL only if PEER_CACHE_SIZE <= PEER_HW_SLOTS
+}
+
+// Register entry with the radio, evicting the least recently used registration if full
+static hal_err_t Peer_Register(peer_entry_t *entry) {
+  uint32_t start = Hal_Micros();
+
+  if(Hal_Radio_Peer_Exists(entry->mac)) {
+    // Added outside the cache: keep it if encrypted, else replace it
+    bool encrypted = false;
+    if(Hal_Radio_Peer_Encrypted(entry->mac, &encrypted) == HAL_OK && encrypted) {
+      entry->registered = true;
+      registered++;
+      return HAL_OK;
+    }
+    Hal_Radio_Del_Peer(entry->mac);
+  }
+
+  if(registered >= PEER_HW_SLOTS) {
+    peer_entry_t *victim = Peer_Oldest(true);
+    if(victim != NULL && Hal_Radio_Del_Peer(victim->mac) == HAL_OK) {
+      victim->registered = false;
+      registered--;
+      stats.evictions++;
+    }
+  }
+
+  hal_err_t status = Hal_Radio_Add_Peer(entry->mac, peerLmk); // Encrypted in One Step
+  uint32_t elapsed = Hal_Micros() - start;
+  if(status != HAL_OK) {
+    stats.failures++;
+    return status;
+  }
+
+  entry->registered = true;
+  registered++;
+  stats.registrations++;
+  stats.registerUs = elapsed;
+  stats.registerUsTotal += elapsed;
+  Metrics_Observe(HIST_PEER_REGISTER, elapsed);
+  return HAL_OK;
+}
+
+hal_err_t Peer_Cache_Acquire(const uint8_t *mac, uint32_t now) {
+  peer_entry_t *entry = Peer_Find(mac);
+  if(entry == NULL) {
+    entry = Peer_Claim();
+    if(entry == NULL) {
+      stats.failures++;
+      return HAL_FAIL;
+    }
+    memset(entry, 0, sizeof(*entry));
+    memcpy(entry->mac, mac, MAC_SIZE);
+    entry->used = true;
+  }
+
+  entry->stamp = now;
+  entry->sends++;
+  if(entry->registered) {
+    stats.hits++;
+    return HAL_OK;
+  }
+  return Peer_Register(entry);
+}
+
+int Peer_Cache_Registered() {
+  return registered;
+}
+
+const peer_cache_stats_t *Peer_Cache_Get_Stats() {
+  return &stats;
+}
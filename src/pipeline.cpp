@@ -0,0 +1,47 @@
+#include <stddef.h>
+#include "pipeline.h"
+
+#if defined(ARDUINO) && PIPELINE_TASKS
+#include <Arduino.h>
+
+static void Pipeline_Task(void *arg) {
+  pipeline_stage_t *stage = (pipeline_stage_t *)arg;
+  for(;;) {
+    // Notifications collapse: one run drains everything queued since the last
+    if(ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(stage->idleMs)) > 0) {
+      stage->wakes++;
+    } else {
+      stage->timeouts++;
+    }
+    stage->run();
+  }
+}
+
+bool Pipeline_Start(pipeline_stage_t *stage) {
+  TaskHandle_t task = NULL;
+  if(xTaskCreatePinnedToCore(Pipeline_Task, stage->name, stage->stackBytes, stage, stage->priority, &task, stage->core) != pdPASS) {
+    return false;
+  }
+  stage->task = task;
+  return true;
+}
+
+void Pipeline_Wake(pipeline_stage_t *stage) {
+  if(stage->task != NULL) {
+    xTaskNotifyGive((TaskHandle_t)stage->task);
+  }
+}
+#else
+bool Pipeline_Start(pipeline_stage_t *stage) {
+  (void)stage;
+  return false;
+}
+
+void Pipeline_Wake(pipeline_stage_t *stage) {
+  (void)stage;
+}
+#endif
+
+bool Pipeline_Running(const pipeline_stage_t *stage) {
+  return stage->task != NULL;
+}
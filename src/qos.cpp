@@ -0,0 +1,35 @@
+#include <string.h>
+#include "qos.h"
+
+void Qos_Init(qos_scheduler_t *q) {
+  memset(q, 0, sizeof(*q));
+  q->weight[PRIORITY_ALARM] = 1;
+  q->weight[PRIORITY_NORMAL] = QOS_WEIGHT_NORMAL > 0 ? QOS_WEIGHT_NORMAL : 1;
+  q->weight[PRIORITY_BULK] = QOS_WEIGHT_BULK > 0 ? QOS_WEIGHT_BULK : 1;
+  memcpy(q->credit, q->weight, sizeof(q->credit));
+}
+
+int Qos_Pick(qos_scheduler_t *q, uint8_t ready) {
+  if(ready & (1u << PRIORITY_ALARM)) {
+    q->served[PRIORITY_ALARM]++;
+    return PRIORITY_ALARM;
+  }
+  ready &= (uint8_t)~(1u << PRIORITY_ALARM);
+  if(ready == 0) {
+    return -1;
+  }
+
+  for(;;) {
+    for(int i = 0; i < PRIORITY_CLASSES; i++) {
+      uint8_t c = (uint8_t)((q->turn + i) % PRIORITY_CLASSES);
+      if((ready & (1u << c)) && q->credit[c] > 0) {
+        q->credit[c]--;
+        q->turn = q->credit[c] > 0 ? c : (uint8_t)((c + 1) % PRIORITY_CLASSES); // Stay until the Share is Used
+        q->served[c]++;
+        return c;
+      }
+    }
+    // Every waiting class used its share: next round
+    memcpy(q->credit, q->weight, sizeof(q->credit));
+  }
+}
@@ -0,0 +1,241 @@
+#ifndef ARDUINO
+
+#include <string.h>
+#include <map>
+#include <queue>
+#include <random>
+#include <vector>
+#include "radio_sim.h"
+
+#define SIM_AIRTIME_BASE_US 100 // Preamble, MAC Header, Ack
+#define SIM_AIRTIME_PER_BYTE_US 8 // 1 Mbps PHY
+
+typedef struct {
+  uint64_t start;
+  uint64_t end;
+  uint64_t frame; // Frame Copy
+} sim_window_t;
+
+typedef struct {
+  uint8_t mac[6];
+  sim_rx_fn onReceive;
+  sim_sent_fn onSent;
+  uint64_t busyUntil; // Radio Busy with Earlier Frames
+  std::vector<sim_window_t> receiving; // Frames on the Air at this Node (collisions)
+} sim_node_t;
+
+typedef struct {
+  uint64_t at; // Due Time (us)
+  uint64_t order; // Tie Breaker (FIFO)
+  bool receive; // Receive at node, else sent-callback at node
+  bool success;
+  int node;
+  uint64_t frame; // Frame Copy (collisions), 0 -> none
+  uint8_t peer[6]; // Sender (receive) or Destination (sent)
+  std::vector<uint8_t> data;
+} sim_event_t;
+
+struct Sim_Event_Later {
+  bool operator()(const sim_event_t &a, const sim_event_t &b) const {
+    return a.at != b.at ? a.at > b.at : a.order > b.order;
+  }
+};
+
+/* Simulator Variables */
+static std::vector<sim_node_t> nodes;
+static std::map<std::pair<int, int>, sim_link_t> links;
+static std::priority_queue<sim_event_t, std::vector<sim_event_t>, Sim_Event_Later> events;
+static std::mt19937 rng;
+static uint64_t now = 0;
+static uint64_t eventOrder = 0;
+static sim_stats_t stats;
+static bool collisions = false;
+static std::vector<bool> corrupted; // Frame Copy -> Lost to a Collision
+
+static const uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+void Sim_Reset(uint32_t seed) {
+  nodes.clear();
+  links.clear();
+  events = decltype(events)();
+  rng.seed(seed);
+  now = 0;
+  eventOrder = 0;
+  memset(&stats, 0, sizeof(stats));
+  collisions = false;
+  corrupted.assign(1, false);
+}
+
+void Sim_Set_Collisions(bool enabled) {
+  collisions = enabled;
+}
+
+int Sim_Add_Node(const uint8_t *mac, sim_rx_fn onReceive, sim_sent_fn onSent) {
+  sim_node_t node;
+  memcpy(node.mac, mac, 6);
+  node.onReceive = onReceive;
+  node.onSent = onSent;
+  node.busyUntil = 0;
+  nodes.push_back(node);
+  return (int)nodes.size() - 1;
+}
+
+const uint8_t *Sim_Node_MAC(int node) {
+  return nodes[node].mac;
+}
+
+int Sim_Find_Node(const uint8_t *mac) {
+  for(size_t i = 0; i < nodes.size(); i++) {
+    if(memcmp(nodes[i].mac, mac, 6) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+void Sim_Set_Link(int a, int b, const sim_link_t *link) {
+  links[std::make_pair(a, b)] = *link;
+}
+
+void Sim_Connect(int a, int b, const sim_link_t *link) {
+  Sim_Set_Link(a, b, link);
+  Sim_Set_Link(b, a, link);
+}
+
+const sim_link_t *Sim_Get_Link(int a, int b) {
+  auto link = links.find(std::make_pair(a, b));
+  return link != links.end() ? &link->second : NULL;
+}
+
+uint32_t Sim_Random() {
+  return rng();
+}
+
+float Sim_Uniform() {
+  return (float)(rng() >> 8) / (float)(1u << 24);
+}
+
+static void Sim_Push(uint64_t at, bool receive, bool success, int node, uint64_t frame, const uint8_t *peer, const uint8_t *data, size_t len) {
+  sim_event_t ev;
+  ev.at = at;
+  ev.order = eventOrder++;
+  ev.receive = receive;
+  ev.success = success;
+  ev.node = node;
+  ev.frame = frame;
+  memcpy(ev.peer, peer, 6);
+  if(data != NULL) {
+    ev.data.assign(data, data + len);
+  }
+  events.push(ev);
+}
+
+// Mark every frame copy overlapping [start, end) at node, and this one, as collided
+static void Sim_Check_Collisions(sim_node_t &node, uint64_t start, uint64_t end, uint64_t frame) {
+  size_t kept = 0;
+  for(size_t i = 0; i < node.receiving.size(); i++) {
+    sim_window_t &window = node.receiving[i];
+    if(window.end <= now) {
+      continue; // Already Over
+    }
+    if(window.start < end && start < window.end) {
+      corrupted[window.frame] = true;
+      corrupted[frame] = true;
+    }
+    node.receiving[kept++] = window;
+  }
+  node.receiving.resize(kept);
+  node.receiving.push_back({start, end, frame});
+}
+
+// Schedule one copy of a frame over link from -> to. Returns true if it will arrive (*arrival set)
+static bool Sim_Deliver(int from, int to, uint64_t txStart, uint64_t txEnd, const uint8_t *data, size_t len, uint64_t *frame, uint64_t *arrival) {
+  const sim_link_t &link = links[std::make_pair(from, to)];
+  if(Sim_Uniform() < link.loss) {
+    stats.lost++;
+    return false;
+  }
+  uint64_t jitter = link.jitterUs ? rng() % (link.jitterUs + 1) : 0;
+  *arrival = txEnd + link.latencyUs + jitter;
+  *frame = 0;
+  if(collisions) {
+    *frame = corrupted.size();
+    corrupted.push_back(false);
+    Sim_Check_Collisions(nodes[to], txStart + link.latencyUs + jitter, *arrival, *frame);
+  }
+  Sim_Push(*arrival, true, true, to, *frame, nodes[from].mac, data, len);
+  stats.delivered++;
+  return true;
+}
+
+bool Sim_Send(int from, const uint8_t *to, const uint8_t *data, size_t len) {
+  if(len == 0 || len > SIM_MAX_FRAME) {
+    return false;
+  }
+
+  sim_node_t &sender = nodes[from];
+  uint64_t start = sender.busyUntil > now ? sender.busyUntil : now;
+  uint64_t txEnd = start + SIM_AIRTIME_BASE_US + SIM_AIRTIME_PER_BYTE_US * len;
+  sender.busyUntil = txEnd;
+
+  stats.frames++;
+  stats.bytes += len;
+
+  bool success;
+  uint64_t frame = 0;
+  uint64_t arrival = txEnd;
+  if(memcmp(to, broadcastMac, 6) == 0) {
+    for(auto &entry : links) {
+      if(entry.first.first == from) {
+        uint64_t copy, at;
+        Sim_Deliver(from, entry.first.second, start, txEnd, data, len, &copy, &at);
+      }
+    }
+    success = true;
+  } else {
+    int target = Sim_Find_Node(to);
+    if(target < 0 || links.find(std::make_pair(from, target)) == links.end()) {
+      stats.noRoute++;
+      success = false;
+    } else {
+      success = Sim_Deliver(from, target, start, txEnd, data, len, &frame, &arrival);
+    }
+  }
+
+  // With collisions the outcome is known only once the frame has been received
+  Sim_Push(collisions && success ? arrival : txEnd, false, success, from, frame, to, NULL, 0);
+  return true;
+}
+
+uint64_t Sim_Now_Us() {
+  return now;
+}
+
+void Sim_Run_Until(uint64_t untilUs) {
+  while(!events.empty() && events.top().at <= untilUs) {
+    sim_event_t ev = events.top();
+    events.pop();
+    now = ev.at;
+
+    sim_node_t &node = nodes[ev.node];
+    bool collided = ev.frame != 0 && corrupted[ev.frame];
+    if(ev.receive && collided) {
+      stats.collided++;
+    } else if(ev.receive) {
+      if(node.onReceive != NULL) {
+        node.onReceive(ev.node, ev.peer, ev.data.data(), (int)ev.data.size());
+      }
+    } else if(node.onSent != NULL) {
+      node.onSent(ev.node, ev.peer, ev.success && !collided);
+    }
+  }
+  if(untilUs > now) {
+    now = untilUs;
+  }
+}
+
+const sim_stats_t *Sim_Get_Stats() {
+  return &stats;
+}
+
+#endif
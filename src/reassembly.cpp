@@ -0,0 +1,204 @@
+#include <atomic>
+#include <string.h>
+#include "reassembly.h"
+
+static_assert(REASSEMBLY_MAX_BYTES <= 65535, "Payload length is 16-bit on the wire");
+static_assert(REASSEMBLY_POOL_BYTES >= REASSEMBLY_MAX_BYTES, "Pool cannot hold the largest payload");
+static_assert(REASSEMBLY_POOL_BYTES <= 65536, "Pool offsets are 16-bit");
+static_assert(REASSEMBLY_SLOTS <= 32, "Held slots are a 32-bit mask");
+
+/* Reassembly Variables */
+static reassembly_slot_t slots[REASSEMBLY_SLOTS];
+static uint8_t pool[REASSEMBLY_POOL_BYTES];
+static reassembly_stats_t stats;
+static std::atomic<uint32_t> held(0); // Bit i -> slots[i] Delivered, not yet Released
+
+void Reassembly_Init() {
+  memset(slots, 0, sizeof(slots));
+  memset(&stats, 0, sizeof(stats));
+  held.store(0, std::memory_order_relaxed);
+}
+
+static bool Reassembly_Held(int i) {
+  return (held.load(std::memory_order_acquire) >> i) & 1u;
+}
+
+static bool Reassembly_Stale(const reassembly_slot_t *slot, uint32_t now) {
+  return (uint32_t)(now - slot->started) > REASSEMBLY_TIMEOUT_MS;
+}
+
+static bool Reassembly_Valid(const fragment_t *fragment) {
+  return fragment->count > 0 && fragment->count <= REASSEMBLY_MAX_FRAGMENTS &&
+         fragment->index < fragment->count && fragment->total > 0 && fragment->total <= REASSEMBLY_MAX_BYTES &&
+         fragment->len > 0 && (uint32_t)fragment->offset + fragment->len <= fragment->total;
+}
+
+// Bytes still needed: a partial payload, or a delivered one not yet released
+static bool Reassembly_Occupies(int i) {
+  return slots[i].used && (!slots[i].complete || Reassembly_Held(i));
+}
+
+// First pool offset with len free bytes, or -1
+static int32_t Reassembly_Place(size_t len) {
+  for(int c = -1; c < REASSEMBLY_SLOTS; c++) {
+    if(c >= 0 && !Reassembly_Occupies(c)) {
+      continue;
+    }
+    size_t start = c < 0 ? 0 : (size_t)slots[c].offset + slots[c].total; // Pool Start, or just past a Payload
+    bool fits = start + len <= REASSEMBLY_POOL_BYTES;
+    for(int i = 0; i < REASSEMBLY_SLOTS && fits; i++) {
+      fits = !Reassembly_Occupies(i) || start + len <= slots[i].offset || slots[i].offset + slots[i].total <= start;
+    }
+    if(fits) {
+      return (int32_t)start;
+    }
+  }
+  return -1;
+}
+
+static reassembly_slot_t *Reassembly_Oldest_Partial() {
+  reassembly_slot_t *victim = NULL;
+  for(int i = 0; i < REASSEMBLY_SLOTS; i++) {
+    reassembly_slot_t *slot = &slots[i];
+    if(slot->used && !slot->complete && (victim == NULL || (int32_t)(slot->started - victim->started) < 0)) {
+      victim = slot;
+    }
+  }
+  return victim;
+}
+
+static void Reassembly_Evict(reassembly_slot_t *victim, uint32_t now) {
+  if(Reassembly_Stale(victim, now)) {
+    stats.timedOut++;
+  } else {
+    stats.evicted++;
+  }
+  victim->used = false;
+}
+
+// Slot and pool room for a new payload of total bytes. The slot is free, the
+// oldest released delivered one, or the oldest partial one; partial payloads
+// are evicted oldest first until the pool has room
+static reassembly_slot_t *Reassembly_Claim(uint32_t now, uint16_t total) {
+  int32_t offset;
+  while((offset = Reassembly_Place(total)) < 0) {
+    reassembly_slot_t *victim = Reassembly_Oldest_Partial();
+    if(victim == NULL) {
+      return NULL; // The Pool Holds only Payloads Waiting on Reassembly_Release
+    }
+    Reassembly_Evict(victim, now);
+  }
+
+  reassembly_slot_t *victim = NULL;
+  for(int i = 0; i < REASSEMBLY_SLOTS; i++) {
+    reassembly_slot_t *slot = &slots[i];
+    if(!slot->used) {
+      victim = slot;
+      break;
+    }
+    if(slot->complete && !Reassembly_Held(i) && (victim == NULL || (int32_t)(slot->started - victim->started) < 0)) {
+      victim = slot;
+    }
+  }
+  if(victim == NULL) {
+    victim = Reassembly_Oldest_Partial();
+    if(victim == NULL) {
+      return NULL; // Every slot waiting on Reassembly_Release
+    }
+    Reassembly_Evict(victim, now);
+  }
+  victim->offset = (uint16_t)offset;
+  return victim;
+}
+
+reassembly_result Reassembly_Add(const uint8_t *source, const fragment_t *fragment, uint32_t now,
+                                 const uint8_t **payload, uint16_t *len) {
+  if(!Reassembly_Valid(fragment)) {
+    stats.rejected++;
+    return REASSEMBLY_REJECTED;
+  }
+
+  reassembly_slot_t *slot = NULL;
+  for(int i = 0; i < REASSEMBLY_SLOTS; i++) {
+    if(slots[i].used && slots[i].messageID == fragment->messageID && memcmp(slots[i].mac, source, MAC_SIZE) == 0) {
+      slot = &slots[i];
+      break;
+    }
+  }
+
+  if(slot != NULL && Reassembly_Stale(slot, now) && !Reassembly_Held((int)(slot - slots))) {
+    // Same key long after the first fragment: a new payload reusing the ID
+    if(!slot->complete) {
+      stats.timedOut++;
+    }
+    slot->used = false;
+    slot = NULL;
+  }
+
+  if(slot == NULL) {
+    slot = Reassembly_Claim(now, fragment->total);
+    if(slot == NULL) {
+      stats.noRoom++;
+      return REASSEMBLY_NO_ROOM;
+    }
+    memcpy(slot->mac, source, MAC_SIZE);
+    slot->used = true;
+    slot->complete = false;
+    slot->messageID = fragment->messageID;
+    slot->count = fragment->count;
+    slot->received = 0;
+    slot->total = fragment->total;
+    slot->bitmap = 0;
+    slot->started = now;
+  }
+
+  uint32_t bit = 1u << fragment->index;
+  if(slot->complete || (slot->bitmap & bit)) {
+    stats.duplicates++;
+    return REASSEMBLY_DUPLICATE;
+  }
+  if(fragment->count != slot->count || fragment->total != slot->total) {
+    stats.rejected++;
+    return REASSEMBLY_REJECTED;
+  }
+
+  memcpy(&pool[slot->offset + fragment->offset], fragment->data, fragment->len);
+  slot->bitmap |= bit;
+  slot->received++;
+  stats.fragments++;
+
+  if(slot->received < slot->count) {
+    return REASSEMBLY_PENDING;
+  }
+
+  slot->complete = true;
+  held.fetch_or(1u << (slot - slots), std::memory_order_acq_rel);
+  stats.completed++;
+  stats.completedBytes += slot->total;
+  *payload = &pool[slot->offset];
+  *len = slot->total;
+  return REASSEMBLY_COMPLETE;
+}
+
+void Reassembly_Expire(uint32_t now) {
+  for(int i = 0; i < REASSEMBLY_SLOTS; i++) {
+    reassembly_slot_t *slot = &slots[i];
+    if(slot->used && !slot->complete && Reassembly_Stale(slot, now)) {
+      slot->used = false;
+      stats.timedOut++;
+    }
+  }
+}
+
+void Reassembly_Release(const uint8_t *payload) {
+  for(int i = 0; i < REASSEMBLY_SLOTS; i++) {
+    if(Reassembly_Held(i) && &pool[slots[i].offset] == payload) { // Released Slots may Share a Stale Offset
+      held.fetch_and(~(1u << i), std::memory_order_acq_rel);
+      return;
+    }
+  }
+}
+
+const reassembly_stats_t *Reassembly_Get_Stats() {
+  return &stats;
+}
@@ -0,0 +1,332 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "record_writer.h"
+
+/* Bounded output cursor. Every put checks space; once a put fails the
+   writer stays failed and the record is discarded by the caller. */
+typedef struct {
+  uint8_t *p;
+  uint8_t *end;
+  bool ok;
+} cursor_t;
+
+static void Put(cursor_t *c, const void *data, size_t len) {
+  if(!c->ok || (size_t)(c->end - c->p) < len) {
+    c->ok = false;
+    return;
+  }
+  memcpy(c->p, data, len);
+  c->p += len;
+}
+
+static void Put_Byte(cursor_t *c, uint8_t b) {
+  Put(c, &b, 1);
+}
+
+static void Put_Str(cursor_t *c, const char *s) {
+  Put(c, s, strlen(s));
+}
+
+/* JSON */
+
+static void Json_Int(cursor_t *c, int32_t value) {
+  char digits[12];
+  int n = 0;
+  uint32_t v = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+  do {
+    digits[sizeof(digits) - 1 - n++] = (char)('0' + v % 10);
+    v /= 10;
+  } while(v);
+  if(value < 0) {
+    digits[sizeof(digits) - 1 - n++] = '-';
+  }
+  Put(c, &digits[sizeof(digits) - n], n);
+}
+
+static void Json_Text(cursor_t *c, const unsigned char *text, size_t max) {
+  static const char hex[] = "0123456789abcdef";
+  Put_Byte(c, '"');
+  for(size_t i = 0; i < max && text[i]; i++) {
+    unsigned char ch = text[i];
+    if(ch == '"' || ch == '\\') {
+      Put_Byte(c, '\\');
+      Put_Byte(c, ch);
+    } else if(ch < 0x20) {
+      char esc[6] = {'\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 0x0F]};
+      Put(c, esc, sizeof(esc));
+    } else {
+      Put_Byte(c, ch);
+    }
+  }
+  Put_Byte(c, '"');
+}
+
+static void Json_Key_Int(cursor_t *c, const char *key, int32_t value) {
+  Put_Str(c, key);
+  Json_Int(c, value);
+}
+
+static void Json_Key_Uint(cursor_t *c, const char *key, uint32_t value) {
+  Put_Str(c, key);
+  char digits[12];
+  int n = snprintf(digits, sizeof(digits), "%lu", (unsigned long)value);
+  Put(c, digits, (size_t)n);
+}
+
+static void Json_Key_Double(cursor_t *c, const char *key, double value) {
+  Put_Str(c, key);
+  if(!isfinite(value)) {
+    Put_Str(c, "null"); // JSON has no inf
+    return;
+  }
+  char digits[32];
+  int n = snprintf(digits, sizeof(digits), "%.9g", value);
+  Put(c, digits, (size_t)n);
+}
+
+static void Json_Mac(cursor_t *c, const uint8_t *mac) {
+  Put_Byte(c, '[');
+  for(int j = 0; j < MAC_SIZE; j++) {
+    if(j) {
+      Put_Byte(c, ',');
+    }
+    Json_Int(c, mac[j]);
+  }
+  Put_Byte(c, ']');
+}
+
+static void Json_Base64(cursor_t *c, const uint8_t *data, size_t len) {
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  Put_Byte(c, '"');
+  for(size_t i = 0; i < len; i += 3) {
+    uint32_t n = (uint32_t)data[i] << 16;
+    if(i + 1 < len) {
+      n |= (uint32_t)data[i + 1] << 8;
+    }
+    if(i + 2 < len) {
+      n |= data[i + 2];
+    }
+    char quad[4] = {alphabet[(n >> 18) & 0x3F], alphabet[(n >> 12) & 0x3F],
+                    i + 1 < len ? alphabet[(n >> 6) & 0x3F] : '=', i + 2 < len ? alphabet[n & 0x3F] : '='};
+    Put(c, quad, sizeof(quad));
+  }
+  Put_Byte(c, '"');
+}
+
+// Key written only for classes other than PRIORITY_NORMAL
+static const char *Priority_Name(uint8_t priority) {
+  return priority == PRIORITY_ALARM ? "alarm" : priority == PRIORITY_BULK ? "bulk" : NULL;
+}
+
+static void Write_Json(cursor_t *c, const message_t *msg, const uint8_t *payload, size_t len) {
+  Put_Str(c, "{\"text\":");
+  Json_Text(c, msg->text, sizeof(msg->text));
+  Json_Key_Int(c, ",\"TTL\":", msg->TTL);
+  Json_Key_Int(c, ",\"identification\":", msg->identification);
+  Put_Str(c, msg->broadcast_Ack ? ",\"broadcast_Ack\":true" : ",\"broadcast_Ack\":false");
+  Put_Str(c, msg->Data_Ack ? ",\"Data_Ack\":true" : ",\"Data_Ack\":false");
+  Json_Key_Int(c, ",\"packetID\":", msg->packetID);
+  Json_Key_Int(c, ",\"Path_Index\":", msg->Path_Index);
+  Json_Key_Int(c, ",\"Path_Length\":", msg->Path_Length);
+  Put_Str(c, msg->Path_Exist ? ",\"Path_Exist\":true" : ",\"Path_Exist\":false");
+
+  // Path rows 0..Path_Index
+  Put_Str(c, ",\"Path_Array\":[");
+  for(int i = 0; i <= msg->Path_Index && i < MAX_NODES; i++) {
+    if(i) {
+      Put_Byte(c, ',');
+    }
+    Json_Mac(c, msg->Path_Array[i]);
+  }
+  Put_Str(c, "],\"SourceMAC\":");
+  Json_Mac(c, msg->source_mac);
+  const char *priority = Priority_Name(msg->priority);
+  if(priority != NULL) {
+    Put_Str(c, ",\"priority\":\"");
+    Put_Str(c, priority);
+    Put_Byte(c, '"');
+  }
+  if(msg->captured) {
+    Json_Key_Uint(c, ",\"captured_ms\":", msg->captured);
+  }
+  if(payload != NULL) {
+    Put_Str(c, ",\"payload\":");
+    Json_Base64(c, payload, len);
+  }
+  Put_Byte(c, '}');
+}
+
+static void Write_Json_Summary(cursor_t *c, const aggregate_summary_t *summary) {
+  Put_Str(c, "{\"SourceMAC\":");
+  Json_Mac(c, summary->source);
+  Json_Key_Int(c, ",\"packetID\":", summary->lastPacketID);
+  Json_Key_Int(c, ",\"count\":", (int32_t)summary->count);
+  Json_Key_Double(c, ",\"min\":", summary->min);
+  Json_Key_Double(c, ",\"max\":", summary->max);
+  Json_Key_Double(c, ",\"mean\":", summary->mean);
+  Json_Key_Double(c, ",\"last\":", summary->last);
+  Json_Key_Int(c, ",\"window_ms\":", (int32_t)(summary->lastMs - summary->firstMs));
+  Put_Byte(c, '}');
+}
+
+/* MessagePack */
+
+static void Pack_Int(cursor_t *c, int32_t value) {
+  if(value >= 0 && value <= 0x7F) {
+    Put_Byte(c, (uint8_t)value); // positive fixint
+  } else if(value < 0 && value >= -32) {
+    Put_Byte(c, (uint8_t)(int8_t)value); // negative fixint
+  } else {
+    uint8_t b[5] = {0xD2, (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value};
+    Put(c, b, sizeof(b)); // int32
+  }
+}
+
+static void Pack_Uint(cursor_t *c, uint32_t value) {
+  uint8_t b[5] = {0xCE, (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value};
+  Put(c, b, sizeof(b)); // uint32
+}
+
+static void Pack_Str(cursor_t *c, const char *s, size_t len) {
+  if(len < 32) {
+    Put_Byte(c, (uint8_t)(0xA0 | len)); // fixstr
+  } else {
+    Put_Byte(c, 0xD9); // str8
+    Put_Byte(c, (uint8_t)len);
+  }
+  Put(c, s, len);
+}
+
+static void Pack_Key(cursor_t *c, const char *key) {
+  Pack_Str(c, key, strlen(key));
+}
+
+static void Pack_Bool(cursor_t *c, bool value) {
+  Put_Byte(c, value ? 0xC3 : 0xC2);
+}
+
+static void Pack_Mac(cursor_t *c, const uint8_t *mac) {
+  Put_Byte(c, 0x90 | MAC_SIZE); // fixarray
+  for(int j = 0; j < MAC_SIZE; j++) {
+    Pack_Int(c, mac[j]);
+  }
+}
+
+static void Pack_Bin(cursor_t *c, const uint8_t *data, size_t len) {
+  if(len <= 0xFF) {
+    Put_Byte(c, 0xC4); // bin8
+    Put_Byte(c, (uint8_t)len);
+  } else {
+    uint8_t b[3] = {0xC5, (uint8_t)(len >> 8), (uint8_t)len}; // bin16
+    Put(c, b, sizeof(b));
+  }
+  Put(c, data, len);
+}
+
+static void Pack_Double(cursor_t *c, double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint8_t b[9] = {0xCB}; // float64
+  for(int i = 0; i < 8; i++) {
+    b[1 + i] = (uint8_t)(bits >> (56 - 8 * i));
+  }
+  Put(c, b, sizeof(b));
+}
+
+static void Write_Msgpack_Summary(cursor_t *c, const aggregate_summary_t *summary) {
+  Put_Byte(c, 0x80 | 8); // fixmap
+  Pack_Key(c, "SourceMAC");
+  Pack_Mac(c, summary->source);
+  Pack_Key(c, "packetID");
+  Pack_Int(c, summary->lastPacketID);
+  Pack_Key(c, "count");
+  Pack_Int(c, (int32_t)summary->count);
+  Pack_Key(c, "min");
+  Pack_Double(c, summary->min);
+  Pack_Key(c, "max");
+  Pack_Double(c, summary->max);
+  Pack_Key(c, "mean");
+  Pack_Double(c, summary->mean);
+  Pack_Key(c, "last");
+  Pack_Double(c, summary->last);
+  Pack_Key(c, "window_ms");
+  Pack_Int(c, (int32_t)(summary->lastMs - summary->firstMs));
+}
+
+static void Write_Msgpack(cursor_t *c, const message_t *msg, const uint8_t *payload, size_t len) {
+  const char *priority = Priority_Name(msg->priority);
+  Put_Byte(c, (uint8_t)(0x80 | (11 + (payload != NULL) + (priority != NULL) + (msg->captured != 0)))); // fixmap
+  Pack_Key(c, "text");
+  Pack_Str(c, (const char *)msg->text, strnlen((const char *)msg->text, sizeof(msg->text) - 1));
+  Pack_Key(c, "TTL");
+  Pack_Int(c, msg->TTL);
+  Pack_Key(c, "identification");
+  Pack_Int(c, msg->identification);
+  Pack_Key(c, "broadcast_Ack");
+  Pack_Bool(c, msg->broadcast_Ack);
+  Pack_Key(c, "Data_Ack");
+  Pack_Bool(c, msg->Data_Ack);
+  Pack_Key(c, "packetID");
+  Pack_Int(c, msg->packetID);
+  Pack_Key(c, "Path_Index");
+  Pack_Int(c, msg->Path_Index);
+  Pack_Key(c, "Path_Length");
+  Pack_Int(c, msg->Path_Length);
+  Pack_Key(c, "Path_Exist");
+  Pack_Bool(c, msg->Path_Exist);
+
+  int rows = msg->Path_Index < MAX_NODES ? msg->Path_Index + 1 : MAX_NODES;
+  Pack_Key(c, "Path_Array");
+  Put_Byte(c, (uint8_t)(0x90 | rows)); // fixarray
+  for(int i = 0; i < rows; i++) {
+    Pack_Mac(c, msg->Path_Array[i]);
+  }
+  Pack_Key(c, "SourceMAC");
+  Pack_Mac(c, msg->source_mac);
+  if(priority != NULL) {
+    Pack_Key(c, "priority");
+    Pack_Str(c, priority, strlen(priority));
+  }
+  if(msg->captured) {
+    Pack_Key(c, "captured_ms");
+    Pack_Uint(c, msg->captured);
+  }
+  if(payload != NULL) {
+    Pack_Key(c, "payload");
+    Pack_Bin(c, payload, len);
+  }
+}
+
+size_t Record_Write_Payload(const message_t *msg, const uint8_t *payload, size_t len, record_format format,
+                            uint8_t *out, size_t cap) {
+  cursor_t c = {out, out + cap, len <= 0xFFFF};
+
+  if(format == RECORD_MSGPACK) {
+    Write_Msgpack(&c, msg, payload, len);
+  } else {
+    Write_Json(&c, msg, payload, len);
+  }
+
+  return c.ok ? (size_t)(c.p - out) : 0;
+}
+
+size_t Record_Write(const message_t *msg, record_format format, uint8_t *out, size_t cap) {
+  return Record_Write_Payload(msg, NULL, 0, format, out, cap);
+}
+
+size_t Record_Write_Summary(const aggregate_summary_t *summary, record_format format, uint8_t *out, size_t cap) {
+  cursor_t c = {out, out + cap, true};
+
+  if(format == RECORD_MSGPACK) {
+    Write_Msgpack_Summary(&c, summary);
+  } else {
+    Write_Json_Summary(&c, summary);
+  }
+
+  return c.ok ? (size_t)(c.p - out) : 0;
+}
+
+const char *Record_Content_Type(record_format format) {
+  return format == RECORD_MSGPACK ? "application/msgpack" : "application/json";
+}
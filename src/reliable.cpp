@@ -0,0 +1,208 @@
+#include <string.h>
+#include "reliable.h"
+#include "wire_format.h"
+
+static_assert(RELIABLE_WINDOW >= 1 && RELIABLE_WINDOW <= 255, "RELIABLE_WINDOW out of range");
+
+#define RELIABLE_RTO_GRANULARITY_US 1000 // Floor for the 4 * RTTVAR term
+
+static uint32_t Reliable_Clamp(uint32_t rto) {
+  if(rto < RELIABLE_RTO_MIN_MS * 1000u) {
+    return RELIABLE_RTO_MIN_MS * 1000u;
+  }
+  if(rto > RELIABLE_RTO_MAX_MS * 1000u) {
+    return RELIABLE_RTO_MAX_MS * 1000u;
+  }
+  return rto;
+}
+
+void Reliable_Init(reliable_t *r, reliable_send_fn send, void *ctx, uint32_t seed) {
+  memset(r, 0, sizeof(*r));
+  r->send = send;
+  r->ctx = ctx;
+  r->window = RELIABLE_WINDOW;
+  r->maxTries = MAX_TRIES;
+  r->rtoInitial = RELIABLE_RTO_INITIAL_MS * 1000u;
+  r->nextID = (int32_t)seed;
+}
+
+static reliable_peer_t *Reliable_Find(const reliable_t *r, const uint8_t *mac) {
+  for(int i = 0; i < RELIABLE_PEERS; i++) {
+    const reliable_peer_t *peer = &r->peers[i];
+    if(peer->used && memcmp(peer->mac, mac, MAC_SIZE) == 0) {
+      return (reliable_peer_t *)peer;
+    }
+  }
+  return NULL;
+}
+
+// Existing entry, a free one, or the least recently used idle one
+static reliable_peer_t *Reliable_Claim(reliable_t *r, const uint8_t *mac, uint32_t now) {
+  reliable_peer_t *peer = Reliable_Find(r, mac);
+  if(peer != NULL) {
+    return peer;
+  }
+
+  reliable_peer_t *victim = NULL;
+  for(int i = 0; i < RELIABLE_PEERS; i++) {
+    reliable_peer_t *candidate = &r->peers[i];
+    if(!candidate->used) {
+      victim = candidate;
+      break;
+    }
+    if(candidate->inFlight == 0 && (victim == NULL || (int32_t)(candidate->stamp - victim->stamp) < 0)) {
+      victim = candidate;
+    }
+  }
+  if(victim == NULL) {
+    return NULL; // Every destination has packets in flight
+  }
+
+  memset(victim, 0, sizeof(*victim));
+  memcpy(victim->mac, mac, MAC_SIZE);
+  victim->used = true;
+  victim->rto = r->rtoInitial;
+  victim->stamp = now;
+  return victim;
+}
+
+static void Reliable_Transmit(reliable_t *r, reliable_slot_t *slot) {
+  r->stats.transmissions++;
+  if(r->send != NULL) {
+    r->send(r->ctx, slot->nextHop, slot->frame, slot->len); // A rejected frame is retried on timeout
+  }
+}
+
+bool Reliable_Can_Send(const reliable_t *r, const uint8_t *destination) {
+  const reliable_peer_t *peer = Reliable_Find(r, destination);
+  if(peer != NULL) {
+    return peer->inFlight < r->window;
+  }
+  for(int i = 0; i < RELIABLE_PEERS; i++) {
+    if(!r->peers[i].used || r->peers[i].inFlight == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Reliable_Send(reliable_t *r, const uint8_t *nextHop, message_t *packet, const fragment_t *fragment, uint32_t now) {
+  reliable_peer_t *peer = Reliable_Claim(r, packet->destination_mac, now);
+  if(peer == NULL || peer->inFlight >= r->window) {
+    return false;
+  }
+
+  reliable_slot_t *slot = NULL;
+  for(int i = 0; i < RELIABLE_WINDOW; i++) {
+    if(!peer->slots[i].used) {
+      slot = &peer->slots[i];
+      break;
+    }
+  }
+  if(slot == NULL) {
+    return false;
+  }
+
+  if(r->nextID == 0) {
+    r->nextID++; // ackID 0 means "no ack"
+  }
+  packet->packetID = r->nextID;
+
+  size_t len = fragment != NULL ? Wire_Encode_Fragment(packet, fragment, slot->frame, sizeof(slot->frame))
+                                : Wire_Encode(packet, slot->frame, sizeof(slot->frame));
+  if(len == 0) {
+    return false;
+  }
+  r->nextID++;
+
+  slot->used = true;
+  slot->tries = 1;
+  slot->packetID = packet->packetID;
+  slot->len = (uint8_t)len;
+  memcpy(slot->nextHop, nextHop, MAC_SIZE);
+  slot->firstSent = now;
+  slot->sentAt = now;
+  slot->deadline = now + peer->rto;
+  peer->inFlight++;
+  peer->stamp = now;
+  r->stats.sent++;
+
+  Reliable_Transmit(r, slot);
+  return true;
+}
+
+// RFC 6298 estimator
+static void Reliable_Sample(reliable_peer_t *peer, uint32_t rtt) {
+  if(!peer->sampled) {
+    peer->srtt = rtt;
+    peer->rttvar = rtt / 2;
+    peer->sampled = true;
+  } else {
+    uint32_t delta = peer->srtt > rtt ? peer->srtt - rtt : rtt - peer->srtt;
+    peer->rttvar = (3 * peer->rttvar + delta) / 4;
+    peer->srtt = (7 * peer->srtt + rtt) / 8;
+  }
+  uint32_t spread = 4 * peer->rttvar;
+  peer->rto = Reliable_Clamp(peer->srtt + (spread > RELIABLE_RTO_GRANULARITY_US ? spread : RELIABLE_RTO_GRANULARITY_US));
+}
+
+bool Reliable_On_Ack(reliable_t *r, const uint8_t *source, int32_t ackID, uint32_t now) {
+  reliable_peer_t *peer = Reliable_Find(r, source);
+  if(peer != NULL && ackID != 0) {
+    for(int i = 0; i < RELIABLE_WINDOW; i++) {
+      reliable_slot_t *slot = &peer->slots[i];
+      if(!slot->used || slot->packetID != ackID) {
+        continue;
+      }
+      if(slot->tries == 1) {
+        Reliable_Sample(peer, now - slot->sentAt); // Karn: only unambiguous samples
+        r->stats.rttSamples++;
+      }
+      r->stats.acked++;
+      r->stats.lastAckLatency = now - slot->firstSent;
+      r->stats.ackLatency += r->stats.lastAckLatency;
+      slot->used = false;
+      peer->inFlight--;
+      peer->stamp = now;
+      return true;
+    }
+  }
+  r->stats.duplicateAcks++;
+  return false;
+}
+
+void Reliable_Poll(reliable_t *r, uint32_t now) {
+  for(int p = 0; p < RELIABLE_PEERS; p++) {
+    reliable_peer_t *peer = &r->peers[p];
+    if(!peer->used || peer->inFlight == 0) {
+      continue;
+    }
+    for(int i = 0; i < RELIABLE_WINDOW; i++) {
+      reliable_slot_t *slot = &peer->slots[i];
+      if(!slot->used || (int32_t)(now - slot->deadline) < 0) {
+        continue;
+      }
+      if(slot->tries >= r->maxTries) {
+        slot->used = false;
+        peer->inFlight--;
+        r->stats.failed++;
+        if(r->failed != NULL) {
+          r->failed(r->ctx, peer->mac, slot->packetID, now);
+        }
+        continue;
+      }
+      // Back off: each retry waits twice as long as the one before
+      uint32_t timeout = peer->rto << slot->tries;
+      slot->tries++;
+      slot->sentAt = now;
+      slot->deadline = now + Reliable_Clamp(timeout);
+      r->stats.retransmits++;
+      Reliable_Transmit(r, slot);
+    }
+  }
+}
+
+uint32_t Reliable_RTO(const reliable_t *r, const uint8_t *destination) {
+  const reliable_peer_t *peer = Reliable_Find(r, destination);
+  return peer != NULL ? peer->rto : r->rtoInitial;
+}
@@ -0,0 +1,246 @@
+#include <math.h>
+#include <string.h>
+#include "link_quality.h"
+#include "route_cache.h"
+
+/* Route Cache Variables */
+static route_entry_t routes[ROUTE_CACHE_SIZE];
+static route_cache_stats_t stats;
+
+void Route_Cache_Init() {
+  memset(routes, 0, sizeof(routes));
+  memset(&stats, 0, sizeof(stats));
+}
+
+static bool Route_Stale(uint32_t stamp, uint32_t now) {
+  return (uint32_t)(now - stamp) > ROUTE_MAX_AGE_MS;
+}
+
+static void Route_Forget_Acks(route_entry_t *entry, int path) {
+  for(int i = 0; i < ROUTE_ACK_HISTORY; i++) {
+    if(path < 0 || entry->ackedPath[i] == path) {
+      entry->ackedPath[i] = -1;
+    }
+  }
+}
+
+// Live entry for source (expired entries and paths are released on the way)
+static route_entry_t *Route_Find(const uint8_t *source, uint32_t now) {
+  for(int i = 0; i < ROUTE_CACHE_SIZE; i++) {
+    route_entry_t *entry = &routes[i];
+    if(!entry->used || memcmp(entry->mac, source, MAC_SIZE) != 0) {
+      continue;
+    }
+    if(Route_Stale(entry->stamp, now)) {
+      entry->used = 0;
+      stats.expired++;
+      return NULL;
+    }
+    for(int p = 0; p < ROUTE_CANDIDATES; p++) {
+      if(entry->paths[p].used && Route_Stale(entry->paths[p].stamp, now)) {
+        entry->paths[p].used = 0;
+        Route_Forget_Acks(entry, p);
+        stats.expired++;
+      }
+    }
+    return entry;
+  }
+  return NULL;
+}
+
+float Route_Cache_Cost(const route_path_t *path) {
+  float first = Link_Delivery(path->reverse[1]);
+  float prior = first * powf(ROUTE_HOP_PRIOR, (float)(path->hops - 1));
+  float delivered = (path->acks - path->lost + ROUTE_PRIOR_WEIGHT * prior) / (path->acks + ROUTE_PRIOR_WEIGHT);
+  if(delivered < LINK_DELIVERY_MIN) {
+    delivered = LINK_DELIVERY_MIN;
+  }
+  if(path->hops <= 1) {
+    return 1.0f / delivered; // First hop is the whole path
+  }
+  float rest = delivered < first ? delivered / first : 1.0f; // Past the First Hop
+  float perHop = powf(rest, 1.0f / (float)(path->hops - 1));
+  return 1.0f / first + (float)(path->hops - 1) / perHop;
+}
+
+static int Route_Best(const route_entry_t *entry) {
+  int best = -1;
+  float bestCost = 0;
+  for(int p = 0; p < ROUTE_CANDIDATES; p++) {
+    if(!entry->paths[p].used) {
+      continue;
+    }
+    float cost = Route_Cache_Cost(&entry->paths[p]);
+    if(best < 0 || cost < bestCost) {
+      best = p;
+      bestCost = cost;
+    }
+  }
+  return best;
+}
+
+// Candidate whose reverse rows match the forward path (source first), or -1
+static int Route_Path_Index(const route_entry_t *entry, const uint8_t path[MAX_NODES][MAC_SIZE], uint8_t hops) {
+  for(int p = 0; p < ROUTE_CANDIDATES; p++) {
+    const route_path_t *candidate = &entry->paths[p];
+    if(!candidate->used || candidate->hops != hops) {
+      continue;
+    }
+    int row = 0;
+    while(row < hops && memcmp(path[row], candidate->reverse[hops - row], MAC_SIZE) == 0) {
+      row++;
+    }
+    if(row == hops) {
+      return p;
+    }
+  }
+  return -1;
+}
+
+// Cheapest candidate, counting a switch when it is not the arrival path
+static const route_path_t *Route_Choose(route_entry_t *entry, int arrival) {
+  int best = Route_Best(entry);
+  if(best < 0) {
+    return NULL;
+  }
+  if(best != arrival) {
+    stats.switches++;
+  }
+  return &entry->paths[best];
+}
+
+const route_path_t *Route_Cache_Match(const uint8_t *source, const uint8_t path[MAX_NODES][MAC_SIZE], uint8_t hops, uint32_t now) {
+  route_entry_t *entry = Route_Find(source, now);
+  int arrival = entry != NULL && hops > 0 && hops < MAX_NODES ? Route_Path_Index(entry, path, hops) : -1;
+
+  if(arrival < 0) {
+    stats.misses++;
+    return NULL;
+  }
+
+  entry->stamp = now;
+  entry->paths[arrival].stamp = now;
+  stats.hits++;
+  return Route_Choose(entry, arrival);
+}
+
+const route_path_t *Route_Cache_Lookup(const uint8_t *source, uint32_t now) {
+  route_entry_t *entry = Route_Find(source, now);
+  if(entry == NULL) {
+    return NULL;
+  }
+  int best = Route_Best(entry);
+  return best < 0 ? NULL : &entry->paths[best];
+}
+
+const route_path_t *Route_Cache_Store(const uint8_t *source, const uint8_t reverse[MAX_NODES][MAC_SIZE], uint8_t hops, uint32_t now) {
+  if(hops == 0 || hops >= MAX_NODES) {
+    return NULL; // Reverse path would not fit
+  }
+
+  route_entry_t *entry = Route_Find(source, now);
+
+  if(entry == NULL) {
+    // Free slot, else least recently used
+    route_entry_t *oldest = NULL;
+    for(int i = 0; i < ROUTE_CACHE_SIZE; i++) {
+      if(!routes[i].used) {
+        entry = &routes[i];
+        break;
+      }
+      if(oldest == NULL || (int32_t)(routes[i].stamp - oldest->stamp) < 0) {
+        oldest = &routes[i];
+      }
+    }
+    if(entry == NULL) {
+      entry = oldest;
+      if(Route_Stale(entry->stamp, now)) {
+        stats.expired++;
+      } else {
+        stats.evictions++;
+      }
+    }
+    memset(entry, 0, sizeof(*entry));
+    memcpy(entry->mac, source, MAC_SIZE);
+    entry->used = 1;
+    Route_Forget_Acks(entry, -1);
+  }
+
+  // Free candidate, else the least recently used one
+  int slot = -1;
+  for(int p = 0; p < ROUTE_CANDIDATES; p++) {
+    if(!entry->paths[p].used) {
+      slot = p;
+      break;
+    }
+    if(slot < 0 || (int32_t)(entry->paths[p].stamp - entry->paths[slot].stamp) < 0) {
+      slot = p;
+    }
+  }
+  Route_Forget_Acks(entry, slot);
+
+  route_path_t *path = &entry->paths[slot];
+  memset(path, 0, sizeof(*path));
+  path->used = 1;
+  path->hops = hops;
+  path->stamp = now;
+  memcpy(path->reverse, reverse, (size_t)(hops + 1) * MAC_SIZE);
+  entry->stamp = now;
+  return Route_Choose(entry, slot);
+}
+
+// Entry and candidate index of a path handed out by this cache
+static route_entry_t *Route_Owner(const uint8_t *source, const route_path_t *path, int *index) {
+  for(int i = 0; i < ROUTE_CACHE_SIZE; i++) {
+    route_entry_t *entry = &routes[i];
+    if(entry->used && memcmp(entry->mac, source, MAC_SIZE) == 0 &&
+       path >= entry->paths && path < entry->paths + ROUTE_CANDIDATES) {
+      *index = (int)(path - entry->paths);
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+void Route_Cache_Ack_Sent(const uint8_t *source, const route_path_t *path, int32_t packetID, uint32_t now) {
+  int index;
+  route_entry_t *entry = path != NULL ? Route_Owner(source, path, &index) : NULL;
+  if(entry == NULL) {
+    return;
+  }
+  route_path_t *candidate = &entry->paths[index];
+  if(candidate->acks >= ROUTE_SAMPLE_WINDOW) {
+    candidate->acks /= 2; // Favour Recent Acks
+    candidate->lost /= 2;
+  }
+  candidate->acks += 1.0f;
+  candidate->stamp = now;
+  entry->ackedID[entry->ackHead] = packetID;
+  entry->ackedPath[entry->ackHead] = (int8_t)index;
+  entry->ackHead = (uint8_t)((entry->ackHead + 1) % ROUTE_ACK_HISTORY);
+}
+
+void Route_Cache_Ack_Lost(const uint8_t *source, int32_t packetID) {
+  for(int i = 0; i < ROUTE_CACHE_SIZE; i++) {
+    route_entry_t *entry = &routes[i];
+    if(!entry->used || memcmp(entry->mac, source, MAC_SIZE) != 0) {
+      continue;
+    }
+    for(int h = 0; h < ROUTE_ACK_HISTORY; h++) {
+      int path = entry->ackedPath[h];
+      if(path >= 0 && entry->ackedID[h] == packetID) {
+        if(entry->paths[path].lost < entry->paths[path].acks) {
+          entry->paths[path].lost += 1.0f;
+        }
+        entry->ackedPath[h] = -1; // Charged Once
+        stats.acksLost++;
+        return;
+      }
+    }
+    return;
+  }
+}
+
+const route_cache_stats_t *Route_Cache_Get_Stats() {
+  return &stats;
+}
@@ -0,0 +1,1489 @@
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING) // Unit Tests bring their own main (test/test_*/)
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "aggregate.h"
+#include "capture.h"
+#include "command.h"
+#include "compress.h"
+#include "datagram.h"
+#include "dedup_cache.h"
+#include "flood.h"
+#include "hal.h"
+#include "link_quality.h"
+#include "log.h"
+#include "message.h"
+#include "metrics.h"
+#include "microbench.h"
+#include "peer_cache.h"
+#include "radio_sim.h"
+#include "reassembly.h"
+#include "reliable.h"
+#include "route_cache.h"
+#include "tdma.h"
+#include "uplink.h"
+#include "wire_format.h"
+
+/* Native entry point: runs the gateway (setup/loop from main.cpp) against a
+   simulated mesh of sensor and relay nodes that speak the same Path_Array
+   source-routing protocol, and reports end-to-end throughput and latency.
+
+   Topology: a chain of relays hangs off the gateway (relay k is k hops
+   out). Source i sits 1 + (i % hops) hops out, attached to the gateway or
+   to the relay one hop closer. Data climbs the chain with each relay
+   appending its MAC; the gateway's ack follows the path it picks back.
+
+   --paths N widens every relay layer to N relays. Each node is then
+   linked to every relay of the layer below and sends each packet up
+   through a random one of them, so a source's data arrives over many
+   paths. --loss-spread P adds a uniform 0..P to each link's loss. Each
+   link then reports an RSSI in line with that loss.
+
+   --capture FILE records every frame the gateway receives; --replay FILE
+   skips the mesh and feeds such a capture (from the sim or a device
+   stream) straight into the gateway's On_Data_Receive, at its recorded
+   spacing or, with --replay-fast, one frame per loop() pass.
+
+   --dense N replaces the mesh with N nodes scattered over a unit square.
+   The gateway sits in the middle, and any two nodes within --range of
+   each other are linked. The first --sources nodes start a broadcast
+   flood every --interval. Every node, the gateway included, runs the
+   flooding layer (TTL, duplicate cache, jitter, k-suppression). The
+   report gives transmissions per flood and coverage. --collisions
+   (any mode) makes frames that overlap at a receiver destroy each
+   other.
+
+   --commands MS plays the server's side of the downlink command channel.
+   It connects to the gateway's COMMAND_PORT over loopback and sends a
+   command to a random source every MS. Sources execute each command once
+   and ack it along the reversed path. The report gives command outcomes
+   and latency from the command line written to its report line read,
+   both in virtual time.
+
+   --alarm N and --bulk N put the first N sources in PRIORITY_ALARM and
+   the next N in PRIORITY_BULK; the rest stay PRIORITY_NORMAL. Alarm
+   sources read every --alarm-interval instead of --interval. --post-ms
+   MS makes every uplink POST hold the gateway for MS of virtual time, as
+   a synchronous POST to a slow server does, so enough sources saturate
+   it. The report gives, per class, readings uploaded and latency from
+   reading taken to the POST carrying it completing (text readings).
+
+   --tdma turns on the gateway's time sync beacons and makes sources keep
+   to their transmit slots (--slot-us wide), stop-and-wait: a window's
+   frames would cross their own acks at the relays. Every mesh node runs
+   its own clock from a random offset and syncs it from the beacons;
+   relays repeat each beacon once. Sources stamp readings with their
+   synced clock, and
+   the report gives how far the uploaded capture times are from the true
+   ones. Without --tdma the gateway stamps readings when they arrive.
+
+   --transport http|udp picks how the gateway sends batches. With udp a
+   stand-in receiver thread takes the datagrams on UPLINK_UDP_PORT and
+   acks them (loopback, so virtual time only paces the mesh).
+   --uplink-bench N skips the mesh and pushes N text records through the
+   uplink stage as fast as the transport takes them. The gateway clock
+   follows the wall clock, and the stand-in receiver answers POSTs on
+   SERVER_URL's port as well. Every reply is held back --rtt-us to stand
+   in for the network. The report gives records per second, the
+   gateway thread's CPU time and the latency from a record queued to
+   its arrival at the receiver.
+
+   --microbench times the gateway's per-packet stages one by one instead
+   (see microbench.h). --baseline FILE fails the run when a stage is more
+   than --tolerance percent slower than FILE records. --results FILE
+   keeps the report, so a run with --results test/microbench_baseline.txt
+   takes a new baseline. */
+
+void setup();
+void loop();
+size_t Serve_Metrics(const char *path, char *body, size_t cap, const char **contentType);
+void CollectMetrics();
+void On_Data_Receive(const uint8_t *mac, const uint8_t *data, int len);
+extern bool uplinkCompress;
+extern flood_t flooding;
+extern tdma_schedule_t tdma;
+extern uplink_transport uplinkTransport;
+extern datagram_t datagrams;
+bool QueueUplink(const message_t *data, const uint8_t *payload, uint16_t len);
+bool Uplink_Transport_Ready();
+
+#define SIM_TICK_US 100 // Gateway loop() period in virtual time
+#define BEACON_JITTER_US 2000 // Longest Delay before a Node Repeats a Beacon
+
+typedef struct {
+  int sources;
+  int hops;
+  float loss;
+  float lossSpread; // Extra per-link loss, uniform 0..lossSpread
+  int paths; // Relays per layer
+  int dense; // Nodes scattered for the flooding scenario (0 -> relay mesh)
+  float range; // Radio range in the dense scenario (unit square)
+  int ttl; // Hops a flood may take
+  int floodK; // Copies that cancel a rebroadcast (0 -> never)
+  uint32_t floodJitterUs; // Longest rebroadcast delay
+  bool collisions; // Overlapping frames are lost at the receiver
+  uint32_t latencyUs;
+  uint32_t jitterUs;
+  uint32_t intervalMs; // Per-source reading interval
+  uint32_t ackTimeoutMs; // Initial retransmission timeout
+  int window; // Source packets in flight (1 -> stop-and-wait)
+  int tries; // Transmissions per packet (1 -> no retransmits)
+  uint32_t payload; // Bytes per reading (0 -> short text reading)
+  bool fragment; // Send payloads as fragments instead of 63-byte text packets
+  bool numeric; // Readings are plain numbers (a random walk) the gateway can aggregate
+  uint32_t aggregateMs; // Gateway aggregation window (0 -> none)
+  uint32_t aggregateCount; // Readings per window (0 -> none)
+  int raw; // Sources kept on raw pass-through
+  bool compress; // Gzip uplink batches
+  const char *capture; // Record gateway receive frames here (NULL -> off)
+  const char *replay; // Feed this capture to the gateway instead of running the mesh
+  bool replayFast; // Ignore recorded spacing
+  uint32_t durationS;
+  uint32_t seed;
+  bool server; // POST to SERVER_URL instead of the built-in sink
+  bool metrics; // Append the gateway's /metrics scrape to the report
+  bool verbose; // Keep gateway console output
+  uint32_t commandMs; // Downlink command interval (0 -> none)
+  int alarm; // Sources sending PRIORITY_ALARM
+  int bulk; // Sources sending PRIORITY_BULK
+  uint32_t alarmIntervalMs; // Reading interval of alarm sources (0 -> --interval)
+  uint32_t postMs; // Virtual time one POST holds the gateway
+  bool tdma; // Gateway beacons on, sources keep to their slots
+  uint32_t slotUs; // TDMA slot width
+  uplink_transport transport;
+  uint32_t benchRecords; // Records for --uplink-bench (0 -> mesh)
+  uint32_t rttUs; // Stand-in receiver reply delay
+  bool microbench; // Time the gateway stages instead of running the mesh
+  const char *baseline; // Microbenchmark results to hold the stages to
+  const char *results; // Write microbenchmark results here
+  uint32_t tolerance; // Percent a stage may exceed its baseline
+} sim_options_t;
+
+typedef struct {
+  int id; // Simulator Node
+  std::vector<int> parents; // Next Hops toward the Gateway (one picked per packet)
+  int depth; // Hops from the Gateway
+  bool source; // Generates Data
+  uint64_t nextReading;
+  uint32_t generated; // Readings Taken
+  uint32_t backlog; // Readings Waiting for Window Space
+  reliable_t reliable; // Source Side of End-to-End Delivery
+  uint16_t messageID; // Current Payload
+  uint32_t offset; // Bytes of the Current Payload Handed Out
+  uint32_t chunk; // Fragment Size of the Current Payload
+  uint8_t pathRows; // Forward Path Rows Learned from Acks (room kept in fragments)
+  uint64_t ackedBytes; // Payload Bytes Acknowledged
+  double value; // Current Numeric Reading
+  std::unordered_map<int32_t, uint16_t> inFlightBytes; // Packet ID -> Payload Bytes
+  std::unordered_set<int32_t> commands; // Gateway Commands Executed (by packet ID)
+  int32_t nextAckID; // Packet ID for Command Acks
+  uint8_t priority; // priority_class of its Readings
+  std::vector<uint64_t> readingAt; // Reading -> Taken (virtual us, 0 once uploaded)
+  uint32_t clockOffset; // Local Clock - Virtual Time
+  tdma_node_t tdma;
+  beacon_t beacon; // Copy to Repeat
+  uint64_t beaconAt; // Repeat Time (0 -> none pending)
+} mesh_node_t;
+
+typedef struct {
+  int fd; // Connection to the Gateway's COMMAND_PORT (-1 -> none)
+  uint32_t nextID;
+  uint64_t nextCommand;
+  std::unordered_map<uint32_t, uint64_t> sentAt; // Command ID -> Written (virtual us)
+  std::vector<uint32_t> latencies; // Written -> Report Read, Delivered Only
+  uint32_t sent;
+  uint32_t outcomes[COMMAND_MALFORMED + 1]; // By command_status
+  uint32_t executed; // Distinct Commands Run by Nodes
+  std::string input; // Report Text not yet Split into Lines
+} standin_t;
+
+typedef struct {
+  int id; // Simulator Node
+  bool source; // Starts Floods
+  uint64_t nextFlood;
+  int32_t nextID; // Next Flood Packet ID
+  dedup_cache_t seen;
+  flood_t flood;
+} dense_node_t;
+
+/* Simulation Variables */
+static sim_options_t options = {4, 3, 0.0f, 0.0f, 1, 0, 0.25f, FLOOD_TTL, FLOOD_K, FLOOD_JITTER_US, false, 2000, 500, 1000, 1000, RELIABLE_WINDOW, MAX_TRIES, 0, true, false, 0, 0, 0, false, NULL, NULL, false, 60, 1, false, false, false, 0, 0, 0, 0, 0, false, TDMA_SLOT_US, UPLINK_TRANSPORT, 0, 0, false, NULL, NULL, MICROBENCH_TOLERANCE};
+static std::vector<mesh_node_t> mesh;
+static std::vector<int> meshIndex; // Simulator node id -> mesh index (-1 for gateway)
+static std::vector<uint32_t> latencies; // Data -> Ack (us)
+static std::vector<uint32_t> classLatencies[PRIORITY_CLASSES]; // Reading Taken -> its POST Done (us)
+static std::vector<uint32_t> captureErrors; // |Uploaded Capture Time - Reading Taken| (us)
+static uint64_t simNow = 0; // Mesh Clock, Advanced by Modelled POSTs too
+static uint64_t simEnd = 0;
+static uint8_t gatewayMac[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+static FILE *captureFile = NULL;
+static std::vector<dense_node_t> dense; // Reserved up front: flood_t points into it
+static standin_t standin;
+
+/* Stand-in uplink receiver: one thread serving POSTs and datagrams over loopback */
+typedef struct {
+  uint64_t due; // Wall us
+  int fd;
+  bool datagram;
+  struct sockaddr_in to;
+  uint8_t data[DATAGRAM_ACK_SIZE];
+  size_t len;
+} reply_t;
+
+typedef struct {
+  int listenFd; // HTTP
+  int clientFd;
+  int udpFd;
+  std::thread thread;
+  std::atomic<bool> stop;
+  std::string request; // HTTP Bytes not yet a Whole Request
+  std::deque<reply_t> replies; // Held Back rttUs
+  uint32_t session; // Datagram Session Seen Last
+  uint32_t cumulative; // Highest Seq Held in Order
+  std::set<uint32_t> ahead; // Held beyond cumulative
+  std::mutex lock; // Guards what the Report Reads
+  std::vector<uint64_t> arrivals; // Reading -> First Arrival (wall us, 0 -> not yet)
+  uint32_t arrived; // Distinct Readings
+  uint64_t bytes; // Read off the Sockets
+  uint32_t requests; // POSTs and Datagrams, Repeats Included
+  uint32_t repeats; // Datagrams Held Already
+} receiver_t;
+static receiver_t receiver;
+
+static void Mesh_Send(int id, const uint8_t *to, const message_t *packet, const fragment_t *fragment) {
+  uint8_t frame[ESPNOW_MTU];
+  size_t len = fragment != NULL ? Wire_Encode_Fragment(packet, fragment, frame, sizeof(frame))
+                                : Wire_Encode(packet, frame, sizeof(frame));
+  if(len > 0) {
+    Sim_Send(id, to, frame, len);
+  }
+}
+
+// Upstream next hop: the only parent, or a random one when there are several
+static int Mesh_Parent(const mesh_node_t *node) {
+  return node->parents.size() == 1 ? node->parents[0] : node->parents[Sim_Random() % node->parents.size()];
+}
+
+static void Mesh_Receive(int id, const uint8_t *from, const uint8_t *data, int len) {
+  (void)from;
+  mesh_node_t *node = &mesh[meshIndex[id]];
+  const uint8_t *self = Sim_Node_MAC(id);
+  message_t packet;
+  fragment_t fragment;
+  bool fragmented = len > 0 && Wire_Is_Fragment(data, (size_t)len);
+
+  beacon_t beacon;
+  if(len > 0 && Wire_Decode_Beacon(data, (size_t)len, &beacon)) {
+    uint32_t local = (uint32_t)Sim_Now_Us() + node->clockOffset;
+    if(Tdma_Node_On_Beacon(&node->tdma, &beacon, local) && beacon.ttl > 1 && !node->source) { // Leaves have no one to Pass it to
+      node->beacon = beacon;
+      node->beaconAt = Sim_Now_Us() + 1 + Sim_Random() % BEACON_JITTER_US; // Spread Neighbours' Repeats
+    }
+    return;
+  }
+
+  if(len <= 0 || !(fragmented ? Wire_Decode_Fragment(data, (size_t)len, &packet, &fragment) : Wire_Decode(data, (size_t)len, &packet))) {
+    return;
+  }
+
+  if(memcmp(packet.destination_mac, self, 6) == 0 && !packet.Data_Ack && packet.Path_Exist) {
+    // Gateway Command: run it once, ack every copy back along the reversed path
+    if(node->commands.insert(packet.packetID).second) {
+      standin.executed++;
+    }
+    message_t ack;
+    memset(&ack, 0, sizeof(ack));
+    strcpy((char *)ack.text, "Done");
+    ack.TTL = 10;
+    ack.identification = 2;
+    ack.Data_Ack = true;
+    ack.Path_Exist = true;
+    ack.ackID = packet.packetID;
+    ack.packetID = node->nextAckID++;
+    memcpy(ack.destination_mac, packet.source_mac, 6);
+    memcpy(ack.source_mac, self, 6);
+    for(int i = 0; i <= packet.Path_Index; i++) {
+      memcpy(ack.Path_Array[i], packet.Path_Array[packet.Path_Index - i], 6);
+    }
+    ack.Path_Index = 1;
+    Mesh_Send(id, ack.Path_Array[1], &ack, NULL);
+    return;
+  }
+
+  if(memcmp(packet.destination_mac, self, 6) == 0) {
+    // Ack for one of our Packets in Flight
+    if(packet.Data_Ack && Reliable_On_Ack(&node->reliable, packet.source_mac, packet.ackID, (uint32_t)Sim_Now_Us())) {
+      latencies.push_back(node->reliable.stats.lastAckLatency);
+      auto bytes = node->inFlightBytes.find(packet.ackID);
+      if(bytes != node->inFlightBytes.end()) {
+        node->ackedBytes += bytes->second;
+        node->inFlightBytes.erase(bytes);
+      }
+      node->pathRows = packet.Path_Index; // Our row in the reversed path = forward rows
+    }
+    return;
+  }
+
+  if(packet.Path_Exist) {
+    // Source-Routed: forward to the next row of Path_Array
+    if(packet.Path_Index + 1 >= MAX_NODES) {
+      return;
+    }
+    packet.Path_Index++;
+    Mesh_Send(id, packet.Path_Array[packet.Path_Index], &packet, fragmented ? &fragment : NULL);
+  } else if(!node->parents.empty()) {
+    // Heading to the Gateway: record this hop and pass it up
+    if(packet.Path_Index >= MAX_NODES) {
+      return;
+    }
+    memcpy(packet.Path_Array[packet.Path_Index], self, 6);
+    packet.Path_Index++;
+    packet.Path_Length++;
+    Mesh_Send(id, Sim_Node_MAC(Mesh_Parent(node)), &packet, fragmented ? &fragment : NULL);
+  }
+}
+
+static bool Mesh_Transmit(void *ctx, const uint8_t *nextHop, const uint8_t *frame, size_t len) {
+  Sim_Send((int)(intptr_t)ctx, nextHop, frame, len);
+  return true;
+}
+
+// Hand the next reading (or the next piece of it) to the delivery engine. False if the window is full
+static bool Mesh_Send_Data(mesh_node_t *node) {
+  message_t packet;
+  fragment_t fragment;
+  uint32_t bytes;
+  memset(&packet, 0, sizeof(packet));
+
+  if(options.payload == 0 && options.numeric) {
+    snprintf((char *)packet.text, sizeof(packet.text), "%.2f", node->value);
+    node->value += (double)(Sim_Random() % 201) / 100.0 - 1.0; // Drift by up to 1 per reading
+    bytes = (uint32_t)strlen((const char *)packet.text);
+  } else if(options.payload == 0) {
+    snprintf((char *)packet.text, sizeof(packet.text), "Reading %u from node %d", (unsigned)(node->generated - node->backlog), node->id);
+    bytes = (uint32_t)strlen((const char *)packet.text);
+  } else if(options.fragment) {
+    if(node->offset == 0) {
+      node->chunk = (uint32_t)Wire_Fragment_Chunk(node->pathRows); // Fixed for the whole payload
+    }
+    uint32_t chunk = node->chunk;
+    bytes = options.payload - node->offset < chunk ? options.payload - node->offset : chunk;
+    fragment.messageID = node->messageID;
+    fragment.index = (uint8_t)(node->offset / chunk);
+    fragment.count = (uint8_t)((options.payload + chunk - 1) / chunk);
+    fragment.total = (uint16_t)options.payload;
+    fragment.offset = (uint16_t)node->offset;
+    fragment.len = (uint8_t)bytes;
+    for(uint32_t i = 0; i < bytes; i++) {
+      fragment.data[i] = (uint8_t)(node->offset + i);
+    }
+  } else {
+    // Split by hand into text packets
+    bytes = options.payload - node->offset < WIRE_TEXT_MAX ? options.payload - node->offset : (uint32_t)WIRE_TEXT_MAX;
+    for(uint32_t i = 0; i < bytes; i++) {
+      packet.text[i] = (unsigned char)('a' + (node->offset + i) % 26);
+    }
+  }
+
+  packet.TTL = 10;
+  packet.identification = 2;
+  packet.priority = node->priority;
+  uint32_t reading = node->generated - node->backlog;
+  if(node->tdma.synced && reading < node->readingAt.size()) {
+    uint32_t local = (uint32_t)node->readingAt[reading] + node->clockOffset;
+    packet.captured = Tdma_Node_Time(&node->tdma, local) / 1000; // Synced Clock at the Reading
+  }
+  memcpy(packet.destination_mac, gatewayMac, 6);
+  memcpy(packet.source_mac, Sim_Node_MAC(node->id), 6);
+  memcpy(packet.Path_Array[0], Sim_Node_MAC(node->id), 6);
+  packet.Path_Index = 1;
+  packet.Path_Length = 1;
+
+  bool fragmented = options.payload > 0 && options.fragment;
+  if(!Reliable_Send(&node->reliable, Sim_Node_MAC(Mesh_Parent(node)), &packet, fragmented ? &fragment : NULL, (uint32_t)Sim_Now_Us())) {
+    return false;
+  }
+  node->inFlightBytes[packet.packetID] = (uint16_t)bytes;
+
+  node->offset += bytes;
+  if(node->offset >= options.payload) {
+    // Reading Fully Handed Out
+    node->offset = 0;
+    node->messageID++;
+    node->backlog--;
+  }
+  return true;
+}
+
+static int Mesh_Add(const std::vector<int> &parents, int depth, bool source) {
+  uint8_t mac[6] = {0x02, 0x00, 0x00, 0x00, (uint8_t)(mesh.size() >> 8), (uint8_t)mesh.size()};
+  mesh_node_t node = {};
+  node.id = Sim_Add_Node(mac, Mesh_Receive, NULL);
+  node.parents = parents;
+  node.depth = depth;
+  node.source = source;
+  node.clockOffset = Sim_Random(); // Nodes Boot at Different Times
+  // One hop of beacon delay: link latency, mean jitter and the airtime of a beacon with every source's grant
+  Tdma_Node_Init(&node.tdma, mac, options.latencyUs + options.jitterUs / 2 + 100 +
+                                      8 * (WIRE_BEACON_HEADER_SIZE + WIRE_BEACON_GRANT_SIZE * options.sources));
+  if(source) {
+    node.nextReading = (uint64_t)(Sim_Random() % (options.intervalMs * 1000)); // Desynchronize Sources
+    Reliable_Init(&node.reliable, Mesh_Transmit, (void *)(intptr_t)node.id, Sim_Random());
+    node.reliable.window = (uint8_t)(options.tdma ? 1 : options.window);
+    node.reliable.maxTries = (uint8_t)options.tries;
+    node.reliable.rtoInitial = options.ackTimeoutMs * 1000;
+    node.messageID = (uint16_t)Sim_Random();
+    node.pathRows = MAX_NODES; // Until an Ack tells the Path Length
+    node.value = 20.0 + node.id; // Numeric Readings Start Apart
+    node.nextAckID = (int32_t)Sim_Random();
+  }
+
+  for(int parent : parents) {
+    sim_link_t link = {options.loss, options.latencyUs, options.jitterUs, 0};
+    if(options.lossSpread > 0) {
+      link.loss += Sim_Uniform() * options.lossSpread;
+      link.rssi = (int8_t)(link.loss < 0.6f ? -60 - 50 * link.loss : -90); // -60 dBm clean, -85 at 50% loss
+    }
+    Sim_Connect(node.id, parent, &link);
+  }
+
+  if((int)meshIndex.size() <= node.id) {
+    meshIndex.resize(node.id + 1, -1);
+  }
+  meshIndex[node.id] = (int)mesh.size();
+  mesh.push_back(node);
+  return node.id;
+}
+
+static void Build_Topology(int gateway) {
+  std::vector<std::vector<int>> relays; // relays[k] is the layer k+1 hops out
+  std::vector<int> below(1, gateway);
+  for(int depth = 1; depth < options.hops; depth++) {
+    std::vector<int> layer;
+    for(int p = 0; p < options.paths; p++) {
+      layer.push_back(Mesh_Add(below, depth, false));
+    }
+    relays.push_back(layer);
+    below = layer;
+  }
+  for(int i = 0; i < options.sources; i++) {
+    int depth = 1 + i % options.hops;
+    Mesh_Add(depth == 1 ? std::vector<int>(1, gateway) : relays[depth - 2], depth, true);
+    mesh.back().priority = i < options.alarm ? PRIORITY_ALARM : i < options.alarm + options.bulk ? PRIORITY_BULK : PRIORITY_NORMAL;
+  }
+}
+
+static bool Dense_Broadcast(void *ctx, const uint8_t *frame, size_t len) {
+  return Sim_Send((int)(intptr_t)ctx, (const uint8_t *)"\xFF\xFF\xFF\xFF\xFF\xFF", frame, len);
+}
+
+static void Dense_Receive(int id, const uint8_t *from, const uint8_t *data, int len) {
+  (void)from;
+  dense_node_t *node = &dense[meshIndex[id]];
+  message_t packet;
+  if(len <= 0 || Wire_Is_Fragment(data, (size_t)len) || !Wire_Decode(data, (size_t)len, &packet)) {
+    return;
+  }
+  if(Flood_Is_Broadcast(packet.destination_mac)) {
+    Flood_On_Receive(&node->flood, &packet, (uint32_t)Sim_Now_Us(), (uint32_t)(Sim_Now_Us() / 1000));
+  } else if(packet.Path_Exist && memcmp(packet.destination_mac, Sim_Node_MAC(id), 6) != 0 && packet.Path_Index + 1 < MAX_NODES) {
+    // Gateway Ack Routed Back along the Flood's Path
+    packet.Path_Index++;
+    Mesh_Send(id, packet.Path_Array[packet.Path_Index], &packet, NULL);
+  }
+}
+
+// Nodes at random spots, linked within range; the gateway sits in the middle
+static void Build_Dense(int gateway) {
+  std::vector<float> x(1, 0.5f), y(1, 0.5f);
+  std::vector<int> ids(1, gateway);
+  dense.reserve(options.dense);
+  for(int i = 0; i < options.dense; i++) {
+    uint8_t mac[6] = {0x02, 0x00, 0x00, 0x01, (uint8_t)(i >> 8), (uint8_t)i};
+    dense_node_t node = {};
+    node.id = Sim_Add_Node(mac, Dense_Receive, NULL);
+    node.source = i < options.sources;
+    node.nextFlood = (uint64_t)(Sim_Random() % (options.intervalMs * 1000));
+    node.nextID = (int32_t)Sim_Random();
+    if((int)meshIndex.size() <= node.id) {
+      meshIndex.resize(node.id + 1, -1);
+    }
+    meshIndex[node.id] = (int)dense.size();
+    dense.push_back(node);
+    dense_node_t *added = &dense.back();
+    Dedup_Init(&added->seen);
+    Flood_Init(&added->flood, Dense_Broadcast, (void *)(intptr_t)added->id, mac, &added->seen);
+    added->flood.k = (uint8_t)options.floodK;
+    added->flood.jitterUs = options.floodJitterUs;
+    x.push_back(Sim_Uniform());
+    y.push_back(Sim_Uniform());
+    ids.push_back(node.id);
+  }
+  for(size_t a = 0; a < ids.size(); a++) {
+    for(size_t b = a + 1; b < ids.size(); b++) {
+      float d = hypotf(x[a] - x[b], y[a] - y[b]);
+      if(d <= options.range) {
+        sim_link_t link = {options.loss, options.latencyUs, options.jitterUs, (int8_t)(-50 - 40 * d / options.range)};
+        Sim_Connect(ids[a], ids[b], &link);
+      }
+    }
+  }
+}
+
+// Start due floods and run every node's rebroadcast timers
+static void Dense_Tick(uint64_t now) {
+  for(auto &node : dense) {
+    if(node.source && now >= node.nextFlood) {
+      message_t packet;
+      memset(&packet, 0, sizeof(packet));
+      snprintf((char *)packet.text, sizeof(packet.text), "Flood %u from node %d", (unsigned)node.flood.stats.originated, node.id);
+      packet.TTL = options.ttl;
+      packet.identification = 2;
+      packet.packetID = node.nextID++;
+      memcpy(packet.destination_mac, "\xFF\xFF\xFF\xFF\xFF\xFF", 6);
+      memcpy(packet.source_mac, Sim_Node_MAC(node.id), 6);
+      memcpy(packet.Path_Array[0], Sim_Node_MAC(node.id), 6);
+      packet.Path_Index = 1;
+      packet.Path_Length = 1;
+      Flood_Originate(&node.flood, &packet, (uint32_t)(now / 1000));
+      node.nextFlood = now + (uint64_t)options.intervalMs * 1000;
+    }
+    Flood_Poll(&node.flood, (uint32_t)now);
+  }
+}
+
+static void Dense_Report(double cpuSeconds) {
+  flood_stats_t total = flooding.stats;
+  uint32_t originated = 0, reached = 0;
+  for(auto &node : dense) {
+    originated += node.flood.stats.originated;
+    reached += node.flood.stats.delivered;
+    total.duplicates += node.flood.stats.duplicates;
+    total.expired += node.flood.stats.expired;
+    total.rebroadcasts += node.flood.stats.rebroadcasts;
+    total.suppressed += node.flood.stats.suppressed;
+    total.overflow += node.flood.stats.overflow;
+  }
+  reached += flooding.stats.delivered;
+  const sim_stats_t *radio = Sim_Get_Stats();
+  uint64_t expected = (uint64_t)originated * (uint64_t)options.dense; // Every Other Node, Gateway Included
+
+  printf("sim.dense=%d\nsim.range=%.3f\nsim.loss=%.3f\nsim.collisions=%d\nsim.duration_s=%u\n", options.dense, options.range,
+         options.loss, options.collisions, (unsigned)options.durationS);
+  printf("flood.ttl=%d\nflood.k=%d\nflood.jitter_us=%u\n", options.ttl, options.floodK, (unsigned)options.floodJitterUs);
+  printf("flood.originated=%u\nflood.rebroadcasts=%u\nflood.suppressed=%u\nflood.expired=%u\nflood.overflow=%u\nflood.duplicates=%u\n",
+         (unsigned)originated, (unsigned)total.rebroadcasts, (unsigned)total.suppressed, (unsigned)total.expired, (unsigned)total.overflow,
+         (unsigned)total.duplicates);
+  printf("flood.tx_per_flood=%.2f\n", originated ? (double)(originated + total.rebroadcasts) / originated : 0.0);
+  printf("flood.coverage=%.4f\nflood.gateway_delivery=%.4f\n", expected ? (double)reached / expected : 0.0,
+         originated ? (double)flooding.stats.delivered / originated : 0.0);
+  printf("radio.frames=%llu\nradio.lost=%llu\nradio.collided=%llu\n", (unsigned long long)radio->frames,
+         (unsigned long long)radio->lost, (unsigned long long)radio->collided);
+  printf("uplink.records=%u\n", (unsigned)Uplink_Get_Stats()->records);
+  printf("host.cpu_s=%.3f\n", cpuSeconds);
+}
+
+static void Usage(const char *argv0) {
+  printf("usage: %s [--sources N] [--hops H] [--paths N] [--loss P] [--loss-spread P] [--latency US] [--jitter US]\n"
+         "          [--interval MS] [--ack-timeout MS] [--window N] [--tries N]\n"
+         "          [--payload BYTES] [--no-fragment] [--numeric] [--aggregate-ms MS] [--aggregate-count N]\n"
+         "          [--raw N] [--compress] [--capture FILE] [--duration S] [--seed N] [--server] [--metrics]\n"
+         "          [--collisions] [--commands MS] [--alarm N] [--bulk N] [--alarm-interval MS] [--post-ms MS]\n"
+         "          [--tdma] [--slot-us US] [--transport http|udp] [--verbose]\n"
+         "       %s --dense N [--range R] [--ttl N] [--flood-k N] [--flood-jitter US] [--sources N] [--interval MS]\n"
+         "          [--loss P] [--collisions] [--duration S] [--seed N]\n"
+         "       %s --replay FILE [--replay-fast] [--compress] [--server] [--metrics] [--verbose]\n"
+         "       %s --uplink-bench N [--transport http|udp] [--rtt-us US] [--compress]\n"
+         "       %s --microbench [--baseline FILE] [--results FILE] [--tolerance PCT] [--seed N]\n", argv0, argv0, argv0, argv0,
+         argv0);
+}
+
+static bool Parse_Options(int argc, char **argv) {
+  for(int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if(strcmp(arg, "--server") == 0) {
+      options.server = true;
+    } else if(strcmp(arg, "--no-fragment") == 0) {
+      options.fragment = false;
+    } else if(strcmp(arg, "--numeric") == 0) {
+      options.numeric = true;
+    } else if(strcmp(arg, "--compress") == 0) {
+      options.compress = true;
+    } else if(strcmp(arg, "--replay-fast") == 0) {
+      options.replayFast = true;
+    } else if(strcmp(arg, "--metrics") == 0) {
+      options.metrics = true;
+    } else if(strcmp(arg, "--collisions") == 0) {
+      options.collisions = true;
+    } else if(strcmp(arg, "--tdma") == 0) {
+      options.tdma = true;
+    } else if(strcmp(arg, "--verbose") == 0) {
+      options.verbose = true;
+    } else if(strcmp(arg, "--microbench") == 0) {
+      options.microbench = true;
+    } else if(value == NULL) {
+      return false;
+    } else if(strcmp(arg, "--sources") == 0) {
+      options.sources = atoi(value), i++;
+    } else if(strcmp(arg, "--hops") == 0) {
+      options.hops = atoi(value), i++;
+    } else if(strcmp(arg, "--paths") == 0) {
+      options.paths = atoi(value), i++;
+    } else if(strcmp(arg, "--dense") == 0) {
+      options.dense = atoi(value), i++;
+    } else if(strcmp(arg, "--range") == 0) {
+      options.range = (float)atof(value), i++;
+    } else if(strcmp(arg, "--ttl") == 0) {
+      options.ttl = atoi(value), i++;
+    } else if(strcmp(arg, "--flood-k") == 0) {
+      options.floodK = atoi(value), i++;
+    } else if(strcmp(arg, "--flood-jitter") == 0) {
+      options.floodJitterUs = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--loss") == 0) {
+      options.loss = (float)atof(value), i++;
+    } else if(strcmp(arg, "--loss-spread") == 0) {
+      options.lossSpread = (float)atof(value), i++;
+    } else if(strcmp(arg, "--latency") == 0) {
+      options.latencyUs = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--jitter") == 0) {
+      options.jitterUs = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--interval") == 0) {
+      options.intervalMs = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--ack-timeout") == 0) {
+      options.ackTimeoutMs = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--window") == 0) {
+      options.window = atoi(value), i++;
+    } else if(strcmp(arg, "--tries") == 0) {
+      options.tries = atoi(value), i++;
+    } else if(strcmp(arg, "--payload") == 0) {
+      options.payload = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--aggregate-ms") == 0) {
+      options.aggregateMs = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--aggregate-count") == 0) {
+      options.aggregateCount = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--raw") == 0) {
+      options.raw = atoi(value), i++;
+    } else if(strcmp(arg, "--capture") == 0) {
+      options.capture = value, i++;
+    } else if(strcmp(arg, "--replay") == 0) {
+      options.replay = value, i++;
+    } else if(strcmp(arg, "--duration") == 0) {
+      options.durationS = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--commands") == 0) {
+      options.commandMs = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--alarm") == 0) {
+      options.alarm = atoi(value), i++;
+    } else if(strcmp(arg, "--bulk") == 0) {
+      options.bulk = atoi(value), i++;
+    } else if(strcmp(arg, "--alarm-interval") == 0) {
+      options.alarmIntervalMs = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--post-ms") == 0) {
+      options.postMs = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--slot-us") == 0) {
+      options.slotUs = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--transport") == 0) {
+      if(strcmp(value, "http") != 0 && strcmp(value, "udp") != 0) {
+        return false;
+      }
+      options.transport = strcmp(value, "udp") == 0 ? UPLINK_UDP : UPLINK_HTTP, i++;
+    } else if(strcmp(arg, "--uplink-bench") == 0) {
+      options.benchRecords = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--rtt-us") == 0) {
+      options.rttUs = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--baseline") == 0) {
+      options.baseline = value, i++;
+    } else if(strcmp(arg, "--results") == 0) {
+      options.results = value, i++;
+    } else if(strcmp(arg, "--tolerance") == 0) {
+      options.tolerance = (uint32_t)atol(value), i++;
+    } else if(strcmp(arg, "--seed") == 0) {
+      options.seed = (uint32_t)atol(value), i++;
+    } else {
+      return false;
+    }
+  }
+  // Path_Array holds the source, every relay and the gateway
+  return options.sources > 0 && options.hops >= 1 && options.hops < MAX_NODES && options.paths >= 1 && options.intervalMs > 0 &&
+         options.window >= 1 && options.window <= RELIABLE_WINDOW && options.tries >= 1 && options.tries <= MAX_TRIES &&
+         options.payload <= REASSEMBLY_MAX_BYTES && options.dense >= 0 && options.range > 0.0f && options.ttl >= 1 &&
+         options.ttl < MAX_NODES && options.floodK >= 0 && options.floodK <= 255 && (options.dense == 0 || options.sources <= options.dense) &&
+         options.alarm >= 0 && options.bulk >= 0 && options.alarm + options.bulk <= options.sources && options.slotUs > 0;
+}
+
+static uint32_t Percentile(std::vector<uint32_t> &sorted, double p) {
+  if(sorted.empty()) {
+    return 0;
+  }
+  size_t rank = (size_t)(p * (sorted.size() - 1) + 0.5);
+  return sorted[rank];
+}
+
+static void Report(double cpuSeconds) {
+  uint32_t generated = 0, backlog = 0, sent = 0, acked = 0, failed = 0, retransmits = 0;
+  uint64_t ackedBytes = 0;
+  for(auto &node : mesh) {
+    if(!node.source) {
+      continue;
+    }
+    generated += node.generated;
+    backlog += node.backlog;
+    sent += node.reliable.stats.sent;
+    acked += node.reliable.stats.acked;
+    failed += node.reliable.stats.failed;
+    retransmits += node.reliable.stats.retransmits;
+    ackedBytes += node.ackedBytes;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  uint64_t sum = 0;
+  for(uint32_t l : latencies) {
+    sum += l;
+  }
+
+  const sim_stats_t *radio = Sim_Get_Stats();
+  const uplink_stats_t *uplink = Uplink_Get_Stats();
+
+  printf("sim.sources=%d\nsim.hops=%d\nsim.paths=%d\nsim.loss=%.3f\nsim.loss_spread=%.3f\nsim.duration_s=%u\n", options.sources, options.hops,
+         options.paths, options.loss, options.lossSpread, (unsigned)options.durationS);
+  printf("sim.window=%d\nsim.tries=%d\n", options.window, options.tries);
+  printf("data.generated=%u\ndata.backlog=%u\ndata.sent=%u\ndata.acked=%u\ndata.failed=%u\ndata.retransmits=%u\n",
+         (unsigned)generated, (unsigned)backlog, (unsigned)sent, (unsigned)acked, (unsigned)failed, (unsigned)retransmits);
+  printf("delivery_ratio=%.4f\n", sent ? (double)acked / sent : 0.0);
+  printf("goodput_pps=%.2f\n", (double)acked / options.durationS);
+  const reassembly_stats_t *reassembly = Reassembly_Get_Stats();
+  bool fragmented = options.payload > 0 && options.fragment;
+  uint64_t delivered = fragmented ? reassembly->completedBytes : ackedBytes; // Whole payloads only when fragmented
+  printf("payload.bytes=%u\npayload.fragmented=%d\npayload.acked_bytes=%llu\ngoodput_Bps=%.0f\n", (unsigned)options.payload,
+         fragmented, (unsigned long long)ackedBytes, (double)delivered / options.durationS);
+  printf("reassembly.completed=%u\nreassembly.bytes=%u\nreassembly.duplicates=%u\nreassembly.timed_out=%u\nreassembly.evicted=%u\n",
+         (unsigned)reassembly->completed, (unsigned)reassembly->completedBytes, (unsigned)reassembly->duplicates,
+         (unsigned)reassembly->timedOut, (unsigned)reassembly->evicted);
+  printf("latency_us.mean=%.0f\nlatency_us.p50=%u\nlatency_us.p99=%u\nlatency_us.max=%u\n",
+         latencies.empty() ? 0.0 : (double)sum / latencies.size(), (unsigned)Percentile(latencies, 0.50),
+         (unsigned)Percentile(latencies, 0.99), latencies.empty() ? 0u : (unsigned)latencies.back());
+  printf("radio.frames=%llu\nradio.bytes=%llu\nradio.lost=%llu\nradio.collided=%llu\nradio.no_route=%llu\n",
+         (unsigned long long)radio->frames, (unsigned long long)radio->bytes, (unsigned long long)radio->lost,
+         (unsigned long long)radio->collided, (unsigned long long)radio->noRoute);
+  printf("uplink.records=%u\nuplink.batches=%u\nuplink.failures=%u\nhttp.posts=%u\n",
+         (unsigned)uplink->records, (unsigned)uplink->batches, (unsigned)uplink->failures, (unsigned)Hal_Native_Http_Posts());
+  const route_cache_stats_t *routes = Route_Cache_Get_Stats();
+  printf("route.candidates=%d\nroute.hits=%u\nroute.misses=%u\nroute.evictions=%u\nroute.switches=%u\nroute.acks_lost=%u\n", ROUTE_CANDIDATES,
+         (unsigned)routes->hits, (unsigned)routes->misses, (unsigned)routes->evictions, (unsigned)routes->switches, (unsigned)routes->acksLost);
+  printf("link.samples=%u\n", (unsigned)Link_Get_Stats()->samples);
+  const aggregate_stats_t *aggregate = Aggregate_Get_Stats();
+  printf("aggregate.readings=%u\naggregate.summaries=%u\naggregate.raw=%u\naggregate.lost=%u\n", (unsigned)aggregate->readings,
+         (unsigned)aggregate->summaries, (unsigned)aggregate->raw, (unsigned)aggregate->lost);
+  const compress_stats_t *compress = Compress_Get_Stats();
+  printf("compress.batches=%u\ncompress.skipped=%u\ncompress.bytes_in=%llu\ncompress.bytes_out=%llu\ncompress.ratio=%.3f\n",
+         (unsigned)compress->batches, (unsigned)compress->skipped, (unsigned long long)compress->bytesIn,
+         (unsigned long long)compress->bytesOut, compress->bytesIn ? (double)compress->bytesOut / compress->bytesIn : 0.0);
+  const peer_cache_stats_t *peers = Peer_Cache_Get_Stats();
+  printf("peer.registered=%d\npeer.hits=%u\npeer.registrations=%u\npeer.evictions=%u\npeer.failures=%u\n", Peer_Cache_Registered(),
+         (unsigned)peers->hits, (unsigned)peers->registrations, (unsigned)peers->evictions, (unsigned)peers->failures);
+  const log_stats_t *logs = Log_Get_Stats();
+  printf("log.level=%d\nlog.written=%u\nlog.dropped=%u\n", LOG_LEVEL, (unsigned)logs->written, (unsigned)logs->dropped);
+  printf("host.cpu_s=%.3f\n", cpuSeconds);
+}
+
+// Stand-in server: one kept-open connection to the gateway's command port
+static bool Standin_Connect() {
+  standin.fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(COMMAND_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(standin.fd < 0 || connect(standin.fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    fprintf(stderr, "cannot connect to the command port %d\n", COMMAND_PORT);
+    return false;
+  }
+  fcntl(standin.fd, F_SETFL, fcntl(standin.fd, F_GETFL) | O_NONBLOCK);
+  int one = 1;
+  setsockopt(standin.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // No Nagle Wait Inside Virtual Time
+  standin.nextID = 1;
+  standin.nextCommand = (uint64_t)options.intervalMs * 1000; // Sources have Reported Once
+  return true;
+}
+
+// Send a due command to a random source, then read the gateway's reports
+static void Standin_Tick(uint64_t now) {
+  static const char *const names[] = {"delivered", "failed", "noroute", "busy", "malformed"};
+  if(now >= standin.nextCommand) {
+    std::vector<int> sources;
+    for(auto &node : mesh) {
+      if(node.source) {
+        sources.push_back(node.id);
+      }
+    }
+    const uint8_t *mac = Sim_Node_MAC(sources[Sim_Random() % sources.size()]);
+    char line[COMMAND_LINE_MAX + 2];
+    int n = snprintf(line, sizeof(line), "%u %02x:%02x:%02x:%02x:%02x:%02x SET relay %u\n", (unsigned)standin.nextID, mac[0], mac[1],
+                     mac[2], mac[3], mac[4], mac[5], (unsigned)(standin.nextID & 1));
+    if(send(standin.fd, line, (size_t)n, MSG_NOSIGNAL) == n) {
+      standin.sentAt[standin.nextID] = now;
+      standin.sent++;
+    }
+    standin.nextID++;
+    standin.nextCommand = now + (uint64_t)options.commandMs * 1000;
+  }
+
+  char chunk[512];
+  ssize_t n;
+  while((n = recv(standin.fd, chunk, sizeof(chunk), MSG_DONTWAIT)) > 0) {
+    standin.input.append(chunk, (size_t)n);
+  }
+  size_t end;
+  while((end = standin.input.find('\n')) != std::string::npos) {
+    std::string report = standin.input.substr(0, end);
+    standin.input.erase(0, end + 1);
+    unsigned id;
+    char status[16];
+    if(sscanf(report.c_str(), "%u %15s", &id, status) != 2) {
+      continue;
+    }
+    for(int i = 0; i <= COMMAND_MALFORMED; i++) {
+      if(strcmp(status, names[i]) == 0) {
+        standin.outcomes[i]++;
+        auto sent = standin.sentAt.find(id);
+        if(i == COMMAND_DELIVERED && sent != standin.sentAt.end()) {
+          standin.latencies.push_back((uint32_t)(now - sent->second));
+        }
+      }
+    }
+    standin.sentAt.erase(id);
+  }
+}
+
+static void Standin_Report() {
+  std::sort(standin.latencies.begin(), standin.latencies.end());
+  uint64_t sum = 0;
+  for(uint32_t l : standin.latencies) {
+    sum += l;
+  }
+  printf("command.sent=%u\ncommand.delivered=%u\ncommand.failed=%u\ncommand.noroute=%u\ncommand.busy=%u\ncommand.malformed=%u\n",
+         (unsigned)standin.sent, (unsigned)standin.outcomes[COMMAND_DELIVERED], (unsigned)standin.outcomes[COMMAND_FAILED],
+         (unsigned)standin.outcomes[COMMAND_NO_ROUTE], (unsigned)standin.outcomes[COMMAND_BUSY],
+         (unsigned)standin.outcomes[COMMAND_MALFORMED]);
+  printf("command.unanswered=%u\ncommand.executed=%u\n", (unsigned)standin.sentAt.size(), (unsigned)standin.executed);
+  printf("command_latency_us.mean=%.0f\ncommand_latency_us.p50=%u\ncommand_latency_us.p99=%u\ncommand_latency_us.max=%u\n",
+         standin.latencies.empty() ? 0.0 : (double)sum / standin.latencies.size(), (unsigned)Percentile(standin.latencies, 0.50),
+         (unsigned)Percentile(standin.latencies, 0.99), standin.latencies.empty() ? 0u : (unsigned)standin.latencies.back());
+}
+
+// Readings uploaded and their latency per priority class
+static void Class_Report() {
+  static const char *const names[PRIORITY_CLASSES] = {"normal", "alarm", "bulk"};
+  CollectMetrics();
+  for(int c = 0; c < PRIORITY_CLASSES; c++) {
+    uint32_t sources = 0, generated = 0;
+    for(auto &node : mesh) {
+      if(node.source && node.priority == c) {
+        sources++;
+        generated += node.generated;
+      }
+    }
+    if(sources == 0) {
+      continue;
+    }
+    std::vector<uint32_t> &l = classLatencies[c];
+    std::sort(l.begin(), l.end());
+    printf("class.%s.sources=%u\nclass.%s.generated=%u\nclass.%s.uploaded=%u\n", names[c], (unsigned)sources, names[c],
+           (unsigned)generated, names[c], (unsigned)l.size());
+    printf("class.%s.latency_us.p50=%u\nclass.%s.latency_us.p99=%u\nclass.%s.latency_us.max=%u\n", names[c],
+           (unsigned)Percentile(l, 0.50), names[c], (unsigned)Percentile(l, 0.99), names[c], l.empty() ? 0u : (unsigned)l.back());
+  }
+  std::sort(captureErrors.begin(), captureErrors.end());
+  uint32_t synced = 0;
+  for(auto &node : mesh) {
+    synced += node.tdma.synced;
+  }
+  printf("tdma.enabled=%d\ntdma.slot_us=%u\ntdma.beacons=%u\ntdma.slots=%d\ntdma.synced_nodes=%u\n", options.tdma,
+         (unsigned)tdma.slotUs, (unsigned)tdma.stats.beacons, Tdma_Active(&tdma), (unsigned)synced);
+  printf("capture_error_us.p50=%u\ncapture_error_us.p99=%u\ncapture_error_us.max=%u\n", (unsigned)Percentile(captureErrors, 0.50),
+         (unsigned)Percentile(captureErrors, 0.99), captureErrors.empty() ? 0u : (unsigned)captureErrors.back());
+  printf("http.post_ms=%u\nrx.dropped=%u\nuplink.queue_dropped=%u\n", (unsigned)options.postMs, (unsigned)Metrics_Get(METRIC_RX_DROPPED),
+         (unsigned)Metrics_Get(METRIC_UPLINK_QUEUE_DROPPED));
+}
+
+static void Scrape_Metrics() {
+  static char scrape[HAL_HTTP_RESPONSE_MAX];
+  const char *contentType;
+  size_t len = Serve_Metrics("/metrics", scrape, sizeof(scrape), &contentType);
+  fwrite(scrape, 1, len, stdout);
+}
+
+static size_t Capture_File_Write(const uint8_t *data, size_t len) {
+  return fwrite(data, 1, len, captureFile);
+}
+
+// Feed a capture to the gateway. Virtual time follows the recorded spacing unless replayFast
+static int Replay(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if(file == NULL) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+  std::vector<uint8_t> capture;
+  uint8_t chunk[4096];
+  size_t n;
+  while((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    capture.insert(capture.end(), chunk, chunk + n);
+  }
+  fclose(file);
+
+  uint8_t capturedMac[MAC_SIZE];
+  if(!Capture_Check_Header(capture.data(), capture.size(), capturedMac)) {
+    fprintf(stderr, "%s is not a capture\n", path);
+    return 1;
+  }
+
+  Sim_Reset(options.seed);
+  Serial.enabled = options.verbose;
+  Hal_Native_Http_Sink(!options.server);
+  Hal_Native_Set_MAC(capturedMac); // Answer as the Captured Gateway
+  setup();
+  tdma.beaconMs = 0; // No Mesh to Sync
+  uplinkCompress = options.compress;
+
+  uint64_t now = 0;
+  uint32_t frames = 0;
+  size_t offset = CAPTURE_HEADER_SIZE;
+  capture_frame_t frame;
+  clock_t cpuStart = clock();
+
+  size_t used;
+  while((used = Capture_Parse(&capture[offset], capture.size() - offset, &frame)) > 0) {
+    offset += used;
+    if(options.replayFast) {
+      now += SIM_TICK_US;
+      Sim_Run_Until(now);
+    } else {
+      uint64_t due = now + (frames > 0 ? frame.deltaUs : 0);
+      while(now + SIM_TICK_US <= due) {
+        now += SIM_TICK_US;
+        Sim_Run_Until(now);
+        loop();
+      }
+      now = due;
+      Sim_Run_Until(now);
+    }
+    On_Data_Receive(frame.mac, frame.data, frame.len);
+    frames++;
+    if(options.replayFast) {
+      loop();
+    }
+  }
+  // Let queued frames and the uplink batch settle
+  for(int i = 0; i < 100; i++) {
+    now += SIM_TICK_US;
+    Sim_Run_Until(now);
+    loop();
+  }
+  Aggregate_Flush(Hal_Millis());
+  Uplink_Flush(UPLINK_FLUSH_FORCED);
+  double cpuSeconds = (double)(clock() - cpuStart) / CLOCKS_PER_SEC;
+
+  CollectMetrics();
+  const uplink_stats_t *uplink = Uplink_Get_Stats();
+  printf("replay.file=%s\nreplay.fast=%d\nreplay.frames=%u\nreplay.trailing_bytes=%u\nreplay.virtual_s=%.3f\n", path,
+         options.replayFast, (unsigned)frames, (unsigned)(capture.size() - offset), now / 1e6);
+  printf("rx.frames=%u\nrx.malformed=%u\nrx.dropped=%u\nrx.duplicates=%u\n", (unsigned)Metrics_Get(METRIC_RX_FRAMES),
+         (unsigned)Metrics_Get(METRIC_RX_MALFORMED), (unsigned)Metrics_Get(METRIC_RX_DROPPED), (unsigned)Metrics_Get(METRIC_DUPLICATES));
+  printf("reassembly.completed=%u\nuplink.records=%u\nuplink.batches=%u\n", (unsigned)Reassembly_Get_Stats()->completed,
+         (unsigned)uplink->records, (unsigned)uplink->batches);
+  printf("host.cpu_s=%.3f\nhost.frames_per_s=%.0f\n", cpuSeconds, cpuSeconds > 0 ? frames / cpuSeconds : 0.0);
+
+  if(options.metrics) {
+    Scrape_Metrics();
+  }
+  return 0;
+}
+
+static uint64_t Wall_Us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static double Thread_Cpu_Seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Note the first arrival of each bench reading in a batch body (JSON text records)
+static void Receiver_Readings(const uint8_t *body, size_t len, uint64_t now) {
+  static const char marker[] = "Reading ";
+  const uint8_t *p = body, *end = body + len;
+  std::lock_guard<std::mutex> guard(receiver.lock);
+  while((p = (const uint8_t *)memmem(p, (size_t)(end - p), marker, sizeof(marker) - 1)) != NULL) {
+    p += sizeof(marker) - 1;
+    unsigned reading = (unsigned)strtoul((const char *)p, NULL, 10);
+    if(reading < receiver.arrivals.size() && receiver.arrivals[reading] == 0) {
+      receiver.arrivals[reading] = now;
+      receiver.arrived++;
+    }
+  }
+}
+
+// Whole requests in the HTTP buffer: note readings, queue a 200 for each
+static void Receiver_Http(uint64_t now) {
+  for(;;) {
+    size_t head = receiver.request.find("\r\n\r\n");
+    if(head == std::string::npos) {
+      return;
+    }
+    size_t length = 0;
+    size_t field = receiver.request.find("Content-Length:");
+    if(field != std::string::npos && field < head) {
+      length = strtoul(receiver.request.c_str() + field + 15, NULL, 10);
+    }
+    if(receiver.request.size() < head + 4 + length) {
+      return;
+    }
+    Receiver_Readings((const uint8_t *)receiver.request.data() + head + 4, length, now);
+    receiver.requests++;
+    receiver.request.erase(0, head + 4 + length);
+
+    static const char ok[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+    reply_t reply = {};
+    reply.due = now + options.rttUs;
+    reply.fd = receiver.clientFd;
+    reply.len = sizeof(ok) - 1; // Text Filled in when Sent
+    receiver.replies.push_back(reply);
+  }
+}
+
+// One datagram: hold it once, ack the session's cumulative seq
+static void Receiver_Datagram(const uint8_t *data, size_t len, const struct sockaddr_in *from, uint64_t now) {
+  if(len < DATAGRAM_HEADER_SIZE || (data[0] != DATAGRAM_DATA && data[0] != DATAGRAM_SKIP)) {
+    return;
+  }
+  uint32_t session, seq, floor;
+  memcpy(&session, &data[2], 4); // Little-Endian Host
+  memcpy(&seq, &data[6], 4);
+  memcpy(&floor, &data[10], 4);
+  receiver.requests++;
+  if(session != receiver.session) {
+    receiver.session = session; // Gateway (or this Receiver) Restarted: Start at the Floor
+    receiver.cumulative = floor;
+    receiver.ahead.clear();
+  } else if(floor > receiver.cumulative) {
+    receiver.cumulative = floor; // Seqs the Gateway Gave up on: Step over them
+    receiver.ahead.erase(receiver.ahead.begin(), receiver.ahead.upper_bound(floor));
+  }
+  if(data[0] != DATAGRAM_DATA) {
+    // A Skip only Moves the Floor
+  } else if(seq <= receiver.cumulative || !receiver.ahead.insert(seq).second) {
+    receiver.repeats++;
+  } else {
+    Receiver_Readings(data + DATAGRAM_HEADER_SIZE, len - DATAGRAM_HEADER_SIZE, now);
+  }
+  while(!receiver.ahead.empty() && *receiver.ahead.begin() == receiver.cumulative + 1) {
+    receiver.cumulative++;
+    receiver.ahead.erase(receiver.ahead.begin());
+  }
+
+  reply_t reply = {};
+  reply.due = now + options.rttUs;
+  reply.fd = receiver.udpFd;
+  reply.datagram = true;
+  reply.to = *from;
+  reply.data[0] = DATAGRAM_ACK;
+  memcpy(&reply.data[2], &session, 4);
+  memcpy(&reply.data[6], &receiver.cumulative, 4);
+  reply.len = DATAGRAM_ACK_SIZE;
+  receiver.replies.push_back(reply);
+}
+
+static void Receiver_Run() {
+  static uint8_t buffer[65536];
+  while(!receiver.stop) {
+    uint64_t now = Wall_Us();
+    while(!receiver.replies.empty() && receiver.replies.front().due <= now) {
+      reply_t &reply = receiver.replies.front();
+      if(reply.datagram) {
+        sendto(reply.fd, reply.data, reply.len, 0, (struct sockaddr *)&reply.to, sizeof(reply.to));
+      } else if(reply.fd == receiver.clientFd) {
+        send(reply.fd, "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n", reply.len, MSG_NOSIGNAL);
+      }
+      receiver.replies.pop_front();
+    }
+
+    struct pollfd fds[3] = {{receiver.listenFd, POLLIN, 0}, {receiver.udpFd, POLLIN, 0}, {receiver.clientFd, POLLIN, 0}};
+    int wait = receiver.replies.empty() ? 10 : 0; // Replies Due Soon: Spin
+    if(poll(fds, receiver.clientFd >= 0 ? 3 : 2, wait) <= 0) {
+      continue;
+    }
+    now = Wall_Us();
+    if(fds[0].revents & POLLIN) {
+      int fd = accept(receiver.listenFd, NULL, NULL);
+      if(fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if(receiver.clientFd >= 0) {
+          close(receiver.clientFd);
+        }
+        receiver.clientFd = fd;
+        receiver.request.clear();
+      }
+    }
+    if(fds[1].revents & POLLIN) {
+      struct sockaddr_in from;
+      socklen_t fromLen = sizeof(from);
+      ssize_t n;
+      while((n = recvfrom(receiver.udpFd, buffer, sizeof(buffer), MSG_DONTWAIT, (struct sockaddr *)&from, &fromLen)) > 0) {
+        receiver.bytes += (uint64_t)n;
+        Receiver_Datagram(buffer, (size_t)n, &from, now);
+        fromLen = sizeof(from);
+      }
+    }
+    if(receiver.clientFd >= 0 && (fds[2].revents & (POLLIN | POLLHUP))) {
+      ssize_t n = recv(receiver.clientFd, buffer, sizeof(buffer), MSG_DONTWAIT);
+      if(n <= 0) {
+        close(receiver.clientFd);
+        receiver.clientFd = -1;
+      } else {
+        receiver.bytes += (uint64_t)n;
+        receiver.request.append((const char *)buffer, (size_t)n);
+        Receiver_Http(now);
+      }
+    }
+  }
+}
+
+// HTTP on SERVER_URL's port, datagrams on UPLINK_UDP_PORT
+static bool Receiver_Start(uint32_t readings) {
+  int httpPort = 0;
+  if(sscanf(SERVER_URL, "http://%*[^:]:%d", &httpPort) != 1) {
+    fprintf(stderr, "SERVER_URL has no port\n");
+    return false;
+  }
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  int on = 1;
+
+  receiver.listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  setsockopt(receiver.listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  addr.sin_port = htons((uint16_t)httpPort);
+  if(receiver.listenFd < 0 || bind(receiver.listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(receiver.listenFd, 4) != 0) {
+    fprintf(stderr, "cannot listen on port %d\n", httpPort);
+    return false;
+  }
+  receiver.udpFd = socket(AF_INET, SOCK_DGRAM, 0);
+  addr.sin_port = htons(UPLINK_UDP_PORT);
+  if(receiver.udpFd < 0 || bind(receiver.udpFd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    fprintf(stderr, "cannot bind port %d\n", UPLINK_UDP_PORT);
+    return false;
+  }
+  int room = 1 << 22;
+  setsockopt(receiver.udpFd, SOL_SOCKET, SO_RCVBUF, &room, sizeof(room)); // Batches up to 8 KB each
+
+  receiver.clientFd = -1;
+  receiver.arrivals.assign(readings, 0);
+  receiver.stop = false;
+  receiver.thread = std::thread(Receiver_Run);
+  return true;
+}
+
+static void Receiver_Stop() {
+  receiver.stop = true;
+  receiver.thread.join();
+}
+
+// Push records through the uplink stage as fast as the transport takes them
+static int Uplink_Bench() {
+  uint32_t records = options.benchRecords;
+  Sim_Reset(options.seed);
+  Serial.enabled = options.verbose;
+  Hal_Native_Http_Sink(false);
+  Hal_Native_Set_MAC(gatewayMac);
+  if(!Receiver_Start(records)) {
+    return 1;
+  }
+  uplinkTransport = options.transport;
+  setup();
+  tdma.beaconMs = 0; // No Mesh
+  uplinkCompress = options.compress;
+
+  // A relayed reading: source, two relays, gateway
+  message_t record;
+  memset(&record, 0, sizeof(record));
+  record.TTL = 8;
+  record.identification = 2;
+  uint8_t source[MAC_SIZE] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x07};
+  memcpy(record.source_mac, source, MAC_SIZE);
+  memcpy(record.destination_mac, gatewayMac, MAC_SIZE);
+  for(int i = 0; i < 4; i++) {
+    memcpy(record.Path_Array[i], i == 3 ? gatewayMac : source, MAC_SIZE);
+    record.Path_Array[i][4] = (uint8_t)i;
+  }
+  record.Path_Index = 3;
+  record.Path_Length = 3;
+  record.Path_Exist = true;
+
+  std::vector<uint64_t> queuedAt(records);
+  uint32_t queued = 0;
+  uint64_t start = Wall_Us(), lastArrival = start;
+  double cpuStart = Thread_Cpu_Seconds();
+  uint32_t arrived = 0;
+  while(arrived < records && Wall_Us() - lastArrival < 2000000) {
+    Sim_Run_Until(Wall_Us() - start); // Gateway Clock Follows the Wall Clock
+    if(queued < records && Uplink_Transport_Ready()) {
+      snprintf((char *)record.text, sizeof(record.text), "Reading %u from node 7", (unsigned)queued);
+      record.packetID = (int32_t)queued;
+      record.captured = Hal_Millis();
+      queuedAt[queued] = Wall_Us();
+      QueueUplink(&record, NULL, 0);
+      if(++queued == records) {
+        loop();
+        Uplink_Flush(UPLINK_FLUSH_FORCED); // No Deadline Wait for the Last Batch
+      }
+    } else {
+      usleep(50); // Waiting on the Receiver: Idle, as the Uplink Task Blocks on Device
+    }
+    loop();
+    std::lock_guard<std::mutex> guard(receiver.lock);
+    if(receiver.arrived != arrived) {
+      arrived = receiver.arrived;
+      lastArrival = Wall_Us();
+    }
+  }
+  double cpu = Thread_Cpu_Seconds() - cpuStart;
+  Receiver_Stop();
+
+  std::vector<uint32_t> latency;
+  uint64_t last = start;
+  for(uint32_t i = 0; i < records; i++) {
+    if(receiver.arrivals[i] != 0) {
+      latency.push_back((uint32_t)(receiver.arrivals[i] - queuedAt[i]));
+      last = std::max(last, receiver.arrivals[i]);
+    }
+  }
+  std::sort(latency.begin(), latency.end());
+  double wall = (last - start) / 1e6;
+
+  printf("bench.transport=%s\nbench.rtt_us=%u\nbench.compress=%d\nbench.records=%u\nbench.arrived=%u\n",
+         options.transport == UPLINK_UDP ? "udp" : "http", (unsigned)options.rttUs, options.compress, (unsigned)records,
+         (unsigned)receiver.arrived);
+  printf("bench.wall_s=%.3f\nbench.records_per_s=%.0f\nbench.cpu_s=%.3f\nbench.cpu_us_per_record=%.2f\n", wall,
+         wall > 0 ? receiver.arrived / wall : 0.0, cpu, receiver.arrived ? cpu * 1e6 / receiver.arrived : 0.0);
+  printf("bench.latency_us.p50=%u\nbench.latency_us.p99=%u\nbench.latency_us.max=%u\n", (unsigned)Percentile(latency, 0.50),
+         (unsigned)Percentile(latency, 0.99), latency.empty() ? 0u : (unsigned)latency.back());
+  printf("bench.requests=%u\nbench.bytes=%llu\nbench.bytes_per_record=%.1f\nuplink.batches=%u\n", (unsigned)receiver.requests,
+         (unsigned long long)receiver.bytes, receiver.arrived ? (double)receiver.bytes / receiver.arrived : 0.0,
+         (unsigned)Uplink_Get_Stats()->batches);
+  printf("datagram.sent=%u\ndatagram.acked=%u\ndatagram.resent=%u\ndatagram.failed=%u\ndatagram.resyncs=%u\ndatagram.repeats=%u\n",
+         (unsigned)datagrams.stats.sent, (unsigned)datagrams.stats.acked, (unsigned)datagrams.stats.resent,
+         (unsigned)datagrams.stats.failed, (unsigned)datagrams.stats.resyncs, (unsigned)receiver.repeats);
+  return receiver.arrived == records ? 0 : 1;
+}
+
+// Take due readings and send what the windows allow, as of now
+static void Mesh_Tick(uint64_t now) {
+  Sim_Run_Until(now);
+
+  for(auto &node : mesh) {
+    uint32_t local = (uint32_t)now + node.clockOffset;
+    if(node.beaconAt != 0 && now >= node.beaconAt) {
+      Tdma_Node_Restamp(&node.tdma, &node.beacon, local);
+      uint8_t frame[ESPNOW_MTU];
+      size_t len = Wire_Encode_Beacon(&node.beacon, frame, sizeof(frame));
+      Sim_Send(node.id, (const uint8_t *)"\xFF\xFF\xFF\xFF\xFF\xFF", frame, len);
+      node.beaconAt = 0;
+    }
+    if(!node.source) {
+      continue;
+    }
+    if(now >= node.nextReading) {
+      uint32_t interval = node.priority == PRIORITY_ALARM && options.alarmIntervalMs > 0 ? options.alarmIntervalMs : options.intervalMs;
+      node.generated++;
+      node.backlog++;
+      node.readingAt.push_back(now);
+      node.nextReading = now + (uint64_t)interval * 1000;
+    }
+    if(options.tdma && !Tdma_Node_May_Send(&node.tdma, local)) {
+      continue; // Outside our Slot: Retransmits and New Readings Wait
+    }
+    Reliable_Poll(&node.reliable, (uint32_t)now);
+    while(node.backlog > 0 && Mesh_Send_Data(&node)) {
+    }
+  }
+
+  if(options.commandMs > 0) {
+    Standin_Tick(now);
+  }
+}
+
+// Built-in sink: the mesh runs on while the gateway waits out the POST, then each text reading in the batch is timed
+static int Sim_Post(const char *contentType, const char *contentEncoding, const uint8_t *body, size_t len) {
+  (void)contentType;
+  uint64_t done = simNow + (uint64_t)options.postMs * 1000;
+  while(simNow + SIM_TICK_US <= done && simNow < simEnd) {
+    simNow += SIM_TICK_US;
+    Mesh_Tick(simNow);
+  }
+  if(contentEncoding != NULL) {
+    return 200; // Compressed: Readings not Visible
+  }
+
+  static const char marker[] = "Reading ";
+  const uint8_t *p = body, *end = body + len;
+  while((p = (const uint8_t *)memmem(p, (size_t)(end - p), marker, sizeof(marker) - 1)) != NULL) {
+    p += sizeof(marker) - 1;
+    char text[48];
+    size_t n = (size_t)(end - p) < sizeof(text) - 1 ? (size_t)(end - p) : sizeof(text) - 1;
+    memcpy(text, p, n);
+    text[n] = '\0';
+    unsigned reading;
+    int id;
+    if(sscanf(text, "%u from node %d", &reading, &id) != 2 || id < 0 || id >= (int)meshIndex.size() || meshIndex[id] < 0) {
+      continue;
+    }
+    mesh_node_t *node = &mesh[meshIndex[id]];
+    if(reading < node->readingAt.size() && node->readingAt[reading] != 0) {
+      classLatencies[node->priority].push_back((uint32_t)(simNow - node->readingAt[reading]));
+      static const char key[] = "\"captured_ms\":";
+      const uint8_t *close = (const uint8_t *)memchr(p, '}', (size_t)(end - p));
+      const uint8_t *stamp = close != NULL ? (const uint8_t *)memmem(p, (size_t)(close - p), key, sizeof(key) - 1) : NULL;
+      if(stamp != NULL) {
+        int64_t error = (int64_t)strtoul((const char *)stamp + sizeof(key) - 1, NULL, 10) * 1000 - (int64_t)node->readingAt[reading];
+        captureErrors.push_back((uint32_t)(error < 0 ? -error : error));
+      }
+      node->readingAt[reading] = 0; // Counted Once
+    }
+  }
+  return 200;
+}
+
+int main(int argc, char **argv) {
+  if(!Parse_Options(argc, argv)) {
+    Usage(argv[0]);
+    return 2;
+  }
+  if(options.replay != NULL) {
+    return Replay(options.replay);
+  }
+  if(options.benchRecords > 0) {
+    return Uplink_Bench();
+  }
+  if(options.microbench) {
+    microbench_options_t microbench = {options.baseline, options.results, options.tolerance, options.seed};
+    return Microbench_Run(&microbench);
+  }
+
+  Sim_Reset(options.seed);
+  Sim_Set_Collisions(options.collisions);
+  Serial.enabled = options.verbose;
+  Hal_Native_Http_Sink(!options.server);
+  Hal_Native_Set_MAC(gatewayMac);
+  if(options.transport == UPLINK_UDP && !Receiver_Start(0)) {
+    return 1;
+  }
+  uplinkTransport = options.transport;
+
+  setup();
+  tdma.beaconMs = options.tdma ? tdma.beaconMs : 0; // Off unless Asked for (in --dense they would Count as Flood Traffic)
+  tdma.slotUs = options.slotUs;
+  if(options.dense > 0) {
+    Build_Dense(Hal_Native_Node());
+    flooding.k = (uint8_t)options.floodK;
+    flooding.jitterUs = options.floodJitterUs;
+    clock_t cpuStart = clock();
+    uint64_t end = (uint64_t)options.durationS * 1000000;
+    for(uint64_t now = 0; now < end; now += SIM_TICK_US) {
+      Sim_Run_Until(now);
+      Dense_Tick(now);
+      loop();
+    }
+    Uplink_Flush(UPLINK_FLUSH_FORCED);
+    Dense_Report((double)(clock() - cpuStart) / CLOCKS_PER_SEC);
+    return 0;
+  }
+  Build_Topology(Hal_Native_Node());
+  if(options.commandMs > 0 && !Standin_Connect()) {
+    return 1;
+  }
+  Aggregate_Configure(options.aggregateMs, options.aggregateCount);
+  uplinkCompress = options.compress;
+  if(options.capture != NULL) {
+    captureFile = fopen(options.capture, "wb");
+    if(captureFile == NULL) {
+      fprintf(stderr, "cannot create %s\n", options.capture);
+      return 1;
+    }
+    Capture_Init(Capture_File_Write, gatewayMac);
+    Capture_Start_Stream();
+  }
+  for(int i = 0, marked = 0; i < (int)mesh.size() && marked < options.raw; i++) {
+    if(mesh[i].source) {
+      Aggregate_Set_Passthrough(Sim_Node_MAC(mesh[i].id), true);
+      marked++;
+    }
+  }
+
+  clock_t cpuStart = clock();
+  simEnd = (uint64_t)options.durationS * 1000000;
+  Hal_Native_Http_Hook(Sim_Post);
+
+  for(simNow = 0; simNow < simEnd; simNow += SIM_TICK_US) {
+    Mesh_Tick(simNow);
+    loop();
+  }
+
+  Aggregate_Flush(Hal_Millis());
+  Uplink_Flush(UPLINK_FLUSH_FORCED);
+  if(options.transport == UPLINK_UDP) {
+    for(int i = 0; i < 1000 && Datagram_In_Flight(&datagrams) > 0; i++) {
+      usleep(100); // Last Acks, on the Wall Clock
+      Datagram_Poll(&datagrams, Hal_Millis());
+    }
+    Receiver_Stop();
+  }
+  Report((double)(clock() - cpuStart) / CLOCKS_PER_SEC);
+  Class_Report();
+  if(options.transport == UPLINK_UDP) {
+    printf("datagram.sent=%u\ndatagram.acked=%u\ndatagram.resent=%u\ndatagram.failed=%u\ndatagram.resyncs=%u\ndatagram.repeats=%u\n",
+           (unsigned)datagrams.stats.sent, (unsigned)datagrams.stats.acked, (unsigned)datagrams.stats.resent,
+           (unsigned)datagrams.stats.failed, (unsigned)datagrams.stats.resyncs, (unsigned)receiver.repeats);
+  }
+  if(options.commandMs > 0) {
+    Standin_Report();
+  }
+
+  if(captureFile != NULL) {
+    Capture_Drain();
+    fclose(captureFile);
+    capture_stats_t capture = Capture_Get_Stats();
+    printf("capture.frames=%u\ncapture.dropped=%u\ncapture.written=%u\n", (unsigned)capture.captured,
+           (unsigned)capture.dropped, (unsigned)capture.written);
+  }
+  if(options.metrics) {
+    Scrape_Metrics();
+  }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,228 @@
+#include <string.h>
+#include "spool.h"
+
+#define SPOOL_MAGIC 0x4C4F5053UL // "SPOL"
+#define SPOOL_STATE_PENDING 0xFF
+#define SPOOL_STATE_CONSUMED 0x00
+
+/* Slot Header (16 bytes, little-endian)
+   0  magic
+   4  seq
+   8  len (u16)
+   10 state (not covered by crc)
+   11 reserved
+   12 crc32 over seq, len and payload */
+typedef struct {
+  uint32_t magic;
+  uint32_t seq;
+  uint16_t len;
+  uint8_t state;
+  uint8_t reserved;
+  uint32_t crc;
+} spool_header_t;
+
+static_assert(sizeof(spool_header_t) == SPOOL_HEADER_SIZE, "Spool header layout");
+
+/* Spool Variables */
+static spool_storage_t *store = NULL;
+static uplink_send_fn deliver = NULL;
+static uint32_t tailSeq = 0; // Oldest Pending Batch
+static uint32_t headSeq = 0; // Next Sequence to Write
+static uint16_t slotLen[SPOOL_SLOTS]; // Payload Length per Slot (0 -> empty)
+static uint32_t nextReplay = 0; // Earliest Time for the next Replay
+static uint32_t drainStart = 0; // Start of Current Replay Run
+static uint32_t drainBytes = 0; // Bytes Replayed in Current Run
+static spool_stats_t stats;
+static uint8_t slotBuffer[UPLINK_BATCH_BYTES]; // Replay Buffer
+
+static uint32_t Crc32(uint32_t crc, const uint8_t *data, size_t len) {
+  crc = ~crc;
+  while(len--) {
+    crc ^= *data++;
+    for(int k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0u - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+static uint32_t Slot_Offset(uint32_t seq) {
+  return (seq % SPOOL_SLOTS) * SPOOL_SLOT_SIZE;
+}
+
+static uint32_t Header_Crc(const spool_header_t *hdr, const uint8_t *payload) {
+  uint32_t crc = Crc32(0, (const uint8_t *)&hdr->seq, sizeof(hdr->seq));
+  crc = Crc32(crc, (const uint8_t *)&hdr->len, sizeof(hdr->len));
+  return Crc32(crc, payload, hdr->len);
+}
+
+// Step the tail over gaps left by consumed or torn slots inside the run
+static void Spool_Skip_Gaps() {
+  while(tailSeq != headSeq && slotLen[tailSeq % SPOOL_SLOTS] == 0) {
+    tailSeq++;
+  }
+}
+
+// Mark the tail slot as consumed and advance
+static void Spool_Pop() {
+  uint8_t state = SPOOL_STATE_CONSUMED;
+  if(!store->write(store->ctx, Slot_Offset(tailSeq) + offsetof(spool_header_t, state), &state, 1)) {
+    stats.storageErrors++;
+  }
+  stats.depth--;
+  stats.bytes -= slotLen[tailSeq % SPOOL_SLOTS];
+  slotLen[tailSeq % SPOOL_SLOTS] = 0;
+  tailSeq++;
+  Spool_Skip_Gaps();
+}
+
+static bool Spool_Append(const uint8_t *body, size_t len) {
+  if(len == 0 || len > UPLINK_BATCH_BYTES) {
+    return false;
+  }
+
+  if(headSeq - tailSeq >= SPOOL_SLOTS) {
+    stats.overwritten++; // Ring Full: Give up on the Oldest Batch
+    stats.depth--;
+    stats.bytes -= slotLen[tailSeq % SPOOL_SLOTS];
+    slotLen[tailSeq % SPOOL_SLOTS] = 0;
+    tailSeq++;
+    Spool_Skip_Gaps();
+  }
+
+  spool_header_t hdr;
+  hdr.magic = SPOOL_MAGIC;
+  hdr.seq = headSeq;
+  hdr.len = (uint16_t)len;
+  hdr.state = SPOOL_STATE_PENDING;
+  hdr.reserved = 0xFF;
+  hdr.crc = Header_Crc(&hdr, body);
+
+  // Payload first, header last: a torn write leaves an invalid slot
+  uint32_t offset = Slot_Offset(headSeq);
+  if(!store->write(store->ctx, offset + SPOOL_HEADER_SIZE, body, len) ||
+     !store->write(store->ctx, offset, &hdr, sizeof(hdr))) {
+    stats.storageErrors++;
+    return false;
+  }
+
+  slotLen[headSeq % SPOOL_SLOTS] = (uint16_t)len;
+  headSeq++;
+  stats.depth++;
+  stats.bytes += len;
+  stats.spooled++;
+  return true;
+}
+
+bool Spool_Init(spool_storage_t *storage, uplink_send_fn transport) {
+  store = storage;
+  deliver = transport;
+  memset(&stats, 0, sizeof(stats));
+  memset(slotLen, 0, sizeof(slotLen));
+  tailSeq = headSeq = 0;
+
+  // Collect Pending Slots. A slot whose consume mark failed to write can
+  // outlive its generation, and consumed or torn slots leave holes, so the
+  // run is rebuilt from the newest seq back rather than taken as min..max
+  bool found = false;
+  uint32_t maxSeq = 0;
+  uint32_t slotSeq[SPOOL_SLOTS];
+  for(uint32_t slot = 0; slot < SPOOL_SLOTS; slot++) {
+    spool_header_t hdr;
+    if(!store->read(store->ctx, slot * SPOOL_SLOT_SIZE, &hdr, sizeof(hdr))) {
+      stats.storageErrors++;
+      continue;
+    }
+    if(hdr.magic != SPOOL_MAGIC || hdr.state != SPOOL_STATE_PENDING || hdr.len == 0 ||
+       hdr.len > UPLINK_BATCH_BYTES || hdr.seq % SPOOL_SLOTS != slot) {
+      continue;
+    }
+    if(!store->read(store->ctx, slot * SPOOL_SLOT_SIZE + SPOOL_HEADER_SIZE, slotBuffer, hdr.len) ||
+       Header_Crc(&hdr, slotBuffer) != hdr.crc) {
+      continue; // Torn Write
+    }
+    if(!found || (int32_t)(hdr.seq - maxSeq) > 0) {
+      maxSeq = hdr.seq;
+    }
+    found = true;
+    slotLen[slot] = hdr.len;
+    slotSeq[slot] = hdr.seq;
+  }
+
+  if(found) {
+    // Only the last SPOOL_SLOTS seqs up to the newest can still be waiting
+    headSeq = maxSeq + 1;
+    tailSeq = headSeq;
+    for(uint32_t slot = 0; slot < SPOOL_SLOTS; slot++) {
+      if(slotLen[slot] == 0) {
+        continue;
+      }
+      if(maxSeq - slotSeq[slot] >= SPOOL_SLOTS) {
+        slotLen[slot] = 0; // Stale Generation
+        continue;
+      }
+      if((int32_t)(slotSeq[slot] - tailSeq) < 0) {
+        tailSeq = slotSeq[slot];
+      }
+      stats.depth++;
+      stats.bytes += slotLen[slot];
+    }
+  }
+
+  return true;
+}
+
+bool Spool_Send(const uint8_t *body, size_t len) {
+  // Keep Order: nothing bypasses batches already waiting
+  if(stats.depth == 0 && deliver != NULL && deliver(body, len)) {
+    return true;
+  }
+  return Spool_Append(body, len);
+}
+
+bool Spool_Store(const uint8_t *body, size_t len) {
+  return Spool_Append(body, len);
+}
+
+void Spool_Drain(uint32_t now) {
+  if(stats.depth == 0 || deliver == NULL || (int32_t)(now - nextReplay) < 0) {
+    return;
+  }
+
+  uint32_t slot = tailSeq % SPOOL_SLOTS;
+  uint16_t len = slotLen[slot];
+
+  if(!store->read(store->ctx, Slot_Offset(tailSeq) + SPOOL_HEADER_SIZE, slotBuffer, len)) {
+    // Slot Unreadable; skip it
+    stats.storageErrors++;
+    Spool_Pop();
+    return;
+  }
+
+  if(!deliver(slotBuffer, len)) {
+    nextReplay = now + SPOOL_RETRY_MS; // Link still down
+    drainBytes = 0;
+    return;
+  }
+
+  if(drainBytes == 0) {
+    drainStart = now;
+  }
+  drainBytes += len;
+  if(now != drainStart) {
+    stats.replayBytesPerSec = (uint32_t)((uint64_t)drainBytes * 1000 / (now - drainStart));
+  }
+
+  stats.replayed++;
+  stats.replayedBytes += len;
+  Spool_Pop();
+  nextReplay = now + SPOOL_REPLAY_INTERVAL_MS;
+
+  if(stats.depth == 0) {
+    drainBytes = 0;
+  }
+}
+
+const spool_stats_t *Spool_Get_Stats() {
+  return &stats;
+}
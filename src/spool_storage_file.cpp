@@ -0,0 +1,43 @@
+#ifndef ARDUINO
+
+#include <stdio.h>
+#include "spool.h"
+
+/* Spool backend for host builds: a preallocated regular file */
+
+static FILE *spoolFile = NULL;
+
+static bool File_Read(void *ctx, uint32_t offset, void *buf, size_t len) {
+  FILE *file = (FILE *)ctx;
+  return fseek(file, (long)offset, SEEK_SET) == 0 && fread(buf, 1, len, file) == len;
+}
+
+static bool File_Write(void *ctx, uint32_t offset, const void *buf, size_t len) {
+  FILE *file = (FILE *)ctx;
+  return fseek(file, (long)offset, SEEK_SET) == 0 && fwrite(buf, 1, len, file) == len && fflush(file) == 0;
+}
+
+bool Spool_Storage_Open(spool_storage_t *storage, const char *path, uint32_t size) {
+  spoolFile = fopen(path, "r+b");
+  if(spoolFile == NULL) {
+    spoolFile = fopen(path, "w+b");
+    if(spoolFile == NULL) {
+      return false;
+    }
+  }
+
+  // Extend to full size (new bytes read as zero)
+  fseek(spoolFile, 0, SEEK_END);
+  if(ftell(spoolFile) < (long)size) {
+    fseek(spoolFile, (long)size - 1, SEEK_SET);
+    fputc(0, spoolFile);
+    fflush(spoolFile);
+  }
+
+  storage->read = File_Read;
+  storage->write = File_Write;
+  storage->ctx = spoolFile;
+  return true;
+}
+
+#endif
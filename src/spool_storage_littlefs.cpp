@@ -0,0 +1,56 @@
+#ifdef ARDUINO
+
+#include <LittleFS.h>
+#include <string.h>
+#include "spool.h"
+
+/* Spool backend: one file on the LittleFS partition, grown on demand.
+   Preallocating all of SPOOL_STORAGE_SIZE would write every block once on
+   first boot (flash wear, and seconds of boot time) for slots an outage may
+   never reach. Bytes past the end read as zero, which is an empty slot. */
+
+static File spoolFile;
+
+static bool File_Read(void *ctx, uint32_t offset, void *buf, size_t len) {
+  File *file = (File *)ctx;
+  size_t size = file->size();
+  size_t have = offset >= size ? 0 : (size - offset < len ? size - offset : len);
+  memset((uint8_t *)buf + have, 0, len - have); // Never Written Yet
+  return have == 0 || (file->seek(offset) && file->read((uint8_t *)buf, have) == have);
+}
+
+static bool File_Write(void *ctx, uint32_t offset, const void *buf, size_t len) {
+  File *file = (File *)ctx;
+  if(!file->seek(offset) || file->write((const uint8_t *)buf, len) != len) {
+    return false;
+  }
+  file->flush(); // Commit before reporting success (a write past the end zero-fills the gap)
+  return true;
+}
+
+bool Spool_Storage_Open(spool_storage_t *storage, const char *path, uint32_t size) {
+  if(!LittleFS.begin(true)) { // Format on first use
+    return false;
+  }
+
+  if(!LittleFS.exists(path)) {
+    File create = LittleFS.open(path, "w"); // Empty: slots are written as batches arrive
+    if(!create) {
+      return false;
+    }
+    create.close();
+  }
+
+  spoolFile = LittleFS.open(path, "r+");
+  if(!spoolFile) {
+    return false;
+  }
+  (void)size; // Grown by Writes (a File Preallocated by an Older Build Works as is)
+
+  storage->read = File_Read;
+  storage->write = File_Write;
+  storage->ctx = &spoolFile;
+  return true;
+}
+
+#endif
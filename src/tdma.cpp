@@ -0,0 +1,154 @@
+#include <string.h>
+#include "tdma.h"
+#include "wire_format.h"
+
+void Tdma_Init(tdma_schedule_t *t, tdma_send_fn send, void *ctx) {
+  memset(t, 0, sizeof(*t));
+  t->send = send;
+  t->ctx = ctx;
+  t->beaconMs = TDMA_BEACON_MS;
+  t->slotUs = TDMA_SLOT_US;
+}
+
+void Tdma_Register(tdma_schedule_t *t, const uint8_t *source, uint32_t nowUs) {
+  tdma_grant_t *free = NULL;
+  for(int i = 0; i < BEACON_MAX_GRANTS; i++) {
+    tdma_grant_t *grant = &t->grants[i];
+    if(grant->used && memcmp(grant->mac, source, MAC_SIZE) == 0) {
+      grant->lastUs = nowUs;
+      return;
+    }
+    if(!grant->used && free == NULL) {
+      free = grant; // Lowest Free Slot
+    }
+  }
+  if(free == NULL) {
+    t->stats.full++;
+    return;
+  }
+  free->used = true;
+  memcpy(free->mac, source, MAC_SIZE);
+  free->lastUs = nowUs;
+  t->stats.granted++; // Announced with the Next Beacon
+}
+
+int Tdma_Active(const tdma_schedule_t *t) {
+  int active = 0;
+  for(int i = 0; i < BEACON_MAX_GRANTS; i++) {
+    active += t->grants[i].used;
+  }
+  return active;
+}
+
+void Tdma_Poll(tdma_schedule_t *t, uint32_t nowUs) {
+  if(t->beaconMs == 0) {
+    return;
+  }
+  if(t->started) {
+    uint32_t elapsed = nowUs - t->epochUs;
+    uint32_t period = (t->slots + 2) * t->slotUs;
+    if(elapsed < t->beaconMs * 1000 || elapsed % period >= t->slotUs) {
+      return; // Not Due, or Due but Mid-Superframe: wait for the Beacon Slot
+    }
+  }
+
+  beacon_t beacon;
+  memset(&beacon, 0, sizeof(beacon));
+  t->slots = 0;
+  for(int i = 0; i < BEACON_MAX_GRANTS; i++) {
+    tdma_grant_t *grant = &t->grants[i];
+    if(grant->used && nowUs - grant->lastUs > TDMA_IDLE_MS * 1000u) {
+      grant->used = false;
+      t->stats.released++;
+    }
+    if(grant->used) {
+      memcpy(beacon.grants[beacon.count].mac, grant->mac, MAC_SIZE);
+      beacon.grants[beacon.count].slot = (uint8_t)i;
+      beacon.count++;
+      t->slots = (uint8_t)(i + 1); // Freed Slots below the Highest Stay Empty until Reused
+    }
+  }
+
+  t->started = true;
+  t->epochUs = nowUs;
+  beacon.seq = ++t->seq;
+  beacon.ttl = TDMA_BEACON_TTL;
+  beacon.timeUs = nowUs;
+  beacon.epochUs = nowUs;
+  beacon.slotUs = t->slotUs;
+  beacon.slots = t->slots;
+
+  uint8_t frame[ESPNOW_MTU];
+  size_t len = Wire_Encode_Beacon(&beacon, frame, sizeof(frame));
+  if(len > 0 && t->send(t->ctx, frame, len)) {
+    t->stats.beacons++;
+  }
+}
+
+void Tdma_Node_Init(tdma_node_t *n, const uint8_t *self, uint32_t hopDelayUs) {
+  memset(n, 0, sizeof(*n));
+  memcpy(n->self, self, MAC_SIZE);
+  n->hopDelayUs = hopDelayUs;
+  n->slot = -1;
+}
+
+bool Tdma_Node_On_Beacon(tdma_node_t *n, const beacon_t *beacon, uint32_t localUs) {
+  if(n->synced && (int16_t)(beacon->seq - n->seq) <= 0) {
+    n->stats.repeats++;
+    return false;
+  }
+  n->stats.beacons++;
+  n->synced = true;
+  n->seq = beacon->seq;
+  n->beaconAt = localUs;
+  n->offsetUs = beacon->timeUs + n->hopDelayUs - localUs;
+  n->depth = (uint8_t)(beacon->hops + 1);
+  n->epochUs = beacon->epochUs;
+  n->slotUs = beacon->slotUs;
+  n->slots = beacon->slots;
+  n->slot = -1;
+  for(int i = 0; i < beacon->count; i++) {
+    if(memcmp(beacon->grants[i].mac, n->self, MAC_SIZE) == 0) {
+      n->slot = beacon->grants[i].slot;
+      break;
+    }
+  }
+  return true;
+}
+
+void Tdma_Node_Restamp(const tdma_node_t *n, beacon_t *beacon, uint32_t localUs) {
+  beacon->ttl--;
+  beacon->hops++;
+  beacon->timeUs = Tdma_Node_Time(n, localUs);
+}
+
+uint32_t Tdma_Node_Time(const tdma_node_t *n, uint32_t localUs) {
+  return n->synced ? localUs + n->offsetUs : localUs;
+}
+
+// Contention slot use in this superframe (FNV-1a of MAC, beacon and superframe number)
+static bool Tdma_Contention_Turn(const tdma_node_t *n, uint32_t superframe) {
+  uint32_t h = 2166136261u;
+  for(int i = 0; i < MAC_SIZE; i++) {
+    h = (h ^ n->self[i]) * 16777619u;
+  }
+  h = (h ^ n->seq) * 16777619u;
+  h = (h ^ superframe) * 16777619u;
+  return TDMA_CONTENTION_SPREAD <= 1 || (h >> 16) % TDMA_CONTENTION_SPREAD == 0;
+}
+
+bool Tdma_Node_May_Send(const tdma_node_t *n, uint32_t localUs) {
+  if(!n->synced || n->slotUs == 0 || localUs - n->beaconAt > TDMA_SYNC_TIMEOUT_MS * 1000u) {
+    return true; // No Schedule to Keep
+  }
+  uint32_t period = (n->slots + 2) * n->slotUs;
+  uint32_t elapsed = Tdma_Node_Time(n, localUs) - n->epochUs;
+  uint32_t at = elapsed % period;
+  if(n->slot < 0 && !Tdma_Contention_Turn(n, elapsed / period)) {
+    return false;
+  }
+  uint32_t own = (n->slot >= 0 ? n->slot + 1 : n->slots + 1) * n->slotUs; // Contention Slot is the Last
+  uint32_t roundTrip = 2 * n->depth * n->hopDelayUs;
+  uint32_t window = roundTrip < n->slotUs / 2 ? n->slotUs - roundTrip : n->slotUs / 2; // Slot too Narrow for the Path: Use Half
+  return at >= own && at - own < window;
+}
@@ -0,0 +1,186 @@
+#include <string.h>
+#include "metrics.h"
+#include "uplink.h"
+
+/* Uplink Variables */
+static uint8_t batchBody[UPLINK_BATCH_BYTES]; // JSON "[rec,rec,...]" or MessagePack array16 + records
+static size_t batchLen = 0; // Bytes used (excluding JSON closing bracket)
+static uint16_t batchRecords = 0; // Records in Batch
+static uint32_t batchDue = 0; // Earliest Record Deadline (ms)
+static bool batchAlarm = false; // Deadline Set by an Alarm
+static uint32_t recordStamps[UPLINK_BATCH_RECORDS]; // Arrival per Record (Metrics_Clock)
+static uint8_t recordClass[UPLINK_BATCH_RECORDS]; // priority_class per Record
+static record_format batchFormat = RECORD_JSON;
+static uplink_send_fn sendBatch = NULL;
+static uplink_stats_t stats;
+
+#define MSGPACK_ARRAY16_SIZE 3
+
+void Uplink_Init(uplink_send_fn send, record_format format) {
+  sendBatch = send;
+  batchFormat = format;
+  batchLen = 0;
+  batchRecords = 0;
+  memset(&stats, 0, sizeof(stats));
+}
+
+void Uplink_Flush(uplink_flush_reason reason) {
+  if(batchRecords == 0) {
+    return;
+  }
+
+  if(batchFormat == RECORD_MSGPACK) {
+    batchBody[0] = 0xDC; // array16
+    batchBody[1] = (uint8_t)(batchRecords >> 8);
+    batchBody[2] = (uint8_t)batchRecords;
+  } else {
+    batchBody[batchLen++] = ']'; // Space reserved when the record was added
+  }
+
+  uint32_t handoff = Metrics_Clock();
+  for(uint16_t i = 0; i < batchRecords; i++) {
+    Metrics_Observe(HIST_PROCESS_TO_UPLINK, handoff - recordStamps[i]);
+    if(recordClass[i] == PRIORITY_ALARM) {
+      Metrics_Observe(HIST_ALARM_TO_UPLINK, handoff - recordStamps[i]);
+    }
+  }
+
+  stats.batches++;
+  stats.flushes[reason]++;
+  stats.lastBatchRecords = batchRecords;
+  if(batchRecords > stats.maxBatchRecords) {
+    stats.maxBatchRecords = batchRecords;
+  }
+
+  if(sendBatch == NULL || !sendBatch(batchBody, batchLen)) {
+    stats.failures++;
+  }
+
+  batchLen = 0;
+  batchRecords = 0;
+}
+
+// Space for the next record, after any separator. Keeps room for "]"
+static uint8_t *Uplink_Record_Slot(size_t *cap) {
+  size_t used;
+  if(batchRecords == 0) {
+    used = batchFormat == RECORD_MSGPACK ? MSGPACK_ARRAY16_SIZE : 1;
+  } else {
+    used = batchLen + (batchFormat == RECORD_MSGPACK ? 0 : 1);
+  }
+  size_t reserve = batchFormat == RECORD_MSGPACK ? 0 : 1;
+  *cap = sizeof(batchBody) - used - reserve;
+  return &batchBody[used];
+}
+
+// Account for a record written into Uplink_Record_Slot
+static void Uplink_Commit(size_t len, uint32_t now, uint8_t priority) {
+  bool alarm = priority == PRIORITY_ALARM;
+  uint32_t due = now + (alarm ? UPLINK_ALARM_LATENCY_MS : UPLINK_MAX_LATENCY_MS);
+  if(batchRecords == 0 || (int32_t)(due - batchDue) < 0) {
+    batchDue = due; // Earliest Deadline Wins
+    batchAlarm = alarm;
+  }
+
+  if(batchRecords == 0) {
+    if(batchFormat == RECORD_MSGPACK) {
+      batchLen = MSGPACK_ARRAY16_SIZE;
+    } else {
+      batchBody[0] = '[';
+      batchLen = 1;
+    }
+  } else if(batchFormat == RECORD_JSON) {
+    batchBody[batchLen++] = ',';
+  }
+
+  batchLen += len;
+  recordClass[batchRecords] = priority;
+  recordStamps[batchRecords++] = Metrics_Clock();
+  stats.records++;
+  stats.alarms += alarm;
+
+  if(batchRecords >= UPLINK_BATCH_RECORDS) {
+    Uplink_Flush(UPLINK_FLUSH_COUNT);
+  }
+}
+
+bool Uplink_Add_Payload(const message_t *msg, const uint8_t *payload, size_t payloadLen, uint32_t now) {
+  size_t cap;
+  uint8_t *slot = Uplink_Record_Slot(&cap);
+  size_t len = Record_Write_Payload(msg, payload, payloadLen, batchFormat, slot, cap);
+
+  if(len == 0 && batchRecords > 0) {
+    Uplink_Flush(UPLINK_FLUSH_SIZE);
+    slot = Uplink_Record_Slot(&cap);
+    len = Record_Write_Payload(msg, payload, payloadLen, batchFormat, slot, cap);
+  }
+
+  if(len == 0) {
+    stats.oversize++;
+    return false;
+  }
+
+  Uplink_Commit(len, now, msg->priority);
+  return true;
+}
+
+bool Uplink_Add_Message(const message_t *msg, uint32_t now) {
+  return Uplink_Add_Payload(msg, NULL, 0, now);
+}
+
+bool Uplink_Add_Summary(const aggregate_summary_t *summary, uint32_t now) {
+  size_t cap;
+  uint8_t *slot = Uplink_Record_Slot(&cap);
+  size_t len = Record_Write_Summary(summary, batchFormat, slot, cap);
+
+  if(len == 0 && batchRecords > 0) {
+    Uplink_Flush(UPLINK_FLUSH_SIZE);
+    slot = Uplink_Record_Slot(&cap);
+    len = Record_Write_Summary(summary, batchFormat, slot, cap);
+  }
+
+  if(len == 0) {
+    stats.oversize++;
+    return false;
+  }
+
+  Uplink_Commit(len, now, PRIORITY_NORMAL);
+  return true;
+}
+
+bool Uplink_Add_Record(const uint8_t *record, size_t len, uint32_t now) {
+  size_t cap;
+  Uplink_Record_Slot(&cap);
+
+  if(len > cap && batchRecords > 0) {
+    Uplink_Flush(UPLINK_FLUSH_SIZE);
+  }
+
+  uint8_t *slot = Uplink_Record_Slot(&cap);
+  if(len > cap) {
+    stats.oversize++;
+    return false;
+  }
+
+  memcpy(slot, record, len);
+  Uplink_Commit(len, now, PRIORITY_NORMAL);
+  return true;
+}
+
+void Uplink_Poll(uint32_t now) {
+  if(batchRecords > 0 && (int32_t)(now - batchDue) >= 0) {
+    Uplink_Flush(batchAlarm ? UPLINK_FLUSH_ALARM : UPLINK_FLUSH_DEADLINE);
+  }
+}
+
+uint16_t Uplink_Pending() {
+  return batchRecords;
+}
+
+const char *Uplink_Content_Type() {
+  return Record_Content_Type(batchFormat);
+}
+
+const uplink_stats_t *Uplink_Get_Stats() {
+  return &stats;
+}
@@ -0,0 +1,274 @@
+#include <string.h>
+#include "wire_format.h"
+
+static_assert(WIRE_MAX_FRAME < WIRE_LEGACY_SIZE, "Compact frame must stay distinguishable from legacy layout");
+static_assert(FRAGMENT_DATA_MAX == ESPNOW_MTU - WIRE_HEADER_SIZE - WIRE_FRAGMENT_HEADER_SIZE, "FRAGMENT_DATA_MAX out of date");
+static_assert(WIRE_BEACON_HEADER_SIZE + BEACON_MAX_GRANTS * WIRE_BEACON_GRANT_SIZE <= ESPNOW_MTU, "BEACON_MAX_GRANTS too large");
+static_assert(BEACON_MAX_GRANTS <= 255, "Grant count and slot numbers are one byte on the wire");
+
+static void Put_U32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t Get_U32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Number of Path Rows up to the last non-zero one
+static uint8_t Used_Hops(const message_t *msg) {
+  static const uint8_t zero[MAC_SIZE] = {0};
+  uint8_t hops = MAX_NODES;
+  while(hops > 0 && memcmp(msg->Path_Array[hops - 1], zero, MAC_SIZE) == 0) {
+    --hops;
+  }
+  return hops;
+}
+
+static void Put_U16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t Get_U16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Header and path rows; returns the position after them
+static uint8_t *Encode_Header(const message_t *msg, uint8_t version, uint8_t hops, uint8_t *out) {
+  out[0] = version;
+  out[1] = (msg->broadcast_Ack ? WIRE_FLAG_BROADCAST_ACK : 0) |
+           (msg->Data_Ack ? WIRE_FLAG_DATA_ACK : 0) |
+           (msg->Path_Exist ? WIRE_FLAG_PATH_EXIST : 0) |
+           (msg->Data_Ack ? WIRE_FLAG_ACK_ID : 0) |
+           ((msg->priority < PRIORITY_CLASSES ? msg->priority : (uint8_t)PRIORITY_NORMAL) << WIRE_PRIORITY_SHIFT);
+  out[2] = (uint8_t)msg->identification;
+  out[3] = (uint8_t)(msg->TTL < 0 ? 0 : (msg->TTL > 255 ? 255 : msg->TTL));
+  Put_U32(&out[4], (uint32_t)msg->packetID);
+  memcpy(&out[8], msg->destination_mac, MAC_SIZE);
+  memcpy(&out[14], msg->source_mac, MAC_SIZE);
+  out[20] = msg->Path_Index;
+  out[21] = msg->Path_Length;
+  out[22] = hops;
+
+  uint8_t *p = &out[WIRE_HEADER_SIZE];
+  memcpy(p, msg->Path_Array, hops * MAC_SIZE); // Rows are contiguous
+  return p + hops * MAC_SIZE;
+}
+
+// Legacy raw struct: exactly WIRE_LEGACY_SIZE long and not led by a fragment or beacon version.
+// A fragment or beacon can be that long too, but legacy text never starts with those control bytes
+static bool Is_Legacy(const uint8_t *data, size_t len) {
+  return len == WIRE_LEGACY_SIZE && data[0] != WIRE_VERSION_FRAGMENT && data[0] != WIRE_VERSION_BEACON;
+}
+
+// Path_Index and Path_Length must point inside the rows sent, or the ack path walks off Path_Array
+static bool Path_Valid(uint8_t index, uint8_t length, uint8_t hops) {
+  return index < MAX_NODES && index <= hops && length <= hops;
+}
+
+// Header and path rows into a cleared msg; returns the position after them, or NULL
+static const uint8_t *Decode_Header(const uint8_t *data, size_t len, uint8_t version, message_t *msg) {
+  if(len < WIRE_HEADER_SIZE + 1 || data[0] != version) {
+    return NULL;
+  }
+
+  uint8_t hops = data[22];
+  if(hops > MAX_NODES || len < WIRE_HEADER_SIZE + hops * MAC_SIZE + 1u || !Path_Valid(data[20], data[21], hops)) {
+    return NULL;
+  }
+
+  memset(msg, 0, sizeof(*msg));
+  msg->broadcast_Ack = (data[1] & WIRE_FLAG_BROADCAST_ACK) != 0;
+  msg->Data_Ack = (data[1] & WIRE_FLAG_DATA_ACK) != 0;
+  msg->Path_Exist = (data[1] & WIRE_FLAG_PATH_EXIST) != 0;
+  uint8_t priority = (data[1] & WIRE_PRIORITY_MASK) >> WIRE_PRIORITY_SHIFT;
+  msg->priority = priority < PRIORITY_CLASSES ? priority : (uint8_t)PRIORITY_NORMAL;
+  msg->identification = data[2];
+  msg->TTL = data[3];
+  msg->packetID = (int32_t)Get_U32(&data[4]);
+  memcpy(msg->destination_mac, &data[8], MAC_SIZE);
+  memcpy(msg->source_mac, &data[14], MAC_SIZE);
+  msg->Path_Index = data[20];
+  msg->Path_Length = data[21];
+  memcpy(msg->Path_Array, &data[WIRE_HEADER_SIZE], hops * MAC_SIZE);
+
+  return &data[WIRE_HEADER_SIZE + hops * MAC_SIZE];
+}
+
+size_t Wire_Encode(const message_t *msg, uint8_t *out, size_t cap) {
+  uint8_t hops = Used_Hops(msg);
+  size_t textLen = strnlen((const char *)msg->text, WIRE_TEXT_MAX);
+  size_t total = WIRE_HEADER_SIZE + hops * MAC_SIZE + 1 + textLen + (msg->Data_Ack ? 4 : 0) + (msg->captured ? 4 : 0);
+
+  if(total > cap) {
+    return 0;
+  }
+
+  uint8_t *p = Encode_Header(msg, WIRE_VERSION, hops, out);
+  *p++ = (uint8_t)textLen;
+  memcpy(p, msg->text, textLen);
+  p += textLen;
+  if(msg->Data_Ack) {
+    Put_U32(p, (uint32_t)msg->ackID);
+    p += 4;
+  }
+  if(msg->captured) {
+    out[1] |= WIRE_FLAG_CAPTURED; // Data Frames Only
+    Put_U32(p, msg->captured);
+  }
+
+  return total;
+}
+
+bool Wire_Decode(const uint8_t *data, size_t len, message_t *msg) {
+  if(Is_Legacy(data, len)) {
+    // Legacy Raw Struct (every row is sent)
+    message_t legacy;
+    memset(&legacy, 0, sizeof(legacy));
+    memcpy(&legacy, data, WIRE_LEGACY_SIZE);
+    legacy.text[sizeof(legacy.text) - 1] = '\0';
+    if(!Path_Valid(legacy.Path_Index, legacy.Path_Length, MAX_NODES)) {
+      return false;
+    }
+    memcpy(msg, &legacy, sizeof(legacy));
+    return true;
+  }
+
+  message_t decoded;
+  const uint8_t *p = Decode_Header(data, len, WIRE_VERSION, &decoded);
+  if(p == NULL) {
+    return false;
+  }
+
+  uint8_t textLen = *p++;
+  if(textLen > WIRE_TEXT_MAX || (size_t)(p + textLen - data) > len) {
+    return false;
+  }
+  memcpy(decoded.text, p, textLen);
+  p += textLen;
+  size_t optional = ((data[1] & WIRE_FLAG_ACK_ID) ? 4 : 0) + ((data[1] & WIRE_FLAG_CAPTURED) ? 4 : 0);
+  if((size_t)(p - data) + optional > len) {
+    return false; // Flags Announce Fields the Frame is too Short to Hold
+  }
+  if(data[1] & WIRE_FLAG_ACK_ID) {
+    decoded.ackID = (int32_t)Get_U32(p);
+    p += 4;
+  }
+  if(data[1] & WIRE_FLAG_CAPTURED) {
+    decoded.captured = Get_U32(p);
+  }
+
+  memcpy(msg, &decoded, sizeof(decoded));
+  return true;
+}
+
+size_t Wire_Fragment_Chunk(uint8_t reserveHops) {
+  if(reserveHops > MAX_NODES) {
+    reserveHops = MAX_NODES;
+  }
+  return ESPNOW_MTU - WIRE_HEADER_SIZE - WIRE_FRAGMENT_HEADER_SIZE - reserveHops * MAC_SIZE;
+}
+
+bool Wire_Is_Fragment(const uint8_t *data, size_t len) {
+  return len > 0 && data[0] == WIRE_VERSION_FRAGMENT; // Version First: a Fragment may be WIRE_LEGACY_SIZE Long
+}
+
+size_t Wire_Encode_Fragment(const message_t *msg, const fragment_t *fragment, uint8_t *out, size_t cap) {
+  uint8_t hops = Used_Hops(msg);
+  size_t total = WIRE_HEADER_SIZE + hops * MAC_SIZE + WIRE_FRAGMENT_HEADER_SIZE + fragment->len;
+
+  if(total > cap || fragment->len > FRAGMENT_DATA_MAX) {
+    return 0;
+  }
+
+  uint8_t *p = Encode_Header(msg, WIRE_VERSION_FRAGMENT, hops, out);
+  Put_U16(p, fragment->messageID);
+  p[2] = fragment->index;
+  p[3] = fragment->count;
+  Put_U16(p + 4, fragment->total);
+  Put_U16(p + 6, fragment->offset);
+  p[8] = fragment->len;
+  memcpy(p + WIRE_FRAGMENT_HEADER_SIZE, fragment->data, fragment->len);
+
+  return total;
+}
+
+bool Wire_Decode_Fragment(const uint8_t *data, size_t len, message_t *msg, fragment_t *fragment) {
+  message_t decoded;
+  const uint8_t *p = Decode_Header(data, len, WIRE_VERSION_FRAGMENT, &decoded);
+  if(p == NULL || (size_t)(p + WIRE_FRAGMENT_HEADER_SIZE - data) > len) {
+    return false;
+  }
+
+  uint8_t chunk = p[8];
+  if(chunk > FRAGMENT_DATA_MAX || (size_t)(p + WIRE_FRAGMENT_HEADER_SIZE + chunk - data) > len) {
+    return false;
+  }
+
+  fragment->messageID = Get_U16(p);
+  fragment->index = p[2];
+  fragment->count = p[3];
+  fragment->total = Get_U16(p + 4);
+  fragment->offset = Get_U16(p + 6);
+  fragment->len = chunk;
+  memcpy(fragment->data, p + WIRE_FRAGMENT_HEADER_SIZE, chunk);
+
+  memcpy(msg, &decoded, sizeof(decoded));
+  return true;
+}
+
+bool Wire_Is_Beacon(const uint8_t *data, size_t len) {
+  return len > 0 && data[0] == WIRE_VERSION_BEACON; // Version First: 19 Grants make WIRE_LEGACY_SIZE
+}
+
+size_t Wire_Encode_Beacon(const beacon_t *beacon, uint8_t *out, size_t cap) {
+  size_t total = WIRE_BEACON_HEADER_SIZE + beacon->count * WIRE_BEACON_GRANT_SIZE;
+  if(total > cap || beacon->count > BEACON_MAX_GRANTS) {
+    return 0;
+  }
+
+  out[0] = WIRE_VERSION_BEACON;
+  out[1] = beacon->ttl;
+  out[2] = beacon->hops;
+  Put_U16(&out[3], beacon->seq);
+  Put_U32(&out[5], beacon->timeUs);
+  Put_U32(&out[9], beacon->epochUs);
+  Put_U32(&out[13], beacon->slotUs);
+  out[17] = beacon->slots;
+  out[18] = beacon->count;
+  uint8_t *p = &out[WIRE_BEACON_HEADER_SIZE];
+  for(int i = 0; i < beacon->count; i++, p += WIRE_BEACON_GRANT_SIZE) {
+    memcpy(p, beacon->grants[i].mac, MAC_SIZE);
+    p[MAC_SIZE] = beacon->grants[i].slot;
+  }
+
+  return total;
+}
+
+bool Wire_Decode_Beacon(const uint8_t *data, size_t len, beacon_t *beacon) {
+  if(!Wire_Is_Beacon(data, len) || len < WIRE_BEACON_HEADER_SIZE) {
+    return false;
+  }
+  uint8_t count = data[18];
+  if(count > BEACON_MAX_GRANTS || len < WIRE_BEACON_HEADER_SIZE + (size_t)count * WIRE_BEACON_GRANT_SIZE) {
+    return false;
+  }
+
+  beacon->ttl = data[1];
+  beacon->hops = data[2];
+  beacon->seq = Get_U16(&data[3]);
+  beacon->timeUs = Get_U32(&data[5]);
+  beacon->epochUs = Get_U32(&data[9]);
+  beacon->slotUs = Get_U32(&data[13]);
+  beacon->slots = data[17];
+  beacon->count = count;
+  const uint8_t *p = &data[WIRE_BEACON_HEADER_SIZE];
+  for(int i = 0; i < count; i++, p += WIRE_BEACON_GRANT_SIZE) {
+    memcpy(beacon->grants[i].mac, p, MAC_SIZE);
+    beacon->grants[i].slot = p[MAC_SIZE];
+  }
+  return true;
+}
@@ -0,0 +1,174 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "aggregate.h"
+
+/* Windowed aggregation: count and time windows close exactly at their
+   bounds, the summary statistics match the readings folded in, sources
+   keep separate windows, and everything that must go up raw does. Quiet
+   sources give their entry back, so more sources than AGGREGATE_SOURCES
+   aggregate over time */
+
+#define MAX_SUMMARIES 16
+
+static aggregate_summary_t summaries[MAX_SUMMARIES];
+static uint32_t emitted = 0;
+static bool refuse = false;
+
+static bool Record_Summary(const aggregate_summary_t *summary, uint32_t now) {
+  (void)now;
+  if(refuse || emitted == MAX_SUMMARIES) {
+    return false;
+  }
+  summaries[emitted++] = *summary;
+  return true;
+}
+
+static const uint8_t sourceA[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x0A};
+static const uint8_t sourceB[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x0B};
+static int32_t packetID = 0;
+
+static bool Add(const uint8_t *source, const char *text, uint32_t now) {
+  message_t msg;
+  memset(&msg, 0, sizeof(msg));
+  strncpy((char *)msg.text, text, sizeof(msg.text) - 1);
+  memcpy(msg.source_mac, source, MAC_SIZE);
+  msg.packetID = ++packetID;
+  return Aggregate_Add(&msg, now);
+}
+
+void setUp() {
+  emitted = 0;
+  refuse = false;
+  Aggregate_Init(Record_Summary);
+  Aggregate_Configure(0, 0);
+}
+void tearDown() {}
+
+void test_off_by_default_uploads_raw() {
+  TEST_ASSERT_FALSE(Add(sourceA, "21.5", 0));
+  TEST_ASSERT_EQUAL_UINT32(1, Aggregate_Get_Stats()->raw);
+}
+
+void test_count_window_statistics() {
+  Aggregate_Configure(0, 4);
+  static const char *readings[] = {"20", "22.5", " 19 ", "25.5"};
+  for(int i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(Add(sourceA, readings[i], 100 + i));
+    TEST_ASSERT_EQUAL_UINT32(i < 3 ? 0 : 1, emitted); // Closed by the Fourth, not Before
+  }
+  const aggregate_summary_t *s = &summaries[0];
+  TEST_ASSERT_EQUAL_MEMORY(sourceA, s->source, MAC_SIZE);
+  TEST_ASSERT_EQUAL_UINT32(4, s->count);
+  TEST_ASSERT_TRUE(s->min == 19.0 && s->max == 25.5 && s->last == 25.5);
+  TEST_ASSERT_TRUE(fabs(s->mean - 21.75) < 1e-9);
+  TEST_ASSERT_EQUAL_UINT32(100, s->firstMs);
+  TEST_ASSERT_EQUAL_UINT32(103, s->lastMs);
+  TEST_ASSERT_EQUAL_INT32(packetID, s->lastPacketID);
+
+  TEST_ASSERT_TRUE(Add(sourceA, "1", 200)); // Next Window Starts Fresh
+  Aggregate_Flush(201);
+  TEST_ASSERT_EQUAL_UINT32(2, emitted);
+  TEST_ASSERT_EQUAL_UINT32(1, summaries[1].count);
+  TEST_ASSERT_TRUE(summaries[1].min == 1.0 && summaries[1].max == 1.0);
+}
+
+void test_time_window_closes_at_its_bound() {
+  Aggregate_Configure(1000, 0);
+  TEST_ASSERT_TRUE(Add(sourceA, "1", 5000));
+  TEST_ASSERT_TRUE(Add(sourceA, "3", 5999));
+  Aggregate_Poll(5999);
+  TEST_ASSERT_EQUAL_UINT32(0, emitted);
+  Aggregate_Poll(6000);
+  TEST_ASSERT_EQUAL_UINT32(1, emitted);
+  TEST_ASSERT_EQUAL_UINT32(2, summaries[0].count);
+  TEST_ASSERT_TRUE(fabs(summaries[0].mean - 2.0) < 1e-9);
+}
+
+void test_late_reading_opens_a_new_window() {
+  // A Reading Taken after the Window's Time is Up belongs to the Next One, Poll or no Poll
+  Aggregate_Configure(1000, 0);
+  TEST_ASSERT_TRUE(Add(sourceA, "1", 5000));
+  TEST_ASSERT_TRUE(Add(sourceA, "9", 6000));
+  TEST_ASSERT_EQUAL_UINT32(1, emitted);
+  TEST_ASSERT_EQUAL_UINT32(1, summaries[0].count);
+  TEST_ASSERT_TRUE(summaries[0].max == 1.0);
+  Aggregate_Flush(6001);
+  TEST_ASSERT_EQUAL_UINT32(6000, summaries[1].firstMs);
+}
+
+void test_sources_keep_separate_windows() {
+  Aggregate_Configure(0, 2);
+  TEST_ASSERT_TRUE(Add(sourceA, "10", 0));
+  TEST_ASSERT_TRUE(Add(sourceB, "100", 1));
+  TEST_ASSERT_EQUAL_UINT32(0, emitted);
+  TEST_ASSERT_TRUE(Add(sourceB, "300", 2));
+  TEST_ASSERT_EQUAL_UINT32(1, emitted);
+  TEST_ASSERT_EQUAL_MEMORY(sourceB, summaries[0].source, MAC_SIZE);
+  TEST_ASSERT_TRUE(fabs(summaries[0].mean - 200.0) < 1e-9);
+}
+
+void test_raw_readings_and_passthrough() {
+  Aggregate_Configure(0, 2);
+  TEST_ASSERT_FALSE(Add(sourceA, "door open", 0));
+  TEST_ASSERT_FALSE(Add(sourceA, "12abc", 0));
+  TEST_ASSERT_FALSE(Add(sourceA, "nan", 0));
+  TEST_ASSERT_TRUE(Add(sourceA, "5", 1));
+  TEST_ASSERT_TRUE(Aggregate_Set_Passthrough(sourceA, true)); // Closes the Open Window
+  TEST_ASSERT_EQUAL_UINT32(1, emitted);
+  TEST_ASSERT_FALSE(Add(sourceA, "6", 2));
+  TEST_ASSERT_TRUE(Aggregate_Set_Passthrough(sourceA, false));
+  TEST_ASSERT_TRUE(Add(sourceA, "7", 3));
+  TEST_ASSERT_EQUAL_UINT32(4, Aggregate_Get_Stats()->raw);
+}
+
+void test_passthrough_list() {
+  Aggregate_Configure(0, 1);
+  TEST_ASSERT_EQUAL_INT(0, Aggregate_Set_Passthrough_List(""));
+  TEST_ASSERT_EQUAL_INT(2, Aggregate_Set_Passthrough_List("24:0a:c4:00:00:0a, 24:0A:C4:00:00:0B"));
+  TEST_ASSERT_FALSE(Add(sourceA, "1", 0));
+  TEST_ASSERT_FALSE(Add(sourceB, "2", 0));
+  TEST_ASSERT_EQUAL_INT(-1, Aggregate_Set_Passthrough_List("24:0A:C4:00:00"));
+  TEST_ASSERT_EQUAL_INT(-1, Aggregate_Set_Passthrough_List("24:0A:C4:00:00:0A;24:0A:C4:00:00:0B"));
+}
+
+void test_quiet_sources_free_their_entry() {
+  Aggregate_Configure(1000, 0);
+  uint8_t source[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x01, 0x00};
+  uint32_t now = 0;
+  for(int round = 0; round < 4; round++) { // Each Round a Fresh Set of AGGREGATE_SOURCES Sources
+    for(int i = 0; i < AGGREGATE_SOURCES; i++) {
+      source[4] = (uint8_t)round;
+      source[5] = (uint8_t)i;
+      TEST_ASSERT_TRUE(Add(source, "1", now));
+    }
+    source[5] = AGGREGATE_SOURCES;
+    TEST_ASSERT_FALSE(Add(source, "1", now)); // Table Full while every Window is Open
+    now += 1000;
+    Aggregate_Poll(now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(4 * AGGREGATE_SOURCES, Aggregate_Get_Stats()->summaries);
+}
+
+void test_refused_summary_counted_lost() {
+  Aggregate_Configure(0, 1);
+  refuse = true;
+  TEST_ASSERT_TRUE(Add(sourceA, "1", 0));
+  TEST_ASSERT_EQUAL_UINT32(1, Aggregate_Get_Stats()->summaries);
+  TEST_ASSERT_EQUAL_UINT32(1, Aggregate_Get_Stats()->lost);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_off_by_default_uploads_raw);
+  RUN_TEST(test_count_window_statistics);
+  RUN_TEST(test_time_window_closes_at_its_bound);
+  RUN_TEST(test_late_reading_opens_a_new_window);
+  RUN_TEST(test_sources_keep_separate_windows);
+  RUN_TEST(test_raw_readings_and_passthrough);
+  RUN_TEST(test_passthrough_list);
+  RUN_TEST(test_quiet_sources_free_their_entry);
+  RUN_TEST(test_refused_summary_counted_lost);
+  return UNITY_END();
+}
@@ -0,0 +1,257 @@
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "compress.h"
+
+/* Gzip output checked by decoding it: a small inflater for the stored and
+   fixed Huffman blocks the encoder may emit walks every stream, and the
+   CRC32 and ISIZE trailer must match the original. Also checks the
+   "would not shrink" path and reports ratio and throughput on a batch of
+   JSON records like the ones the uplink sends */
+
+#define BUFFER_SIZE 8192
+
+static uint8_t input[BUFFER_SIZE];
+static uint8_t packed[BUFFER_SIZE];
+static uint8_t unpacked[BUFFER_SIZE];
+
+typedef struct {
+  const uint8_t *data;
+  size_t len;
+  size_t pos; // In Bits
+  bool overrun;
+} bit_reader_t;
+
+static uint32_t Get_Bits(bit_reader_t *r, int n) {
+  uint32_t value = 0;
+  for(int i = 0; i < n; i++, r->pos++) {
+    if(r->pos / 8 >= r->len) {
+      r->overrun = true;
+      return 0;
+    }
+    value |= (uint32_t)((r->data[r->pos / 8] >> (r->pos % 8)) & 1) << i;
+  }
+  return value;
+}
+
+static uint32_t Get_Code(bit_reader_t *r, int n) { // Huffman Codes Start at their Most Significant Bit
+  uint32_t code = 0;
+  for(int i = 0; i < n; i++) {
+    code = (code << 1) | Get_Bits(r, 1);
+  }
+  return code;
+}
+
+static int Get_Literal_Length(bit_reader_t *r) { // Fixed Code, RFC 1951 3.2.6
+  uint32_t code = Get_Code(r, 7);
+  if(code <= 0x17) {
+    return 256 + code;
+  }
+  code = (code << 1) | Get_Code(r, 1);
+  if(code >= 0x30 && code <= 0xBF) {
+    return code - 0x30;
+  }
+  if(code >= 0xC0 && code <= 0xC7) {
+    return 280 + code - 0xC0;
+  }
+  code = (code << 1) | Get_Code(r, 1);
+  return 144 + code - 0x190;
+}
+
+static const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                          513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static uint32_t Crc32(const uint8_t *data, size_t len) { // Bitwise, Independent of the Encoder's Table
+  uint32_t crc = 0xFFFFFFFF;
+  for(size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for(int k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return crc ^ 0xFFFFFFFF;
+}
+
+static uint32_t Get_U32(const uint8_t *p) {
+  return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Inflates a gzip member into out. Returns the decoded length, or -1 on any malformed stream or trailer mismatch
+static long Gunzip(const uint8_t *gz, size_t len, uint8_t *out, size_t cap) {
+  if(len < 18 || gz[0] != 0x1F || gz[1] != 0x8B || gz[2] != 8 || gz[3] != 0) {
+    return -1; // Deflate, no Optional Header Fields
+  }
+  bit_reader_t r = {gz + 10, len - 18, 0, false};
+  size_t n = 0;
+  uint32_t final;
+  do {
+    final = Get_Bits(&r, 1);
+    uint32_t type = Get_Bits(&r, 2);
+    if(type == 0) { // Stored
+      r.pos = (r.pos + 7) & ~(size_t)7;
+      uint32_t storedLen = Get_Bits(&r, 16);
+      if((Get_Bits(&r, 16) ^ 0xFFFF) != storedLen || n + storedLen > cap) {
+        return -1;
+      }
+      for(uint32_t i = 0; i < storedLen; i++) {
+        out[n++] = (uint8_t)Get_Bits(&r, 8);
+      }
+    } else if(type == 1) {
+      for(;;) {
+        int symbol = Get_Literal_Length(&r);
+        if(r.overrun || symbol > 285) {
+          return -1;
+        }
+        if(symbol < 256) {
+          if(n == cap) {
+            return -1;
+          }
+          out[n++] = (uint8_t)symbol;
+          continue;
+        }
+        if(symbol == 256) {
+          break;
+        }
+        size_t length = lengthBase[symbol - 257] + Get_Bits(&r, lengthExtra[symbol - 257]);
+        uint32_t code = Get_Code(&r, 5);
+        if(code >= 30) {
+          return -1;
+        }
+        size_t distance = distanceBase[code] + Get_Bits(&r, distanceExtra[code]);
+        if(distance > n || n + length > cap) {
+          return -1;
+        }
+        for(size_t i = 0; i < length; i++, n++) {
+          out[n] = out[n - distance]; // Overlapping Copies Repeat the Run
+        }
+      }
+    } else {
+      return -1; // The Encoder Never Builds Dynamic Tables
+    }
+    if(r.overrun) {
+      return -1;
+    }
+  } while(!final);
+
+  if((r.pos + 7) / 8 != len - 18) {
+    return -1; // Trailing Garbage before the Trailer
+  }
+  const uint8_t *trailer = gz + len - 8;
+  if(Get_U32(trailer) != Crc32(out, n) || Get_U32(trailer + 4) != (uint32_t)n) {
+    return -1;
+  }
+  return (long)n;
+}
+
+static uint32_t rng = 1;
+
+static uint32_t Next_Random() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static size_t Fill_Records(uint8_t *buf, size_t cap) { // Uplink-Like Batch of JSON Records
+  size_t n = 0;
+  for(int i = 0; n + 160 < cap; i++) {
+    n += snprintf((char *)buf + n, cap - n,
+                  "{\"sourceMac\":\"24:0A:C4:00:%02X:%02X\",\"packetID\":%d,\"hops\":%u,\"text\":\"%u.%u\",\"priority\":%u}\n",
+                  (unsigned)(Next_Random() & 0x0F), (unsigned)(Next_Random() & 0xFF), 1000 + i,
+                  (unsigned)(Next_Random() % 8), (unsigned)(Next_Random() % 40), (unsigned)(Next_Random() % 10),
+                  (unsigned)(Next_Random() % 3));
+  }
+  return n;
+}
+
+static void Check_Round_Trip(const uint8_t *data, size_t len) {
+  size_t packedLen = Compress_Gzip(data, len, packed, sizeof(packed));
+  TEST_ASSERT_TRUE(packedLen > 0 && packedLen < len);
+  long n = Gunzip(packed, packedLen, unpacked, sizeof(unpacked));
+  TEST_ASSERT_EQUAL_INT32((int32_t)len, (int32_t)n);
+  TEST_ASSERT_EQUAL_MEMORY(data, unpacked, len);
+}
+
+void setUp() {
+  rng = 1;
+}
+void tearDown() {}
+
+void test_records_round_trip() {
+  Check_Round_Trip(input, Fill_Records(input, sizeof(input)));
+}
+
+void test_runs_and_long_matches_round_trip() {
+  memset(input, 'a', 4000); // Distance 1, Lengths up to 258
+  for(size_t i = 4000; i < sizeof(input); i++) {
+    input[i] = "0123456789abcdef"[(i * 7) % 16];
+  }
+  Check_Round_Trip(input, sizeof(input));
+}
+
+void test_every_length_round_trips() {
+  size_t recordsLen = Fill_Records(input, sizeof(input));
+  for(size_t len = 1; len <= 600 && len <= recordsLen; len++) {
+    size_t packedLen = Compress_Gzip(input, len, packed, sizeof(packed));
+    if(packedLen == 0) {
+      continue; // Too Short to Shrink
+    }
+    long n = Gunzip(packed, packedLen, unpacked, sizeof(unpacked));
+    TEST_ASSERT_EQUAL_INT32((int32_t)len, (int32_t)n);
+    TEST_ASSERT_EQUAL_MEMORY(input, unpacked, len);
+  }
+}
+
+void test_incompressible_input_returns_zero() {
+  for(size_t i = 0; i < 2048; i++) {
+    input[i] = (uint8_t)Next_Random();
+  }
+  uint32_t skipped = Compress_Get_Stats()->skipped;
+  TEST_ASSERT_EQUAL_UINT32(0, Compress_Gzip(input, 2048, packed, sizeof(packed)));
+  TEST_ASSERT_EQUAL_UINT32(0, Compress_Gzip(input, 8, packed, sizeof(packed))); // Header and Trailer Alone are 18
+  TEST_ASSERT_EQUAL_UINT32(skipped + 2, Compress_Get_Stats()->skipped);
+}
+
+void test_small_output_buffer_returns_zero() {
+  size_t len = Fill_Records(input, sizeof(input));
+  size_t packedLen = Compress_Gzip(input, len, packed, sizeof(packed));
+  TEST_ASSERT_EQUAL_UINT32(0, Compress_Gzip(input, len, packed, packedLen - 1));
+  TEST_ASSERT_EQUAL_UINT32(packedLen, Compress_Gzip(input, len, packed, packedLen));
+}
+
+void test_report_ratio_and_throughput() {
+  size_t len = Fill_Records(input, sizeof(input));
+  size_t packedLen = 0;
+  const int rounds = 2000;
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < rounds; i++) {
+    packedLen = Compress_Gzip(input, len, packed, sizeof(packed));
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  TEST_ASSERT_TRUE(packedLen > 0);
+
+  for(int i = 0; i < 20; i++) {
+    TEST_ASSERT_EQUAL_INT32((int32_t)len, (int32_t)Gunzip(packed, packedLen, unpacked, sizeof(unpacked)));
+  }
+
+  char line[160];
+  snprintf(line, sizeof(line), "compress.bytes_in=%u compress.bytes_out=%u compress.ratio=%.3f compress.mb_per_s=%.1f",
+           (unsigned)len, (unsigned)packedLen, (double)packedLen / len, len * (double)rounds / seconds / 1e6);
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_round_trip);
+  RUN_TEST(test_runs_and_long_matches_round_trip);
+  RUN_TEST(test_every_length_round_trips);
+  RUN_TEST(test_incompressible_input_returns_zero);
+  RUN_TEST(test_small_output_buffer_returns_zero);
+  RUN_TEST(test_report_ratio_and_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,227 @@
+#include <string.h>
+#include <unity.h>
+#include "datagram.h"
+
+/* Datagram uplink against a scripted receiver: acks are queued by hand
+   and every datagram sent is recorded. Covers cumulative acks, losing the
+   oldest seq until it is given up and skipped, a backwards ack after a
+   receiver restart, placement in a fragmented shared buffer, and the
+   failed callback getting the batch as it was handed in, not gzipped */
+
+#define SENT_MAX 64
+#define QUARTER (DATAGRAM_BUFFER_BYTES / 4)
+
+typedef struct {
+  uint8_t type;
+  uint8_t flags;
+  uint32_t seq;
+  uint32_t floor;
+  size_t len;
+} sent_t;
+
+static datagram_t d;
+static sent_t sent[SENT_MAX];
+static int sentCount = 0;
+static uint8_t acks[8][DATAGRAM_ACK_SIZE];
+static int ackCount = 0;
+static int ackNext = 0;
+static uint8_t failedBody[UPLINK_BATCH_BYTES];
+static size_t failedLen = 0;
+static int failedCount = 0;
+static uint8_t batches[6][UPLINK_BATCH_BYTES];
+
+static uint32_t Get_U32(const uint8_t *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static bool Record_Send(const uint8_t *data, size_t len) {
+  TEST_ASSERT_TRUE(len >= DATAGRAM_HEADER_SIZE && sentCount < SENT_MAX);
+  TEST_ASSERT_EQUAL_UINT32(d.session, Get_U32(&data[2]));
+  sent_t *s = &sent[sentCount++];
+  s->type = data[0];
+  s->flags = data[1];
+  s->seq = Get_U32(&data[6]);
+  s->floor = Get_U32(&data[10]);
+  s->len = len - DATAGRAM_HEADER_SIZE;
+  return true;
+}
+
+static size_t Next_Ack(uint8_t *data, size_t cap) {
+  if(ackNext == ackCount) {
+    return 0;
+  }
+  TEST_ASSERT_TRUE(cap >= DATAGRAM_ACK_SIZE);
+  memcpy(data, acks[ackNext++], DATAGRAM_ACK_SIZE);
+  return DATAGRAM_ACK_SIZE;
+}
+
+static void Record_Failed(const uint8_t *body, size_t len) {
+  memcpy(failedBody, body, len);
+  failedLen = len;
+  failedCount++;
+}
+
+static void Queue_Ack(uint32_t cumulative) {
+  uint8_t *a = acks[ackCount++];
+  memset(a, 0, DATAGRAM_ACK_SIZE);
+  a[0] = DATAGRAM_ACK;
+  for(int i = 0; i < 4; i++) {
+    a[2 + i] = (uint8_t)(d.session >> (8 * i));
+    a[6 + i] = (uint8_t)(cumulative >> (8 * i));
+  }
+}
+
+static bool Send(int batch, size_t len, uint8_t flags, uint32_t now) {
+  return Datagram_Send(&d, batches[batch], len, flags, now);
+}
+
+static const datagram_slot_t *Slot_Of(uint32_t seq) {
+  for(int i = 0; i < DATAGRAM_WINDOW; i++) {
+    if(d.slots[i].used && d.slots[i].seq == seq) {
+      return &d.slots[i];
+    }
+  }
+  return NULL;
+}
+
+void setUp() {
+  sentCount = 0;
+  ackCount = ackNext = 0;
+  failedCount = 0;
+  Datagram_Init(&d, Record_Send, Next_Ack, 0x5EED1234);
+  d.failed = Record_Failed;
+  for(int b = 0; b < 6; b++) {
+    for(size_t i = 0; i < UPLINK_BATCH_BYTES; i++) {
+      batches[b][i] = (uint8_t)('a' + (i / 64 + b) % 26); // Compressible, Different per Batch
+    }
+  }
+}
+void tearDown() {}
+
+void test_cumulative_ack_releases_prefix() {
+  for(int b = 0; b < 3; b++) {
+    TEST_ASSERT_TRUE(Send(b, 100, 0, 0));
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, sent[2].seq);
+  TEST_ASSERT_EQUAL_UINT32(0, sent[2].floor); // Nothing Settled Yet
+  Queue_Ack(2);
+  Datagram_Poll(&d, 10);
+  TEST_ASSERT_EQUAL_UINT32(2, d.stats.acked);
+  TEST_ASSERT_EQUAL_UINT8(1, Datagram_In_Flight(&d));
+  TEST_ASSERT_NOT_NULL(Slot_Of(3));
+}
+
+void test_lost_oldest_is_given_up_then_skipped() {
+  for(int b = 0; b < 3; b++) {
+    TEST_ASSERT_TRUE(Send(b, 100, 0, 0));
+  }
+  // The Receiver Holds 2 and 3 but not 1, so its Cumulative Ack Stays at 0
+  uint32_t now = 0;
+  for(int t = 1; t < DATAGRAM_TRIES; t++) {
+    now += DATAGRAM_RTO_MS << (t - 1);
+    Datagram_Poll(&d, now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(3 * DATAGRAM_TRIES, (uint32_t)sentCount);
+  now += DATAGRAM_RTO_MS << (DATAGRAM_TRIES - 1);
+  Datagram_Poll(&d, now);
+
+  TEST_ASSERT_EQUAL_INT(1, failedCount); // Only the Oldest
+  TEST_ASSERT_EQUAL_UINT32(100, failedLen);
+  TEST_ASSERT_EQUAL_MEMORY(batches[0], failedBody, 100);
+  const sent_t *skip = &sent[sentCount - 1];
+  TEST_ASSERT_EQUAL_UINT8(DATAGRAM_SKIP, skip->type);
+  TEST_ASSERT_EQUAL_UINT32(1, skip->floor);
+  TEST_ASSERT_EQUAL_UINT32(0, skip->len);
+  TEST_ASSERT_EQUAL_UINT8(2, Datagram_In_Flight(&d)); // 2 and 3 Wait for the Skip's Ack
+
+  Queue_Ack(3); // Floor Stepped the Receiver past the Hole
+  Datagram_Poll(&d, now + 1);
+  TEST_ASSERT_EQUAL_UINT8(0, Datagram_In_Flight(&d));
+  TEST_ASSERT_EQUAL_INT(1, failedCount);
+  TEST_ASSERT_EQUAL_UINT32(1, d.stats.skips);
+}
+
+void test_backwards_ack_resends_window() {
+  for(int b = 0; b < 3; b++) {
+    TEST_ASSERT_TRUE(Send(b, 100, 0, 0));
+  }
+  Queue_Ack(2);
+  Datagram_Poll(&d, 10);
+  int before = sentCount;
+
+  Queue_Ack(0); // Receiver Restarted and Knows Nothing
+  Datagram_Poll(&d, 20);
+  TEST_ASSERT_EQUAL_UINT32(1, d.stats.resyncs);
+  TEST_ASSERT_EQUAL_INT(before + 1, sentCount); // Sent Again at once, not on Timeout
+  TEST_ASSERT_EQUAL_UINT32(3, sent[before].seq);
+  TEST_ASSERT_EQUAL_UINT32(2, sent[before].floor); // Lets it Start from 2
+  TEST_ASSERT_EQUAL_UINT8(1, Slot_Of(3)->tries); // A Resync Uses no Try
+
+  Queue_Ack(3);
+  Datagram_Poll(&d, 30);
+  TEST_ASSERT_EQUAL_UINT8(0, Datagram_In_Flight(&d));
+}
+
+void test_place_in_fragmented_buffer() {
+  // In Quarters of the Shared Buffer: seq 1 [0, 1), 2 [1, 1.5), 3 [1.5, 2), 4 [2, 2.5)
+  TEST_ASSERT_TRUE(Send(0, QUARTER, 0, 0));
+  TEST_ASSERT_TRUE(Send(1, QUARTER / 2, 0, 0));
+  TEST_ASSERT_TRUE(Send(2, QUARTER / 2, 0, 0));
+  TEST_ASSERT_TRUE(Send(3, QUARTER / 2, 0, 0));
+  Queue_Ack(1); // Frees the Front Quarter
+  Datagram_Poll(&d, 1);
+
+  TEST_ASSERT_TRUE(Send(4, QUARTER + QUARTER / 4, 0, 1)); // Too Big for the Front Gap: [2.5, 3.75)
+  TEST_ASSERT_EQUAL_UINT16(2 * QUARTER + QUARTER / 2, Slot_Of(5)->offset);
+  Queue_Ack(2); // Two Gaps now: [0, 1.5) and [3.75, 4) Quarters
+  Datagram_Poll(&d, 2);
+
+  TEST_ASSERT_FALSE(Datagram_Can_Send(&d)); // No Gap Holds a Whole Batch
+  TEST_ASSERT_FALSE(Send(5, QUARTER + QUARTER / 2 + 1, 0, 2)); // 1.75 Quarters Free, but not in One Gap
+  TEST_ASSERT_EQUAL_UINT32(1, d.stats.full);
+  TEST_ASSERT_TRUE(Send(5, QUARTER + QUARTER / 2, 0, 2)); // Fills the Front Gap Exactly
+  TEST_ASSERT_EQUAL_UINT16(0, Slot_Of(6)->offset);
+
+  static const int batchOf[] = {0, 0, 0, 2, 3, 4, 5}; // Seq -> Batch
+  for(uint32_t seq = 3; seq <= 6; seq++) {
+    const datagram_slot_t *slot = Slot_Of(seq);
+    TEST_ASSERT_NOT_NULL(slot);
+    TEST_ASSERT_EQUAL_MEMORY(batches[batchOf[seq]], &d.buffer[slot->offset], slot->len); // No Overlap
+  }
+}
+
+void test_failed_callback_gets_uncompressed_body() {
+  TEST_ASSERT_TRUE(Send(0, 4000, DATAGRAM_FLAG_GZIP, 0));
+  TEST_ASSERT_TRUE(sent[0].flags & DATAGRAM_FLAG_GZIP);
+  TEST_ASSERT_TRUE(sent[0].len < 4000);
+
+  uint32_t now = 0;
+  for(int t = 1; t <= DATAGRAM_TRIES; t++) {
+    now += DATAGRAM_RTO_MS << (t - 1);
+    Datagram_Poll(&d, now);
+  }
+  TEST_ASSERT_EQUAL_INT(1, failedCount);
+  TEST_ASSERT_EQUAL_UINT32(4000, failedLen);
+  TEST_ASSERT_EQUAL_MEMORY(batches[0], failedBody, 4000);
+}
+
+void test_stray_acks_counted() {
+  TEST_ASSERT_TRUE(Send(0, 100, 0, 0));
+  d.session ^= 1;
+  Queue_Ack(1); // Another Session
+  d.session ^= 1;
+  Datagram_Poll(&d, 1);
+  TEST_ASSERT_EQUAL_UINT32(1, d.stats.stray);
+  TEST_ASSERT_EQUAL_UINT8(1, Datagram_In_Flight(&d));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_cumulative_ack_releases_prefix);
+  RUN_TEST(test_lost_oldest_is_given_up_then_skipped);
+  RUN_TEST(test_backwards_ack_resends_window);
+  RUN_TEST(test_place_in_fragmented_buffer);
+  RUN_TEST(test_failed_callback_gets_uncompressed_body);
+  RUN_TEST(test_stray_acks_counted);
+  return UNITY_END();
+}
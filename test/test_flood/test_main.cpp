@@ -0,0 +1,128 @@
+#include <string.h>
+#include <unity.h>
+#include "flood.h"
+#include "wire_format.h"
+
+/* Controlled flooding: first copies delivered and repeated once, later
+   copies suppressed, k copies cancelling a rebroadcast, and the shared
+   duplicate cache staying consistent with unicast after Hal_Micros()
+   wraps (about 71.6 minutes after boot) while Hal_Millis() does not */
+
+static dedup_cache_t seen;
+static flood_t flood;
+static uint32_t sent = 0;
+static message_t lastSent;
+
+static const uint8_t self[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+static const uint8_t origin[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x0F};
+
+static bool Record_Send(void *ctx, const uint8_t *frame, size_t len) {
+  (void)ctx;
+  sent++;
+  TEST_ASSERT_TRUE(Wire_Decode(frame, len, &lastSent));
+  return true;
+}
+
+static message_t Broadcast(int32_t packetID, uint8_t ttl) {
+  message_t packet;
+  memset(&packet, 0, sizeof(packet));
+  memset(packet.destination_mac, 0xFF, MAC_SIZE);
+  memcpy(packet.source_mac, origin, MAC_SIZE);
+  memcpy(packet.Path_Array[0], origin, MAC_SIZE);
+  packet.Path_Index = 1;
+  packet.Path_Length = 1;
+  packet.TTL = ttl;
+  packet.packetID = packetID;
+  strcpy((char *)packet.text, "flood");
+  return packet;
+}
+
+// Both HAL clocks at the same instant: micros wraps, millis does not
+static uint32_t Micros_At(uint32_t ms) {
+  return (uint32_t)((uint64_t)ms * 1000);
+}
+
+void setUp() {
+  sent = 0;
+  Dedup_Init(&seen);
+  Flood_Init(&flood, Record_Send, NULL, self, &seen);
+}
+void tearDown() {}
+
+void test_first_copy_delivered_and_relayed() {
+  message_t packet = Broadcast(1, 3);
+  TEST_ASSERT_TRUE(Flood_On_Receive(&flood, &packet, 0, 0));
+  TEST_ASSERT_FALSE(Flood_On_Receive(&flood, &packet, 100, 0));
+  Flood_Poll(&flood, FLOOD_JITTER_US);
+  TEST_ASSERT_EQUAL_UINT32(1, sent);
+  TEST_ASSERT_EQUAL_UINT8(2, lastSent.TTL);
+  TEST_ASSERT_EQUAL_UINT8(2, lastSent.Path_Index);
+  TEST_ASSERT_EQUAL_MEMORY(self, lastSent.Path_Array[1], MAC_SIZE);
+  TEST_ASSERT_EQUAL_UINT32(1, flood.stats.duplicates);
+}
+
+void test_k_copies_cancel_rebroadcast() {
+  message_t packet = Broadcast(2, 3);
+  TEST_ASSERT_TRUE(Flood_On_Receive(&flood, &packet, 0, 0));
+  for(int i = 1; i < FLOOD_K; i++) {
+    TEST_ASSERT_FALSE(Flood_On_Receive(&flood, &packet, i, 0));
+  }
+  Flood_Poll(&flood, FLOOD_JITTER_US);
+  TEST_ASSERT_EQUAL_UINT32(0, sent);
+  TEST_ASSERT_EQUAL_UINT32(1, flood.stats.suppressed);
+}
+
+void test_last_hop_is_not_relayed() {
+  message_t packet = Broadcast(3, 1);
+  TEST_ASSERT_TRUE(Flood_On_Receive(&flood, &packet, 0, 0));
+  Flood_Poll(&flood, FLOOD_JITTER_US);
+  TEST_ASSERT_EQUAL_UINT32(0, sent);
+  TEST_ASSERT_EQUAL_UINT32(1, flood.stats.expired);
+}
+
+void test_rebroadcast_due_across_micros_wrap() {
+  uint32_t ms = 4294967 - 5; // 5 ms before Hal_Micros() Wraps
+  message_t packet = Broadcast(4, 3);
+  TEST_ASSERT_TRUE(Flood_On_Receive(&flood, &packet, Micros_At(ms), ms));
+  ms += FLOOD_JITTER_US / 1000 + 1; // Due Falls on Either Side of the Wrap
+  Flood_Poll(&flood, Micros_At(ms));
+  TEST_ASSERT_EQUAL_UINT32(1, sent);
+}
+
+void test_shared_cache_consistent_after_micros_wrap() {
+  // 10 Minutes past the Wrap: Hal_Micros() is Small Again, Hal_Millis() is Not
+  uint32_t ms = 4294967 + 600000;
+  uint8_t unicast[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x01, 0x00};
+  const int floods = 32;
+  const int unicasts = DEDUP_CACHE_SIZE / 2;
+
+  for(int32_t id = 0; id < floods; id++) {
+    message_t packet = Broadcast(1000 + id, 1);
+    TEST_ASSERT_TRUE(Flood_On_Receive(&flood, &packet, Micros_At(ms), ms));
+  }
+  for(int32_t id = 0; id < unicasts; id++) { // The Unicast Path Stamps Hal_Millis()
+    unicast[5] = (uint8_t)id;
+    TEST_ASSERT_FALSE(Dedup_Check_And_Insert(&seen, unicast, id, ms + 1));
+  }
+
+  ms += 10;
+  for(int32_t id = 0; id < floods; id++) {
+    message_t packet = Broadcast(1000 + id, 1);
+    TEST_ASSERT_FALSE(Flood_On_Receive(&flood, &packet, Micros_At(ms), ms)); // Repeats, not Delivered Again
+  }
+  for(int32_t id = 0; id < unicasts; id++) {
+    unicast[5] = (uint8_t)id;
+    TEST_ASSERT_TRUE(Dedup_Check_And_Insert(&seen, unicast, id, ms));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, seen.evictions);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_copy_delivered_and_relayed);
+  RUN_TEST(test_k_copies_cancel_rebroadcast);
+  RUN_TEST(test_last_hop_is_not_relayed);
+  RUN_TEST(test_rebroadcast_due_across_micros_wrap);
+  RUN_TEST(test_shared_cache_consistent_after_micros_wrap);
+  return UNITY_END();
+}
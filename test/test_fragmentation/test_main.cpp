@@ -0,0 +1,294 @@
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "reassembly.h"
+#include "wire_format.h"
+
+/* Fragmentation: payloads split with Wire_Fragment_Chunk, carried as
+   fragment frames and rebuilt by the reassembly pool, in and out of order,
+   with repeats and timeouts. A fragment frame exactly WIRE_LEGACY_SIZE long
+   must still be taken as a fragment. Payloads share one pool, so several
+   large ones evict the oldest partial one rather than failing. Reports
+   payload bytes/s through encode, decode and reassembly, and wire bytes
+   per payload byte, against the same data sent as 64-byte text packets */
+
+#define BENCH_PAYLOADS 20000
+
+static const uint8_t sensor[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x02};
+static uint8_t payload[REASSEMBLY_MAX_BYTES];
+static uint16_t nextMessageID = 1;
+
+static void Make_Header(message_t *msg, uint8_t hops) {
+  memset(msg, 0, sizeof(*msg));
+  msg->TTL = 7;
+  msg->identification = 2;
+  memcpy(msg->source_mac, sensor, MAC_SIZE);
+  for(uint8_t i = 0; i < hops; i++) {
+    memcpy(msg->Path_Array[i], sensor, MAC_SIZE);
+    msg->Path_Array[i][MAC_SIZE - 1] = (uint8_t)(0x10 + i);
+  }
+  msg->Path_Index = hops;
+  msg->Path_Length = hops;
+}
+
+// Split len payload bytes into frames of at most chunk bytes each; returns the fragment count
+static uint8_t Split(const message_t *msg, size_t len, size_t chunk, uint8_t frames[][ESPNOW_MTU], size_t *sizes) {
+  fragment_t fragment;
+  uint8_t count = (uint8_t)((len + chunk - 1) / chunk);
+  fragment.messageID = nextMessageID++;
+  fragment.count = count;
+  fragment.total = (uint16_t)len;
+  for(uint8_t i = 0; i < count; i++) {
+    fragment.index = i;
+    fragment.offset = (uint16_t)(i * chunk);
+    fragment.len = (uint8_t)(len - fragment.offset < chunk ? len - fragment.offset : chunk);
+    memcpy(fragment.data, &payload[fragment.offset], fragment.len);
+    sizes[i] = Wire_Encode_Fragment(msg, &fragment, frames[i], ESPNOW_MTU);
+    TEST_ASSERT_GREATER_THAN(0, sizes[i]);
+  }
+  return count;
+}
+
+// Feed one frame to the pool as the gateway's receive path would
+static reassembly_result Deliver(const uint8_t *frame, size_t len, uint32_t now, const uint8_t **out, uint16_t *outLen) {
+  message_t msg;
+  fragment_t fragment;
+  TEST_ASSERT_TRUE(Wire_Is_Fragment(frame, len));
+  TEST_ASSERT_TRUE(Wire_Decode_Fragment(frame, len, &msg, &fragment));
+  return Reassembly_Add(msg.source_mac, &fragment, now, out, outLen);
+}
+
+void setUp() {
+  Reassembly_Init();
+  for(size_t i = 0; i < sizeof(payload); i++) {
+    payload[i] = (uint8_t)(i * 7 + 3);
+  }
+}
+void tearDown() {}
+
+void test_round_trip_sizes_and_hops() {
+  static const size_t sizes[] = {1, FRAGMENT_DATA_MAX, FRAGMENT_DATA_MAX + 1, 600, REASSEMBLY_MAX_BYTES};
+  static uint8_t frames[REASSEMBLY_MAX_FRAGMENTS][ESPNOW_MTU];
+  size_t frameLen[REASSEMBLY_MAX_FRAGMENTS];
+  for(uint8_t hops = 0; hops < MAX_NODES; hops += 4) {
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      message_t msg;
+      Make_Header(&msg, hops);
+      uint8_t count = Split(&msg, sizes[s], Wire_Fragment_Chunk(hops), frames, frameLen);
+      const uint8_t *out = NULL;
+      uint16_t outLen = 0;
+      for(uint8_t i = 0; i < count; i++) {
+        reassembly_result result = Deliver(frames[i], frameLen[i], 0, &out, &outLen);
+        TEST_ASSERT_EQUAL(i + 1 == count ? REASSEMBLY_COMPLETE : REASSEMBLY_PENDING, result);
+      }
+      TEST_ASSERT_EQUAL(sizes[s], outLen);
+      TEST_ASSERT_EQUAL_MEMORY(payload, out, outLen);
+      Reassembly_Release(out);
+    }
+  }
+}
+
+void test_legacy_sized_fragment_round_trip() {
+  // Header, no Path, Fragment Header and a 120 Byte Chunk: exactly WIRE_LEGACY_SIZE
+  size_t chunk = WIRE_LEGACY_SIZE - WIRE_HEADER_SIZE - WIRE_FRAGMENT_HEADER_SIZE;
+  static uint8_t frames[2][ESPNOW_MTU];
+  size_t frameLen[2];
+  message_t msg, legacy;
+  Make_Header(&msg, 0);
+  uint8_t count = Split(&msg, 2 * chunk, chunk, frames, frameLen);
+  TEST_ASSERT_EQUAL(2, count);
+  TEST_ASSERT_EQUAL(WIRE_LEGACY_SIZE, frameLen[0]);
+  TEST_ASSERT_FALSE(Wire_Decode(frames[0], frameLen[0], &legacy)); // Not a Legacy Data Frame
+
+  const uint8_t *out = NULL;
+  uint16_t outLen = 0;
+  TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, Deliver(frames[0], frameLen[0], 0, &out, &outLen));
+  TEST_ASSERT_EQUAL(REASSEMBLY_COMPLETE, Deliver(frames[1], frameLen[1], 0, &out, &outLen));
+  TEST_ASSERT_EQUAL(2 * chunk, outLen);
+  TEST_ASSERT_EQUAL_MEMORY(payload, out, outLen);
+  Reassembly_Release(out);
+}
+
+void test_out_of_order_with_repeats() {
+  static uint8_t frames[REASSEMBLY_MAX_FRAGMENTS][ESPNOW_MTU];
+  size_t frameLen[REASSEMBLY_MAX_FRAGMENTS];
+  message_t msg;
+  Make_Header(&msg, 2);
+  uint8_t count = Split(&msg, 800, Wire_Fragment_Chunk(2), frames, frameLen);
+  TEST_ASSERT_GREATER_THAN(2, count);
+
+  const uint8_t *out = NULL;
+  uint16_t outLen = 0;
+  for(int i = count - 1; i > 0; i--) { // Last First, each Twice
+    TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, Deliver(frames[i], frameLen[i], 0, &out, &outLen));
+    TEST_ASSERT_EQUAL(REASSEMBLY_DUPLICATE, Deliver(frames[i], frameLen[i], 0, &out, &outLen));
+  }
+  TEST_ASSERT_EQUAL(REASSEMBLY_COMPLETE, Deliver(frames[0], frameLen[0], 0, &out, &outLen));
+  TEST_ASSERT_EQUAL_MEMORY(payload, out, 800);
+  Reassembly_Release(out);
+  TEST_ASSERT_EQUAL(REASSEMBLY_DUPLICATE, Deliver(frames[1], frameLen[1], 0, &out, &outLen)); // Late Repeat
+}
+
+void test_partial_payload_times_out() {
+  static uint8_t frames[REASSEMBLY_MAX_FRAGMENTS][ESPNOW_MTU];
+  size_t frameLen[REASSEMBLY_MAX_FRAGMENTS];
+  message_t msg;
+  Make_Header(&msg, 1);
+  Split(&msg, 500, Wire_Fragment_Chunk(1), frames, frameLen);
+
+  const uint8_t *out = NULL;
+  uint16_t outLen = 0;
+  TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, Deliver(frames[0], frameLen[0], 1000, &out, &outLen));
+  Reassembly_Expire(1000 + REASSEMBLY_TIMEOUT_MS + 1);
+  TEST_ASSERT_EQUAL_UINT32(1, Reassembly_Get_Stats()->timedOut);
+  TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, Deliver(frames[1], frameLen[1], 1000 + REASSEMBLY_TIMEOUT_MS + 2, &out, &outLen));
+}
+
+void test_pool_shared_by_large_payloads() {
+  static uint8_t frames[3][REASSEMBLY_MAX_FRAGMENTS][ESPNOW_MTU];
+  size_t frameLen[3][REASSEMBLY_MAX_FRAGMENTS];
+  uint8_t count[3];
+  message_t msg;
+  Make_Header(&msg, 0);
+  for(int p = 0; p < 3; p++) {
+    count[p] = Split(&msg, REASSEMBLY_MAX_BYTES, FRAGMENT_DATA_MAX, frames[p], frameLen[p]);
+  }
+
+  const uint8_t *out = NULL;
+  uint16_t outLen = 0;
+  for(int p = 0; p < 3; p++) { // The Third does not Fit beside the Others: the Oldest Partial Goes
+    TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, Deliver(frames[p][0], frameLen[p][0], (uint32_t)p, &out, &outLen));
+  }
+  TEST_ASSERT_EQUAL_UINT32(REASSEMBLY_POOL_BYTES / REASSEMBLY_MAX_BYTES < 3 ? 1 : 0, Reassembly_Get_Stats()->evicted);
+
+  for(int p = 1; p < 3; p++) {
+    for(uint8_t i = 1; i < count[p]; i++) {
+      Deliver(frames[p][i], frameLen[p][i], 10, &out, &outLen);
+    }
+    TEST_ASSERT_EQUAL(REASSEMBLY_MAX_BYTES, outLen);
+    TEST_ASSERT_EQUAL_MEMORY(payload, out, outLen); // Neighbours in the Pool Never Overlap
+  }
+  if(REASSEMBLY_POOL_BYTES < 3 * REASSEMBLY_MAX_BYTES) { // Both Delivered Payloads Held: no Room for Another
+    TEST_ASSERT_EQUAL(REASSEMBLY_NO_ROOM, Deliver(frames[0][0], frameLen[0][0], 20, &out, &outLen));
+  }
+}
+
+void test_small_payloads_use_every_slot() {
+  static uint8_t frames[REASSEMBLY_SLOTS][2][ESPNOW_MTU];
+  size_t frameLen[REASSEMBLY_SLOTS][2];
+  message_t msg;
+  Make_Header(&msg, 0);
+  const uint8_t *out = NULL;
+  uint16_t outLen = 0;
+  for(int p = 0; p < REASSEMBLY_SLOTS; p++) {
+    Split(&msg, 300, FRAGMENT_DATA_MAX, frames[p], frameLen[p]);
+    TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, Deliver(frames[p][0], frameLen[p][0], 0, &out, &outLen));
+  }
+  for(int p = 0; p < REASSEMBLY_SLOTS; p++) {
+    TEST_ASSERT_EQUAL(REASSEMBLY_COMPLETE, Deliver(frames[p][1], frameLen[p][1], 0, &out, &outLen));
+    TEST_ASSERT_EQUAL_MEMORY(payload, out, 300);
+    Reassembly_Release(out);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, Reassembly_Get_Stats()->evicted);
+}
+
+void test_bench_bytes_per_second() {
+  static uint8_t frames[REASSEMBLY_MAX_FRAGMENTS][ESPNOW_MTU];
+  size_t frameLen[REASSEMBLY_MAX_FRAGMENTS];
+  message_t msg;
+  Make_Header(&msg, 2);
+  size_t chunk = Wire_Fragment_Chunk(2);
+  uint64_t wireBytes = 0;
+  auto started = std::chrono::steady_clock::now();
+  for(int n = 0; n < BENCH_PAYLOADS; n++) {
+    uint8_t count = Split(&msg, REASSEMBLY_MAX_BYTES, chunk, frames, frameLen);
+    const uint8_t *out = NULL;
+    uint16_t outLen = 0;
+    for(uint8_t i = 0; i < count; i++) {
+      wireBytes += frameLen[i];
+      Deliver(frames[i], frameLen[i], (uint32_t)n, &out, &outLen);
+    }
+    TEST_ASSERT_EQUAL(REASSEMBLY_MAX_BYTES, outLen);
+    Reassembly_Release(out);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  char line[128];
+  snprintf(line, sizeof(line), "fragment.payload_bytes=%u fragment.bytes_per_s=%.0f fragment.wire_per_payload_byte=%.3f",
+           (unsigned)REASSEMBLY_MAX_BYTES, (double)BENCH_PAYLOADS * REASSEMBLY_MAX_BYTES / seconds,
+           (double)wireBytes / ((double)BENCH_PAYLOADS * REASSEMBLY_MAX_BYTES));
+  TEST_MESSAGE(line);
+}
+
+void test_compare_with_64_byte_packets() {
+  // The same Payload as Plain Data Packets of 64 Text Bytes each, as Nodes Sent it before Fragmentation
+  static uint8_t frames[REASSEMBLY_MAX_FRAGMENTS][ESPNOW_MTU];
+  size_t frameLen[REASSEMBLY_MAX_FRAGMENTS];
+  const size_t len = REASSEMBLY_MAX_BYTES;
+  const int rounds = 2000;
+  message_t msg;
+  Make_Header(&msg, 2);
+  size_t chunk = Wire_Fragment_Chunk(2);
+
+  uint64_t fragmentBytes = 0;
+  uint32_t fragmentFrames = 0;
+  auto started = std::chrono::steady_clock::now();
+  for(int n = 0; n < rounds; n++) {
+    uint8_t count = Split(&msg, len, chunk, frames, frameLen);
+    const uint8_t *out = NULL;
+    uint16_t outLen = 0;
+    for(uint8_t i = 0; i < count; i++) {
+      fragmentBytes += frameLen[i];
+      Deliver(frames[i], frameLen[i], (uint32_t)n, &out, &outLen);
+    }
+    fragmentFrames += count;
+    Reassembly_Release(out);
+  }
+  double fragmentSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  uint64_t packetBytes = 0;
+  uint32_t packetFrames = 0;
+  uint8_t frame[ESPNOW_MTU];
+  message_t decoded;
+  started = std::chrono::steady_clock::now();
+  for(int n = 0; n < rounds; n++) {
+    for(size_t offset = 0; offset < len; offset += sizeof(msg.text)) {
+      size_t take = len - offset < sizeof(msg.text) ? len - offset : sizeof(msg.text);
+      for(size_t i = 0; i < take; i++) {
+        msg.text[i] = (uint8_t)('!' + payload[offset + i] % 90); // Text Cannot Carry a Zero Byte
+      }
+      if(take < sizeof(msg.text)) {
+        msg.text[take] = '\0';
+      }
+      msg.packetID++;
+      size_t frameBytes = Wire_Encode(&msg, frame, sizeof(frame));
+      TEST_ASSERT_TRUE(Wire_Decode(frame, frameBytes, &decoded));
+      packetBytes += frameBytes;
+      packetFrames++;
+    }
+  }
+  double packetSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  TEST_ASSERT_TRUE(fragmentFrames < packetFrames && fragmentBytes < packetBytes);
+
+  char line[200];
+  snprintf(line, sizeof(line), "fragment.frames=%u fragment.wire_bytes=%u fragment.ns_per_payload=%.0f",
+           (unsigned)(fragmentFrames / rounds), (unsigned)(fragmentBytes / rounds), fragmentSeconds * 1e9 / rounds);
+  TEST_MESSAGE(line);
+  snprintf(line, sizeof(line), "packets64.frames=%u packets64.wire_bytes=%u packets64.ns_per_payload=%.0f",
+           (unsigned)(packetFrames / rounds), (unsigned)(packetBytes / rounds), packetSeconds * 1e9 / rounds);
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_sizes_and_hops);
+  RUN_TEST(test_legacy_sized_fragment_round_trip);
+  RUN_TEST(test_out_of_order_with_repeats);
+  RUN_TEST(test_partial_payload_times_out);
+  RUN_TEST(test_pool_shared_by_large_payloads);
+  RUN_TEST(test_small_payloads_use_every_slot);
+  RUN_TEST(test_bench_bytes_per_second);
+  RUN_TEST(test_compare_with_64_byte_packets);
+  return UNITY_END();
+}
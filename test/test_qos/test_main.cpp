@@ -0,0 +1,89 @@
+#include <unity.h>
+#include "qos.h"
+
+/* Class scheduler: a waiting alarm is always picked first, and with
+   normal and bulk both backlogged the long-run share of each matches its
+   weight, while a class with nothing waiting hands its turn on */
+
+#define ALARM (1u << PRIORITY_ALARM)
+#define NORMAL (1u << PRIORITY_NORMAL)
+#define BULK (1u << PRIORITY_BULK)
+
+static qos_scheduler_t q;
+
+void setUp() {
+  Qos_Init(&q);
+}
+void tearDown() {}
+
+void test_nothing_ready() {
+  TEST_ASSERT_EQUAL_INT(-1, Qos_Pick(&q, 0));
+}
+
+void test_alarm_always_wins() {
+  for(int i = 0; i < 1000; i++) {
+    uint8_t ready = (uint8_t)(ALARM | (i % 2 ? NORMAL : 0) | (i % 3 ? BULK : 0));
+    TEST_ASSERT_EQUAL_INT(PRIORITY_ALARM, Qos_Pick(&q, ready));
+  }
+  TEST_ASSERT_EQUAL_UINT32(1000, q.served[PRIORITY_ALARM]);
+  TEST_ASSERT_EQUAL_UINT32(0, q.served[PRIORITY_NORMAL] + q.served[PRIORITY_BULK]);
+}
+
+void test_alarm_between_rounds_keeps_the_share() {
+  // Alarms Interleaved with a Backlog do not Cost Normal or Bulk their Turn
+  uint32_t picks = 0;
+  for(int i = 0; i < 10000; i++) {
+    if(i % 7 == 0) {
+      TEST_ASSERT_EQUAL_INT(PRIORITY_ALARM, Qos_Pick(&q, ALARM | NORMAL | BULK));
+      continue;
+    }
+    Qos_Pick(&q, NORMAL | BULK);
+    picks++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(picks, q.served[PRIORITY_NORMAL] + q.served[PRIORITY_BULK]);
+  TEST_ASSERT_UINT32_WITHIN(QOS_WEIGHT_NORMAL + QOS_WEIGHT_BULK,
+                            picks * QOS_WEIGHT_BULK / (QOS_WEIGHT_NORMAL + QOS_WEIGHT_BULK), q.served[PRIORITY_BULK]);
+}
+
+void test_weighted_share_when_backlogged() {
+  const uint32_t rounds = 10000;
+  const uint32_t total = rounds * (QOS_WEIGHT_NORMAL + QOS_WEIGHT_BULK);
+  for(uint32_t i = 0; i < total; i++) {
+    Qos_Pick(&q, NORMAL | BULK);
+  }
+  TEST_ASSERT_EQUAL_UINT32(rounds * QOS_WEIGHT_NORMAL, q.served[PRIORITY_NORMAL]);
+  TEST_ASSERT_EQUAL_UINT32(rounds * QOS_WEIGHT_BULK, q.served[PRIORITY_BULK]);
+}
+
+void test_bulk_never_starved() {
+  // Within any Run of one Round's Picks, Bulk gets its Weight
+  int sinceBulk = 0;
+  for(int i = 0; i < 1000; i++) {
+    if(Qos_Pick(&q, NORMAL | BULK) == PRIORITY_BULK) {
+      sinceBulk = 0;
+    } else {
+      sinceBulk++;
+      TEST_ASSERT_TRUE(sinceBulk <= QOS_WEIGHT_NORMAL);
+    }
+  }
+}
+
+void test_idle_class_hands_on_its_turn() {
+  for(int i = 0; i < 50; i++) {
+    TEST_ASSERT_EQUAL_INT(PRIORITY_BULK, Qos_Pick(&q, BULK));
+  }
+  for(int i = 0; i < 50; i++) {
+    TEST_ASSERT_EQUAL_INT(PRIORITY_NORMAL, Qos_Pick(&q, NORMAL));
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_nothing_ready);
+  RUN_TEST(test_alarm_always_wins);
+  RUN_TEST(test_alarm_between_rounds_keeps_the_share);
+  RUN_TEST(test_weighted_share_when_backlogged);
+  RUN_TEST(test_bulk_never_starved);
+  RUN_TEST(test_idle_class_hands_on_its_turn);
+  return UNITY_END();
+}
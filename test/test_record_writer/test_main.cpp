@@ -0,0 +1,122 @@
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <string.h>
+#include <unity.h>
+#include "record_writer.h"
+
+/* Record serializer: exact JSON for a known record (escaping included),
+   the MessagePack map shape, the no-truncation rule, then ns and bytes per
+   record for JSON and MessagePack against building the same JSON in a
+   heap string, as the DynamicJsonDocument/String path used to */
+
+#define BENCH_RECORDS 200000
+
+static message_t msg;
+
+void setUp() {
+  memset(&msg, 0, sizeof(msg));
+  strcpy((char *)msg.text, "Say \"hi\"\n\x01");
+  msg.TTL = 5;
+  msg.identification = 2;
+  msg.packetID = -7;
+  msg.Path_Index = 1;
+  msg.Path_Length = 1;
+  msg.Path_Array[0][5] = 0xAB;
+  msg.source_mac[0] = 0x24;
+  msg.source_mac[5] = 0x02;
+}
+void tearDown() {}
+
+void test_json_exact() {
+  static const char expected[] =
+      "{\"text\":\"Say \\\"hi\\\"\\u000a\\u0001\",\"TTL\":5,\"identification\":2,\"broadcast_Ack\":false,\"Data_Ack\":false,"
+      "\"packetID\":-7,\"Path_Index\":1,\"Path_Length\":1,\"Path_Exist\":false,\"Path_Array\":[[0,0,0,0,0,171],[0,0,0,0,0,0]],"
+      "\"SourceMAC\":[36,0,0,0,0,2]}";
+  uint8_t out[RECORD_JSON_MAX];
+  size_t len = Record_Write(&msg, RECORD_JSON, out, sizeof(out));
+  TEST_ASSERT_EQUAL(sizeof(expected) - 1, len);
+  TEST_ASSERT_EQUAL_MEMORY(expected, out, len);
+}
+
+void test_json_payload_and_priority() {
+  static const uint8_t payload[5] = {1, 2, 3, 4, 5};
+  msg.priority = PRIORITY_ALARM;
+  uint8_t out[RECORD_JSON_MAX];
+  size_t len = Record_Write_Payload(&msg, payload, sizeof(payload), RECORD_JSON, out, sizeof(out));
+  std::string json((const char *)out, len);
+  TEST_ASSERT_TRUE(json.find(",\"priority\":\"alarm\"") != std::string::npos);
+  TEST_ASSERT_TRUE(json.find(",\"payload\":\"AQIDBAU=\"}") == json.size() - strlen(",\"payload\":\"AQIDBAU=\"}"));
+}
+
+void test_msgpack_map_shape() {
+  uint8_t out[RECORD_MSGPACK_MAX];
+  size_t len = Record_Write(&msg, RECORD_MSGPACK, out, sizeof(out));
+  TEST_ASSERT_GREATER_THAN(0, len);
+  TEST_ASSERT_EQUAL_HEX8(0x8B, out[0]); // fixmap, 11 Keys (as in JSON)
+  TEST_ASSERT_EQUAL_HEX8(0xA4, out[1]); // fixstr "text"
+  TEST_ASSERT_EQUAL_MEMORY("text", &out[2], 4);
+  TEST_ASSERT_EQUAL_HEX8(0xAA, out[6]); // Text itself, Unescaped
+  TEST_ASSERT_EQUAL_MEMORY(msg.text, &out[7], 10);
+}
+
+void test_never_truncates() {
+  uint8_t out[RECORD_JSON_MAX];
+  for(int f = RECORD_JSON; f <= RECORD_MSGPACK; f++) {
+    size_t len = Record_Write(&msg, (record_format)f, out, sizeof(out));
+    for(size_t cap = 0; cap < len; cap++) {
+      TEST_ASSERT_EQUAL(0, Record_Write(&msg, (record_format)f, out, cap));
+    }
+  }
+}
+
+// The Old Path's Shape: one heap string grown key by key
+static size_t Heap_Json(const message_t *m, std::string *json) {
+  *json = "{\"text\":\"";
+  *json += (const char *)m->text;
+  *json += "\",\"TTL\":" + std::to_string(m->TTL) + ",\"identification\":" + std::to_string(m->identification);
+  *json += ",\"packetID\":" + std::to_string(m->packetID) + ",\"Path_Index\":" + std::to_string(m->Path_Index);
+  *json += ",\"Path_Length\":" + std::to_string(m->Path_Length) + ",\"Path_Array\":[";
+  for(int row = 0; row <= m->Path_Index; row++) {
+    *json += row ? ",[" : "[";
+    for(int i = 0; i < MAC_SIZE; i++) {
+      *json += (i ? "," : "") + std::to_string(m->Path_Array[row][i]);
+    }
+    *json += "]";
+  }
+  *json += "]}";
+  return json->size();
+}
+
+void test_bench() {
+  uint8_t out[RECORD_JSON_MAX];
+  volatile size_t sink = 0;
+  double ns[3];
+  size_t bytes[3];
+  for(int f = 0; f < 3; f++) {
+    std::string heap;
+    auto started = std::chrono::steady_clock::now();
+    for(int32_t i = 0; i < BENCH_RECORDS; i++) {
+      msg.packetID = i;
+      bytes[f] = f < 2 ? Record_Write(&msg, (record_format)f, out, sizeof(out)) : Heap_Json(&msg, &heap);
+      sink = sink + bytes[f];
+    }
+    ns[f] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count() / BENCH_RECORDS;
+  }
+  TEST_ASSERT_LESS_THAN(bytes[RECORD_JSON], bytes[RECORD_MSGPACK]);
+
+  char line[160];
+  snprintf(line, sizeof(line), "record.json_ns=%.1f record.json_bytes=%u record.msgpack_ns=%.1f record.msgpack_bytes=%u record.heap_json_ns=%.1f",
+           ns[0], (unsigned)bytes[0], ns[1], (unsigned)bytes[1], ns[2]);
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_json_exact);
+  RUN_TEST(test_json_payload_and_priority);
+  RUN_TEST(test_msgpack_map_shape);
+  RUN_TEST(test_never_truncates);
+  RUN_TEST(test_bench);
+  return UNITY_END();
+}
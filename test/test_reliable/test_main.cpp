@@ -0,0 +1,161 @@
+#include <string.h>
+#include <unity.h>
+#include "reliable.h"
+
+/* Sliding-window reliable delivery driven with synthetic microsecond
+   timestamps: the RFC 6298 estimator and its clamps, Karn's rule for
+   retransmitted packets, exponential back-off, window-full refusal and
+   giving up after maxTries */
+
+static reliable_t r;
+static uint32_t transmissions = 0;
+static uint32_t failures = 0;
+static int32_t failedID = 0;
+
+static const uint8_t node[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x05};
+static const uint8_t hop[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x03};
+
+static bool Count_Send(void *ctx, const uint8_t *nextHop, const uint8_t *frame, size_t len) {
+  (void)ctx;
+  (void)frame;
+  TEST_ASSERT_EQUAL_MEMORY(hop, nextHop, MAC_SIZE);
+  TEST_ASSERT_TRUE(len > 0);
+  transmissions++;
+  return true;
+}
+
+static void Record_Failure(void *ctx, const uint8_t *destination, int32_t packetID, uint32_t now) {
+  (void)ctx;
+  (void)now;
+  TEST_ASSERT_EQUAL_MEMORY(node, destination, MAC_SIZE);
+  failures++;
+  failedID = packetID;
+}
+
+static int32_t Send_To(const uint8_t *destination, uint32_t now) {
+  message_t packet;
+  memset(&packet, 0, sizeof(packet));
+  memcpy(packet.destination_mac, destination, MAC_SIZE);
+  strcpy((char *)packet.text, "cmd");
+  if(!Reliable_Send(&r, hop, &packet, NULL, now)) {
+    return 0;
+  }
+  return packet.packetID;
+}
+
+// One packet sent at now and acked rtt later; returns the ack time
+static uint32_t Round_Trip(uint32_t now, uint32_t rtt) {
+  int32_t id = Send_To(node, now);
+  TEST_ASSERT_NOT_EQUAL(0, id);
+  TEST_ASSERT_TRUE(Reliable_On_Ack(&r, node, id, now + rtt));
+  return now + rtt;
+}
+
+void setUp() {
+  transmissions = 0;
+  failures = 0;
+  Reliable_Init(&r, Count_Send, NULL, 100);
+  r.failed = Record_Failure;
+}
+void tearDown() {}
+
+void test_unknown_destination_uses_initial_rto() {
+  TEST_ASSERT_EQUAL_UINT32(RELIABLE_RTO_INITIAL_MS * 1000u, Reliable_RTO(&r, node));
+}
+
+void test_rfc6298_estimator() {
+  uint32_t now = Round_Trip(0, 100000); // SRTT 100 ms, RTTVAR 50 ms
+  TEST_ASSERT_EQUAL_UINT32(100000 + 4 * 50000, Reliable_RTO(&r, node));
+  Round_Trip(now, 60000); // RTTVAR (3 * 50 + 40) / 4 = 47.5, SRTT (7 * 100 + 60) / 8 = 95
+  TEST_ASSERT_EQUAL_UINT32(95000 + 4 * 47500, Reliable_RTO(&r, node));
+  TEST_ASSERT_EQUAL_UINT32(2, r.stats.rttSamples);
+}
+
+void test_rto_clamped() {
+  Round_Trip(0, 1000);
+  TEST_ASSERT_EQUAL_UINT32(RELIABLE_RTO_MIN_MS * 1000u, Reliable_RTO(&r, node));
+  Reliable_Init(&r, Count_Send, NULL, 100);
+  Round_Trip(0, RELIABLE_RTO_MAX_MS * 1000u);
+  TEST_ASSERT_EQUAL_UINT32(RELIABLE_RTO_MAX_MS * 1000u, Reliable_RTO(&r, node));
+}
+
+void test_karn_skips_retransmitted_samples() {
+  uint32_t now = Round_Trip(0, 100000);
+  uint32_t rto = Reliable_RTO(&r, node);
+  int32_t id = Send_To(node, now);
+  Reliable_Poll(&r, now + rto); // Retransmitted
+  TEST_ASSERT_EQUAL_UINT32(1, r.stats.retransmits);
+  TEST_ASSERT_TRUE(Reliable_On_Ack(&r, node, id, now + rto + 5000)); // Ambiguous: for which copy?
+  TEST_ASSERT_EQUAL_UINT32(1, r.stats.rttSamples);
+  TEST_ASSERT_EQUAL_UINT32(rto, Reliable_RTO(&r, node));
+}
+
+void test_retries_back_off_then_give_up() {
+  uint32_t rto = Reliable_RTO(&r, node);
+  int32_t id = Send_To(node, 0);
+  Reliable_Poll(&r, rto - 1);
+  TEST_ASSERT_EQUAL_UINT32(1, transmissions);
+  Reliable_Poll(&r, rto); // Second Try, Waits 2 x RTO
+  TEST_ASSERT_EQUAL_UINT32(2, transmissions);
+  Reliable_Poll(&r, rto + 2 * rto - 1);
+  TEST_ASSERT_EQUAL_UINT32(2, transmissions);
+  Reliable_Poll(&r, rto + 2 * rto); // Third Try, Waits 4 x RTO
+  TEST_ASSERT_EQUAL_UINT32(3, transmissions);
+  TEST_ASSERT_EQUAL_UINT32(0, failures);
+  Reliable_Poll(&r, 3 * rto + 4 * rto); // Out of Tries
+  TEST_ASSERT_EQUAL_UINT32(MAX_TRIES, transmissions);
+  TEST_ASSERT_EQUAL_UINT32(1, failures);
+  TEST_ASSERT_EQUAL_INT32(id, failedID);
+  TEST_ASSERT_EQUAL_UINT32(1, r.stats.failed);
+  TEST_ASSERT_FALSE(Reliable_On_Ack(&r, node, id, 8 * rto)); // Too Late: Nothing in Flight
+  TEST_ASSERT_EQUAL_UINT32(1, r.stats.duplicateAcks);
+}
+
+void test_window_full_refuses() {
+  int32_t first = 0;
+  for(int i = 0; i < RELIABLE_WINDOW; i++) {
+    int32_t id = Send_To(node, 0);
+    TEST_ASSERT_NOT_EQUAL(0, id);
+    first = i == 0 ? id : first;
+  }
+  TEST_ASSERT_FALSE(Reliable_Can_Send(&r, node));
+  TEST_ASSERT_EQUAL_INT32(0, Send_To(node, 0));
+  TEST_ASSERT_EQUAL_UINT32(RELIABLE_WINDOW, r.stats.sent);
+
+  TEST_ASSERT_TRUE(Reliable_On_Ack(&r, node, first, 1000));
+  TEST_ASSERT_TRUE(Reliable_Can_Send(&r, node));
+  TEST_ASSERT_NOT_EQUAL(0, Send_To(node, 1000));
+}
+
+void test_stop_and_wait() {
+  r.window = 1;
+  int32_t id = Send_To(node, 0);
+  TEST_ASSERT_EQUAL_INT32(0, Send_To(node, 0));
+  TEST_ASSERT_TRUE(Reliable_On_Ack(&r, node, id, 1000));
+  TEST_ASSERT_EQUAL_INT32(id + 1, Send_To(node, 1000)); // IDs Consecutive per Sender
+}
+
+void test_every_destination_busy_refuses_a_new_one() {
+  uint8_t destination[MAC_SIZE];
+  memcpy(destination, node, MAC_SIZE);
+  for(int i = 0; i < RELIABLE_PEERS; i++) {
+    destination[5] = (uint8_t)(0x40 + i);
+    TEST_ASSERT_NOT_EQUAL(0, Send_To(destination, 0));
+  }
+  destination[5] = 0x40 + RELIABLE_PEERS;
+  TEST_ASSERT_FALSE(Reliable_Can_Send(&r, destination));
+  TEST_ASSERT_EQUAL_INT32(0, Send_To(destination, 0));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_unknown_destination_uses_initial_rto);
+  RUN_TEST(test_rfc6298_estimator);
+  RUN_TEST(test_rto_clamped);
+  RUN_TEST(test_karn_skips_retransmitted_samples);
+  RUN_TEST(test_retries_back_off_then_give_up);
+  RUN_TEST(test_window_full_refuses);
+  RUN_TEST(test_stop_and_wait);
+  RUN_TEST(test_every_destination_busy_refuses_a_new_one);
+  return UNITY_END();
+}
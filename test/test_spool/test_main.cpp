@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "spool.h"
+
+/* Spool against the host file backend: batches replay in order, survive
+   a restart (Spool_Init over the same file), and the run is rebuilt
+   around a CRC-corrupt slot in the middle, across the ring's wrap, and
+   after a write torn between payload and header */
+
+#define SPOOL_TEST_PATH "test_spool.bin"
+#define MAX_DELIVERED (3 * SPOOL_SLOTS)
+
+static spool_storage_t storage;
+static uint32_t now = 0; // Only Moves Forward (the Replay Timer Outlives Spool_Init)
+static bool linkUp = true;
+static int delivered[MAX_DELIVERED];
+static int deliveredCount = 0;
+
+// Batch n is "batch <n>" padded with n % 50 dots, so lengths differ
+static size_t Make_Batch(int n, uint8_t *out) {
+  int len = snprintf((char *)out, UPLINK_BATCH_BYTES, "batch %d ", n);
+  memset(out + len, '.', n % 50);
+  return (size_t)len + n % 50;
+}
+
+static bool Record_Delivery(const uint8_t *body, size_t len) {
+  if(!linkUp) {
+    return false;
+  }
+  uint8_t expected[UPLINK_BATCH_BYTES];
+  int n = -1;
+  sscanf((const char *)body, "batch %d", &n);
+  TEST_ASSERT_TRUE(n >= 0 && deliveredCount < MAX_DELIVERED);
+  TEST_ASSERT_EQUAL_UINT32(Make_Batch(n, expected), len);
+  TEST_ASSERT_EQUAL_MEMORY(expected, body, len);
+  delivered[deliveredCount++] = n;
+  return true;
+}
+
+static void Store(int first, int count) {
+  uint8_t body[UPLINK_BATCH_BYTES];
+  for(int n = first; n < first + count; n++) {
+    TEST_ASSERT_TRUE(Spool_Store(body, Make_Batch(n, body)));
+  }
+}
+
+static void Drain_All() {
+  for(int guard = 0; Spool_Get_Stats()->depth > 0 && guard < MAX_DELIVERED; guard++) {
+    now += SPOOL_REPLAY_INTERVAL_MS;
+    Spool_Drain(now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, Spool_Get_Stats()->depth);
+}
+
+// Delivered exactly first, first + 1, ... last
+static void Expect_Delivered(int first, int last) {
+  TEST_ASSERT_EQUAL_INT(last - first + 1, deliveredCount);
+  for(int i = 0; i < deliveredCount; i++) {
+    TEST_ASSERT_EQUAL_INT(first + i, delivered[i]);
+  }
+}
+
+static void Restart() {
+  TEST_ASSERT_TRUE(Spool_Storage_Open(&storage, SPOOL_TEST_PATH, SPOOL_STORAGE_SIZE));
+  TEST_ASSERT_TRUE(Spool_Init(&storage, Record_Delivery));
+}
+
+static uint32_t Slot_Of(uint32_t seq) {
+  return (seq % SPOOL_SLOTS) * SPOOL_SLOT_SIZE;
+}
+
+void setUp() {
+  remove(SPOOL_TEST_PATH);
+  linkUp = true;
+  deliveredCount = 0;
+  Restart();
+}
+void tearDown() {
+  remove(SPOOL_TEST_PATH);
+}
+
+void test_send_bypasses_empty_spool_and_keeps_order() {
+  uint8_t body[UPLINK_BATCH_BYTES];
+  TEST_ASSERT_TRUE(Spool_Send(body, Make_Batch(0, body))); // Straight Through
+  linkUp = false;
+  TEST_ASSERT_TRUE(Spool_Send(body, Make_Batch(1, body)));
+  linkUp = true;
+  TEST_ASSERT_TRUE(Spool_Send(body, Make_Batch(2, body))); // Waits behind 1
+  TEST_ASSERT_EQUAL_UINT32(2, Spool_Get_Stats()->depth);
+  Drain_All();
+  Expect_Delivered(0, 2);
+}
+
+void test_failed_replay_backs_off() {
+  Store(0, 2);
+  linkUp = false;
+  now += SPOOL_REPLAY_INTERVAL_MS;
+  Spool_Drain(now);
+  linkUp = true;
+  Spool_Drain(now + SPOOL_RETRY_MS - 1);
+  TEST_ASSERT_EQUAL_INT(0, deliveredCount);
+  now += SPOOL_RETRY_MS;
+  Drain_All();
+  Expect_Delivered(0, 1);
+}
+
+void test_restart_replays_pending_in_order() {
+  Store(0, 6);
+  now += SPOOL_REPLAY_INTERVAL_MS;
+  Spool_Drain(now); // 0 Replayed and Marked Consumed
+  Restart();
+  TEST_ASSERT_EQUAL_UINT32(5, Spool_Get_Stats()->depth);
+  Drain_All();
+  Expect_Delivered(0, 5);
+}
+
+void test_crc_corrupt_slot_in_the_middle() {
+  Store(0, 5);
+  uint8_t flipped = '#';
+  TEST_ASSERT_TRUE(storage.write(storage.ctx, Slot_Of(2) + SPOOL_HEADER_SIZE + 1, &flipped, 1));
+  Restart();
+  TEST_ASSERT_EQUAL_UINT32(4, Spool_Get_Stats()->depth);
+  Drain_All();
+  TEST_ASSERT_EQUAL_INT(4, deliveredCount);
+  static const int expected[] = {0, 1, 3, 4};
+  TEST_ASSERT_EQUAL_INT_ARRAY(expected, delivered, 4);
+}
+
+void test_wrap_around_overwrites_oldest() {
+  Store(0, SPOOL_SLOTS + 5);
+  TEST_ASSERT_EQUAL_UINT32(5, Spool_Get_Stats()->overwritten);
+  TEST_ASSERT_EQUAL_UINT32(SPOOL_SLOTS, Spool_Get_Stats()->depth);
+  Restart(); // The Newest Generation Wins Every Slot
+  TEST_ASSERT_EQUAL_UINT32(SPOOL_SLOTS, Spool_Get_Stats()->depth);
+  Drain_All();
+  Expect_Delivered(5, SPOOL_SLOTS + 4);
+}
+
+void test_wrap_after_partial_drain_with_corrupt_slot() {
+  Store(0, SPOOL_SLOTS);
+  for(int i = 0; i < 10; i++) {
+    now += SPOOL_REPLAY_INTERVAL_MS;
+    Spool_Drain(now);
+  }
+  Store(SPOOL_SLOTS, 8); // Reuses Slots 0..7
+  uint8_t flipped = '#';
+  TEST_ASSERT_TRUE(storage.write(storage.ctx, Slot_Of(SPOOL_SLOTS + 3) + SPOOL_HEADER_SIZE, &flipped, 1));
+  Restart();
+  TEST_ASSERT_EQUAL_UINT32(SPOOL_SLOTS - 10 + 8 - 1, Spool_Get_Stats()->depth);
+  deliveredCount = 0;
+  Drain_All();
+  TEST_ASSERT_EQUAL_INT(SPOOL_SLOTS - 10 + 8 - 1, deliveredCount);
+  int expect = 10;
+  for(int i = 0; i < deliveredCount; i++, expect++) {
+    if(expect == SPOOL_SLOTS + 3) {
+      expect++; // Corrupt Slot Skipped
+    }
+    TEST_ASSERT_EQUAL_INT(expect, delivered[i]);
+  }
+}
+
+void test_init_after_torn_write() {
+  Store(0, SPOOL_SLOTS);
+  // Power Lost after the Payload of Batch SPOOL_SLOTS but before its Header:
+  // Slot 0 keeps Batch 0's Header over the New Payload
+  uint8_t body[UPLINK_BATCH_BYTES];
+  size_t len = Make_Batch(SPOOL_SLOTS, body);
+  TEST_ASSERT_TRUE(storage.write(storage.ctx, Slot_Of(SPOOL_SLOTS) + SPOOL_HEADER_SIZE, body, len));
+  Restart();
+  TEST_ASSERT_EQUAL_UINT32(SPOOL_SLOTS - 1, Spool_Get_Stats()->depth);
+
+  Store(SPOOL_SLOTS, 2); // Appending Resumes after the Newest Intact Batch; the Second Fills the Ring
+  TEST_ASSERT_EQUAL_UINT32(1, Spool_Get_Stats()->overwritten);
+  Restart();
+  Drain_All();
+  Expect_Delivered(2, SPOOL_SLOTS + 1);
+}
+
+void test_half_written_header_is_ignored() {
+  Store(0, 3);
+  uint8_t body[UPLINK_BATCH_BYTES];
+  size_t len = Make_Batch(3, body);
+  uint8_t garbage[SPOOL_HEADER_SIZE / 2];
+  memset(garbage, 0xA5, sizeof(garbage));
+  TEST_ASSERT_TRUE(storage.write(storage.ctx, Slot_Of(3) + SPOOL_HEADER_SIZE, body, len));
+  TEST_ASSERT_TRUE(storage.write(storage.ctx, Slot_Of(3), garbage, sizeof(garbage)));
+  Restart();
+  TEST_ASSERT_EQUAL_UINT32(3, Spool_Get_Stats()->depth);
+  Drain_All();
+  Expect_Delivered(0, 2);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_send_bypasses_empty_spool_and_keeps_order);
+  RUN_TEST(test_failed_replay_backs_off);
+  RUN_TEST(test_restart_replays_pending_in_order);
+  RUN_TEST(test_crc_corrupt_slot_in_the_middle);
+  RUN_TEST(test_wrap_around_overwrites_oldest);
+  RUN_TEST(test_wrap_after_partial_drain_with_corrupt_slot);
+  RUN_TEST(test_init_after_torn_write);
+  RUN_TEST(test_half_written_header_is_ignored);
+  return UNITY_END();
+}
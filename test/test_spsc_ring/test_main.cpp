@@ -0,0 +1,103 @@
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include <unity.h>
+#include "spsc_ring.h"
+
+/* SpscRing: ordering and both overflow policies on one thread, then one
+   producer and one consumer thread passing a counted sequence (the
+   receive callback -> loop() hand-off), reported as items/s */
+
+#define THREAD_ITEMS 2000000u
+
+void setUp() {}
+void tearDown() {}
+
+void test_fifo_order_and_wrap() {
+  SpscRing<uint32_t, 8> ring;
+  uint32_t out;
+  for(uint32_t round = 0; round < 5; round++) { // Indexes Wrap past N
+    for(uint32_t i = 0; i < 6; i++) {
+      TEST_ASSERT_TRUE(ring.Push(round * 10 + i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(6, ring.Size());
+    for(uint32_t i = 0; i < 6; i++) {
+      TEST_ASSERT_TRUE(ring.Pop(out));
+      TEST_ASSERT_EQUAL_UINT32(round * 10 + i, out);
+    }
+  }
+  TEST_ASSERT_TRUE(ring.Empty());
+  TEST_ASSERT_FALSE(ring.Pop(out));
+}
+
+void test_full_drops_newest() {
+  SpscRing<uint32_t, 4> ring;
+  for(uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(ring.Push(i));
+  }
+  TEST_ASSERT_FALSE(ring.Push(99));
+  TEST_ASSERT_EQUAL_UINT32(1, ring.Dropped());
+  uint32_t out;
+  for(uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(ring.Pop(out));
+    TEST_ASSERT_EQUAL_UINT32(i, out);
+  }
+}
+
+void test_full_drops_oldest() {
+  SpscRing<uint32_t, 4, RING_DROP_OLDEST> ring;
+  for(uint32_t i = 0; i < 6; i++) {
+    TEST_ASSERT_TRUE(ring.Push(i));
+  }
+  TEST_ASSERT_EQUAL_UINT32(2, ring.Dropped());
+  uint32_t out;
+  for(uint32_t i = 2; i < 6; i++) {
+    TEST_ASSERT_TRUE(ring.Pop(out));
+    TEST_ASSERT_EQUAL_UINT32(i, out);
+  }
+  TEST_ASSERT_FALSE(ring.Pop(out));
+}
+
+static SpscRing<uint32_t, 256> threadRing;
+
+void test_two_threads_in_order_no_loss() {
+  uint32_t retries = 0;
+  auto started = std::chrono::steady_clock::now();
+  std::thread producer([&retries]() {
+    for(uint32_t i = 0; i < THREAD_ITEMS; i++) {
+      while(!threadRing.Push(i)) { // Full: the Consumer Catches up
+        retries++;
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0, misordered = 0, value;
+  while(expected < THREAD_ITEMS) {
+    if(!threadRing.Pop(value)) {
+      std::this_thread::yield(); // Empty: let the Producer Run (the Host may have One Core)
+      continue;
+    }
+    misordered += value != expected;
+    expected++;
+  }
+  producer.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  TEST_ASSERT_EQUAL_UINT32(0, misordered);
+  TEST_ASSERT_TRUE(threadRing.Empty());
+  TEST_ASSERT_EQUAL_UINT32(retries, threadRing.Dropped()); // Every Refused Push was Retried
+
+  char line[96];
+  snprintf(line, sizeof(line), "spsc.items_per_s=%.0f spsc.full_retries=%u", THREAD_ITEMS / seconds, (unsigned)retries);
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fifo_order_and_wrap);
+  RUN_TEST(test_full_drops_newest);
+  RUN_TEST(test_full_drops_oldest);
+  RUN_TEST(test_two_threads_in_order_no_loss);
+  return UNITY_END();
+}
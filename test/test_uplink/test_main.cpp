@@ -0,0 +1,196 @@
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unity.h>
+#include "hal.h"
+#include "uplink.h"
+
+/* Uplink batching: the flush reasons on a recording transport, then the
+   real host POST path against a stand-in HTTP server on loopback, which
+   must see one kept-alive connection carrying every record */
+
+#define RECORDS 100
+
+static std::string bodies; // Recording Transport: every Batch Body Sent
+static uint32_t sends = 0;
+
+static bool Record_Send(const uint8_t *body, size_t len) {
+  bodies.append((const char *)body, len);
+  sends++;
+  return true;
+}
+
+static size_t Count(const std::string &haystack, const char *needle) {
+  size_t count = 0;
+  for(size_t at = haystack.find(needle); at != std::string::npos; at = haystack.find(needle, at + 1)) {
+    count++;
+  }
+  return count;
+}
+
+static void Make_Message(message_t *msg, int32_t packetID) {
+  memset(msg, 0, sizeof(*msg));
+  snprintf((char *)msg->text, sizeof(msg->text), "Reading %d", (int)packetID);
+  msg->TTL = 5;
+  msg->identification = 2;
+  msg->packetID = packetID;
+  msg->source_mac[5] = 0x02;
+}
+
+void setUp() {
+  bodies.clear();
+  sends = 0;
+  Uplink_Init(Record_Send, RECORD_JSON);
+}
+void tearDown() {}
+
+void test_count_flush() {
+  message_t msg;
+  for(int32_t i = 0; i < UPLINK_BATCH_RECORDS; i++) {
+    Make_Message(&msg, i);
+    TEST_ASSERT_TRUE(Uplink_Add_Message(&msg, 0));
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, sends);
+  TEST_ASSERT_EQUAL_UINT32(1, Uplink_Get_Stats()->flushes[UPLINK_FLUSH_COUNT]);
+  TEST_ASSERT_EQUAL(UPLINK_BATCH_RECORDS, Count(bodies, "\"packetID\":"));
+  TEST_ASSERT_EQUAL('[', bodies[0]);
+  TEST_ASSERT_EQUAL(']', bodies[bodies.size() - 1]);
+}
+
+void test_deadline_flush() {
+  message_t msg;
+  Make_Message(&msg, 1);
+  TEST_ASSERT_TRUE(Uplink_Add_Message(&msg, 1000));
+  Uplink_Poll(1000 + UPLINK_MAX_LATENCY_MS - 1);
+  TEST_ASSERT_EQUAL_UINT32(0, sends);
+  Uplink_Poll(1000 + UPLINK_MAX_LATENCY_MS);
+  TEST_ASSERT_EQUAL_UINT32(1, sends);
+  TEST_ASSERT_EQUAL_UINT32(1, Uplink_Get_Stats()->flushes[UPLINK_FLUSH_DEADLINE]);
+}
+
+void test_alarm_flushes_first() {
+  message_t msg;
+  Make_Message(&msg, 1);
+  msg.priority = PRIORITY_ALARM;
+  TEST_ASSERT_TRUE(Uplink_Add_Message(&msg, 1000));
+  Uplink_Poll(1000 + UPLINK_ALARM_LATENCY_MS);
+  TEST_ASSERT_EQUAL_UINT32(1, sends);
+  TEST_ASSERT_EQUAL_UINT32(1, Uplink_Get_Stats()->flushes[UPLINK_FLUSH_ALARM]);
+}
+
+/* Stand-in Server: answers every whole request with an empty 200 */
+static std::atomic<bool> serverStop(false);
+static std::atomic<uint32_t> serverConnections(0);
+static std::atomic<uint32_t> serverRequests(0);
+static std::string serverBodies;
+
+static void Server_Run(int listenFd) {
+  int client = -1;
+  std::string pending;
+  char buffer[16384];
+  while(!serverStop) {
+    struct pollfd fds[2] = {{listenFd, POLLIN, 0}, {client, POLLIN, 0}};
+    if(poll(fds, client >= 0 ? 2 : 1, 10) <= 0) {
+      continue;
+    }
+    if(fds[0].revents & POLLIN) {
+      if(client >= 0) {
+        close(client);
+      }
+      client = accept(listenFd, NULL, NULL);
+      serverConnections++;
+      pending.clear();
+      continue;
+    }
+    ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+    if(n <= 0) {
+      close(client);
+      client = -1;
+      continue;
+    }
+    pending.append(buffer, (size_t)n);
+    for(;;) {
+      size_t head = pending.find("\r\n\r\n");
+      size_t field = pending.find("Content-Length:");
+      if(head == std::string::npos || field == std::string::npos || field > head) {
+        break;
+      }
+      size_t length = strtoul(pending.c_str() + field + 15, NULL, 10);
+      if(pending.size() < head + 4 + length) {
+        break;
+      }
+      serverBodies.append(pending, head + 4, length);
+      pending.erase(0, head + 4 + length);
+      serverRequests++;
+      static const char ok[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+      send(client, ok, sizeof(ok) - 1, MSG_NOSIGNAL);
+    }
+  }
+  if(client >= 0) {
+    close(client);
+  }
+}
+
+static char serverUrl[64];
+
+static bool Post_Send(const uint8_t *body, size_t len) {
+  int status = Hal_Http_Post(serverUrl, Uplink_Content_Type(), NULL, body, len);
+  return status >= 200 && status < 300;
+}
+
+void test_stand_in_server_one_connection() {
+  int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addrLen = sizeof(addr);
+  TEST_ASSERT_EQUAL(0, bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)));
+  TEST_ASSERT_EQUAL(0, listen(listenFd, 4));
+  getsockname(listenFd, (struct sockaddr *)&addr, &addrLen);
+  snprintf(serverUrl, sizeof(serverUrl), "http://127.0.0.1:%u/receive_data", (unsigned)ntohs(addr.sin_port));
+  std::thread server(Server_Run, listenFd);
+
+  Hal_Native_Http_Sink(false);
+  Uplink_Init(Post_Send, RECORD_JSON);
+  message_t msg;
+  auto started = std::chrono::steady_clock::now();
+  for(int32_t i = 0; i < RECORDS; i++) {
+    Make_Message(&msg, i);
+    TEST_ASSERT_TRUE(Uplink_Add_Message(&msg, (uint32_t)i));
+  }
+  Uplink_Flush(UPLINK_FLUSH_FORCED);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  Hal_Native_Http_Sink(true);
+
+  serverStop = true;
+  server.join();
+  close(listenFd);
+
+  const uplink_stats_t *stats = Uplink_Get_Stats();
+  TEST_ASSERT_EQUAL_UINT32(0, stats->failures);
+  TEST_ASSERT_EQUAL_UINT32(stats->batches, serverRequests.load());
+  TEST_ASSERT_EQUAL_UINT32(1, serverConnections.load()); // Kept Alive across every Batch
+  TEST_ASSERT_EQUAL(RECORDS, Count(serverBodies, "\"packetID\":"));
+
+  char line[128];
+  snprintf(line, sizeof(line), "uplink.records=%u uplink.posts=%u uplink.connections=%u uplink.records_per_s=%.0f", RECORDS,
+           (unsigned)serverRequests.load(), (unsigned)serverConnections.load(), RECORDS / seconds);
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_count_flush);
+  RUN_TEST(test_deadline_flush);
+  RUN_TEST(test_alarm_flushes_first);
+  RUN_TEST(test_stand_in_server_one_connection);
+  return UNITY_END();
+}
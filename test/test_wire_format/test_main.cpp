@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "wire_format.h"
+
+/* Compact wire format: round trips at every path length, optional fields,
+   the legacy raw struct, and frames whose header would walk off the path.
+   Reports bytes per frame against the WIRE_LEGACY_SIZE every frame used to be */
+
+static const uint8_t gateway[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+static const uint8_t sensor[MAC_SIZE] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x02};
+
+// A data packet that has crossed hops nodes, with textLen bytes of text
+static void Make_Message(message_t *msg, uint8_t hops, size_t textLen) {
+  memset(msg, 0, sizeof(*msg));
+  for(size_t i = 0; i < textLen; i++) {
+    msg->text[i] = (unsigned char)('a' + i % 26);
+  }
+  msg->TTL = 7;
+  msg->identification = 2;
+  memcpy(msg->destination_mac, gateway, MAC_SIZE);
+  memcpy(msg->source_mac, sensor, MAC_SIZE);
+  msg->packetID = 0x12345678;
+  for(uint8_t i = 0; i < hops; i++) {
+    memcpy(msg->Path_Array[i], sensor, MAC_SIZE);
+    msg->Path_Array[i][MAC_SIZE - 1] = (uint8_t)(0x10 + i);
+  }
+  msg->Path_Index = hops < MAX_NODES ? hops : MAX_NODES - 1; // MAX_NODES would Index Past Path_Array
+  msg->Path_Length = hops;
+  msg->Path_Exist = hops > 0;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_round_trip_every_hop_count() {
+  static const size_t textLens[] = {0, 20, WIRE_TEXT_MAX};
+  uint8_t frame[ESPNOW_MTU];
+  char line[96];
+  for(uint8_t hops = 0; hops <= MAX_NODES; hops++) {
+    for(size_t t = 0; t < sizeof(textLens) / sizeof(textLens[0]); t++) {
+      message_t msg, decoded;
+      Make_Message(&msg, hops, textLens[t]);
+      size_t len = Wire_Encode(&msg, frame, sizeof(frame));
+      TEST_ASSERT_EQUAL(WIRE_HEADER_SIZE + hops * MAC_SIZE + 1 + textLens[t], len);
+      TEST_ASSERT_LESS_OR_EQUAL(WIRE_MAX_FRAME, len);
+      TEST_ASSERT_TRUE(Wire_Decode(frame, len, &decoded));
+      TEST_ASSERT_EQUAL_MEMORY(&msg, &decoded, sizeof(msg));
+    }
+    snprintf(line, sizeof(line), "wire.hops=%u wire.bytes=%u wire.legacy_bytes=%u", (unsigned)hops,
+             (unsigned)(WIRE_HEADER_SIZE + hops * MAC_SIZE + 1 + 20), (unsigned)WIRE_LEGACY_SIZE);
+    TEST_MESSAGE(line); // 20 Byte Reading
+  }
+}
+
+void test_optional_fields_round_trip() {
+  uint8_t frame[ESPNOW_MTU];
+  message_t msg, decoded;
+  Make_Message(&msg, 3, 10);
+  msg.Data_Ack = true;
+  msg.ackID = -42;
+  msg.priority = PRIORITY_ALARM;
+  msg.captured = 987654;
+  size_t len = Wire_Encode(&msg, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL(WIRE_HEADER_SIZE + 3 * MAC_SIZE + 1 + 10 + 4 + 4, len);
+  TEST_ASSERT_TRUE(Wire_Decode(frame, len, &decoded));
+  TEST_ASSERT_EQUAL_MEMORY(&msg, &decoded, sizeof(msg));
+}
+
+void test_encode_refuses_small_buffer() {
+  uint8_t frame[ESPNOW_MTU];
+  message_t msg;
+  Make_Message(&msg, 4, 30);
+  size_t len = Wire_Encode(&msg, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL(0, Wire_Encode(&msg, frame, len - 1));
+}
+
+void test_truncated_frame_rejected() {
+  uint8_t frame[ESPNOW_MTU];
+  message_t msg, decoded;
+  Make_Message(&msg, 5, 40);
+  size_t len = Wire_Encode(&msg, frame, sizeof(frame));
+  for(size_t cut = 0; cut < len; cut++) {
+    TEST_ASSERT_FALSE(Wire_Decode(frame, cut, &decoded));
+  }
+}
+
+void test_truncated_optional_fields_rejected() {
+  uint8_t frame[ESPNOW_MTU];
+  message_t msg, decoded;
+  Make_Message(&msg, 2, 12);
+  msg.Data_Ack = true;
+  msg.ackID = 77;
+  msg.captured = 123456;
+  size_t len = Wire_Encode(&msg, frame, sizeof(frame));
+  for(size_t cut = len - 8; cut < len; cut++) { // Text Intact, Flagged ackID/captured Short or Missing
+    TEST_ASSERT_FALSE(Wire_Decode(frame, cut, &decoded));
+  }
+  TEST_ASSERT_TRUE(Wire_Decode(frame, len, &decoded));
+}
+
+void test_legacy_struct_decodes() {
+  message_t msg, decoded;
+  Make_Message(&msg, 2, 12);
+  uint8_t frame[WIRE_LEGACY_SIZE];
+  memcpy(frame, &msg, WIRE_LEGACY_SIZE);
+  TEST_ASSERT_TRUE(Wire_Decode(frame, sizeof(frame), &decoded));
+  TEST_ASSERT_EQUAL_STRING((const char *)msg.text, (const char *)decoded.text);
+  TEST_ASSERT_EQUAL_INT32(msg.packetID, decoded.packetID);
+  TEST_ASSERT_EQUAL_MEMORY(msg.Path_Array, decoded.Path_Array, sizeof(msg.Path_Array));
+  TEST_ASSERT_EQUAL_UINT8(PRIORITY_NORMAL, decoded.priority);
+}
+
+void test_path_index_past_path_rejected() {
+  uint8_t frame[ESPNOW_MTU];
+  message_t msg, decoded;
+  Make_Message(&msg, 3, 8);
+  size_t len = Wire_Encode(&msg, frame, sizeof(frame));
+
+  frame[20] = 4; // Path_Index beyond the 3 Rows Sent
+  TEST_ASSERT_FALSE(Wire_Decode(frame, len, &decoded));
+  frame[20] = 3;
+  frame[21] = 4; // Path_Length beyond them
+  TEST_ASSERT_FALSE(Wire_Decode(frame, len, &decoded));
+  frame[21] = 3;
+  TEST_ASSERT_TRUE(Wire_Decode(frame, len, &decoded));
+
+  Make_Message(&msg, MAX_NODES, 8);
+  len = Wire_Encode(&msg, frame, sizeof(frame));
+  frame[20] = MAX_NODES; // Every Row Sent, Index Past the Last
+  TEST_ASSERT_FALSE(Wire_Decode(frame, len, &decoded));
+
+  Make_Message(&msg, MAX_NODES, 8);
+  msg.Path_Index = MAX_NODES; // Past the Last Row
+  uint8_t legacy[WIRE_LEGACY_SIZE];
+  memcpy(legacy, &msg, WIRE_LEGACY_SIZE);
+  TEST_ASSERT_FALSE(Wire_Decode(legacy, sizeof(legacy), &decoded));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_every_hop_count);
+  RUN_TEST(test_optional_fields_round_trip);
+  RUN_TEST(test_encode_refuses_small_buffer);
+  RUN_TEST(test_truncated_frame_rejected);
+  RUN_TEST(test_truncated_optional_fields_rejected);
+  RUN_TEST(test_legacy_struct_decodes);
+  RUN_TEST(test_path_index_past_path_rejected);
+  return UNITY_END();
+}